@@ -1749,6 +1749,47 @@ static MDEV RAM_PAGE    =   {TRUE,  FALSE,  NULL};  /* this makes a page RAM
 static MDEV EMPTY_PAGE  =   {FALSE, TRUE,   NULL};  /* this is non-existing memory  */
 static MDEV mmu_table[MAXMEMORY >> LOG2PAGESIZE];
 
+/* Host pointers to the pages of M[] which can be accessed directly: RAM and ROM for reads,
+   RAM only for writes. NULL for empty and memory mapped I/O pages, which take the slow path.
+   mmu_rd_ptr/mmu_wr_ptr cover all of memory and follow mmu_table (see mmu_set_page).
+   cpu_rd_ptr/cpu_wr_ptr cover the 64KB the 8080/Z80 currently sees, with bank select and
+   common memory applied; they are rebuilt by mmu_remap when the bank changes and whenever
+   the simulation starts. */
+static uint8 *mmu_rd_ptr[MAXMEMORY >> LOG2PAGESIZE];
+static uint8 *mmu_wr_ptr[MAXMEMORY >> LOG2PAGESIZE];
+static uint8 *cpu_rd_ptr[MAXBANKSIZE >> LOG2PAGESIZE];
+static uint8 *cpu_wr_ptr[MAXBANKSIZE >> LOG2PAGESIZE];
+static int32 cpu_ptr_bank = -1;                 /* bank cpu_rd_ptr/cpu_wr_ptr were built for */
+
+/* page of memory seen by the 8080/Z80 at page 'vpage' of its address space */
+static uint32 mmu_visible_page(const uint32 vpage) {
+    uint32 addr = vpage << LOG2PAGESIZE;
+    if ((cpu_unit.flags & UNIT_CPU_BANKED) && (addr < common))
+        addr |= bankSelect << MAXBANKSIZELOG2;
+    return addr >> LOG2PAGESIZE;
+}
+
+static void mmu_remap(void) {
+    uint32 vpage, page;
+    cpu_ptr_bank = bankSelect;
+    for (vpage = 0; vpage < (MAXBANKSIZE >> LOG2PAGESIZE); vpage++) {
+        page = mmu_visible_page(vpage);
+        cpu_rd_ptr[vpage] = mmu_rd_ptr[page];
+        cpu_wr_ptr[vpage] = mmu_wr_ptr[page];
+    }
+}
+
+static void mmu_set_page(const uint32 page, const MDEV m) {
+    const uint32 vpage = page & ((MAXBANKSIZE >> LOG2PAGESIZE) - 1);
+    mmu_table[page] = m;
+    mmu_rd_ptr[page] = (m.routine || m.isEmpty) ? NULL : &M[page << LOG2PAGESIZE];
+    mmu_wr_ptr[page] = (m.isRAM && (m.routine == NULL)) ? &M[page << LOG2PAGESIZE] : NULL;
+    if (mmu_visible_page(vpage) == page) {  /* currently visible to 8080/Z80? */
+        cpu_rd_ptr[vpage] = mmu_rd_ptr[page];
+        cpu_wr_ptr[vpage] = mmu_wr_ptr[page];
+    }
+}
+
 /* Memory and I/O Resource Mapping and Unmapping routine. */
 uint32 sim_map_resource(uint32 baseaddr, uint32 size, uint32 resource_type,
         int32 (*routine)(const int32, const int32, const int32), uint8 unmap) {
@@ -1766,16 +1807,17 @@ uint32 sim_map_resource(uint32 baseaddr, uint32 size, uint32 resource_type,
                 if (mmu_table[page].routine == routine) {   /* unmap only if it was mapped */
                     if (MEMORYSIZE < MAXBANKSIZE)
                         if (addr < MEMORYSIZE)
-                            mmu_table[page] = RAM_PAGE;
+                            mmu_set_page(page, RAM_PAGE);
                         else
-                            mmu_table[page] = EMPTY_PAGE;
+                            mmu_set_page(page, EMPTY_PAGE);
                     else
-                        mmu_table[page] = RAM_PAGE;
+                        mmu_set_page(page, RAM_PAGE);
                 }
             }
             else {
-                mmu_table[page] = ROM_PAGE;
-                mmu_table[page].routine = routine;
+                MDEV m = ROM_PAGE;
+                m.routine = routine;
+                mmu_set_page(page, m);
             }
         }
     } else if (resource_type == RESOURCE_TYPE_IO) {
@@ -1801,8 +1843,14 @@ uint32 sim_map_resource(uint32 baseaddr, uint32 size, uint32 resource_type,
 
 static void PutBYTE(register uint32 Addr, const register uint32 Value) {
     MDEV m;
+    uint8 *p;
 
     Addr &= ADDRMASK;   /* registers are NOT guaranteed to be always 16-bit values */
+    p = cpu_wr_ptr[Addr >> LOG2PAGESIZE];
+    if (p) {            /* plain RAM */
+        p[Addr & (PAGESIZE - 1)] = Value;
+        return;
+    }
     if ((cpu_unit.flags & UNIT_CPU_BANKED) && (Addr < common))
         Addr |= bankSelect << MAXBANKSIZELOG2;
     m = mmu_table[Addr >> LOG2PAGESIZE];
@@ -1823,6 +1871,10 @@ void PutBYTEExtended(register uint32 Addr, const register uint32 Value) {
     MDEV m;
 
     Addr &= ADDRMASKEXTENDED;
+    if (mmu_wr_ptr[Addr >> LOG2PAGESIZE]) {
+        M[Addr] = Value;
+        return;
+    }
     m = mmu_table[Addr >> LOG2PAGESIZE];
 
     if (m.isRAM)
@@ -1844,8 +1896,12 @@ static void PutWORD(register uint32 Addr, const register uint32 Value) {
 
 static uint32 GetBYTE(register uint32 Addr) {
     MDEV m;
+    const uint8 *p;
 
     Addr &= ADDRMASK;   /* registers are NOT guaranteed to be always 16-bit values */
+    p = cpu_rd_ptr[Addr >> LOG2PAGESIZE];
+    if (p)              /* plain RAM or ROM */
+        return p[Addr & (PAGESIZE - 1)];
     if ((cpu_unit.flags & UNIT_CPU_BANKED) && (Addr < common))
         Addr |= bankSelect << MAXBANKSIZELOG2;
     m = mmu_table[Addr >> LOG2PAGESIZE];
@@ -1866,6 +1922,8 @@ uint32 GetBYTEExtended(register uint32 Addr) {
     MDEV m;
 
     Addr &= ADDRMASKEXTENDED;
+    if (mmu_rd_ptr[Addr >> LOG2PAGESIZE])
+        return M[Addr];
     m = mmu_table[Addr >> LOG2PAGESIZE];
 
     if (m.isRAM)
@@ -1886,6 +1944,8 @@ int32 getBankSelect(void) {
 
 void setBankSelect(const int32 b) {
     bankSelect = b;
+    if (b != cpu_ptr_bank)
+        mmu_remap();
 }
 
 uint32 getCommon(void) {
@@ -2001,6 +2061,7 @@ int32 switch_cpu_now = TRUE; /* hharte */
 
 t_stat sim_instr (void) {
     t_stat result;
+    mmu_remap();    /* banking or common may have been changed from the console */
     if (chiptype == CHIP_TYPE_M68K) {
         result = sim_instr_m68k();
     } else if ((chiptype == CHIP_TYPE_8086) || (cpu_unit.flags & UNIT_CPU_MMU))
@@ -6255,22 +6316,26 @@ t_stat install_bootrom(const int32 bootrom[], const int32 size, const int32 addr
         return SCPE_IERR;
     for (i = 0; i < size; i++) {
         if (makeROM && ((i & (PAGESIZE - 1)) == 0))
-            mmu_table[(i + addr) >> LOG2PAGESIZE] = ROM_PAGE;
+            mmu_set_page((i + addr) >> LOG2PAGESIZE, ROM_PAGE);
         M[i + addr] = bootrom[i] & 0xff;
     }
     return SCPE_OK;
 }
 
+/* physical address of a console address (bank in the upper bits) for the 8080/Z80 */
+static uint32 cpu_console_address(const t_addr addr) {
+    uint32 result = addr & ADDRMASK;
+    if ((cpu_unit.flags & UNIT_CPU_BANKED) && (result < common))
+        result |= ((addr >> MAXBANKSIZELOG2) & BANKMASK) << MAXBANKSIZELOG2;
+    return result;
+}
+
 /* memory examine */
 static t_stat cpu_ex(t_value *vptr, t_addr addr, UNIT *uptr, int32 sw) {
     switch (chiptype) {
         case CHIP_TYPE_8080:
-        case CHIP_TYPE_Z80: {
-            const int32 oldBankSelect = getBankSelect();
-            setBankSelect((addr >> MAXBANKSIZELOG2) & BANKMASK);
-            *vptr = GetBYTE(addr & ADDRMASK);
-            setBankSelect(oldBankSelect);
-        }
+        case CHIP_TYPE_Z80:
+            *vptr = GetBYTEExtended(cpu_console_address(addr));
             break;
 
         case CHIP_TYPE_8086:
@@ -6292,13 +6357,8 @@ static t_stat cpu_ex(t_value *vptr, t_addr addr, UNIT *uptr, int32 sw) {
 static t_stat cpu_dep(t_value val, t_addr addr, UNIT *uptr, int32 sw) {
     switch (chiptype) {
         case CHIP_TYPE_8080:
-        case CHIP_TYPE_Z80: {
-            const int32 oldBankSelect = getBankSelect();
-            setBankSelect((addr >> MAXBANKSIZELOG2) & BANKMASK);
-            PutBYTE(addr & ADDRMASK, val);
-            setBankSelect(oldBankSelect);
-
-        }
+        case CHIP_TYPE_Z80:
+            PutBYTEExtended(cpu_console_address(addr), val);
             break;
 
         case CHIP_TYPE_8086:
@@ -6445,9 +6505,9 @@ static void cpu_clear(void) {
     for (i = 0; i < MAXMEMORY; i++)
         M[i] = 0;
     for (i = 0; i < (MAXMEMORY >> LOG2PAGESIZE); i++)
-        mmu_table[i] = RAM_PAGE;
+        mmu_set_page(i, RAM_PAGE);
     for (i = (MEMORYSIZE >> LOG2PAGESIZE); i < (MAXMEMORY >> LOG2PAGESIZE); i++)
-        mmu_table[i] = EMPTY_PAGE;
+        mmu_set_page(i, EMPTY_PAGE);
     if (cpu_unit.flags & UNIT_CPU_ALTAIRROM)
         install_ALTAIRbootROM();
     m68k_clear_memory();
@@ -6465,8 +6525,8 @@ static t_stat cpu_set_altairrom(UNIT *uptr, int32 value, CONST char *cptr, void
 }
 
 static t_stat cpu_set_noaltairrom(UNIT *uptr, int32 value, CONST char *cptr, void *desc) {
-    mmu_table[ALTAIR_ROM_LOW >> LOG2PAGESIZE] = MEMORYSIZE < MAXBANKSIZE ?
-        EMPTY_PAGE : RAM_PAGE;
+    mmu_set_page(ALTAIR_ROM_LOW >> LOG2PAGESIZE, MEMORYSIZE < MAXBANKSIZE ?
+        EMPTY_PAGE : RAM_PAGE);
     return SCPE_OK;
 }
 
@@ -6904,12 +6964,12 @@ t_stat sim_load(FILE *fileref, CONST char *cptr, CONST char *fnam, int flag) {
         while ((addr < MAXMEMORY) && ((i = getc(fileref)) != EOF)) {
             m = mmu_table[addr >> LOG2PAGESIZE];
             if (!m.isRAM && m.isEmpty) {
-                mmu_table[addr >> LOG2PAGESIZE] = RAM_PAGE;
+                mmu_set_page(addr >> LOG2PAGESIZE, RAM_PAGE);
                 pagesModified++;
                 m = RAM_PAGE;
             }
             if (makeROM) {
-                mmu_table[addr >> LOG2PAGESIZE] = ROM_PAGE;
+                mmu_set_page(addr >> LOG2PAGESIZE, ROM_PAGE);
                 m = ROM_PAGE;
             }
             if (!m.isRAM && m.routine)
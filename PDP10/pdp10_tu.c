@@ -406,6 +406,8 @@ MTAB tu_mod[] = {
       &sim_tape_set_fmt, &sim_tape_show_fmt, NULL },
     { MTAB_XTD|MTAB_VUN, 0, "CAPACITY", "CAPACITY",
       &sim_tape_set_capac, &sim_tape_show_capac, NULL },
+    { MTAB_XTD|MTAB_VUN, 0, "BUFFER", "BUFFER",
+      &sim_tape_set_buffer, &sim_tape_show_buffer, NULL },
     { MTAB_XTD|MTAB_VDV, 0, "ADDRESS", NULL,
       NULL, &show_addr, NULL },
     { MTAB_XTD|MTAB_VDV, 0, "VECTOR", NULL,
@@ -939,8 +939,8 @@ while (reason == 0)  {
     saved_sim_interval = sim_interval;
     if (BPT_SUMM_PC) {                                  /* possible breakpoint */
         t_addr pa = relocR (PC | isenable);             /* relocate PC */
-        if (sim_brk_test (PC, BPT_PCVIR) ||             /* Normal PC breakpoint? */
-            sim_brk_test (pa, BPT_PCPHY))               /* Physical Address breakpoint? */
+        if (BPT_TEST (PC, BPT_PCVIR) ||                 /* Normal PC breakpoint? */
+            BPT_TEST (pa, BPT_PCPHY))                   /* Physical Address breakpoint? */
             ABORT (ABRT_BKPT);                          /* stop simulation */
         }
 
@@ -2607,8 +2607,8 @@ if ((va & 1) && CPUT (HAS_ODD)) {                       /* odd address? */
     }
 pa = relocR (va);                                       /* relocate */
 if (BPT_SUMM_RD &&
-    (sim_brk_test (va & 0177777, BPT_RDVIR) ||
-     sim_brk_test (pa, BPT_RDPHY)))                     /* read breakpoint? */
+    (BPT_TEST (va & 0177777, BPT_RDVIR) ||
+     BPT_TEST (pa, BPT_RDPHY)))                         /* read breakpoint? */
     ABORT (ABRT_BKPT);                                  /* stop simulation */
 if (ADDR_IS_MEM (pa))                                   /* memory address? */
     return RdMemW (pa);
@@ -2634,8 +2634,8 @@ if ((va & 1) && CPUT (HAS_ODD)) {                       /* odd address? */
     }
 pa = relocR (va);                                       /* relocate */
 if (BPT_SUMM_RD &&
-    (sim_brk_test (va & 0177777, BPT_RDVIR) ||
-     sim_brk_test (pa, BPT_RDPHY)))                     /* read breakpoint? */
+    (BPT_TEST (va & 0177777, BPT_RDVIR) ||
+     BPT_TEST (pa, BPT_RDPHY)))                         /* read breakpoint? */
     ABORT (ABRT_BKPT);                                  /* stop simulation */
 return PReadW (pa);
 }
@@ -2646,8 +2646,8 @@ int32 pa;
 
 pa = relocR (va);                                       /* relocate */
 if (BPT_SUMM_RD &&
-    (sim_brk_test (va & 0177777, BPT_RDVIR) ||
-     sim_brk_test (pa, BPT_RDPHY)))                     /* read breakpoint? */
+    (BPT_TEST (va & 0177777, BPT_RDVIR) ||
+     BPT_TEST (pa, BPT_RDPHY)))                         /* read breakpoint? */
     ABORT (ABRT_BKPT);                                  /* stop simulation */
 return PReadB (pa);
 }
@@ -2665,8 +2665,8 @@ if ((va & 1) && CPUT (HAS_ODD)) {                       /* odd address? */
     }
 pa = relocR (va);                                       /* relocate */
 if (BPT_SUMM_RD &&
-    (sim_brk_test (va & 0177777, BPT_RDVIR) ||
-     sim_brk_test (pa, BPT_RDPHY)))                     /* read breakpoint? */
+    (BPT_TEST (va & 0177777, BPT_RDVIR) ||
+     BPT_TEST (pa, BPT_RDPHY)))                         /* read breakpoint? */
     reason = STOP_IBKPT;                                /* report that */
 return PReadW (pa);
 }
@@ -2679,8 +2679,8 @@ if ((va & 1) && CPUT (HAS_ODD)) {                       /* odd address? */
     }
 last_pa = relocW (va);                                  /* reloc, wrt chk */
 if (BPT_SUMM_RW &&
-    (sim_brk_test (va & 0177777, BPT_RWVIR) ||
-     sim_brk_test (last_pa, BPT_RWPHY)))                /* read or write breakpoint? */
+    (BPT_TEST (va & 0177777, BPT_RWVIR) ||
+     BPT_TEST (last_pa, BPT_RWPHY)))                    /* read or write breakpoint? */
     ABORT (ABRT_BKPT);                                  /* stop simulation */
 return PReadW (last_pa);
 }
@@ -2689,8 +2689,8 @@ int32 ReadMB (int32 va)
 {
 last_pa = relocW (va);                                  /* reloc, wrt chk */
 if (BPT_SUMM_RW &&
-    (sim_brk_test (va & 0177777, BPT_RWVIR) ||
-     sim_brk_test (last_pa, BPT_RWPHY)))                /* read or write breakpoint? */
+    (BPT_TEST (va & 0177777, BPT_RWVIR) ||
+     BPT_TEST (last_pa, BPT_RWPHY)))                    /* read or write breakpoint? */
     ABORT (ABRT_BKPT);                                  /* stop simulation */
 return PReadB (last_pa);
 }
@@ -2748,8 +2748,8 @@ if ((va & 1) && CPUT (HAS_ODD)) {                       /* odd address? */
     }
 pa = relocW (va);                                       /* relocate */
 if (BPT_SUMM_WR &&
-    (sim_brk_test (va & 0177777, BPT_WRVIR) ||
-     sim_brk_test (pa, BPT_WRPHY)))                     /* write breakpoint? */
+    (BPT_TEST (va & 0177777, BPT_WRVIR) ||
+     BPT_TEST (pa, BPT_WRPHY)))                         /* write breakpoint? */
     ABORT (ABRT_BKPT);                                  /* stop simulation */
 PWriteW (data, pa);
 }
@@ -2760,8 +2760,8 @@ int32 pa;
 
 pa = relocW (va);                                       /* relocate */
 if (BPT_SUMM_WR &&
-    (sim_brk_test (va & 0177777, BPT_WRVIR) ||
-     sim_brk_test (pa, BPT_WRPHY)))                     /* write breakpoint? */
+    (BPT_TEST (va & 0177777, BPT_WRVIR) ||
+     BPT_TEST (pa, BPT_WRPHY)))                         /* write breakpoint? */
     ABORT (ABRT_BKPT);                                  /* stop simulation */
 PWriteB (data, pa);
 }
@@ -2779,8 +2779,8 @@ if ((va & 1) && CPUT (HAS_ODD)) {                       /* odd address? */
     }
 pa = relocW (va);                                       /* relocate */
 if (BPT_SUMM_WR &&
-    (sim_brk_test (va & 0177777, BPT_WRVIR) ||
-     sim_brk_test (pa, BPT_WRPHY)))                     /* write breakpoint? */
+    (BPT_TEST (va & 0177777, BPT_WRVIR) ||
+     BPT_TEST (pa, BPT_WRPHY)))                         /* write breakpoint? */
     reason = STOP_IBKPT;                                /* report that */
 PWriteW (data, pa);
 }
@@ -231,11 +231,51 @@ return uba_last;
      trimmed to 18b.
    - In a Qbus configuration, the map is always disabled.
      Device addresses are trimmed to 22b.
+
+   Transfers are done in runs of contiguous memory.  Each Unibus
+   map register (8KB window) is resolved once per run, and word runs
+   (and byte runs on a little endian host) are copied directly.
 */
 
+#if defined (UC15)                                      /* memory via uc15 routines */
+#define MAP_DIRECT      0
+#else
+#define MAP_DIRECT      1
+#endif
+
+/* Find the run of memory starting at bus address ba and ending by lim
+
+   Inputs:
+        ba      =       bus address (trimmed)
+        lim     =       bus address limit
+        *ma     =       returned memory address of ba
+        size    =       transfer unit (1 or 2 bytes)
+   Outputs:
+        run     =       run length in bytes, 0 if ba is NXM
+*/
+
+static uint32 Map_Run (uint32 ba, uint32 lim, uint32 *ma, uint32 size)
+{
+uint32 run = lim - ba;
+
+if (cpu_bme) {                                          /* map enabled? */
+    if (run > (uint32) (UBM_PAGSIZE - UBM_GETOFF (ba))) /* stop at window */
+        run = UBM_PAGSIZE - UBM_GETOFF (ba);
+    *ma = Map_Addr (ba);                                /* map addr */
+    }
+else *ma = ba;                                          /* physical */
+if (!ADDR_IS_MEM (*ma))                                 /* NXM? */
+    return 0;
+if (!ADDR_IS_MEM (*ma + run - 1))                       /* stop at NXM */
+    run = (uint32) MEMSIZE - *ma;
+if (cpu_bme)                                            /* last mapped */
+    uba_last = (*ma + run - size) & PAMASK;
+return run;
+}
+
 int32 Map_ReadB (uint32 ba, int32 bc, uint8 *buf)
 {
-uint32 alim, lim, ma;
+uint32 lim, ma, run, i;
 
 if (ba >= IOPAGEBASE) {
     int32 value;
@@ -251,31 +291,24 @@ if (ba >= IOPAGEBASE) {
     }
 ba = ba & BUSMASK;                                      /* trim address */
 lim = ba + bc;
-if (cpu_bme) {                                          /* map enabled? */
-    for ( ; ba < lim; ba++) {                           /* by bytes */
-        ma = Map_Addr (ba);                             /* map addr */
-        if (!ADDR_IS_MEM (ma))                          /* NXM? err */
-            return (lim - ba);
-        *buf++ = (uint8) RdMemB (ma);                   /* get byte */
-        }
-    return 0;
-    }
-else {                                                  /* physical */
-    if (ADDR_IS_MEM (lim))                              /* end ok? */
-        alim = lim;
-    else if (ADDR_IS_MEM (ba))                          /* no, strt ok? */
-        alim = MEMSIZE;
-    else return bc;                                     /* no, err */
-    for ( ; ba < alim; ba++) {                          /* by bytes */
-        *buf++ = (uint8) RdMemB (ba);                   /* get byte */
+for ( ; ba < lim; ba = ba + run) {                      /* by runs */
+    run = Map_Run (ba, lim, &ma, 1);
+    if (run == 0)                                       /* NXM? err */
+        return (lim - ba);
+    if (MAP_DIRECT && sim_end)                          /* copy run */
+        memcpy (buf, ((uint8 *) M) + ma, run);
+    else {
+        for (i = 0; i < run; i++)                       /* by bytes */
+            buf[i] = (uint8) RdMemB (ma + i);           /* get byte */
         }
-    return (lim - alim);
+    buf = buf + run;
     }
+return 0;
 }
 
 int32 Map_ReadW (uint32 ba, int32 bc, uint16 *buf)
 {
-uint32 alim, lim, ma;
+uint32 lim, ma, run, i;
 
 if (ba >= IOPAGEBASE) {
     int32 value;
@@ -292,31 +325,24 @@ if (ba >= IOPAGEBASE) {
     }
 ba = (ba & BUSMASK) & ~01;                              /* trim, align addr */
 lim = ba + (bc & ~01);
-if (cpu_bme) {                                          /* map enabled? */
-    for (; ba < lim; ba = ba + 2) {                     /* by words */
-        ma = Map_Addr (ba);                             /* map addr */
-        if (!ADDR_IS_MEM (ma))                          /* NXM? err */
-            return (lim - ba);
-        *buf++ = (uint16) RdMemW (ma);
+for ( ; ba < lim; ba = ba + run) {                      /* by runs */
+    run = Map_Run (ba, lim, &ma, 2);
+    if (run == 0)                                       /* NXM? err */
+        return (lim - ba);
+    if (MAP_DIRECT)                                     /* copy run */
+        memcpy (buf, &M[ma >> 1], run);
+    else {
+        for (i = 0; i < run; i = i + 2)                 /* by words */
+            buf[i >> 1] = (uint16) RdMemW (ma + i);
         }
-    return 0;
-    }
-else {                                                  /* physical */
-    if (ADDR_IS_MEM (lim))                              /* end ok? */
-        alim = lim;
-    else if (ADDR_IS_MEM (ba))                          /* no, strt ok? */
-        alim = MEMSIZE;
-    else return bc;                                     /* no, err */
-    for ( ; ba < alim; ba = ba + 2) {                   /* by words */
-        *buf++ = (uint16) RdMemW (ba);
-        }
-    return (lim - alim);
+    buf = buf + (run >> 1);
     }
+return 0;
 }
 
 int32 Map_WriteB (uint32 ba, int32 bc, const uint8 *buf)
 {
-uint32 alim, lim, ma;
+uint32 lim, ma, run, i;
 
 if (ba >= IOPAGEBASE) {
     while (bc) {
@@ -329,31 +355,24 @@ if (ba >= IOPAGEBASE) {
 }
 ba = ba & BUSMASK;                                      /* trim address */
 lim = ba + bc;
-if (cpu_bme) {                                          /* map enabled? */
-    for ( ; ba < lim; ba++) {                           /* by bytes */
-        ma = Map_Addr (ba);                             /* map addr */
-        if (!ADDR_IS_MEM (ma))                          /* NXM? err */
-            return (lim - ba);
-        WrMemB (ma, ((uint16) *buf++));
+for ( ; ba < lim; ba = ba + run) {                      /* by runs */
+    run = Map_Run (ba, lim, &ma, 1);
+    if (run == 0)                                       /* NXM? err */
+        return (lim - ba);
+    if (MAP_DIRECT && sim_end)                          /* copy run */
+        memcpy (((uint8 *) M) + ma, buf, run);
+    else {
+        for (i = 0; i < run; i++)                       /* by bytes */
+            WrMemB (ma + i, ((uint16) buf[i]));
         }
-    return 0;
-    }
-else {                                                  /* physical */
-    if (ADDR_IS_MEM (lim))                              /* end ok? */
-        alim = lim;
-    else if (ADDR_IS_MEM (ba))                          /* no, strt ok? */
-        alim = MEMSIZE;
-    else return bc;                                     /* no, err */
-    for ( ; ba < alim; ba++) {                          /* by bytes */
-        WrMemB (ba, ((uint16) *buf++));
-        }
-    return (lim - alim);
+    buf = buf + run;
     }
+return 0;
 }
 
 int32 Map_WriteW (uint32 ba, int32 bc, const uint16 *buf)
 {
-uint32 alim, lim, ma;
+uint32 lim, ma, run, i;
 
 if (ba >= IOPAGEBASE) {
     if ((ba & 1) || (bc & 1))
@@ -368,26 +387,19 @@ if (ba >= IOPAGEBASE) {
 }
 ba = (ba & BUSMASK) & ~01;                              /* trim, align addr */
 lim = ba + (bc & ~01);
-if (cpu_bme) {                                          /* map enabled? */
-    for (; ba < lim; ba = ba + 2) {                     /* by words */
-        ma = Map_Addr (ba);                             /* map addr */
-        if (!ADDR_IS_MEM (ma))                          /* NXM? err */
-            return (lim - ba);
-        WrMemW (ma, *buf++);
+for ( ; ba < lim; ba = ba + run) {                      /* by runs */
+    run = Map_Run (ba, lim, &ma, 2);
+    if (run == 0)                                       /* NXM? err */
+        return (lim - ba);
+    if (MAP_DIRECT)                                     /* copy run */
+        memcpy (&M[ma >> 1], buf, run);
+    else {
+        for (i = 0; i < run; i = i + 2)                 /* by words */
+            WrMemW (ma + i, buf[i >> 1]);
         }
-    return 0;
-    }
-else {                                                  /* physical */
-    if (ADDR_IS_MEM (lim))                              /* end ok? */
-        alim = lim;
-    else if (ADDR_IS_MEM (ba))                          /* no, strt ok? */
-        alim = MEMSIZE;
-    else return bc;                                     /* no, err */
-    for ( ; ba < alim; ba = ba + 2) {                   /* by words */
-        WrMemW (ba, *buf++);
-        }
-    return (lim - alim);
+    buf = buf + (run >> 1);
     }
+return 0;
 }
 
 /* Build tables from device list */
@@ -562,12 +562,16 @@ for (i = 0; i < bc; i = i + pbc) {                      /* loop by pages */
     pbc = UBM_PAGSIZE - UBM_GETOFF (pa);                /* left in page */
     if (pbc > (bc - i))                                 /* limit to rem xfr */
         pbc = bc - i;
-    for (j = 0; j < pbc; j = j + 2) {                   /* loop by words */
-        *buf++ = M[pa >> 1];                            /* fetch word */
-        if (!(massbus[mb].cs2 & CS2_UAI)) {             /* if not inhb */
-            ba = ba + 2;                                /* incr ba, pa */
-            pa = pa + 2;
-            }
+    if (!ADDR_IS_MEM (pa + pbc - 1))                    /* stop at NXM */
+        pbc = MEMSIZE - pa;
+    if (massbus[mb].cs2 & CS2_UAI) {                    /* addr inhibit? */
+        for (j = 0; j < pbc; j = j + 2)                 /* loop by words */
+            *buf++ = M[pa >> 1];                        /* fetch word */
+        }
+    else {
+        memcpy (buf, &M[pa >> 1], pbc);                 /* fetch page */
+        buf = buf + (pbc >> 1);
+        ba = ba + pbc;                                  /* incr ba */
         }
     }
 massbus[mb].wc = (massbus[mb].wc + (bc >> 1)) & DMASK;   /* update wc */
@@ -601,12 +605,16 @@ for (i = 0; i < bc; i = i + pbc) {                      /* loop by pages */
     pbc = UBM_PAGSIZE - UBM_GETOFF (pa);                /* left in page */
     if (pbc > (bc - i))                                 /* limit to rem xfr */
         pbc = bc - i;
-    for (j = 0; j < pbc; j = j + 2) {                   /* loop by words */
-        M[pa >> 1] = *buf++;                            /* put word */
-        if (!(massbus[mb].cs2 & CS2_UAI)) {             /* if not inhb */
-            ba = ba + 2;                                /* incr ba, pa */
-            pa = pa + 2;
-            }
+    if (!ADDR_IS_MEM (pa + pbc - 1))                    /* stop at NXM */
+        pbc = MEMSIZE - pa;
+    if (massbus[mb].cs2 & CS2_UAI) {                    /* addr inhibit? */
+        for (j = 0; j < pbc; j = j + 2)                 /* loop by words */
+            M[pa >> 1] = *buf++;                        /* put word */
+        }
+    else {
+        memcpy (&M[pa >> 1], buf, pbc);                 /* put page */
+        buf = buf + (pbc >> 1);
+        ba = ba + pbc;                                  /* incr ba */
         }
     }
 massbus[mb].wc = (massbus[mb].wc + (bc >> 1)) & DMASK;  /* update wc */
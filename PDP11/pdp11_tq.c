@@ -499,6 +499,8 @@ MTAB tq_mod[] = {
         &sim_tape_set_fmt, &sim_tape_show_fmt, NULL, "Set/Display tape format (SIMH, E11, TPC, P7B)" },
     { MTAB_XTD|MTAB_VUN|MTAB_VALR, 0,       "CAPACITY", "CAPACITY",
         &sim_tape_set_capac, &sim_tape_show_capac, NULL, "Set/Display capacity" },
+    { MTAB_XTD|MTAB_VUN|MTAB_VALR, 0,       "BUFFER", "BUFFER",
+        &sim_tape_set_buffer, &sim_tape_show_buffer, NULL, "Set/Display sequential I/O buffer size in KB (0 = unbuffered)" },
 #if defined (VM_PDP11)
     { MTAB_XTD|MTAB_VDV|MTAB_VALR, 004,     "ADDRESS", "ADDRESS",
         &set_addr, &show_addr, NULL, "Bus address" },
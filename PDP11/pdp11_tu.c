@@ -325,6 +325,8 @@ MTAB tu_mod[] = {
         &sim_tape_set_capac, &sim_tape_show_capac, NULL, "Set unit n capacity to arg MB (0 = unlimited)" },
     { MTAB_XTD|MTAB_VUN|MTAB_NMO, 0,        "CAPACITY", NULL,
         NULL,                &sim_tape_show_capac, NULL, "Set/Display capacity" },
+    { MTAB_XTD|MTAB_VUN|MTAB_VALR, 0,       "BUFFER", "BUFFER",
+        &sim_tape_set_buffer, &sim_tape_show_buffer, NULL, "Set/Display sequential I/O buffer size in KB (0 = unbuffered)" },
     { 0 }
     };
 
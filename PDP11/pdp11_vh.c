@@ -468,6 +468,7 @@ static t_stat vh_show_detail (FILE *st, UNIT *uptr, int32 val, CONST void *desc)
 static t_stat vh_show_rbuf (FILE *st, UNIT *uptr, int32 val, CONST void *desc);
 static t_stat vh_show_txq (FILE *st, UNIT *uptr, int32 val, CONST void *desc);
 static t_stat vh_putc (int32 vh, TMLX *lp, int32 chan, int32 data);
+static int32 vh_putbuf (int32 vh, TMLX *lp, int32 chan, uint8 *buf, int32 count);
 static void vh_set_config (TMLX *lp );
 static void doDMA (int32 vh, int32 chan);
 static t_stat vh_setmode (UNIT *uptr, int32 val, CONST char *cptr, void *desc);
@@ -897,18 +898,71 @@ static t_stat vh_putc ( int32   vh,
     return (status);
 }
 
+/* TX a block of DMA data on a line, returning the number of characters sent */
+
+static int32 vh_putbuf (    int32   vh,
+            TMLX    *lp,
+            int32   chan,
+            uint8   *buf,
+            int32   count   )
+{
+    int32   i, n, sent;
+    uint8   mask = (uint8)bitmask[(lp->lpr >> LPR_V_CHAR_LGTH) & LPR_M_CHAR_LGTH];
+
+    if (count == 0)
+        return (0);
+    if (((lp->lnctrl >> LNCTRL_V_MAINT) & LNCTRL_M_MAINT) != 0) {
+        /* maintenance modes don't reach the TMXR line */
+        for (i = 0; i < count; i++) {
+            if (vh_putc (vh, lp, chan, buf[i]) != SCPE_OK)
+                break;
+        }
+        return (i);
+    }
+    /* truncate to desired character length */
+    for (i = 0; i < count; i++)
+        buf[i] &= mask;
+    sent = tmxr_write_ln (lp->tmln, buf, count);
+    if (sent < 0) {
+        tmxr_reset_ln (lp->tmln);
+        HangupModem (vh, lp, chan);
+        return (0);
+    }
+    while (sent < count) {
+        /* let's flush and try again */
+        tmxr_send_buffered_data (lp->tmln);
+        n = tmxr_write_ln (lp->tmln, buf + sent, count - sent);
+        if (n <= 0)
+            break;
+        sent += n;
+    }
+    return (sent);
+}
+
 /* Retrieve all stored input from TMXR and place in RX FIFO */
 
 static void vh_getc (   int32   vh  )
 {
     uint32  i, c;
+    int32   j, n;
     TMLX    *lp;
+    uint8   buf[FIFO_SIZE];
 
     for (i = 0; i < (uint32)VH_LINES; i++) {
         if (rbuf_idx[vh] >= (FIFO_ALARM-1)) /* close to fifo capacity? */
             continue;                       /* don't bother checking for data */
         lp = &vh_parm[(vh * VH_LINES) + i];
-        while ((c = tmxr_getc_ln (lp->tmln)) != 0) {
+        for (;;) {
+            n = tmxr_read_ln (lp->tmln, buf, sizeof (buf));
+            if (n > 0) {
+                for (j = 0; j < n; j++)
+                    fifo_put (vh, lp, RBUF_PUTLINE (i) | (buf[j] &
+                        bitmask[(lp->lpr >> LPR_V_CHAR_LGTH) & LPR_M_CHAR_LGTH]));
+                continue;
+            }
+            /* breaks, injected and rate limited input come one at a time */
+            if ((c = tmxr_getc_ln (lp->tmln)) == 0)
+                break;
             if (c & SCPE_BREAK) {
                 fifo_put (vh, lp,
                     RBUF_FRAME_ERR | RBUF_PUTLINE (i));
@@ -1326,17 +1380,22 @@ static void doDMA ( int32   vh,
         pa |= (lp->tbuf2 & TB2_M_TBUFFAD) << 16;
         status = chan << CSR_V_TX_LINE;
         while (lp->tbuffct) {
-            uint8   buf;
-            if (Map_ReadB (pa, 1, &buf)) {
+            uint8   buf[256];
+            int32   count, valid, sent;
+
+            count = (lp->tbuffct < sizeof (buf)) ? lp->tbuffct : sizeof (buf);
+            valid = count - Map_ReadB (pa, count, buf);
+            sent = vh_putbuf (vh, lp, chan, buf, valid);
+            /* pa = (pa + sent) & PAMASK; */
+            pa = (pa + sent) & ((1 << 22) - 1);
+            lp->tbuffct -= sent;
+            if (sent < valid)       /* line stalled or lost */
+                break;
+            if (valid < count) {
                 status |= CSR_TX_DMA_ERR;
                 lp->tbuffct = 0;
                 break;
             }
-            if (vh_putc (vh, lp, chan, buf) != SCPE_OK)
-                break;
-            /* pa = (pa + 1) & PAMASK; */
-            pa = (pa + 1) & ((1 << 22) - 1);
-            lp->tbuffct--;
         }
         lp->tbuf1 = pa & 0177777;
         lp->tbuf2 = (lp->tbuf2 & ~TB2_M_TBUFFAD) |
@@ -753,14 +753,18 @@ return SCPE_NOFNC;
 t_stat cpu_boot (int32 unitno, DEVICE *dptr)
 {
 t_stat r;
+uint32 pa;
 
 if (PC == 0x200) {    /* Use VMB directly to boot */
     r = cpu_load_bootcode (BOOT_CODE_FILENAME, BOOT_CODE_ARRAY, BOOT_CODE_SIZE, FALSE, 0x200);
     if (r != SCPE_OK)
         return r;
     }
-else                    /* Boot ROM boot */
+else {                  /* Boot ROM boot */
     memcpy (&M[0xFA00>>2], rom, ROMSIZE);
+    for (pa = 0xFA00; pa < 0xFA00 + ROMSIZE; pa = pa + VA_PAGSIZE)
+        DC_WRITE (pa);
+    }
 return SCPE_OK;
 }
 
@@ -405,7 +405,11 @@ for (i = 0; i < bc; i = i + pbc) {                      /* loop by pages */
         pbc = bc - i;
     if (DEBUG_PRI (uba_dev, UBA_DEB_XFR))
         fprintf (sim_deb, ">>UBA: 8b read, ma = %X, bc = %X\n", ma, pbc);
-    if ((ma | pbc) & 3) {                               /* aligned LW? */
+    if (sim_end) {                                      /* LE host? copy page */
+        memcpy (buf, ((uint8 *) M) + ma, pbc);
+        buf = buf + pbc;
+        }
+    else if ((ma | pbc) & 3) {                          /* aligned LW? */
         for (j = 0; j < pbc; ma++, j++) {               /* no, do by bytes */
             *buf++ = ReadB (ma);
             }
@@ -438,7 +442,11 @@ for (i = 0; i < bc; i = i + pbc) {                      /* loop by pages */
         pbc = bc - i;
     if (DEBUG_PRI (uba_dev, UBA_DEB_XFR))
         fprintf (sim_deb, ">>UBA: 16b read, ma = %X, bc = %X\n", ma, pbc);
-    if ((ma | pbc) & 1) {                               /* aligned word? */
+    if (sim_end && !((ma | pbc) & 1)) {                 /* LE host, aligned? */
+        memcpy (buf, ((uint8 *) M) + ma, pbc);
+        buf = buf + (pbc >> 1);
+        }
+    else if ((ma | pbc) & 1) {                          /* aligned word? */
         for (j = 0; j < pbc; ma++, j++) {               /* no, do by bytes */
             if ((i + j) & 1) {                          /* odd byte? */
                 *buf = (*buf & BMASK) | (ReadB (ma) << 8);
@@ -477,7 +485,12 @@ for (i = 0; i < bc; i = i + pbc) {                      /* loop by pages */
         pbc = bc - i;
     if (DEBUG_PRI (uba_dev, UBA_DEB_XFR))
         fprintf (sim_deb, ">>UBA: 8b write, ma = %X, bc = %X\n", ma, pbc);
-    if ((ma | pbc) & 3) {                               /* aligned LW? */
+    if (sim_end) {                                      /* LE host? copy page */
+        memcpy (((uint8 *) M) + ma, buf, pbc);
+        DC_WRITE (ma);
+        buf = buf + pbc;
+        }
+    else if ((ma | pbc) & 3) {                          /* aligned LW? */
         for (j = 0; j < pbc; ma++, j++) {               /* no, do by bytes */
             WriteB (ma, *buf);
             buf++;
@@ -511,7 +524,12 @@ for (i = 0; i < bc; i = i + pbc) {                      /* loop by pages */
         pbc = bc - i;
     if (DEBUG_PRI (uba_dev, UBA_DEB_XFR))
         fprintf (sim_deb, ">>UBA: 16b write, ma = %X, bc = %X\n", ma, pbc);
-    if ((ma | pbc) & 1) {                               /* aligned word? */
+    if (sim_end && !((ma | pbc) & 1)) {                 /* LE host, aligned? */
+        memcpy (((uint8 *) M) + ma, buf, pbc);
+        DC_WRITE (ma);
+        buf = buf + (pbc >> 1);
+        }
+    else if ((ma | pbc) & 1) {                          /* aligned word? */
         for (j = 0; j < pbc; ma++, j++) {               /* no, bytes */
             if ((i + j) & 1) {
                 WriteB (ma, (*buf >> 8) & BMASK);
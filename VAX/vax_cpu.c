@@ -186,12 +186,36 @@
 
 #define UNIT_V_CONH     (UNIT_V_UF + 0)                 /* halt to console */
 #define UNIT_V_MSIZE    (UNIT_V_UF + 1)                 /* dummy */
+#define UNIT_V_DCACHE   (UNIT_V_UF + 2)                 /* decoded inst cache */
 #define UNIT_CONH       (1u << UNIT_V_CONH)
 #define UNIT_MSIZE      (1u << UNIT_V_MSIZE)
+#define UNIT_DCACHE     (1u << UNIT_V_DCACHE)
 #define GET_CUR         acc = ACC_MASK (PSL_GETCUR (PSL))
 
 #define OPND_SIZE       16
 #define INST_SIZE       52
+
+#define DC_SIZE         8192                            /* decode cache entries, 2**n */
+#define DC_MAXIST       16                              /* max istream items per entry */
+#define DC_HASH(pa)     (((pa) ^ ((pa) >> 13)) & (DC_SIZE - 1))
+
+/* Decoded instruction cache entry
+
+   The istream items of an instruction (opcode, specifier bytes,
+   displacements, immediates and branch displacements) are recorded
+   in the order the specifier flows fetch them.  Entries are tagged
+   by the physical address of the opcode; they become stale when the
+   generation of their physical page changes (any write to the page)
+   or when the cache epoch changes (simulator restarted).
+*/
+
+typedef struct {
+    uint32              pa;                             /* phys addr of opcode */
+    uint32              gen;                            /* page generation */
+    uint32              epoch;                          /* cache epoch */
+    int32               lnt;                            /* instruction length */
+    int32               ist[DC_MAXIST];                 /* istream items */
+    } DCENT;
 #define op0             opnd[0]
 #define op1             opnd[1]
 #define op2             opnd[2]
@@ -263,6 +287,20 @@ int32 cpu_astop = 0;
 int32 mchk_va, mchk_ref;                                /* mem ref param */
 int32 ibufl, ibufh;                                     /* prefetch buf */
 int32 ibcnt, ppc;                                       /* prefetch ctl */
+int32 dc_ppc = -1;                                      /* decode cache phys PC */
+uint32 *dc_pgen = NULL;                                 /* decode cache page generations */
+DCENT *dc_tab = NULL;                                   /* decode cache */
+uint32 dc_npages = 0;                                   /* pages in dc_pgen */
+uint32 dc_epoch = 0;                                    /* decode cache epoch */
+int32 *dc_ist = NULL;                                   /* replay pointer */
+int32 *dc_rec = NULL;                                   /* record pointer */
+int32 dc_rec_buf[DC_MAXIST];                            /* record buffer */
+uint32 dc_hits = 0;                                     /* decode cache stats */
+uint32 dc_misses = 0;
+uint32 dc_fills = 0;
+uint8 *mem_dirty = NULL;                                /* SAVE -I written block map */
+uint32 mem_dirty_shift = 0;                             /* log2 of its block size */
+uint32 mem_dirty_nblk = 0;                              /* blocks in mem_dirty */
 uint32 cpu_idle_mask = VAX_IDLE_VMS;                    /* idle mask */
 uint32 cpu_idle_type = 1;                               /* default VMS */
 int32 extra_bytes;                                      /* bytes referenced by current string instruction */
@@ -316,6 +354,12 @@ t_stat cpu_show_hist (FILE *st, UNIT *uptr, int32 val, CONST void *desc);
 t_stat cpu_show_virt (FILE *st, UNIT *uptr, int32 val, CONST void *desc);
 t_stat cpu_set_idle (UNIT *uptr, int32 val, CONST char *cptr, void *desc);
 t_stat cpu_show_idle (FILE *st, UNIT *uptr, int32 val, CONST void *desc);
+t_stat cpu_set_dcache (UNIT *uptr, int32 val, CONST char *cptr, void *desc);
+t_stat cpu_show_dcache (FILE *st, UNIT *uptr, int32 val, CONST void *desc);
+t_stat dc_setup (void);
+void dc_free (void);
+uint8 *cpu_mem_dirty (UNIT *uptr, t_addr blksize, uint32 nblk);
+void cpu_mem_dirty_free (void);
 const char *cpu_description (DEVICE *dptr);
 int32 cpu_get_vsw (int32 sw);
 static SIM_INLINE int32 get_istr (int32 lnt, int32 acc);
@@ -420,6 +464,10 @@ MTAB cpu_mod[] = {
     { UNIT_CONH, UNIT_CONH, "HALT to console", "CONHALT", NULL, NULL, NULL, "Set HALT to trap to console ROM" },
     { MTAB_XTD|MTAB_VDV, 0, "IDLE", "IDLE={VMS|ULTRIX|ULTRIX-1.X|ULTRIXOLD|NETBSD|NETBSDOLD|OPENBSD|OPENBSDOLD|QUASIJARUS|32V|ELN}{:n}", &cpu_set_idle, &cpu_show_idle, NULL, "Display idle detection mode" },
     { MTAB_XTD|MTAB_VDV, 0, NULL, "NOIDLE", &sim_clr_idle, NULL, NULL,  "Disables idle detection" },
+    { UNIT_DCACHE, UNIT_DCACHE, "decode cache", "DECODECACHE", &cpu_set_dcache, NULL, NULL, "Enable the decoded instruction cache" },
+    { UNIT_DCACHE, 0, "no decode cache", "NODECODECACHE", &cpu_set_dcache, NULL, NULL, "Disable the decoded instruction cache" },
+    { MTAB_XTD|MTAB_VDV|MTAB_NMO, 0, "DCSTATS", NULL,
+      NULL, &cpu_show_dcache, NULL, "Display decoded instruction cache statistics" },
     MEM_MODIFIERS,   /* Model specific memory modifiers from vaxXXX_defs.h */
     { MTAB_XTD|MTAB_VDV|MTAB_NMO|MTAB_SHP|MTAB_NC, 0, "HISTORY", "HISTORY",
       &cpu_set_hist, &cpu_show_hist, NULL, "Displays instruction history" },
@@ -484,6 +532,8 @@ int32 spec = 0, disp = 0, rn = 0, index = 0, numspec = 0;
 int32 vfldrp1 = 0, brdisp = 0, flg = 0, mstat = 0;
 uint32 va = 0, iad = 0;
 int32 opnd[OPND_SIZE];                                  /* operand queue */
+DCENT *dce;                                             /* decode cache entry */
+int32 dc_stat;
 
 if ((ret = build_dib_tab ()) != SCPE_OK)                /* build, chk dib_tab */
     return ret;
@@ -500,8 +550,11 @@ set_map_reg ();                                         /* set map reg */
 GET_CUR;                                                /* set access mask */
 SET_IRQL;                                               /* eval interrupts */
 FLUSH_ISTR;                                             /* clear prefetch */
+if ((ret = dc_setup ()) != SCPE_OK)                     /* set up decode cache */
+    return ret;
 
 abortval = setjmp (save_env);                           /* set abort hdlr */
+dc_ist = dc_rec = NULL;                                 /* not replaying/recording */
 if (abortval > 0) {                                     /* sim stop? */
     PSL = PSL | cc;                                     /* put PSL together */
     pcq_r->qptr = pcq_p;                                /* update pc q ptr */
@@ -707,6 +760,25 @@ for ( ;; ) {
 
     sim_interval = sim_interval - (1 + (extra_bytes>>5));/* count instr */
     extra_bytes = 0;                                    /* digest string count */
+    dce = NULL;
+    if (dc_tab && ((PSL & PSL_FPD) == 0)) {             /* decode cache? */
+        if (dc_ppc < 0)                                 /* phys PC unknown? */
+            dc_ppc = Test (PC, RD, &dc_stat);           /* xlate PC */
+        if ((dc_ppc >= 0) && ADDR_IS_MEM (dc_ppc)) {
+            dce = &dc_tab[DC_HASH (dc_ppc)];
+            if ((dce->pa == (uint32) dc_ppc) && (dce->epoch == dc_epoch) &&
+                (dce->gen == dc_pgen[((uint32) dc_ppc) >> VA_N_OFF])) {
+                dc_ist = dce->ist;                      /* hit, replay */
+                ibcnt = 0;                              /* prefetch unused */
+                ppc = -1;
+                dc_hits++;
+                }
+            else {
+                dc_rec = dc_rec_buf;                    /* miss, record */
+                dc_misses++;
+                }
+            }
+        }
     GET_ISTR (opc, L_BYTE);                             /* get opcode */
     if (opc == 0xFD) {                                  /* 2 byte op? */
         GET_ISTR (opc, L_BYTE);                         /* get second byte */
@@ -1523,6 +1595,33 @@ for ( ;; ) {
             }                                           /* end for */
         }                                               /* end if not FPD */
 
+/* Decode complete - retire the decode cache entry if one was replayed,
+   or fill it if the instruction was recorded and lies within one page.
+   Sequential flow can then locate the next instruction without
+   translating PC again. */
+
+    if (dce) {
+        int32 lnt = PC - fault_PC;
+
+        if (dc_rec && ((VA_GETOFF (dc_ppc) + lnt) <= VA_PAGSIZE)) {
+            uint32 pg = ((uint32) dc_ppc) >> VA_N_OFF;
+
+            if ((dc_pgen[pg] & 1) == 0)                 /* mark code page */
+                dc_pgen[pg]++;
+            dce->pa = dc_ppc;
+            dce->gen = dc_pgen[pg];
+            dce->epoch = dc_epoch;
+            dce->lnt = lnt;
+            memcpy (dce->ist, dc_rec_buf, (dc_rec - dc_rec_buf) * sizeof (int32));
+            dc_fills++;
+            }
+        dc_ist = dc_rec = NULL;
+        if ((VA_GETOFF (dc_ppc) + lnt) < VA_PAGSIZE)    /* next inst same page? */
+            dc_ppc = dc_ppc + lnt;
+        else dc_ppc = -1;
+        }
+    else dc_ppc = -1;
+
 /* Optionally record instruction history */
 
     if (hst_lnt) {
@@ -3138,6 +3237,10 @@ static SIM_INLINE int32 get_istr (int32 lnt, int32 acc)
 int32 bo = PC & 3;
 int32 sc, val, t;
 
+if (dc_ist) {                                           /* replaying decode? */
+    PC = PC + lnt;
+    return *dc_ist++;
+    }
 while ((bo + lnt) > ibcnt) {                            /* until enuf bytes */
     if ((ppc < 0) || (VA_GETOFF (ppc) == 0)) {          /* PPC inv, xpg? */
         ppc = Test ((PC + ibcnt) & ~03, RD, &t);        /* xlate PC */
@@ -3167,6 +3270,11 @@ if ((bo + lnt) >= 4) {                                  /* retire ibufl? */
     ibufl = ibufh;
     ibcnt = ibcnt - 4;
     }
+if (dc_rec) {                                           /* recording decode? */
+    if (dc_rec < &dc_rec_buf[DC_MAXIST])
+        *dc_rec++ = val;
+    else dc_rec = NULL;                                 /* too long, don't cache */
+    }
 return val;
 }
 
@@ -3203,6 +3311,7 @@ FLUSH_ISTR;                             /* init I-stream */
 if (M == NULL) {                        /* first time init? */
     sim_brk_types = sim_brk_dflt = SWMASK ('E');
     sim_vm_is_subroutine_call = cpu_is_pc_a_subroutine_call;
+    sim_vm_mem_dirty = &cpu_mem_dirty;
     pcq_r = find_reg ("PCQ", NULL, dptr);
     if (pcq_r == NULL)
         return SCPE_IERR;
@@ -3330,6 +3439,8 @@ for (i = 0; i < clim; i = i + 4)
 free (M);
 M = nM;
 MEMSIZE = uval; 
+dc_free ();                                             /* page table resized on next run */
+cpu_mem_dirty_free ();                                  /* block map resized on next SAVE */
 reset_all (0);
 return SCPE_OK;
 }
@@ -3647,6 +3758,108 @@ sim_show_idle (st, uptr, val, desc);
 return SCPE_OK;
 }
 
+/* Decoded instruction cache
+
+   The cache tables exist only while the cache is enabled, so that the
+   memory write hook (DC_WRITE) is a single pointer test otherwise.
+   dc_setup runs at every entry to sim_instr: memory may have been
+   changed by examine/deposit, LOAD or device activity while stopped,
+   so the epoch is advanced to retire all previous entries. */
+
+t_stat dc_setup (void)
+{
+uint32 npages = ((uint32) MEMSIZE) >> VA_N_OFF;
+
+if ((cpu_unit.flags & UNIT_DCACHE) == 0) {
+    dc_free ();
+    return SCPE_OK;
+    }
+if (dc_tab == NULL) {
+    dc_tab = (DCENT *) calloc (DC_SIZE, sizeof (DCENT));
+    if (dc_tab == NULL)
+        return SCPE_MEM;
+    }
+if ((dc_pgen == NULL) || (dc_npages != npages)) {
+    free (dc_pgen);
+    dc_pgen = (uint32 *) calloc (npages, sizeof (uint32));
+    if (dc_pgen == NULL) {
+        dc_free ();
+        return SCPE_MEM;
+        }
+    dc_npages = npages;
+    }
+dc_epoch = dc_epoch + 1;
+dc_ppc = -1;
+return SCPE_OK;
+}
+
+void dc_free (void)
+{
+free (dc_tab);
+dc_tab = NULL;
+free (dc_pgen);
+dc_pgen = NULL;
+dc_npages = 0;
+dc_ppc = -1;
+}
+
+t_stat cpu_set_dcache (UNIT *uptr, int32 val, CONST char *cptr, void *desc)
+{
+if (cptr)
+    return SCPE_ARG;
+dc_hits = dc_misses = dc_fills = 0;                     /* restart statistics */
+if (val == 0)                                           /* disabling? */
+    dc_free ();
+return SCPE_OK;
+}
+
+t_stat cpu_show_dcache (FILE *st, UNIT *uptr, int32 val, CONST void *desc)
+{
+double total = (double) dc_hits + (double) dc_misses;
+
+fprintf (st, "decode cache %s, %d entries\n", (cpu_unit.flags & UNIT_DCACHE)? "enabled": "disabled", DC_SIZE);
+fprintf (st, "  hits:   %u (%.1f%%)\n", dc_hits, (total > 0.0)? (100.0 * dc_hits) / total: 0.0);
+fprintf (st, "  misses: %u\n", dc_misses);
+fprintf (st, "  fills:  %u\n", dc_fills);
+return SCPE_OK;
+}
+
+/* Memory write tracking for SAVE -I
+
+   The map has a byte per block of memory, set by DC_WRITE.  It exists
+   once a SAVE or RESTORE has asked for it, so until then DC_WRITE only
+   tests a pointer.  Blocks must be whole pages, since DC_WRITE marks
+   just the block holding the start of each write. */
+
+uint8 *cpu_mem_dirty (UNIT *uptr, t_addr blksize, uint32 nblk)
+{
+uint32 shift;
+
+if ((uptr != &cpu_unit) || (blksize < VA_PAGSIZE))
+    return NULL;
+for (shift = 0; (((t_addr) 1) << shift) < blksize; shift++) ;
+if ((((t_addr) 1) << shift) != blksize)                 /* not a power of 2? */
+    return NULL;
+if ((nblk << shift) < (uint32) MEMSIZE)                 /* doesn't cover memory? */
+    return NULL;
+if ((mem_dirty == NULL) || (mem_dirty_nblk != nblk) || (mem_dirty_shift != shift)) {
+    cpu_mem_dirty_free ();
+    mem_dirty_shift = shift;
+    mem_dirty = (uint8 *) malloc (nblk);
+    if (mem_dirty == NULL)
+        return NULL;
+    memset (mem_dirty, 1, nblk);                        /* contents unknown */
+    mem_dirty_nblk = nblk;
+    }
+return mem_dirty;
+}
+
+void cpu_mem_dirty_free (void)
+{
+free (mem_dirty);
+mem_dirty = NULL;
+mem_dirty_nblk = 0;
+}
 
 t_stat cpu_load_bootcode (const char *filename, const unsigned char *builtin_code, size_t size, t_bool rom, t_addr offset)
 {
@@ -3683,6 +3896,13 @@ cpu_model_help (st, dptr, uptr, flag, cptr);
 fprintf (st, "CPU options include the treatment of the HALT instruction.\n\n");
 fprintf (st, "   sim> SET CPU SIMHALT                 kernel HALT returns to simulator\n");
 fprintf (st, "   sim> SET CPU CONHALT                 kernel HALT returns to boot ROM console\n\n");
+fprintf (st, "The CPU can keep a cache of decoded instructions, indexed by the physical\n");
+fprintf (st, "address of the opcode.  Instructions found in the cache are executed without\n");
+fprintf (st, "re-fetching and re-parsing the instruction stream.  Any write to a physical\n");
+fprintf (st, "page invalidates the instructions cached from that page.\n\n");
+fprintf (st, "   sim> SET CPU DECODECACHE             enable the decoded instruction cache\n");
+fprintf (st, "   sim> SET CPU NODECODECACHE           disable the decoded instruction cache\n");
+fprintf (st, "   sim> SHOW CPU DCSTATS                display decode cache statistics\n\n");
 fprintf (st, "The CPU also implements a command to display a virtual to physical address\n");
 fprintf (st, "translation:\n\n");
 fprintf (st, "   sim> SHOW {-kesu} CPU VIRTUAL=n      show translation for address n\n");
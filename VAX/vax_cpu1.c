@@ -773,7 +773,39 @@ if (ar == 0)                                            /* empty, cc = 0110 */
 return 0;                                               /* q can't be empty */
 }
 
-/* String instructions */
+/* String instructions
+
+   The string instructions process their operands in page runs.  Each
+   source and destination page is translated once, faulting exactly as
+   the first byte reference in it would, and runs in memory are moved,
+   filled, compared or scanned directly in the host's copy of memory.
+   The string registers are updated as each run completes, so a fault
+   on the next page restarts the instruction (PSL<FPD>) after the runs
+   already done.  Runs in I/O space (or on a big endian host) are done
+   a byte at a time through Read and Write.  The read only instructions
+   (CMPC, LOCC, SKPC, SCANC, SPANC) update the registers once per run;
+   restarting a partial run just examines its bytes again.
+*/
+
+/* Length of the run starting at va (ending at va - 1 if backward) */
+
+static int32 str_run_lnt (uint32 va, int32 lnt, t_bool back)
+{
+int32 left = back? (int32) (((va - 1) & VA_M_OFF) + 1): (int32) (VA_PAGSIZE - (va & VA_M_OFF));
+
+return (lnt < left)? lnt: left;
+}
+
+/* Host pointer to the run of lnt bytes starting at va, NULL if not in memory */
+
+static uint8 *str_run_ptr (uint32 va, int32 lnt, int32 acc)
+{
+uint32 pa = Translate (va, acc);
+
+if (sim_end && ADDR_IS_MEM (pa) && ADDR_IS_MEM (pa + lnt - 1))
+    return ((uint8 *) M) + pa;
+return NULL;
+}
 
 #define MVC_FRWD        0                               /* movc state codes */
 #define MVC_BACK        1
@@ -806,9 +838,9 @@ return 0;                                               /* q can't be empty */
 
 int32 op_movc (int32 *opnd, int32 movc5, int32 acc)
 {
-int32 i, cc, fill, wd;
-int32 j, lnt, mlnt[3];
-static const int32 looplnt[3] = { L_BYTE, L_LONG, L_BYTE };
+int32 cc, fill, wd;
+int32 lnt;
+uint8 *sp, *dp;
 
 if (PSL & PSL_FPD) {                                    /* FPD set? */
     SETPC (fault_PC + STR_GETDPC (R[0]));               /* reset PC */
@@ -859,38 +891,52 @@ else {
 switch (R[5] & MVC_M_STATE) {                           /* case on state */
 
     case MVC_FRWD:                                      /* move forward */
-        mlnt[0] = (4 - R[3]) & 3;                       /* length to align */
-        if (mlnt[0] > R[2])                             /* cant exceed total */
-            mlnt[0] = R[2];
-        mlnt[1] = (R[2] - mlnt[0]) & ~03;               /* aligned length */
-        mlnt[2] = R[2] - mlnt[0] - mlnt[1];             /* tail */
-        for (i = 0; i < 3; i++) {                       /* head, align, tail */
-            lnt = looplnt[i];                           /* length for loop */
-            for (j = 0; j < mlnt[i]; j = j + lnt, extra_bytes++) {
-                wd = Read (R[1], lnt, RA);              /* read src */
-                Write (R[3], wd, lnt, WA);              /* write dst */
+        while (R[2] > 0) {                              /* by page runs */
+            lnt = str_run_lnt (R[1], R[2], FALSE);      /* run length */
+            lnt = str_run_lnt (R[3], lnt, FALSE);
+            sp = str_run_ptr (R[1], lnt, RA);           /* translate src */
+            dp = str_run_ptr (R[3], lnt, WA);           /* translate dst */
+            if (sp && dp) {                             /* both in memory? */
+                memmove (dp, sp, lnt);                  /* move run */
+                DC_WRITE (dp - (uint8 *) M);
                 R[1] = R[1] + lnt;                      /* inc src addr */
                 R[3] = R[3] + lnt;                      /* inc dst addr */
                 R[2] = R[2] - lnt;                      /* dec move lnt */
                 }
+            else {
+                for (wd = lnt; wd > 0; wd--) {
+                    Write (R[3], Read (R[1], L_BYTE, RA), L_BYTE, WA);
+                    R[1] = R[1] + 1;                    /* inc src addr */
+                    R[3] = R[3] + 1;                    /* inc dst addr */
+                    R[2] = R[2] - 1;                    /* dec move lnt */
+                    }
+                }
+            extra_bytes = extra_bytes + (lnt >> 2);
             }
         goto FILL;                                      /* check for fill */
 
     case MVC_BACK:                                      /* move backward */
-        mlnt[0] = R[3] & 03;                            /* length to align */
-        if (mlnt[0] > R[2])                             /* cant exceed total */
-            mlnt[0] = R[2];
-        mlnt[1] = (R[2] - mlnt[0]) & ~03;               /* aligned length */
-        mlnt[2] = R[2] - mlnt[0] - mlnt[1];             /* tail */
-        for (i = 0; i < 3; i++) {                       /* head, align, tail */
-            lnt = looplnt[i];                           /* length for loop */
-            for (j = 0; j < mlnt[i]; j = j + lnt, extra_bytes++) {
-                wd = Read (R[1] - lnt, lnt, RA);        /* read src */
-                Write (R[3] - lnt, wd, lnt, WA);        /* write dst */
+        while (R[2] > 0) {                              /* by page runs */
+            lnt = str_run_lnt (R[1], R[2], TRUE);       /* run length */
+            lnt = str_run_lnt (R[3], lnt, TRUE);
+            sp = str_run_ptr (R[1] - lnt, lnt, RA);     /* translate src */
+            dp = str_run_ptr (R[3] - lnt, lnt, WA);     /* translate dst */
+            if (sp && dp) {                             /* both in memory? */
+                memmove (dp, sp, lnt);                  /* move run */
+                DC_WRITE (dp - (uint8 *) M);
                 R[1] = R[1] - lnt;                      /* dec src addr */
                 R[3] = R[3] - lnt;                      /* dec dst addr */
                 R[2] = R[2] - lnt;                      /* dec move lnt */
                 }
+            else {
+                for (wd = lnt; wd > 0; wd--) {
+                    Write (R[3] - 1, Read (R[1] - 1, L_BYTE, RA), L_BYTE, WA);
+                    R[1] = R[1] - 1;                    /* dec src addr */
+                    R[3] = R[3] - 1;                    /* dec dst addr */
+                    R[2] = R[2] - 1;                    /* dec move lnt */
+                    }
+                }
+            extra_bytes = extra_bytes + (lnt >> 2);
             }
         R[1] = R[1] + (R[0] & STR_LNMASK);              /* final src addr */
         R[3] = R[3] + (R[0] & STR_LNMASK);              /* final dst addr */
@@ -900,21 +946,24 @@ switch (R[5] & MVC_M_STATE) {                           /* case on state */
         if (R[4] <= 0)                                  /* any fill? */
             break;
         R[5] = R[5] | MVC_FILL;                         /* set state */
-        mlnt[0] = (4 - R[3]) & 3;                       /* length to align */
-        if (mlnt[0] > R[4])                             /* cant exceed total */
-            mlnt[0] = R[4];
-        mlnt[1] = (R[4] - mlnt[0]) & ~03;               /* aligned length */
-        mlnt[2] = R[4] - mlnt[0] - mlnt[1];             /* tail */
-        for (i = 0; i < 3; i++) {                       /* head, align, tail */
-            lnt = looplnt[i];                           /* length for loop */
-            fill = fill & BMASK;                        /* fill for loop */
-            if (lnt == L_LONG)
-                fill = (((uint32) fill) << 24) | (fill << 16) | (fill << 8) | fill;
-            for (j = 0; j < mlnt[i]; j = j + lnt, extra_bytes++) {
-                Write (R[3], fill, lnt, WA);            /* write fill */
+        fill = fill & BMASK;                            /* fill character */
+        while (R[4] > 0) {                              /* by page runs */
+            lnt = str_run_lnt (R[3], R[4], FALSE);      /* run length */
+            dp = str_run_ptr (R[3], lnt, WA);           /* translate dst */
+            if (dp) {                                   /* in memory? */
+                memset (dp, fill, lnt);                 /* fill run */
+                DC_WRITE (dp - (uint8 *) M);
                 R[3] = R[3] + lnt;                      /* inc dst addr */
                 R[4] = R[4] - lnt;                      /* dec fill lnt */
                 }
+            else {
+                for (wd = lnt; wd > 0; wd--) {
+                    Write (R[3], fill, L_BYTE, WA);     /* write fill */
+                    R[3] = R[3] + 1;                    /* inc dst addr */
+                    R[4] = R[4] - 1;                    /* dec fill lnt */
+                    }
+                }
+            extra_bytes = extra_bytes + (lnt >> 2);
             }
         break;
 
@@ -953,6 +1002,8 @@ return cc;
 int32 op_cmpc (int32 *opnd, int32 cmpc5, int32 acc)
 {
 int32 cc, s1, s2, fill;
+int32 j, lnt;
+uint8 *p1, *p2;
 
 if (PSL & PSL_FPD) {                                    /* FPD set? */
     SETPC (fault_PC + STR_GETDPC (R[0]));               /* reset PC */
@@ -974,23 +1025,48 @@ else {
     PSL = PSL | PSL_FPD;
     }
 R[2] = R[2] & STR_LNMASK;                               /* mask src2len */
-for (s1 = s2 = 0; ((R[0] | R[2]) & STR_LNMASK) != 0; extra_bytes++) {
-    if (R[0] & STR_LNMASK)                              /* src1? read */
-        s1 = Read (R[1], L_BYTE, RA);
-    else s1 = fill;                                     /* no, use fill */
-    if (R[2])                                           /* src2? read */
-        s2 = Read (R[3], L_BYTE, RA);
-    else s2 = fill;                                     /* no, use fill */
-    if (s1 != s2)                                       /* src1 = src2? */
-        break;
-    if (R[0] & STR_LNMASK) {                            /* if src1, decr */
-        R[0] = (R[0] & ~STR_LNMASK) | ((R[0] - 1) & STR_LNMASK);
-        R[1] = R[1] + 1;
+for (s1 = s2 = 0; ((R[0] | R[2]) & STR_LNMASK) != 0; ) {
+    lnt = (R[0] & STR_LNMASK)? (R[0] & STR_LNMASK): R[2];
+    if (R[2] && (R[2] < lnt))                           /* run length */
+        lnt = R[2];
+    p1 = p2 = NULL;
+    if (R[0] & STR_LNMASK)                              /* src1? translate */
+        lnt = str_run_lnt (R[1], lnt, FALSE);
+    if (R[2])                                           /* src2? translate */
+        lnt = str_run_lnt (R[3], lnt, FALSE);
+    if (R[0] & STR_LNMASK)
+        p1 = str_run_ptr (R[1], lnt, RA);
+    if (R[2])
+        p2 = str_run_ptr (R[3], lnt, RA);
+    if (p1 && p2 && (memcmp (p1, p2, lnt) == 0)) {      /* equal run? */
+        s1 = s2 = p1[lnt - 1];
+        R[0] = (R[0] & ~STR_LNMASK) | ((R[0] - lnt) & STR_LNMASK);
+        R[1] = R[1] + lnt;
+        R[2] = (R[2] - lnt) & STR_LNMASK;
+        R[3] = R[3] + lnt;
+        extra_bytes = extra_bytes + lnt;
+        continue;
         }
-    if (R[2]) {                                         /* if src2, decr */
-        R[2] = (R[2] - 1) & STR_LNMASK;
-        R[3] = R[3] + 1;
+    for (j = 0; j < lnt; j++, extra_bytes++) {
+        if (R[0] & STR_LNMASK)                          /* src1? read */
+            s1 = p1? p1[j]: Read (R[1], L_BYTE, RA);
+        else s1 = fill;                                 /* no, use fill */
+        if (R[2])                                       /* src2? read */
+            s2 = p2? p2[j]: Read (R[3], L_BYTE, RA);
+        else s2 = fill;                                 /* no, use fill */
+        if (s1 != s2)                                   /* src1 = src2? */
+            break;
+        if (R[0] & STR_LNMASK) {                        /* if src1, decr */
+            R[0] = (R[0] & ~STR_LNMASK) | ((R[0] - 1) & STR_LNMASK);
+            R[1] = R[1] + 1;
+            }
+        if (R[2]) {                                     /* if src2, decr */
+            R[2] = (R[2] - 1) & STR_LNMASK;
+            R[3] = R[3] + 1;
+            }
         }
+    if (j < lnt)                                        /* mismatch? */
+        break;
     }
 PSL = PSL & ~PSL_FPD;                                   /* clear FPD */
 CC_CMP_B (s1, s2);                                      /* set cc's */
@@ -1013,6 +1089,8 @@ return cc;
 int32 op_locskp (int32 *opnd, int32 skpc, int32 acc)
 {
 int32 c, match;
+int32 j, lnt;
+uint8 *p;
 
 if (PSL & PSL_FPD) {                                    /* FPD set? */
     SETPC (fault_PC + STR_GETDPC (R[0]));               /* reset PC */
@@ -1024,12 +1102,19 @@ else {
     R[1] = opnd[2];                                     /* src addr */
     PSL = PSL | PSL_FPD;
     }
-for ( ; (R[0] & STR_LNMASK) != 0; extra_bytes++ ) {    /* loop thru string */
-    c = Read (R[1], L_BYTE, RA);                        /* get src byte */
-    if ((c == match) ^ skpc)                            /* match & locc? */
+while ((R[0] & STR_LNMASK) != 0) {                     /* loop thru string */
+    lnt = str_run_lnt (R[1], R[0] & STR_LNMASK, FALSE); /* by page runs */
+    p = str_run_ptr (R[1], lnt, RA);
+    for (j = 0; j < lnt; j++) {
+        c = p? p[j]: Read (R[1] + j, L_BYTE, RA);       /* get src byte */
+        if ((c == match) ^ skpc)                        /* match & locc? */
+            break;
+        }
+    R[0] = (R[0] & ~STR_LNMASK) | ((R[0] - j) & STR_LNMASK);
+    R[1] = R[1] + j;                                    /* incr src1adr */
+    extra_bytes = extra_bytes + j;
+    if (j < lnt)                                        /* found? */
         break;
-    R[0] = (R[0] & ~STR_LNMASK) | ((R[0] - 1) & STR_LNMASK);
-    R[1] = R[1] + 1;                                    /* incr src1adr */
     }
 PSL = PSL & ~PSL_FPD;                                   /* clear FPD */
 R[0] = R[0] & STR_LNMASK;                               /* clear packup */
@@ -1053,6 +1138,8 @@ return (R[0]? 0: CC_Z);                                 /* set cc's */
 int32 op_scnspn (int32 *opnd, int32 spanc, int32 acc)
 {
 int32 c, t, mask;
+int32 j, lnt;
+uint8 *p;
 
 if (PSL & PSL_FPD) {                                    /* FPD set? */
     SETPC (fault_PC + STR_GETDPC (R[0]));               /* reset PC */
@@ -1065,13 +1152,20 @@ else {
     R[0] = STR_PACK (mask, opnd[0]);                    /* srclen + FPD data */
     PSL = PSL | PSL_FPD;
     }
-for ( ; (R[0] & STR_LNMASK) != 0; extra_bytes++ ) {    /* loop thru string */
-    c = Read (R[1], L_BYTE, RA);                        /* get byte */
-    t = Read (R[3] + c, L_BYTE, RA);                    /* get table ent */
-    if (((t & mask) != 0) ^ spanc)                      /* test vs instr */
+while ((R[0] & STR_LNMASK) != 0) {                     /* loop thru string */
+    lnt = str_run_lnt (R[1], R[0] & STR_LNMASK, FALSE); /* by page runs */
+    p = str_run_ptr (R[1], lnt, RA);
+    for (j = 0; j < lnt; j++) {
+        c = p? p[j]: Read (R[1] + j, L_BYTE, RA);       /* get byte */
+        t = Read (R[3] + c, L_BYTE, RA);                /* get table ent */
+        if (((t & mask) != 0) ^ spanc)                  /* test vs instr */
+            break;
+        }
+    R[0] = (R[0] & ~STR_LNMASK) | ((R[0] - j) & STR_LNMASK);
+    R[1] = R[1] + j;
+    extra_bytes = extra_bytes + j;
+    if (j < lnt)                                        /* found? */
         break;
-    R[0] = (R[0] & ~STR_LNMASK) | ((R[0] - 1) & STR_LNMASK);
-    R[1] = R[1] + 1;
     }
 PSL = PSL & ~PSL_FPD;
 R[0] = R[0] & STR_LNMASK;                               /* clear packup */
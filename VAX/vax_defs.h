@@ -623,7 +623,20 @@ enum opcodes {
 #define JUMP(d)         do {PCQ_ENTRY; PC = (d); FLUSH_ISTR; CHECK_FOR_IDLE_LOOP; } while (0)
 #define CMODE_JUMP(d)   do {PCQ_ENTRY; PC = (d); CHECK_FOR_IDLE_LOOP; } while (0)
 #define SETPC(d)        PC = (d), FLUSH_ISTR
-#define FLUSH_ISTR      ibcnt = 0, ppc = -1
+#define FLUSH_ISTR      ibcnt = 0, ppc = -1, dc_ppc = -1
+
+/* Decoded instruction cache - physical memory writes bump the generation
+   of any page holding decoded instructions (odd generation), which
+   invalidates every entry decoded from that page.  They also mark the
+   written block for SAVE -I once a SAVE or RESTORE has asked for the
+   block map (mem_dirty).  Every use writes within one page. */
+
+#define DC_WRITE(pa)    do { \
+                            if (dc_pgen && (dc_pgen[((uint32) (pa)) >> VA_N_OFF] & 1)) \
+                                dc_pgen[((uint32) (pa)) >> VA_N_OFF]++; \
+                            if (mem_dirty) \
+                                mem_dirty[((uint32) (pa)) >> mem_dirty_shift] = 1; \
+                            } while (0)
 
 /* Character string instructions */
 
@@ -806,6 +819,10 @@ extern int32 pcq[PCQ_SIZE];                             /* PC queue */
 extern int32 pcq_p;                                     /* PC queue ptr */
 extern int32 in_ie;                                     /* in exc, int */
 extern int32 ibcnt, ppc;                                /* prefetch ctl */
+extern int32 dc_ppc;                                    /* decode cache phys PC */
+extern uint32 *dc_pgen;                                 /* decode cache page generations */
+extern uint8 *mem_dirty;                                /* SAVE -I written block map */
+extern uint32 mem_dirty_shift;                          /* log2 of its block size */
 extern int32 hlt_pin;                                   /* HLT pin intr */
 extern int32 mem_err;
 extern int32 crd_err;
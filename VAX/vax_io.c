@@ -577,6 +577,7 @@ if (ADDR_IS_MEM (ma)) {
         val = ((val & mask) << sc) | (t & ~(mask << sc));
         }
     M[ma >> 2] = val;
+    DC_WRITE (ma);
     }
 else {
     cq_serr (ma);                                       /* error */
@@ -617,6 +618,7 @@ if (qba_map_addr (qa, &ma)) {                           /* map addr */
         val = ((val & mask) << sc) | (t & ~(mask << sc));
         }
     M[ma >> 2] = val;
+    DC_WRITE (ma);
     }
 else {
     if (ADDR_IS_QVM(pa) && vc_buf)                      /* QVSS Memory */
@@ -727,13 +729,27 @@ return SCPE_OK;
    Map_ReadW    -       fetch word buffer from memory
    Map_WriteB   -       store byte buffer into memory
    Map_WriteW   -       store word buffer into memory
+
+   On a little endian host, each Qbus map page is resolved once and
+   copied directly to or from memory.
 */
 
 int32 Map_ReadB (uint32 ba, int32 bc, uint8 *buf)
 {
-int32 i;
+int32 i, pbc;
 uint32 ma, dat;
 
+if (sim_end) {                                          /* LE host? by pages */
+    for (i = 0; i < bc; i = i + pbc) {
+        if (!qba_map_addr (ba + i, &ma))                /* inv or NXM? */
+            return (bc - i);
+        pbc = VA_PAGSIZE - VA_GETOFF (ma);              /* left in page */
+        if (pbc > (bc - i))                             /* limit to rem xfr */
+            pbc = bc - i;
+        memcpy (buf + i, ((uint8 *) M) + ma, pbc);
+        }
+    return 0;
+    }
 if ((ba | bc) & 03) {                                   /* check alignment */
     for (i = ma = 0; i < bc; i++, buf++) {              /* by bytes */
         if ((ma & VA_M_OFF) == 0) {                     /* need map? */
@@ -763,11 +779,22 @@ return 0;
 
 int32 Map_ReadW (uint32 ba, int32 bc, uint16 *buf)
 {
-int32 i;
+int32 i, pbc;
 uint32 ma,dat;
 
 ba = ba & ~01;
 bc = bc & ~01;
+if (sim_end) {                                          /* LE host? by pages */
+    for (i = 0; i < bc; i = i + pbc) {
+        if (!qba_map_addr (ba + i, &ma))                /* inv or NXM? */
+            return (bc - i);
+        pbc = VA_PAGSIZE - VA_GETOFF (ma);              /* left in page */
+        if (pbc > (bc - i))                             /* limit to rem xfr */
+            pbc = bc - i;
+        memcpy (((uint8 *) buf) + i, ((uint8 *) M) + ma, pbc);
+        }
+    return 0;
+    }
 if ((ba | bc) & 03) {                                   /* check alignment */
     for (i = ma = 0; i < bc; i = i + 2, buf++) {        /* by words */
         if ((ma & VA_M_OFF) == 0) {                     /* need map? */
@@ -795,9 +822,21 @@ return 0;
 
 int32 Map_WriteB (uint32 ba, int32 bc, const uint8 *buf)
 {
-int32 i;
+int32 i, pbc;
 uint32 ma, dat;
 
+if (sim_end) {                                          /* LE host? by pages */
+    for (i = 0; i < bc; i = i + pbc) {
+        if (!qba_map_addr (ba + i, &ma))                /* inv or NXM? */
+            return (bc - i);
+        pbc = VA_PAGSIZE - VA_GETOFF (ma);              /* left in page */
+        if (pbc > (bc - i))                             /* limit to rem xfr */
+            pbc = bc - i;
+        memcpy (((uint8 *) M) + ma, buf + i, pbc);
+        DC_WRITE (ma);
+        }
+    return 0;
+    }
 if ((ba | bc) & 03) {                                   /* check alignment */
     for (i = ma = 0; i < bc; i++, buf++) {              /* by bytes */
         if ((ma & VA_M_OFF) == 0) {                     /* need map? */
@@ -827,11 +866,23 @@ return 0;
 
 int32 Map_WriteW (uint32 ba, int32 bc, const uint16 *buf)
 {
-int32 i;
+int32 i, pbc;
 uint32 ma, dat;
 
 ba = ba & ~01;
 bc = bc & ~01;
+if (sim_end) {                                          /* LE host? by pages */
+    for (i = 0; i < bc; i = i + pbc) {
+        if (!qba_map_addr (ba + i, &ma))                /* inv or NXM? */
+            return (bc - i);
+        pbc = VA_PAGSIZE - VA_GETOFF (ma);              /* left in page */
+        if (pbc > (bc - i))                             /* limit to rem xfr */
+            pbc = bc - i;
+        memcpy (((uint8 *) M) + ma, ((const uint8 *) buf) + i, pbc);
+        DC_WRITE (ma);
+        }
+    return 0;
+    }
 if ((ba | bc) & 03) {                                   /* check alignment */
     for (i = ma = 0; i < bc; i = i + 2, buf++) {        /* by words */
         if ((ma & VA_M_OFF) == 0) {                     /* need map? */
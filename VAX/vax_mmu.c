@@ -47,6 +47,21 @@
         zap_tb_ent      -       clear TB entry
         chk_tb_ent      -       check TB entry
         set_map_reg     -       set up working map registers
+
+   The system and process translation buffers are each organized as
+   tlb_size / tlb_ways sets of tlb_ways entries.  Within a set, the
+   entries are kept in most to least recently used order, so way 0 is
+   the only one probed by the inline Read/Write/Test paths.  On a way 0
+   miss, fill searches the remaining ways and promotes a hit to way 0;
+   otherwise it walks the page table and replaces the least recently
+   used entry.  The ways of a set are tlb_set_mask + 1 entries apart,
+   so way 0 of every set is indexed by the vpn masked, as in the
+   original single level TB.  The default geometry (4096 entries,
+   direct mapped) matches that TB.
+
+   Inline hits are only counted after SET TLB STATISTICS; misses and
+   fills are always counted.  The associativity is kept in u3 of both
+   TLB units, so SAVE and RESTORE carry it with the TB contents.
 */
 
 #include "vax_defs.h"
@@ -56,7 +71,16 @@
 int32 d_p0br, d_p0lr;                                   /* dynamic copies */
 int32 d_p1br, d_p1lr;                                   /* altered per ucode */
 int32 d_sbr, d_slr;
-TLBENT stlb[VA_TBSIZE], ptlb[VA_TBSIZE];
+static TLBENT stlb_def[VA_TBSIZE], ptlb_def[VA_TBSIZE];
+TLBENT *stlb = stlb_def;                                /* system TB */
+TLBENT *ptlb = ptlb_def;                                /* process TB */
+uint32 tlb_size = VA_TBSIZE;                            /* TB entries */
+uint32 tlb_ways = 1;                                    /* TB associativity */
+uint32 tlb_set_mask = VA_M_TBI;                         /* sets - 1 */
+int32 tlb_stats = 0;                                    /* count hits */
+t_uint64 tlb_hits = 0;                                  /* TB statistics */
+t_uint64 tlb_misses = 0;
+t_uint64 tlb_fills = 0;
 static const int32 cvtacc[16] = { 0, 0,
     TLB_ACCW (KERN)+TLB_ACCR (KERN),
     TLB_ACCR (KERN),
@@ -83,7 +107,15 @@ static const int32 cvtacc[16] = { 0, 0,
 t_stat tlb_ex (t_value *vptr, t_addr addr, UNIT *uptr, int32 sw);
 t_stat tlb_dep (t_value val, t_addr addr, UNIT *uptr, int32 sw);
 t_stat tlb_reset (DEVICE *dptr);
+t_stat tlb_set_geom (UNIT *uptr, int32 val, CONST char *cptr, void *desc);
+t_stat tlb_show_geom (FILE *st, UNIT *uptr, int32 val, CONST void *desc);
+t_stat tlb_set_stats (UNIT *uptr, int32 val, CONST char *cptr, void *desc);
+t_stat tlb_show_stats (FILE *st, UNIT *uptr, int32 val, CONST void *desc);
+t_stat tlb_set_msize (UNIT *uptr, int32 val, CONST char *cptr, void *desc);
+t_stat tlb_help (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, const char *cptr);
 const char *tlb_description (DEVICE *dptr);
+static t_stat tlb_resize (uint32 size, uint32 ways);
+static uint32 tlb_saved_ways (UNIT *uptr, uint32 size);
 
 TLBENT fill (uint32 va, int32 lnt, int32 acc, int32 *stat);
 extern int32 ReadIO (uint32 pa, int32 lnt);
@@ -105,18 +137,84 @@ UNIT tlb_unit[] = {
     { UDATA (NULL, UNIT_FIX, VA_TBSIZE * 2) }
     };
 
+#define tlb_uways       u3                              /* unit: TB ways */
+
 REG tlb_reg[] = {
+    { DRDATAD (HITS,     tlb_hits, 64, "TB hits"), PV_LEFT },
+    { DRDATAD (MISSES, tlb_misses, 64, "TB misses (page table walks)"), PV_LEFT },
+    { DRDATAD (FILLS,   tlb_fills, 64, "TB entries loaded"), PV_LEFT },
+    { FLDATAD (STATS,   tlb_stats,  0, "TB hits counted") },
     { NULL }
     };
 
+MTAB tlb_mod[] = {
+    { MTAB_XTD|MTAB_VDV|MTAB_VALR, 0, "GEOMETRY", "SIZE",
+      &tlb_set_geom, &tlb_show_geom, NULL, "Set the number of entries in each TB (power of 2)" },
+    { MTAB_XTD|MTAB_VDV|MTAB_VALR, 1, NULL, "WAYS",
+      &tlb_set_geom, NULL, NULL, "Set the TB associativity (power of 2)" },
+    { MTAB_XTD|MTAB_VDV|MTAB_NMO, 1, "STATISTICS", "STATISTICS",
+      &tlb_set_stats, &tlb_show_stats, NULL, "Count TB hits/Display TB statistics" },
+    { MTAB_XTD|MTAB_VDV, 0, NULL, "NOSTATISTICS",
+      &tlb_set_stats, NULL, NULL, "Stop counting TB hits" },
+    { 0 }
+    };
+
 DEVICE tlb_dev = {
-    "TLB", tlb_unit, tlb_reg, NULL,
+    "TLB", tlb_unit, tlb_reg, tlb_mod,
     2, 16, VA_N_TBI * 2, 1, 16, 32,
     &tlb_ex, &tlb_dep, &tlb_reset,
-    NULL, NULL, NULL, NULL, 0, 0, NULL, NULL, NULL, NULL, NULL, NULL, 
+    NULL, NULL, NULL, NULL, DEV_DYNM, 0, NULL, &tlb_set_msize, NULL, &tlb_help, NULL, NULL, 
     &tlb_description
     };
 
+/* TB set search and replacement
+
+   tlb_find searches a set for vpn; if found (with sufficient access,
+   if acc is non-zero), the entry is moved to way 0 and TRUE is returned.
+   tlb_insert loads vpn into way 0 of a set, replacing an existing entry
+   for vpn, or else the least recently used entry.  TLB_WAY addresses
+   way w of the set starting at way 0 entry set.
+*/
+
+#define TLB_WAY(set,w)  ((set)[(w) * (tlb_set_mask + 1)])
+
+static t_bool tlb_find (TLBENT *set, int32 vpn, int32 acc)
+{
+uint32 w;
+TLBENT ent;
+
+for (w = 0; w < tlb_ways; w++) {
+    ent = TLB_WAY (set, w);
+    if (ent.tag == vpn) {
+        if (acc && (((ent.pte & acc) == 0) ||
+            ((acc & TLB_WACC) && ((ent.pte & TLB_M) == 0))))
+            return FALSE;                               /* must refill */
+        for ( ; w > 0; w--)                             /* promote to MRU */
+            TLB_WAY (set, w) = TLB_WAY (set, w - 1);
+        set[0] = ent;
+        if (tlb_stats)
+            tlb_hits++;
+        return TRUE;
+        }
+    }
+return FALSE;
+}
+
+static void tlb_insert (TLBENT *set, int32 vpn, int32 pte)
+{
+uint32 w;
+
+for (w = 0; w < (tlb_ways - 1); w++) {                  /* find vpn or LRU */
+    if (TLB_WAY (set, w).tag == vpn)
+        break;
+    }
+for ( ; w > 0; w--)                                     /* age the others */
+    TLB_WAY (set, w) = TLB_WAY (set, w - 1);
+set[0].tag = vpn;
+set[0].pte = pte;
+tlb_fills++;
+}
+
 
 /* TLB fill
 
@@ -141,9 +239,16 @@ DEVICE tlb_dev = {
 TLBENT fill (uint32 va, int32 lnt, int32 acc, int32 *stat)
 {
 int32 ptidx = (((uint32) va) >> 7) & ~03;
-int32 tlbpte, ptead, pte, tbi, vpn;
+int32 tlbpte, ptead, pte, vpn;
+TLBENT *set;
 static TLBENT zero_pte = { 0, 0 };
 
+vpn = VA_GETVPN (va);
+set = ((va & VA_S0)? stlb: ptlb) + TLB_SET (vpn);
+if (tlb_find (set, vpn, acc))                           /* in another way? */
+    return set[0];
+tlb_misses++;
+
 if (va & VA_S0) {                                       /* system space? */
     if (ptidx >= d_slr)                                 /* system */
         MM_ERR (PR_LNV);
@@ -163,9 +268,10 @@ else {
 #if !defined (VAX_620)
     if ((ptead & VA_S0) == 0)
         ABORT (STOP_PPTE);                              /* ppte must be sys */
-    vpn = VA_GETVPN (ptead);                            /* get vpn, tbi */
-    tbi = VA_GETTBI (vpn);
-    if (stlb[tbi].tag != vpn) {                         /* in sys tlb? */
+    vpn = VA_GETVPN (ptead);                            /* get vpn, set */
+    set = stlb + TLB_SET (vpn);
+    if (!tlb_find (set, vpn, 0)) {                      /* in sys tlb? */
+        tlb_misses++;
         ptidx = ((uint32) ptead) >> 7;                  /* xlate like sys */
         if (ptidx >= d_slr)
             MM_ERR (PR_PLNV);
@@ -176,11 +282,10 @@ else {
 #endif
         if ((pte & PTE_V) == 0)                         /* spte TNV? */
             MM_ERR (PR_PTNV);
-        stlb[tbi].tag = vpn;                            /* set stlb tag */
-        stlb[tbi].pte = cvtacc[PTE_GETACC (pte)] |
-            ((pte << VA_N_OFF) & TLB_PFN);              /* set stlb data */
+        tlb_insert (set, vpn, cvtacc[PTE_GETACC (pte)] |
+            ((pte << VA_N_OFF) & TLB_PFN));             /* set stlb entry */
         }
-    ptead = (stlb[tbi].pte & TLB_PFN) | VA_GETOFF (ptead);
+    ptead = (set[0].pte & TLB_PFN) | VA_GETOFF (ptead);
 #endif
     }
 pte = ReadL (ptead);                                    /* read pte */
@@ -196,15 +301,9 @@ if (acc & TLB_WACC) {                                   /* write? */
     tlbpte = tlbpte | TLB_M;                            /* set M */
     }
 vpn = VA_GETVPN (va);
-tbi = VA_GETTBI (vpn);
-if ((va & VA_S0) == 0) {                                /* process space? */
-    ptlb[tbi].tag = vpn;                                /* store tlb ent */
-    ptlb[tbi].pte = tlbpte;
-    return ptlb[tbi];
-    }
-stlb[tbi].tag = vpn;                                    /* system space */
-stlb[tbi].pte = tlbpte;                                 /* store tlb ent */
-return stlb[tbi];
+set = ((va & VA_S0)? stlb: ptlb) + TLB_SET (vpn);
+tlb_insert (set, vpn, tlbpte);                          /* store tlb ent */
+return set[0];
 }
 
 /* Utility routines */
@@ -225,22 +324,31 @@ void zap_tb (int stb)
 {
 size_t i;
 
-for (i = 0; i < VA_TBSIZE; i++) {
+for (i = 0; i < tlb_size; i++) {
     ptlb[i].tag = ptlb[i].pte = -1;
     if (stb)
         stlb[i].tag = stlb[i].pte = -1;
     }
+dc_ppc = -1;                                            /* retranslate PC */
 }
 
 /* Zap single tb entry corresponding to va */
 
 void zap_tb_ent (uint32 va)
 {
-int32 tbi = VA_GETTBI (VA_GETVPN (va));
-
-if (va & VA_S0)
-    stlb[tbi].tag = stlb[tbi].pte = -1;
-else ptlb[tbi].tag = ptlb[tbi].pte = -1;
+int32 vpn = VA_GETVPN (va);
+TLBENT *set = ((va & VA_S0)? stlb: ptlb) + TLB_SET (vpn);
+uint32 w;
+
+for (w = 0; w < tlb_ways; w++) {
+    if (TLB_WAY (set, w).tag == vpn) {                  /* move to LRU, clear */
+        for ( ; w < (tlb_ways - 1); w++)
+            TLB_WAY (set, w) = TLB_WAY (set, w + 1);
+        TLB_WAY (set, w).tag = TLB_WAY (set, w).pte = -1;
+        break;
+        }
+    }
+dc_ppc = -1;                                            /* retranslate PC */
 }
 
 /* Check for tlb entry corresponding to va */
@@ -248,12 +356,13 @@ else ptlb[tbi].tag = ptlb[tbi].pte = -1;
 t_bool chk_tb_ent (uint32 va)
 {
 int32 vpn = VA_GETVPN (va);
-int32 tbi = VA_GETTBI (vpn);
-TLBENT xpte;
+TLBENT *set = ((va & VA_S0)? stlb: ptlb) + TLB_SET (vpn);
+uint32 w;
 
-xpte = (va & VA_S0)? stlb[tbi]: ptlb[tbi];
-if (xpte.tag == vpn)
-    return TRUE;
+for (w = 0; w < tlb_ways; w++) {
+    if (TLB_WAY (set, w).tag == vpn)
+        return TRUE;
+    }
 return FALSE;
 }
 
@@ -264,7 +373,7 @@ t_stat tlb_ex (t_value *vptr, t_addr addr, UNIT *uptr, int32 sw)
 int32 tlbn = uptr - tlb_unit;
 uint32 idx = (uint32) addr >> 1;
 
-if (idx >= VA_TBSIZE)
+if (idx >= tlb_size)
     return SCPE_NXM;
 if (addr & 1)
     *vptr = ((uint32) (tlbn? stlb[idx].pte: ptlb[idx].pte));
@@ -278,8 +387,15 @@ t_stat tlb_dep (t_value val, t_addr addr, UNIT *uptr, int32 sw)
 {
 int32 tlbn = uptr - tlb_unit;
 uint32 idx = (uint32) addr >> 1;
+uint32 ways = tlb_saved_ways (uptr, tlb_size);
+t_stat r;
 
-if (idx >= VA_TBSIZE)
+if (ways != tlb_ways) {                                 /* RESTORE of ways? */
+    r = tlb_resize (tlb_size, ways);
+    if (r != SCPE_OK)
+        return r;
+    }
+if (idx >= tlb_size)
     return SCPE_NXM;
 if (addr & 1) {
     if (tlbn) stlb[idx].pte = (int32) val;
@@ -298,8 +414,141 @@ t_stat tlb_reset (DEVICE *dptr)
 {
 size_t i;
 
-for (i = 0; i < VA_TBSIZE; i++)
+for (i = 0; i < tlb_size; i++)
     stlb[i].tag = ptlb[i].tag = stlb[i].pte = ptlb[i].pte = -1;
+tlb_unit[0].tlb_uways = tlb_unit[1].tlb_uways = (int32) tlb_ways;
+return SCPE_OK;
+}
+
+/* Change TB geometry - contents are discarded */
+
+static t_stat tlb_resize (uint32 size, uint32 ways)
+{
+TLBENT *ns, *np;
+
+if ((size < 16) || (size > (1u << 16)) || (size & (size - 1)) ||
+    (ways < 1) || (ways > 16) || (ways & (ways - 1)) || (ways > size))
+    return SCPE_ARG;
+if (size == VA_TBSIZE) {                                /* default size? */
+    ns = stlb_def;
+    np = ptlb_def;
+    }
+else if (size == tlb_size) {                            /* same size? */
+    ns = stlb;
+    np = ptlb;
+    }
+else {
+    ns = (TLBENT *) malloc (size * sizeof (TLBENT));
+    np = (TLBENT *) malloc (size * sizeof (TLBENT));
+    if ((ns == NULL) || (np == NULL)) {
+        free (ns);
+        free (np);
+        return SCPE_MEM;
+        }
+    }
+if ((stlb != ns) && (stlb != stlb_def)) {               /* free old tables */
+    free (stlb);
+    free (ptlb);
+    }
+stlb = ns;
+ptlb = np;
+tlb_size = size;
+tlb_ways = ways;
+tlb_set_mask = (size / ways) - 1;
+tlb_unit[0].capac = tlb_unit[1].capac = size * 2;
+tlb_unit[0].tlb_uways = tlb_unit[1].tlb_uways = (int32) ways;
+tlb_hits = tlb_misses = tlb_fills = 0;                  /* restart statistics */
+zap_tb (1);                                             /* flush, retranslate PC */
+return SCPE_OK;
+}
+
+/* SET TLB SIZE=n, SET TLB WAYS=n */
+
+t_stat tlb_set_geom (UNIT *uptr, int32 val, CONST char *cptr, void *desc)
+{
+uint32 num;
+t_stat r;
+
+if (cptr == NULL)
+    return SCPE_ARG;
+num = (uint32) get_uint (cptr, 10, 1u << 16, &r);
+if (r != SCPE_OK)
+    return r;
+if (val)
+    return tlb_resize (tlb_size, num);
+return tlb_resize (num, (tlb_ways > num)? num: tlb_ways);
+}
+
+/* Associativity to use for a unit's TB contents
+
+   RESTORE reads a unit's u3 (the saved ways) before its capacity and
+   contents, so tlb_set_msize and the first tlb_dep see the saved
+   geometry.  Files saved before the ways were kept have u3 = 0.
+*/
+
+static uint32 tlb_saved_ways (UNIT *uptr, uint32 size)
+{
+uint32 ways = (uptr->tlb_uways > 0)? (uint32) uptr->tlb_uways: tlb_ways;
+
+return (ways > size)? size: ways;
+}
+
+/* Memory size change on RESTORE - capacity is two words per entry */
+
+t_stat tlb_set_msize (UNIT *uptr, int32 val, CONST char *cptr, void *desc)
+{
+uint32 size = ((uint32) val) >> 1;
+
+return tlb_resize (size, tlb_saved_ways (uptr, size));
+}
+
+t_stat tlb_show_geom (FILE *st, UNIT *uptr, int32 val, CONST void *desc)
+{
+fprintf (st, "size=%u, ways=%u", tlb_size, tlb_ways);
+return SCPE_OK;
+}
+
+/* SET TLB STATISTICS, SET TLB NOSTATISTICS - enabling restarts the counts */
+
+t_stat tlb_set_stats (UNIT *uptr, int32 val, CONST char *cptr, void *desc)
+{
+if (cptr != NULL)
+    return SCPE_ARG;
+if (val && !tlb_stats)
+    tlb_hits = tlb_misses = tlb_fills = 0;
+tlb_stats = val;
+return SCPE_OK;
+}
+
+t_stat tlb_show_stats (FILE *st, UNIT *uptr, int32 val, CONST void *desc)
+{
+double total = (double) tlb_hits + (double) tlb_misses;
+
+fprintf (st, "translation buffers: %u entries each, %u way%s\n",
+    tlb_size, tlb_ways, (tlb_ways == 1)? "": "s");
+if (tlb_stats)
+    fprintf (st, "  hits:   %.0f (%.2f%%)\n", (double) tlb_hits,
+        (total > 0.0)? (100.0 * (double) tlb_hits) / total: 0.0);
+else fprintf (st, "  hits:   not counted (SET TLB STATISTICS)\n");
+fprintf (st, "  misses: %.0f\n", (double) tlb_misses);
+fprintf (st, "  fills:  %.0f\n", (double) tlb_fills);
+return SCPE_OK;
+}
+
+t_stat tlb_help (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, const char *cptr)
+{
+fprintf (st, "Translation Buffer (TLB)\n\n");
+fprintf (st, "The TLB device models the system (unit 1) and process (unit 0) translation\n");
+fprintf (st, "buffers.  Each holds SIZE entries organized as SIZE/WAYS sets with least\n");
+fprintf (st, "recently used replacement within a set.  The default geometry is 4096\n");
+fprintf (st, "entries, direct mapped; changing it discards the current contents.\n\n");
+fprintf (st, "   sim> SET TLB SIZE=4096,WAYS=4        4096 entries, 4 way set associative\n");
+fprintf (st, "   sim> SET TLB STATISTICS              start counting hits\n");
+fprintf (st, "   sim> SHOW TLB STATISTICS             display hit/miss statistics\n\n");
+fprintf (st, "SIZE may be 16 to 65536 and WAYS 1 to 16; both must be powers of 2.\n");
+fprintf (st, "Hits are not counted by default, since counting slows every translation;\n");
+fprintf (st, "SET TLB NOSTATISTICS stops counting them.\n");
+fprint_reg_help (st, dptr);
 return SCPE_OK;
 }
 
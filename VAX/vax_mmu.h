@@ -62,7 +62,18 @@ extern DEVICE cpu_dev;
 extern int32 mapen;                                     /* map enable */
 
 extern int32 mchk_va, mchk_ref;                         /* for mcheck */
-extern TLBENT stlb[VA_TBSIZE], ptlb[VA_TBSIZE];
+extern TLBENT *stlb, *ptlb;                             /* system, process TB */
+extern uint32 tlb_set_mask;                             /* sets - 1 */
+extern int32 tlb_stats;                                 /* count hits */
+extern t_uint64 tlb_hits;                               /* TB statistics */
+
+/* The translation buffers are set associative: way 0 of each set holds
+   the most recently used entry and is probed inline; the other ways are
+   searched (and the LRU order maintained) by fill.  Way w of set s is
+   entry s + w * (tlb_set_mask + 1), so the way 0 entries are the first
+   tlb_set_mask + 1 entries and the inline probe is a single mask. */
+
+#define TLB_SET(vpn)    ((vpn) & tlb_set_mask)
 
 static const int32 insert[4] = {
     0x00000000, 0x000000FF, 0x0000FFFF, 0x00FFFFFF
@@ -126,11 +137,13 @@ mchk_va = va;
 if (mapen) {                                            /* mapping on? */
     vpn = VA_GETVPN (va);                               /* get vpn, offset */
     off = VA_GETOFF (va);
-    tbi = VA_GETTBI (vpn);
+    tbi = TLB_SET (vpn);
     xpte = (va & VA_S0)? stlb[tbi]: ptlb[tbi];          /* access tlb */
     if (((xpte.pte & acc) == 0) || (xpte.tag != vpn) ||
         ((acc & TLB_WACC) && ((xpte.pte & TLB_M) == 0)))
         xpte = fill (va, lnt, acc, NULL);               /* fill if needed */
+    else if (tlb_stats)                                 /* counting hits? */
+        tlb_hits++;
     pa = (xpte.pte & TLB_PFN) | off;                    /* get phys addr */
     }
 else {
@@ -146,11 +159,13 @@ if ((pa & (lnt - 1)) == 0) {                            /* aligned? */
     }
 if (mapen && ((uint32)(off + lnt) > VA_PAGSIZE)) {      /* cross page? */
     vpn = VA_GETVPN (va + lnt);                         /* vpn 2nd page */
-    tbi = VA_GETTBI (vpn);
+    tbi = TLB_SET (vpn);
     xpte = (va & VA_S0)? stlb[tbi]: ptlb[tbi];          /* access tlb */
     if (((xpte.pte & acc) == 0) || (xpte.tag != vpn) ||
         ((acc & TLB_WACC) && ((xpte.pte & TLB_M) == 0)))
         xpte = fill (va + lnt, lnt, acc, NULL);         /* fill if needed */
+    else if (tlb_stats)                                 /* counting hits? */
+        tlb_hits++;
     pa1 = ((xpte.pte & TLB_PFN) | VA_GETOFF (va + 4)) & ~03;
     }
 else pa1 = ((pa + 4) & PAMASK) & ~03;                   /* not cross page */
@@ -191,11 +206,13 @@ mchk_va = va;
 if (mapen) {
     vpn = VA_GETVPN (va);
     off = VA_GETOFF (va);
-    tbi = VA_GETTBI (vpn);
+    tbi = TLB_SET (vpn);
     xpte = (va & VA_S0)? stlb[tbi]: ptlb[tbi];          /* access tlb */
     if (((xpte.pte & acc) == 0) || (xpte.tag != vpn) ||
         ((xpte.pte & TLB_M) == 0))
         xpte = fill (va, lnt, acc, NULL);
+    else if (tlb_stats)                                 /* counting hits? */
+        tlb_hits++;
     pa = (xpte.pte & TLB_PFN) | off;
     }
 else {
@@ -212,11 +229,13 @@ if ((pa & (lnt - 1)) == 0) {                            /* aligned? */
     }
 if (mapen && ((uint32)(off + lnt) > VA_PAGSIZE)) {
     vpn = VA_GETVPN (va + 4);
-    tbi = VA_GETTBI (vpn);
+    tbi = TLB_SET (vpn);
     xpte = (va & VA_S0)? stlb[tbi]: ptlb[tbi];          /* access tlb */
     if (((xpte.pte & acc) == 0) || (xpte.tag != vpn) ||
         ((xpte.pte & TLB_M) == 0))
         xpte = fill (va + lnt, lnt, acc, NULL);
+    else if (tlb_stats)                                 /* counting hits? */
+        tlb_hits++;
     pa1 = ((xpte.pte & TLB_PFN) | VA_GETOFF (va + 4)) & ~03;
     }
 else pa1 = ((pa + 4) & PAMASK) & ~03;
@@ -246,10 +265,13 @@ TLBENT xpte;
 if (mapen) {                                            /* mapping on? */
     vpn = VA_GETVPN (va);                               /* get vpn, off */
     off = VA_GETOFF (va);
-    tbi = VA_GETTBI (vpn);
+    tbi = TLB_SET (vpn);
     xpte = (va & VA_S0)? stlb[tbi]: ptlb[tbi];          /* access tlb */
-    if ((xpte.pte & acc) && (xpte.tag == vpn))          /* TB hit, acc ok? */ 
+    if ((xpte.pte & acc) && (xpte.tag == vpn)) {        /* TB hit, acc ok? */ 
+        if (tlb_stats)
+            tlb_hits++;
         return (xpte.pte & TLB_PFN) | off;
+        }
     xpte = fill (va, L_BYTE, acc, status);              /* fill TB */
     if (*status == PR_OK)
         return (xpte.pte & TLB_PFN) | off;
@@ -258,6 +280,37 @@ if (mapen) {                                            /* mapping on? */
 return va & PAMASK;                                     /* ret phys addr */
 }
 
+/* Translate virtual for a string instruction page run
+
+   Inputs:
+        va      =       virtual address
+        acc     =       access code (KESU, write access for a destination)
+   Output:
+        physical address of va; the rest of va's page is contiguous
+
+   Faults exactly as a Read (Write) of a byte at va would.
+*/
+
+static SIM_INLINE uint32 Translate (uint32 va, int32 acc)
+{
+int32 vpn, tbi;
+TLBENT xpte;
+
+mchk_va = va;
+if (mapen) {                                            /* mapping on? */
+    vpn = VA_GETVPN (va);                               /* get vpn */
+    tbi = TLB_SET (vpn);
+    xpte = (va & VA_S0)? stlb[tbi]: ptlb[tbi];          /* access tlb */
+    if (((xpte.pte & acc) == 0) || (xpte.tag != vpn) ||
+        ((acc & TLB_WACC) && ((xpte.pte & TLB_M) == 0)))
+        xpte = fill (va, L_BYTE, acc, NULL);            /* fill if needed */
+    else if (tlb_stats)                                 /* counting hits? */
+        tlb_hits++;
+    return (xpte.pte & TLB_PFN) | VA_GETOFF (va);
+    }
+return va & PAMASK;
+}
+
 /* Read aligned physical (in virtual context, unless indicated)
 
    Inputs:
@@ -357,6 +410,7 @@ if (ADDR_IS_MEM (pa)) {
     int32 sc = (pa & 3) << 3;
     int32 mask = 0xFF << sc;
     M[id] = (M[id] & ~mask) | (val << sc);
+    DC_WRITE (pa);
     }
 else {
     mchk_ref = REF_V;
@@ -373,6 +427,7 @@ if (ADDR_IS_MEM (pa)) {
     int32 id = pa >> 2;
     M[id] = (pa & 2)? (M[id] & 0xFFFF) | (val << 16):
         (M[id] & ~0xFFFF) | val;
+    DC_WRITE (pa);
     }
 else {
     mchk_ref = REF_V;
@@ -385,8 +440,10 @@ return;
 
 static SIM_INLINE void WriteL (uint32 pa, int32 val)
 {
-if (ADDR_IS_MEM (pa))
+if (ADDR_IS_MEM (pa)) {
     M[pa >> 2] = val;
+    DC_WRITE (pa);
+    }
 else {
     mchk_ref = REF_V;
     if (ADDR_IS_IO (pa))
@@ -398,8 +455,10 @@ return;
 
 static SIM_INLINE void WriteLP (uint32 pa, int32 val)
 {
-if (ADDR_IS_MEM (pa))
+if (ADDR_IS_MEM (pa)) {
     M[pa >> 2] = val;
+    DC_WRITE (pa);
+    }
 else {
     mchk_va = pa;
     mchk_ref = REF_P;
@@ -426,6 +485,7 @@ if (ADDR_IS_MEM (pa)) {
     int32 bo = pa & 3;
     int32 sc = bo << 3;
     M[pa >> 2] = (M[pa >> 2] & ~(insert[lnt] << sc)) | ((val & insert[lnt]) << sc);
+    DC_WRITE (pa);
     }
 else {
     mchk_ref = REF_V;
@@ -239,6 +239,7 @@ t_stat vc_detach (UNIT *dptr);
 t_stat vc_set_enable (UNIT *uptr, int32 val, CONST char *cptr, void *desc);
 t_stat vc_set_capture (UNIT *uptr, int32 val, CONST char *cptr, void *desc);
 t_stat vc_show_capture (FILE* st, UNIT* uptr, int32 val, CONST void* desc);
+t_stat vc_show_refresh (FILE* st, UNIT* uptr, int32 val, CONST void* desc);
 void vc_setint (int32 src);
 int32 vc_inta (void);
 void vc_clrint (int32 src);
@@ -332,6 +333,8 @@ MTAB vc_mod[] = {
         NULL, &vc_show_capture, NULL, "Display Input Capture mode" },
     { MTAB_XTD|MTAB_VDV|MTAB_NMO, 0, "VIDEO", NULL,
         NULL, &vid_show_video, NULL, "Display the host system video capabilities" },
+    { MTAB_XTD|MTAB_VDV|MTAB_NMO, 0, "REFRESH", NULL,
+        NULL, &vc_show_refresh, NULL, "Display the cost of a full screen refresh" },
     { MTAB_XTD|MTAB_VDV|MTAB_VALR, 004, "ADDRESS", "ADDRESS",
         &set_addr, &show_addr, NULL, "Bus address" },
     { MTAB_XTD|MTAB_VDV|MTAB_VALR, 0, "VECTOR", "VECTOR",
@@ -874,15 +877,49 @@ sim_debug (DBG_INT, &vc_dev, "Int Ack Vector: 0%03o\n", 0);
 return 0;                                               /* no intr req */
 }
 
+/* Render screen line ln from video memory into vc_lines, merging in the
+   cursor when it is drawn by the simulator.  The cursor is applied to a
+   copy of the line's bits, so the line is then expanded in one pass. */
+
+static void vc_render_line (uint32 ln)
+{
+uint32 line[VC_XSIZE >> 5];
+uint32 *src = &vc_buf[(vc_map[ln] & 0x7FF) * 32];       /* get video buf offset */
+uint32 bits, sh, wd, col;
+uint8 *cur;
+
+if (CUR_V &&                                            /* cursor visible && need to draw cursor? */
+    (vc_input_captured || (vc_dev.dctrl & DBG_CURSOR)) &&
+    (ln >= CUR_Y) && (ln < (CUR_Y + 16))) {             /* cursor on this line? */
+    cur = &vc_cur[((ln - CUR_Y) << 4)];                 /* get image base */
+    for (col = bits = 0; col < 16; col++)
+        bits |= (cur[col] & 1) << col;
+    memcpy (line, src, sizeof (line));
+    sh = CUR_X & 0x1F;
+    wd = CUR_X >> 5;
+    if (CUR_F) {                                        /* mask function */
+        line[wd] |= bits << sh;
+        if ((sh > 16) && ((wd + 1) < (VC_XSIZE >> 5)))  /* spills into next word on screen? */
+            line[wd + 1] |= bits >> (32 - sh);
+        }
+    else {
+        line[wd] &= ~(bits << sh);
+        if ((sh > 16) && ((wd + 1) < (VC_XSIZE >> 5)))
+            line[wd + 1] &= ~(bits >> (32 - sh));
+        }
+    src = line;
+    }
+vid_expand_1bpp (&vc_lines[ln*VC_XSIZE], src, VC_XSIZE, vid_mono_palette);
+}
+
 t_stat vc_svc (UNIT *uptr)
 {
 SIM_MOUSE_EVENT mev;
 SIM_KEY_EVENT kev;
 t_bool updated = FALSE;                                 /* flag for refresh */
 uint32 lines;
-uint32 ln, col, off;
+uint32 ln;
 int32 xpos, ypos, dx, dy;
-uint8 *cur;
 
 vc_crtc_p = vc_crtc_p ^ CRTCP_VB;                       /* Toggle VBI */
 vc_crtc_p = vc_crtc_p | CRTCP_LPF;                      /* Light pen full */
@@ -950,24 +987,7 @@ if (vid_poll_mouse (&mev) == SCPE_OK) {                 /* poll mouse */
 lines = 0;
 for (ln = 0; ln < VC_YSIZE; ln++) {
     if ((vc_map[ln] & VCMAP_VLD) == 0) {                /* line invalid? */
-        off = vc_map[ln] * 32;                          /* get video buf offset */
-        for (col = 0; col < VC_XSIZE; col++)  
-            vc_lines[ln*VC_XSIZE + col] = vid_mono_palette[(vc_buf[off + (col >> 5)] >> (col & 0x1F)) & 1];
-                                                        /* 1bpp to 32bpp */
-        if (CUR_V &&                                    /* cursor visible && need to draw cursor? */
-            (vc_input_captured || (vc_dev.dctrl & DBG_CURSOR))) {
-            if ((ln >= CUR_Y) && (ln < (CUR_Y + 16))) { /* cursor on this line? */
-                cur = &vc_cur[((ln - CUR_Y) << 4)];     /* get image base */
-                for (col = 0; col < 16; col++) {
-                    if ((CUR_X + col) >= VC_XSIZE)      /* Part of cursor off screen? */
-                        continue;                       /* Skip */
-                    if (CUR_F)                          /* mask function */
-                        vc_lines[ln*VC_XSIZE + CUR_X + col] = vid_mono_palette[(vc_lines[ln*VC_XSIZE + CUR_X + col] == vid_mono_palette[1]) | (cur[col] & 1)];
-                    else
-                        vc_lines[ln*VC_XSIZE + CUR_X + col] = vid_mono_palette[(vc_lines[ln*VC_XSIZE + CUR_X + col] == vid_mono_palette[1]) & (~cur[col] & 1)];
-                    }
-                }
-            }
+        vc_render_line (ln);                            /* 1bpp to 32bpp */
         vc_map[ln] |= VCMAP_VLD;                        /* set valid */
         if ((ln == (VC_YSIZE-1)) ||                     /* if end of window OR */
             (vc_map[ln+1] & VCMAP_VLD)) {               /* next is already valid? */
@@ -1091,6 +1111,28 @@ else
 return SCPE_OK;
 }
 
+/* Time the conversion of the whole screen from video memory, which is
+   the work vc_svc does when every line has been invalidated. */
+
+t_stat vc_show_refresh (FILE* st, UNIT* uptr, int32 val, CONST void* desc)
+{
+uint32 frames, ln, start, elapsed;
+
+if (vc_lines == NULL)
+    return sim_messagef (SCPE_NOFNC, "Display not active\n");
+start = sim_os_msec ();
+frames = 0;
+do {
+    for (ln = 0; ln < VC_YSIZE; ln++)
+        vc_render_line (ln);
+    frames++;
+    elapsed = sim_os_msec () - start;
+    } while (elapsed < 500);
+fprintf (st, "Full screen refresh (%dx%d): %.1f usec, %u frames in %u msec\n",
+         VC_XSIZE, VC_YSIZE, (1000.0 * elapsed) / frames, frames, elapsed);
+return SCPE_OK;
+}
+
 t_stat vc_help (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, const char *cptr)
 {
 fprintf (st, "VCB01 Monochrome Video Subsystem (%s)\n\n", dptr->name);
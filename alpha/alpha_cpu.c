@@ -233,6 +233,7 @@ extern t_stat pal_proc_trap (uint32 type);
 extern t_stat pal_proc_intr (uint32 type);
 extern t_stat pal_proc_inst (uint32 fnc);
 extern uint32 tlb_set_cm (int32 cm);
+extern void tlb_rebuild (void);
 
 /* CPU data structures
 
@@ -365,6 +366,7 @@ int abortval;
 t_bool tracing;
 
 PC = PC | pc_align;                                     /* put PC together */
+tlb_rebuild ();                                         /* resync TLB chains */
 abortval = setjmp (save_env);                           /* set abort hdlr */
 if (abortval != 0) {                                    /* exception? */
     if (abortval < 0) {                                 /* SCP stop? */
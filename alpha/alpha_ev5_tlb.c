@@ -46,28 +46,58 @@
         tlb_ia                  TLB invalidate all
         tlb_is                  TLB invalidate single
         tlb_set_cm              TLB set current mode
+        tlb_rebuild             TLB rebuild hash chains
+
+   Each TLB entry stays in the slot it was loaded into; slot i is entry
+   number i, so the NLU pointer selects the slot to load or read directly.
+   Valid entries are chained into a hash table keyed by the VPN with the
+   granularity hint bits cleared.  A lookup probes one chain per
+   granularity hint in use and compares the ASN along the chain.  In front
+   of each TLB, a small direct mapped cache holds recent translations by
+   full VPN; it is flushed whenever the TLB contents or the ASN change.
+   The chains and front caches are derived from the TLB arrays, so they
+   aren't saved; they are rebuilt each time the CPU starts running, which
+   picks up changes made by RESTORE or DEPOSIT.
 */
 
 #include "alpha_defs.h"
 #include "alpha_ev5_defs.h"
 
-#define ITLB_SORT       qsort (itlb, ITLB_SIZE, sizeof (TLBENT), &tlb_comp);
-#define DTLB_SORT       qsort (dtlb, DTLB_SIZE, sizeof (TLBENT), &tlb_comp);
 #define TLB_ESIZE       (sizeof (TLBENT)/sizeof (uint32))
+#define TLB_MINI_SIZE   16                              /* front cache size */
+#define TLB_MINI(v)     ((v) & (TLB_MINI_SIZE - 1))
+#define TLB_HASH_SIZE   64                              /* hash buckets */
+#define TLB_HASH(v)     (((v) ^ ((v) >> 6) ^ ((v) >> 12)) & (TLB_HASH_SIZE - 1))
+#define TLB_NONE        0xFF                            /* end of chain */
+#define TLB_N_GH        4                               /* granularity hints */
+#define GH_MASK(g)      ((1u << (3 * (g))) - 1)
 #define MM_RW(x)        (((x) & PTE_FOW)? EXC_W: EXC_R)
 
 uint32 itlb_cm = 0;                                     /* current modes */
 uint32 itlb_spage = 0;                                  /* superpage enables */
 uint32 itlb_asn = 0;
 uint32 itlb_nlu = 0;
-TLBENT i_mini_tlb;
+TLBENT i_mini_tlb[TLB_MINI_SIZE];
 TLBENT itlb[ITLB_SIZE];
+uint8 itlb_head[TLB_HASH_SIZE];                         /* hash chains */
+uint8 itlb_next[ITLB_SIZE];
+uint32 itlb_ghcnt[TLB_N_GH];                            /* entries per gh */
 uint32 dtlb_cm = 0;
 uint32 dtlb_spage = 0;
 uint32 dtlb_asn = 0;
 uint32 dtlb_nlu = 0;
-TLBENT d_mini_tlb;
+TLBENT d_mini_tlb[TLB_MINI_SIZE];
 TLBENT dtlb[DTLB_SIZE];
+uint8 dtlb_head[TLB_HASH_SIZE];
+uint8 dtlb_next[DTLB_SIZE];
+uint32 dtlb_ghcnt[TLB_N_GH];
+
+t_uint64 itlb_hits[4] = { 0 };                          /* statistics, */
+t_uint64 itlb_misses[4] = { 0 };                        /* by mode */
+t_uint64 dtlb_hits[4] = { 0 };
+t_uint64 dtlb_misses[4] = { 0 };
+t_uint64 itlb_mini_hits = 0;
+t_uint64 dtlb_mini_hits = 0;
 
 uint32 cm_eacc = ACC_E (MODE_K);                        /* precomputed */
 uint32 cm_racc = ACC_R (MODE_K);                        /* access checks */
@@ -81,8 +111,15 @@ uint32 mm_exc (uint32 macc);
 void tlb_inval (TLBENT *tlbp);
 t_stat itlb_reset (void);
 t_stat dtlb_reset (void);
-int tlb_comp (const void *e1, const void *e2);
 t_stat tlb_reset (DEVICE *dptr);
+t_stat tlb_show_stats (FILE *st, UNIT *uptr, int32 val, CONST void *desc);
+static void tlb_hash_ins (TLBENT *tlb, uint8 *head, uint8 *next, uint32 *ghcnt, uint32 i);
+static void tlb_hash_del (TLBENT *tlb, uint8 *head, uint8 *next, uint32 *ghcnt, uint32 i);
+static TLBENT *tlb_hash_find (TLBENT *tlb, uint8 *head, uint8 *next, uint32 *ghcnt,
+    uint32 vpn, uint32 asn);
+static void tlb_hash_rebuild (TLBENT *tlb, uint32 size, uint8 *head, uint8 *next,
+    uint32 *ghcnt, TLBENT *mini);
+static void tlb_mini_flush (TLBENT *mini);
 
 /* TLB data structures
 
@@ -98,19 +135,29 @@ REG tlb_reg[] = {
     { HRDATA (ISPAGE, itlb_spage, 2), REG_HRO },
     { HRDATA (IASN, itlb_asn, ITB_ASN_WIDTH) },
     { HRDATA (INLU, itlb_nlu, ITLB_WIDTH) },
-    { BRDATA (IMINI, &i_mini_tlb, 16, 32, TLB_ESIZE) },
+    { BRDATA (IMINI, i_mini_tlb, 16, 32, TLB_MINI_SIZE*TLB_ESIZE) },
     { BRDATA (ITLB, itlb, 16, 32, ITLB_SIZE*TLB_ESIZE) },
     { HRDATA (DCM, dtlb_cm, 2) },
     { HRDATA (DSPAGE, dtlb_spage, 2), REG_HRO },
     { HRDATA (DASN, dtlb_asn, DTB_ASN_WIDTH) },
     { HRDATA (DNLU, dtlb_nlu, DTLB_WIDTH) },
-    { BRDATA (DMINI, &d_mini_tlb, 16, 32, TLB_ESIZE) },
+    { BRDATA (DMINI, d_mini_tlb, 16, 32, TLB_MINI_SIZE*TLB_ESIZE) },
     { BRDATA (DTLB, dtlb, 16, 32, DTLB_SIZE*TLB_ESIZE) },
+    { BRDATA (IHITS, itlb_hits, 10, 64, 4), REG_RO },
+    { BRDATA (IMISSES, itlb_misses, 10, 64, 4), REG_RO },
+    { BRDATA (DHITS, dtlb_hits, 10, 64, 4), REG_RO },
+    { BRDATA (DMISSES, dtlb_misses, 10, 64, 4), REG_RO },
     { NULL }
     };
 
+MTAB tlb_mod[] = {
+    { MTAB_XTD|MTAB_VDV|MTAB_NMO, 0, "STATISTICS", NULL,
+      NULL, &tlb_show_stats },
+    { 0 }
+    };
+
 DEVICE tlb_dev = {
-    "TLB", &tlb_unit, tlb_reg, NULL,
+    "TLB", &tlb_unit, tlb_reg, tlb_mod,
     1, 0, 0, 1, 0, 0,
     NULL, NULL, &tlb_reset,
     NULL, NULL, NULL
@@ -141,8 +188,11 @@ if ((itlb_spage & SPEN_32) && (VPN_GETSP32 (vpn) == 0x1FFE)) {
     if (itlb_cm != MODE_K) ABORT1 (va, EXC_ACV + EXC_E);
     return (va & SP32_MASK);                            /* 32b superpage? */
     }
-if (!(tlbp = itlb_lookup (vpn)))                        /* lookup vpn; miss? */
+if (!(tlbp = itlb_lookup (vpn))) {                      /* lookup vpn; miss? */
+    itlb_misses[itlb_cm]++;
     ABORT1 (va, EXC_TBM + EXC_E);                       /* abort reference */
+    }
+itlb_hits[itlb_cm]++;
 if (cm_eacc & ~tlbp->pte)                               /* check access */
     ABORT1 (va, mm_exc (cm_eacc & ~tlbp->pte) | EXC_E);
 return PHYS_ADDR (tlbp->pfn, va);                       /* return phys addr */
@@ -164,8 +214,11 @@ if ((dtlb_spage & SPEN_32) && (VPN_GETSP32 (vpn) == 0x1FFE)) {
     if (dtlb_cm != MODE_K) ABORT1 (va, EXC_ACV + MM_RW (acc));
     return (va & SP32_MASK);                            /* 32b superpage? */
     }
-if (!(tlbp = dtlb_lookup (vpn)))                        /* lookup vpn; miss? */
+if (!(tlbp = dtlb_lookup (vpn))) {                      /* lookup vpn; miss? */
+    dtlb_misses[dtlb_cm]++;
     ABORT1 (va, EXC_TBM + MM_RW (acc));                 /* abort reference */
+    }
+dtlb_hits[dtlb_cm]++;
 if (acc & ~tlbp->pte)                                   /* check access */
     ABORT1 (va, mm_exc (acc & ~tlbp->pte) | MM_RW (acc));
 return PHYS_ADDR (tlbp->pfn, va);                       /* return phys addr */
@@ -198,15 +251,17 @@ uint32 vpn = VA_GETVPN (va);
 TLBENT *itlbp, *dtlbp;
 
 if ((va_sext != 0) && (va_sext != VA_M_SEXT)) return;
-if ((flags & TLB_CI) && (itlbp = itlb_lookup (vpn))) {
+if ((flags & TLB_CI) &&
+    (itlbp = tlb_hash_find (itlb, itlb_head, itlb_next, itlb_ghcnt, vpn, itlb_asn))) {
+    tlb_hash_del (itlb, itlb_head, itlb_next, itlb_ghcnt, itlbp->idx);
     tlb_inval (itlbp);
-    tlb_inval (&i_mini_tlb);
-    ITLB_SORT;
+    tlb_mini_flush (i_mini_tlb);
     }
-if ((flags & TLB_CD) && (dtlbp = dtlb_lookup (vpn))) {
+if ((flags & TLB_CD) &&
+    (dtlbp = tlb_hash_find (dtlb, dtlb_head, dtlb_next, dtlb_ghcnt, vpn, dtlb_asn))) {
+    tlb_hash_del (dtlb, dtlb_head, dtlb_next, dtlb_ghcnt, dtlbp->idx);
     tlb_inval (dtlbp);
-    tlb_inval (&d_mini_tlb);
-    DTLB_SORT;
+    tlb_mini_flush (d_mini_tlb);
     }
 return;
 }
@@ -224,167 +279,130 @@ if (flags & TLB_CA) {
     }
 if (flags & TLB_CI) {
     for (i = 0; i < ITLB_SIZE; i++) {
-        if (!(itlb[i].pte & PTE_ASM)) tlb_inval (&itlb[i]);
+        if ((itlb[i].tag != INV_TAG) && !(itlb[i].pte & PTE_ASM)) {
+            tlb_hash_del (itlb, itlb_head, itlb_next, itlb_ghcnt, i);
+            tlb_inval (&itlb[i]);
+            }
         }
-    tlb_inval (&i_mini_tlb);
-    ITLB_SORT;
+    tlb_mini_flush (i_mini_tlb);
     }
 if (flags & TLB_CD) {
     for (i = 0; i < DTLB_SIZE; i++) {
-        if (!(dtlb[i].pte & PTE_ASM)) tlb_inval (&dtlb[i]);
+        if ((dtlb[i].tag != INV_TAG) && !(dtlb[i].pte & PTE_ASM)) {
+            tlb_hash_del (dtlb, dtlb_head, dtlb_next, dtlb_ghcnt, i);
+            tlb_inval (&dtlb[i]);
+            }
         }
-    tlb_inval (&d_mini_tlb);
-    DTLB_SORT;
+    tlb_mini_flush (d_mini_tlb);
     }
 return;
 }
 
-/* TLB lookup */
+/* TLB lookup - front cache, then hash chains; a hit is copied into the
+   front cache and advances the NLU pointer past the entry used */
 
 TLBENT *itlb_lookup (uint32 vpn)
 {
-int32 p, hi, lo;
+TLBENT *mp = &i_mini_tlb[TLB_MINI (vpn)];
+TLBENT *tlbp;
 
-if (vpn == i_mini_tlb.tag) return &i_mini_tlb;
-lo = 0;                                                 /* initial bounds */
-hi = ITLB_SIZE - 1;
-do {
-    p = (lo + hi) >> 1;                                 /* probe */
-    if ((itlb_asn == itlb[p].asn) && 
-        (((vpn ^ itlb[p].tag) &
-         ~((uint32) itlb[p].gh_mask)) == 0)) {          /* match to TLB? */
-        i_mini_tlb.tag = vpn;
-        i_mini_tlb.pte = itlb[p].pte;
-        i_mini_tlb.pfn = itlb[p].pfn;
-        itlb_nlu = itlb[p].idx + 1;
-        if (itlb_nlu >= ITLB_SIZE) itlb_nlu = 0;
-        return &i_mini_tlb;
-        }
-    if ((itlb_asn < itlb[p].asn) ||
-        ((itlb_asn == itlb[p].asn) && (vpn < itlb[p].tag)))
-        hi = p - 1;                                     /* go down? p is upper */
-    else lo = p + 1;                                    /* go up? p is lower */
+if (vpn == mp->tag) {                                   /* front cache hit? */
+    itlb_mini_hits++;
+    return mp;
     }
-while (lo <= hi);
-return NULL;
+tlbp = tlb_hash_find (itlb, itlb_head, itlb_next, itlb_ghcnt, vpn, itlb_asn);
+if (tlbp == NULL)
+    return NULL;
+mp->tag = vpn;
+mp->pte = tlbp->pte;
+mp->pfn = tlbp->pfn;
+itlb_nlu = tlbp->idx + 1;
+if (itlb_nlu >= ITLB_SIZE) itlb_nlu = 0;
+return mp;
 }
 
 TLBENT *dtlb_lookup (uint32 vpn)
 {
-int32 p, hi, lo;
+TLBENT *mp = &d_mini_tlb[TLB_MINI (vpn)];
+TLBENT *tlbp;
 
-if (vpn == d_mini_tlb.tag) return &d_mini_tlb;
-lo = 0;                                                 /* initial bounds */
-hi = DTLB_SIZE - 1;
-do {
-    p = (lo + hi) >> 1;                                 /* probe */
-    if ((dtlb_asn == dtlb[p].asn) && 
-        (((vpn ^ dtlb[p].tag) &
-         ~((uint32) dtlb[p].gh_mask)) == 0)) {          /* match to TLB? */
-        d_mini_tlb.tag = vpn;
-        d_mini_tlb.pte = dtlb[p].pte;
-        d_mini_tlb.pfn = dtlb[p].pfn;
-        dtlb_nlu = dtlb[p].idx + 1;
-        if (dtlb_nlu >= DTLB_SIZE) dtlb_nlu = 0;
-        return &d_mini_tlb;
-        }
-    if ((dtlb_asn < dtlb[p].asn) ||
-        ((dtlb_asn == dtlb[p].asn) && (vpn < dtlb[p].tag)))
-        hi = p - 1;                                     /* go down? p is upper */
-    else lo = p + 1;                                    /* go up? p is lower */
+if (vpn == mp->tag) {                                   /* front cache hit? */
+    dtlb_mini_hits++;
+    return mp;
     }
-while (lo <= hi);
-return NULL;
+tlbp = tlb_hash_find (dtlb, dtlb_head, dtlb_next, dtlb_ghcnt, vpn, dtlb_asn);
+if (tlbp == NULL)
+    return NULL;
+mp->tag = vpn;
+mp->pte = tlbp->pte;
+mp->pfn = tlbp->pfn;
+dtlb_nlu = tlbp->idx + 1;
+if (dtlb_nlu >= DTLB_SIZE) dtlb_nlu = 0;
+return mp;
 }
 
 /* Load TLB entry at NLU pointer, advance NLU pointer */
 
 TLBENT *itlb_load (uint32 vpn, t_uint64 l3pte)
 {
-uint32 i, gh;
-
-for (i = 0; i < ITLB_SIZE; i++) {
-    if (itlb[i].idx == itlb_nlu) {
-        TLBENT *tlbp = itlb + i;
-        itlb_nlu = itlb_nlu + 1;
-        if (itlb_nlu >= ITLB_SIZE) itlb_nlu = 0;
-        tlbp->tag = vpn;
-        tlbp->pte = (uint32) (l3pte & PTE_MASK) ^ (PTE_FOR|PTE_FOR|PTE_FOE);
-        tlbp->pfn = ((uint32) (l3pte >> PTE_V_PFN)) & PFN_MASK;
-        tlbp->asn = itlb_asn;
-        gh = PTE_GETGH (tlbp->pte);
-        tlbp->gh_mask = (1u << (3 * gh)) - 1;
-        tlb_inval (&i_mini_tlb);
-        ITLB_SORT;
-        return tlbp;
-        }
-    }
-fprintf (stderr, "%%ITLB entry not found, itlb_nlu = %d\n", itlb_nlu);
-ABORT (-SCPE_IERR);
-return NULL;
+TLBENT *tlbp = itlb + itlb_nlu;
+uint32 gh;
+
+if (tlbp->tag != INV_TAG)                               /* replacing valid? */
+    tlb_hash_del (itlb, itlb_head, itlb_next, itlb_ghcnt, itlb_nlu);
+itlb_nlu = itlb_nlu + 1;
+if (itlb_nlu >= ITLB_SIZE) itlb_nlu = 0;
+tlbp->tag = vpn;
+tlbp->pte = (uint32) (l3pte & PTE_MASK) ^ (PTE_FOR|PTE_FOR|PTE_FOE);
+tlbp->pfn = ((uint32) (l3pte >> PTE_V_PFN)) & PFN_MASK;
+tlbp->asn = itlb_asn;
+gh = PTE_GETGH (tlbp->pte);
+tlbp->gh_mask = GH_MASK (gh);
+tlb_hash_ins (itlb, itlb_head, itlb_next, itlb_ghcnt, tlbp->idx);
+tlb_mini_flush (i_mini_tlb);
+return tlbp;
 }
 
 TLBENT *dtlb_load (uint32 vpn, t_uint64 l3pte)
 {
-uint32 i, gh;
-
-for (i = 0; i < DTLB_SIZE; i++) {
-    if (dtlb[i].idx == dtlb_nlu) {
-        TLBENT *tlbp = dtlb + i;
-        dtlb_nlu = dtlb_nlu + 1;
-        if (dtlb_nlu >= ITLB_SIZE) dtlb_nlu = 0;
-        tlbp->tag = vpn;
-        tlbp->pte = (uint32) (l3pte & PTE_MASK) ^ (PTE_FOR|PTE_FOR|PTE_FOE);
-        tlbp->pfn = ((uint32) (l3pte >> PTE_V_PFN)) & PFN_MASK;
-        tlbp->asn = dtlb_asn;
-        gh = PTE_GETGH (tlbp->pte);
-        tlbp->gh_mask = (1u << (3 * gh)) - 1;
-        tlb_inval (&d_mini_tlb);
-        DTLB_SORT;
-        return tlbp;
-        }
-    }
-fprintf (stderr, "%%DTLB entry not found, dtlb_nlu = %d\n", dtlb_nlu);
-ABORT (-SCPE_IERR);
-return NULL;
+TLBENT *tlbp = dtlb + dtlb_nlu;
+uint32 gh;
+
+if (tlbp->tag != INV_TAG)                               /* replacing valid? */
+    tlb_hash_del (dtlb, dtlb_head, dtlb_next, dtlb_ghcnt, dtlb_nlu);
+dtlb_nlu = dtlb_nlu + 1;
+if (dtlb_nlu >= DTLB_SIZE) dtlb_nlu = 0;
+tlbp->tag = vpn;
+tlbp->pte = (uint32) (l3pte & PTE_MASK) ^ (PTE_FOR|PTE_FOR|PTE_FOE);
+tlbp->pfn = ((uint32) (l3pte >> PTE_V_PFN)) & PFN_MASK;
+tlbp->asn = dtlb_asn;
+gh = PTE_GETGH (tlbp->pte);
+tlbp->gh_mask = GH_MASK (gh);
+tlb_hash_ins (dtlb, dtlb_head, dtlb_next, dtlb_ghcnt, tlbp->idx);
+tlb_mini_flush (d_mini_tlb);
+return tlbp;
 }
 
 /* Read TLB entry at NLU pointer, advance NLU pointer */
 
 t_uint64 itlb_read (void)
 {
-uint8 i;
+TLBENT *tlbp = itlb + itlb_nlu;
 
-for (i = 0; i < ITLB_SIZE; i++) {
-    if (itlb[i].idx == itlb_nlu) {
-        TLBENT *tlbp = itlb + i;
-        itlb_nlu = itlb_nlu + 1;
-        if (itlb_nlu >= ITLB_SIZE) itlb_nlu = 0;
-        return (((t_uint64) tlbp->pfn) << PTE_V_PFN) |
-            ((tlbp->pte ^ (PTE_FOR|PTE_FOR|PTE_FOE)) & PTE_MASK);
-        }
-    }
-fprintf (stderr, "%%ITLB entry not found, itlb_nlu = %d\n", itlb_nlu);
-ABORT (-SCPE_IERR);
-return 0;
+itlb_nlu = itlb_nlu + 1;
+if (itlb_nlu >= ITLB_SIZE) itlb_nlu = 0;
+return (((t_uint64) tlbp->pfn) << PTE_V_PFN) |
+    ((tlbp->pte ^ (PTE_FOR|PTE_FOR|PTE_FOE)) & PTE_MASK);
 }
 
 t_uint64 dtlb_read (void)
 {
-uint8 i;
+TLBENT *tlbp = dtlb + dtlb_nlu;
 
-for (i = 0; i < DTLB_SIZE; i++) {
-    if (dtlb[i].idx == dtlb_nlu) {
-        TLBENT *tlbp = dtlb + i;
-        dtlb_nlu = dtlb_nlu + 1;
-        if (dtlb_nlu >= DTLB_SIZE) dtlb_nlu = 0;
-        return (((t_uint64) tlbp->pfn) << PTE_V_PFN) |
-            ((tlbp->pte ^ (PTE_FOR|PTE_FOR|PTE_FOE)) & PTE_MASK);
-        }
-    }
-fprintf (stderr, "%%DTLB entry not found, dtlb_nlu = %d\n", dtlb_nlu);
-ABORT (-SCPE_IERR);
-return 0;
+dtlb_nlu = dtlb_nlu + 1;
+if (dtlb_nlu >= DTLB_SIZE) dtlb_nlu = 0;
+return (((t_uint64) tlbp->pfn) << PTE_V_PFN) |
+    ((tlbp->pte ^ (PTE_FOR|PTE_FOR|PTE_FOE)) & PTE_MASK);
 }
 
 /* Set ASN - rewrite TLB globals with correct ASN */
@@ -397,8 +415,7 @@ itlb_asn = asn;
 for (i = 0; i < ITLB_SIZE; i++) {
     if (itlb[i].pte & PTE_ASM) itlb[i].asn = asn;
     }
-tlb_inval (&i_mini_tlb);
-ITLB_SORT;
+tlb_mini_flush (i_mini_tlb);
 return;
 } 
 
@@ -410,8 +427,7 @@ dtlb_asn = asn;
 for (i = 0; i < DTLB_SIZE; i++) {
     if (dtlb[i].pte & PTE_ASM) dtlb[i].asn = asn;
     }
-tlb_inval (&d_mini_tlb);
-DTLB_SORT;
+tlb_mini_flush (d_mini_tlb);
 return;
 }
 
@@ -465,23 +481,103 @@ void tlb_inval (TLBENT *tlbp)
 tlbp->tag = INV_TAG;
 tlbp->pte = 0;
 tlbp->pfn = 0;
-tlbp->asn = tlbp->idx;
+tlbp->asn = 0;
 tlbp->gh_mask = 0;
 return;
 }
 
-/* Compare routine for qsort */
+/* Flush front cache */
+
+static void tlb_mini_flush (TLBENT *mini)
+{
+uint32 i;
+
+for (i = 0; i < TLB_MINI_SIZE; i++)
+    tlb_inval (&mini[i]);
+return;
+}
+
+/* Hash chain routines
+
+   tlb_hash_ins         add valid entry i to its chain
+   tlb_hash_del         remove valid entry i from its chain
+   tlb_hash_find        find the entry translating vpn in address space asn
+   tlb_hash_rebuild     rebuild all chains from the TLB entries
+*/
+
+static void tlb_hash_ins (TLBENT *tlb, uint8 *head, uint8 *next, uint32 *ghcnt, uint32 i)
+{
+uint32 h = TLB_HASH (tlb[i].tag & ~((uint32) tlb[i].gh_mask));
+
+next[i] = head[h];
+head[h] = (uint8) i;
+ghcnt[PTE_GETGH (tlb[i].pte)]++;
+return;
+}
+
+static void tlb_hash_del (TLBENT *tlb, uint8 *head, uint8 *next, uint32 *ghcnt, uint32 i)
+{
+uint32 h = TLB_HASH (tlb[i].tag & ~((uint32) tlb[i].gh_mask));
+uint8 *lnk;
+
+for (lnk = &head[h]; *lnk != TLB_NONE; lnk = &next[*lnk]) {
+    if (*lnk == i) {                                    /* found? unlink */
+        *lnk = next[i];
+        ghcnt[PTE_GETGH (tlb[i].pte)]--;
+        break;
+        }
+    }
+next[i] = TLB_NONE;
+return;
+}
 
-int tlb_comp (const void *e1, const void *e2)
+static TLBENT *tlb_hash_find (TLBENT *tlb, uint8 *head, uint8 *next, uint32 *ghcnt,
+    uint32 vpn, uint32 asn)
 {
-const TLBENT *t1 = (const TLBENT *) e1;
-const TLBENT *t2 = (const TLBENT *) e2;
-
-if (t1->asn > t2->asn) return +1;
-if (t1->asn < t2->asn) return -1;
-if (t1->tag > t2->tag) return +1;
-if (t1->tag < t2->tag) return -1;
-return 0;
+uint32 gh, key, i;
+
+for (gh = 0; gh < TLB_N_GH; gh++) {                     /* each gh in use */
+    if (ghcnt[gh] == 0)
+        continue;
+    key = vpn & ~GH_MASK (gh);
+    for (i = head[TLB_HASH (key)]; i != TLB_NONE; i = next[i]) {
+        if ((tlb[i].asn == asn) &&                      /* match to TLB? */
+            (((vpn ^ tlb[i].tag) & ~((uint32) tlb[i].gh_mask)) == 0))
+            return &tlb[i];
+        }
+    }
+return NULL;
+}
+
+static void tlb_hash_rebuild (TLBENT *tlb, uint32 size, uint8 *head, uint8 *next,
+    uint32 *ghcnt, TLBENT *mini)
+{
+uint32 i;
+
+for (i = 0; i < TLB_HASH_SIZE; i++)
+    head[i] = TLB_NONE;
+for (i = 0; i < TLB_N_GH; i++)
+    ghcnt[i] = 0;
+for (i = 0; i < size; i++) {
+    tlb[i].idx = i;
+    next[i] = TLB_NONE;
+    if (tlb[i].tag != INV_TAG) {
+        tlb[i].gh_mask = GH_MASK (PTE_GETGH (tlb[i].pte));
+        tlb_hash_ins (tlb, head, next, ghcnt, i);
+        }
+    }
+tlb_mini_flush (mini);
+return;
+}
+
+/* Rebuild derived TLB state from the (possibly restored or deposited)
+   TLB arrays */
+
+void tlb_rebuild (void)
+{
+tlb_hash_rebuild (itlb, ITLB_SIZE, itlb_head, itlb_next, itlb_ghcnt, i_mini_tlb);
+tlb_hash_rebuild (dtlb, DTLB_SIZE, dtlb_head, dtlb_next, dtlb_ghcnt, d_mini_tlb);
+return;
 }
 
 /* ITLB reset */
@@ -492,14 +588,15 @@ int32 i;
 
 itlb_nlu = 0;
 for (i = 0; i < ITLB_SIZE; i++) {
-    itlb[i].tag = INV_TAG;
-    itlb[i].pte = 0;
-    itlb[i].pfn = 0;
-    itlb[i].asn = i;
-    itlb[i].gh_mask = 0;
     itlb[i].idx = i;
+    tlb_inval (&itlb[i]);
+    itlb_next[i] = TLB_NONE;
     }
-tlb_inval (&i_mini_tlb);
+for (i = 0; i < TLB_HASH_SIZE; i++)
+    itlb_head[i] = TLB_NONE;
+for (i = 0; i < TLB_N_GH; i++)
+    itlb_ghcnt[i] = 0;
+tlb_mini_flush (i_mini_tlb);
 return SCPE_OK;
 }
 /* DTLB reset */
@@ -510,14 +607,15 @@ int32 i;
 
 dtlb_nlu = 0;
 for (i = 0; i < DTLB_SIZE; i++) {
-    dtlb[i].tag = INV_TAG;
-    dtlb[i].pte = 0;
-    dtlb[i].pfn = 0;
-    dtlb[i].asn = i;
-    dtlb[i].gh_mask = 0;
     dtlb[i].idx = i;
+    tlb_inval (&dtlb[i]);
+    dtlb_next[i] = TLB_NONE;
     }
-tlb_inval (&d_mini_tlb);
+for (i = 0; i < TLB_HASH_SIZE; i++)
+    dtlb_head[i] = TLB_NONE;
+for (i = 0; i < TLB_N_GH; i++)
+    dtlb_ghcnt[i] = 0;
+tlb_mini_flush (d_mini_tlb);
 return SCPE_OK;
 }
 
@@ -525,8 +623,45 @@ return SCPE_OK;
 
 t_stat tlb_reset (DEVICE *dptr)
 {
+uint32 i;
+
 itlb_reset ();
 dtlb_reset ();
+for (i = 0; i < 4; i++)
+    itlb_hits[i] = itlb_misses[i] = dtlb_hits[i] = dtlb_misses[i] = 0;
+itlb_mini_hits = dtlb_mini_hits = 0;
+return SCPE_OK;
+}
+
+/* Show TLB statistics */
+
+t_stat tlb_show_stats (FILE *st, UNIT *uptr, int32 val, CONST void *desc)
+{
+static const char *mname[4] = { "kernel", "executive", "supervisor", "user" };
+t_uint64 *hits[2] = { itlb_hits, dtlb_hits };
+t_uint64 *misses[2] = { itlb_misses, dtlb_misses };
+t_uint64 mini[2];
+double h, m, th, tm;
+uint32 i, j;
+
+mini[0] = itlb_mini_hits;
+mini[1] = dtlb_mini_hits;
+for (i = 0; i < 2; i++) {
+    fprintf (st, "%s: %d entries, %d entry front cache\n", i? "DTLB": "ITLB",
+        i? DTLB_SIZE: ITLB_SIZE, TLB_MINI_SIZE);
+    for (j = 0, th = tm = 0.0; j < 4; j++) {
+        h = (double) hits[i][j];
+        m = (double) misses[i][j];
+        th = th + h;
+        tm = tm + m;
+        if ((h + m) > 0.0)
+            fprintf (st, "  %-10s hits: %.0f (%.2f%%), misses: %.0f\n",
+                mname[j], h, (100.0 * h) / (h + m), m);
+        }
+    fprintf (st, "  %-10s hits: %.0f (%.2f%%), misses: %.0f\n", "total",
+        th, ((th + tm) > 0.0)? (100.0 * th) / (th + tm): 0.0, tm);
+    fprintf (st, "  front cache hits: %.0f\n", (double) mini[i]);
+    }
 return SCPE_OK;
 }
 
@@ -232,11 +232,11 @@ static struct display displays[] = {
 
 /*
  * Unit time (in microseconds) used to store display point time to
- * live at current aging level.  If this is too small, delay values
- * cannot fit in an unsigned short.  If it is too large all pixels
- * will age at once.  Perhaps a suitable value should be calculated at
- * run time?  When display_init() calculates refresh_interval it
- * sanity checks for both cases.
+ * live at current aging level.  If this is too small, the aging wheel
+ * needs many slots.  If it is too large all pixels will age at once.
+ * Perhaps a suitable value should be calculated at run time?  When
+ * display_init() calculates refresh_interval it sanity checks for
+ * both cases.
  */
 #define DELAY_UNIT 250
 
@@ -291,51 +291,46 @@ static struct display displays[] = {
 
 /*
  * Each point on the display is represented by a "struct point".  When
- * a point isn't dark (intensity > 0), it is linked into a circular,
- * doubly linked delta queue (a priority queue where "delay"
- * represents the time difference from the previous entry (if any) in
- * the queue.
+ * a point isn't dark (intensity > 0), it is linked into one of the
+ * circular, doubly linked lists of the aging wheel.
  *
  * All points are aged refresh_rate times/second, each time moved to the
- * next (logarithmically) lower intensity level.  When display_age() is
- * called, only the entries which have expired are processed.  Calling
- * display_age() often allows spreading out the workload.
+ * next (logarithmically) lower intensity level.  Since every point ages
+ * at the same rate, the wheel has one slot per DELAY_UNIT of the
+ * refresh interval, and a point lit at some time goes in the slot for
+ * that time.  Each DELAY_UNIT the wheel advances one slot and every
+ * point in that slot is aged in place; points stay put until they go
+ * dark or are intensified again, so the lists are only walked, never
+ * rebuilt.  Calling display_age() often allows spreading out the
+ * workload.
  *
  * An alternative would be to have intensity levels represent linear
  * decreases in intensity, and have the decay time at each level change.
  * Inverting the decay function for a multi-component phosphor may be
  * tricky, and the two different colors would need different time tables.
- * Furthermore, it would require finding the correct location in the
- * queue when adding a point (currently only need to add points at end)
  */
 
 /*
- * 12 bytes/entry on 32-bit system when REFRESH_RATE > 15
+ * 12 bytes/entry on 32-bit system
  * (requires 3MB for 512x512 display).
  */
 
-typedef unsigned short delay_t;
-#define DELAY_T_MAX USHRT_MAX
-
 struct point {
-    struct point *next;         /* next entry in queue */
-    struct point *prev;         /* prev entry in queue */
-    delay_t delay;              /* delta T in DELAY_UNITs */
+    struct point *next;         /* next entry in slot */
+    struct point *prev;         /* prev entry in slot */
     unsigned char ttl;          /* zero means off, not linked in */
     unsigned char level : 7;    /* intensity level */
     unsigned char color : 1;    /* for VR20 (two colors) */
 };
 
 static struct point *points;    /* allocated array of points */
-static struct point _head;
-#define head (&_head)
 
 /*
- * time span of all entries in queue
- * should never exceed refresh_interval
- * (should be possible to make this a delay_t)
+ * aging wheel: refresh_interval list heads, one per DELAY_UNIT;
+ * "now" is the slot points lit at the current time are added to
  */
-static long queue_interval;
+static struct point *wheel;
+static int now;
 
 /* convert X,Y to a "struct point *" */
 #define P(X,Y) (points + (X) + ((Y)*(size_t)xpixels))
@@ -395,34 +390,23 @@ display_lp_radius(int r)
 /*
  * from display_age and display_point
  * since all points age at the same rate,
- * only adds points at end of list.
+ * only adds points to the current slot.
  */
 static void
 queue_point(struct point *p)
 {
-    int d;
-
-    d = refresh_interval - queue_interval;
-    queue_interval += d;
-    /* queue_interval should now be == refresh_interval */
+    struct point *h = wheel + now;
 
 #ifdef PARANOIA
     if (p->ttl == 0 || p->ttl > MAXTTL)
     printf("queuing %d,%d level %d!\n", X(p), Y(p), p->level);
-    if (d > DELAY_T_MAX)
-    printf("queuing %d,%d delay %d!\n", X(p), Y(p), d);
-    if (queue_interval > DELAY_T_MAX)
-    printf("queue_interval (%d) > DELAY_T_MAX (%d)\n",
-           (int)queue_interval, DELAY_T_MAX);
 #endif /* PARANOIA defined */
 
-    p->next = head;
-    p->prev = head->prev;
-
-    head->prev->next = p;
-    head->prev = p;
+    p->next = h;
+    p->prev = h->prev;
 
-    p->delay = d;
+    h->prev->next = p;
+    h->prev = p;
 }
 
 /*
@@ -617,36 +601,33 @@ display_age(int t,          /* simulated us since last call */
         refresh_elapsed = 0;
         }
 
-    while ((p = head->next) != head) {
-        int x, y;
-
-        /* look at oldest entry */
-        if (p->delay > t) {         /* further than our reach? */
-            p->delay -= t;          /* update head */
-            queue_interval -= t;    /* update span */
-            break;                  /* quit */
-            }
-
-        x = X(p);
-        y = Y(p);
+    /*
+     * advance the wheel a slot at a time, aging every point in
+     * each slot passed; points which stay lit remain in their slot
+     */
+    if (t > MAXTTL*refresh_interval)    /* long gap: all points go dark */
+        t = MAXTTL*refresh_interval;
+    while (t-- > 0) {
+        struct point *h, *next;
+
+        if (++now == refresh_interval)
+            now = 0;
+        h = wheel + now;
+        for (p = h->next; p != h; p = next) {
+            next = p->next;
 #ifdef PARANOIA
-        if (p->ttl == 0)
-            printf("BUG: age %d,%d ttl zero\n", x, y);
+            if (p->ttl == 0)
+                printf("BUG: age %d,%d ttl zero\n", (int)X(p), (int)Y(p));
 #endif /* PARANOIA defined */
-
-        /* dequeue point */
-        p->prev->next = p->next;
-        p->next->prev = p->prev;
-
-        t -= p->delay;              /* lessen our reach */
-        queue_interval -= p->delay; /* update queue span */
-
-        ws_display_point(x, y, colors[p->color][p->level][--p->ttl]);
-        changed = 1;
-
-        /* queue it back up, unless we just turned it off! */
-        if (p->ttl > 0)
-            queue_point(p);
+            ws_display_point(X(p), Y(p), colors[p->color][p->level][--p->ttl]);
+            changed = 1;
+
+            /* unlink it if we just turned it off! */
+            if (p->ttl == 0) {
+                p->prev->next = next;
+                next->prev = p->prev;
+                }
+            }
         }
     return changed;
 } /* display_age */
@@ -686,13 +667,8 @@ intensify(int x,            /* 0..xpixels */
                x, y, p->level, p->ttl, level);
 #endif /* LOUD defined */
 
-        /* unlink from delta queue */
+        /* unlink from its aging slot */
         p->prev->next = p->next;
-
-        if (p->next == head)
-            queue_interval -= p->delay;
-        else
-            p->next->delay += p->delay;
         p->next->prev = p->prev;
         }
 
@@ -717,7 +693,7 @@ intensify(int x,            /* 0..xpixels */
         ws_display_point(x, y, colors[p->color][p->level][p->ttl-1]);
         }
 
-    queue_point(p);         /* put at end of list */
+    queue_point(p);         /* put in current slot */
     return bleed;
 }
 
@@ -863,9 +839,6 @@ display_init(enum display_type type, int sf, void *dptr)
         goto failed;
         }
 
-    /* Initialize display list */
-    head->next = head->prev = head;
-
     display_type = type;
     scale = sf;
 
@@ -912,13 +885,14 @@ display_init(enum display_type type, int sf, void *dptr)
         refresh_interval = 1;
         }
 
-    /* point lifetime in DELAY_UNITs will not fit in p->delay field! */
-    if (refresh_interval > DELAY_T_MAX) {
-        /* increase DELAY_UNIT? */
-        fprintf(stderr, "bad refresh_interval %d > DELAY_T_MAX %d\r\n",
-            refresh_interval, DELAY_T_MAX);
+    /* one aging wheel slot per DELAY_UNIT of the refresh interval */
+    wheel = (struct point *)calloc((size_t)refresh_interval,
+                    sizeof(struct point));
+    if (!wheel)
         goto failed;
-        }
+    for (i = 0; i < refresh_interval; i++)
+        wheel[i].next = wheel[i].prev = wheel + i;
+    now = 0;
 
     /*
      * before phosphor_init;
@@ -61,6 +61,7 @@ static const char *window_name;
 static uint32 *colors = NULL;
 static uint32 ncolors = 0, size_colors = 0;
 static uint32 *surface = NULL;
+static int dirty_top, dirty_bottom;     /* surface rows changed since ws_sync */
 typedef struct cursor {
     Uint8 *data;
     Uint8 *mask;
@@ -321,6 +322,8 @@ ws_init(const char *name, int xp, int yp, int colors, void *dptr)
     surface = (uint32 *)realloc (surface, xpixels*ypixels*sizeof(*surface));
     for (i=0; i<xpixels*ypixels; i++)
         surface[i] = vid_mono_palette[0];
+    dirty_top = 0;
+    dirty_bottom = ypixels - 1;
     ret = (0 == vid_open ((DEVICE *)dptr, name, xp*pix_size, yp*pix_size, 0));
     if (ret)
         vid_set_cursor (1, arrow_cursor->width, arrow_cursor->height, arrow_cursor->data, arrow_cursor->mask, arrow_cursor->hot_x, arrow_cursor->hot_y);
@@ -376,10 +379,14 @@ ws_display_point(int x, int y, void *color)
 {
     uint32 *brush = (uint32 *)color;
 
-    if (x > xpixels || y > ypixels)
+    if (x < 0 || x >= xpixels || y < 0 || y >= ypixels)
         return;
 
     y = ypixels - 1 - y;                /* invert y, top left origin */
+    if (y < dirty_top)
+        dirty_top = y;
+    if (y + pix_size - 1 > dirty_bottom)    /* a point covers pix_size rows */
+        dirty_bottom = (y + pix_size - 1 < ypixels) ? y + pix_size - 1 : ypixels - 1;
 
     if (brush == NULL)
         brush = (uint32 *)ws_color_black ();
@@ -394,9 +401,14 @@ ws_display_point(int x, int y, void *color)
         surface[y*xpixels + x] = *brush;
 }
   
+/* hand the rows changed since the last call to the video layer at once */
 void
 ws_sync(void) {
-    vid_draw (0, 0, xpixels, ypixels, surface);
+    if (dirty_top <= dirty_bottom)
+        vid_draw (0, dirty_top, xpixels, dirty_bottom - dirty_top + 1,
+                  surface + dirty_top*xpixels);
+    dirty_top = ypixels;
+    dirty_bottom = -1;
     vid_refresh ();
 }
 
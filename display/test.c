@@ -46,6 +46,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 #ifndef EXIT_FAILURE
 /* SunOS4 <stdlib.h> doesn't define this */
@@ -172,6 +173,37 @@ t3(void) {
 }
 #endif
 
+#ifdef T4
+/* phosphor aging stress benchmark;
+ * must be compiled with -DT4=<points> (eg. -DT4=20000)
+ *
+ * keeps T4 points lit with a slowly moving pattern spread over the
+ * whole screen, aging the display 50us per point plotted as the PDP-1
+ * would, and reports the CPU time spent per frame
+ */
+void
+t4(void) {
+    static long frame = 0;
+    static clock_t start;
+    int i, x, y;
+
+    if (frame == 0)
+        start = clock();
+    for (i = 0; i < T4; i++) {
+        x = (int)((i * 7919L + frame * 13) % display_xpoints());
+        y = (int)((i * 104729L + frame * 7) % display_ypoints());
+        display_point(x, y, DISPLAY_INT_MAX, 0);
+        display_age(50, 0);
+    }
+    display_sync();
+    if (++frame % 100 == 0) {
+        printf("%d points: %.2f ms/frame\n", T4,
+               (double)(clock() - start) * 1000 / CLOCKS_PER_SEC / 100);
+        start = clock();
+    }
+}
+#endif
+
 int
 main(void) {
     if (!display_init(TEST_DIS, TEST_RES, NULL))
@@ -185,7 +217,11 @@ main(void) {
 #ifdef T3
       t3();
 #endif
+#ifdef T4
+      t4();
+#else
       munch();
+#endif
     }
     /*NOTREACHED*/
 }
@@ -240,6 +240,9 @@
 #endif
 #include <sys/stat.h>
 #include <setjmp.h>
+#if defined (HAVE_ZLIB)
+#include <zlib.h>
+#endif
 
 #if defined(HAVE_DLOPEN)                                /* Dynamic Readline support */
 #include <dlfcn.h>
@@ -265,8 +268,14 @@
 
 #define MAX_DO_NEST_LVL 20                              /* DO cmd nesting level */
 #define SRBSIZ          1024                            /* save/restore buffer */
+#define SAVE_BLK_BASE   0x40000000                      /* [V4.1] block in base */
+#define SAVE_BLK_ZLIB   0x20000000                      /* [V4.1] deflated block */
+#define SAVE_BLK_CNT    0x0FFFFFFF                      /* block count */
+#define SAVE_MAX_BASE   32                              /* max snapshot chain */
 #define SIM_BRK_INILNT  4096                            /* bpt tbl length */
 #define SIM_BRK_ALLTYP  0xFFFFFFFB
+#define SIM_QUEUE_BEFORE(a, b) (((a)->q_due < (b)->q_due) || \
+                                (((a)->q_due == (b)->q_due) && ((a)->q_seq < (b)->q_seq)))
 #define UPDATE_SIM_TIME                                         \
     if (1) {                                                    \
         int32 _x;                                               \
@@ -413,6 +422,7 @@ t_addr (*sim_vm_parse_addr) (DEVICE *dptr, CONST char *cptr, CONST char **tptr)
 t_value (*sim_vm_pc_value) (void) = NULL;
 t_bool (*sim_vm_is_subroutine_call) (t_addr **ret_addrs) = NULL;
 t_bool (*sim_vm_fprint_stopped) (FILE *st, t_stat reason) = NULL;
+uint8 *(*sim_vm_mem_dirty) (UNIT *uptr, t_addr blksize, uint32 nblk) = NULL;
 
 /* Prototypes */
 
@@ -517,6 +527,7 @@ t_stat set_prompt (int32 flag, CONST char *cptr);
 t_stat sim_set_asynch (int32 flag, CONST char *cptr);
 t_stat sim_set_environment (int32 flag, CONST char *cptr);
 static const char *get_dbg_verb (uint32 dbits, DEVICE* dptr);
+static t_stat sim_debug_decode_cmd (CONST char *cptr);
 
 /* Global data */
 
@@ -538,6 +549,7 @@ int32 sim_opt_out = 0;
 volatile t_bool sim_is_running = FALSE;
 t_bool sim_processing_event = FALSE;
 uint32 sim_brk_summ = 0;
+uint32 sim_brk_filt[SIM_BRK_FILT_LNT];
 uint32 sim_brk_types = 0;
 BRKTYPTAB *sim_brk_type_desc = NULL;                  /* type descriptions */
 uint32 sim_brk_dflt = 0;
@@ -558,6 +570,10 @@ size_t *sim_sub_instr_off = NULL;
 static double sim_time;
 static uint32 sim_rtime;
 static int32 noqueue_time;
+static UNIT **sim_clock_heap = NULL;                    /* event queue heap */
+static int32 sim_clock_heap_count = 0;                  /* entries in heap */
+static int32 sim_clock_heap_size = 0;                   /* allocated heap slots */
+static t_uint64 sim_clock_heap_seq = 0;                 /* insertion sequence */
 volatile t_bool stop_cpu = FALSE;
 static unsigned int sim_stop_sleep_ms = 250;
 static char **sim_argv;
@@ -615,6 +631,7 @@ const char *sim_savename = sim_name;      /* Simulator Name used in SAVE/RESTORE
 /* Tables and strings */
 
 const char save_vercur[] = "V4.0";
+const char save_ver41[] = "V4.1";
 const char save_ver40[] = "V4.0";
 const char save_ver35[] = "V3.5";
 const char save_ver32[] = "V3.2";
@@ -838,7 +855,16 @@ static const char simh_help[] =
       " The SAVE command (abbreviation SA) save the complete state of the simulator\n"
       " to a file.  This includes the contents of main memory and all registers,\n"
       " and the I/O connections of devices:\n\n"
-      "++SAVE <filename>\n\n"
+      "++SAVE {-I} {-C} <filename>\n\n"
+      "4Switches\n"
+      " Switches can reduce the size and cost of frequent checkpoints\n\n"
+      "++-I      Incremental, writes only the memory which changed since the\n"
+      "++++last SAVE or RESTORE; that file becomes the base of the new one\n"
+      "++-C      Compresses memory contents (requires zlib)\n\n"
+      " An incremental save file refers to its base by name, relative to the\n"
+      " directory holding the incremental file.  Restoring it restores the\n"
+      " chain of base files first, so those files must be kept unchanged and\n"
+      " must move together.\n"
 #define HLP_RESTORE     "*Commands Saving_and_Restoring_State RESTORE"
       "3RESTORE\n"
       " The RESTORE command (abbreviation REST, alternately GET) restores a\n"
@@ -962,6 +988,10 @@ static const char simh_help[] =
       " \"SET NODEBUG\" commands.  Additionally, support is provided that is\n"
       " equivalent to the \"SET <dev> DEBUG=opt1{;opt2}\" and\n"
       " \"SET <dev> NODEBUG=opt1{;opt2}\" commands.\n\n"
+      " A binary debug file written by \"SET DEBUG -B\" is converted to the\n"
+      " text which would otherwise have been written with:\n\n"
+      "++DEBUG DECODE binary_file {text_file}\n\n"
+      " When no text file is specified, the text is displayed.\n\n"
        /***************** 80 character line width template *************************/
       "2Connecting and Disconnecting Devices\n"
       " Except for main memory and network devices, units are simulated as\n"
@@ -1165,6 +1195,17 @@ static const char simh_help[] =
       "5-E\n"
       " The -E switch causes data blob output to also display the data as\n"
       " EBCDIC characters.\n"
+      "5-B\n"
+      " The -B switch records debug messages in binary form instead of\n"
+      " formatting them while the simulator runs.  This is much faster when\n"
+      " a lot of debug output is produced.  Messages are buffered in memory\n"
+      " and written to the debug file by a separate thread, so the file may\n"
+      " lag slightly behind the simulation.  If the simulator records faster\n"
+      " than the buffer can be written, it waits for the buffer to be written,\n"
+      " so no messages are lost; SHOW DEBUG reports how often that happened.\n"
+      " The debug destination must be a file.  The binary file is converted\n"
+      " to text with the DEBUG DECODE command.  Binary debug output is only\n"
+      " available on hosts which support asynchronous I/O.\n"
 #define HLP_SET_BREAK  "*Commands SET Breakpoints"
       "3Breakpoints\n"
       "+SET BREAK <list>            set breakpoints\n"
@@ -1179,7 +1220,8 @@ static const char simh_help[] =
       "+SET THROTTLE x%%             occupy x percent of the host capacity\n"
       "++++++++executing instructions\n"
       "+SET THROTTLE x/t            sleep for t milliseconds after executing x\n"
-      "++++++++instructions\n\n"
+      "++++++++instructions\n"
+      "+SET -P THROTTLE xM|xK|x%%    throttle precisely (see below)\n\n"
       "+SET NOTHROTTLE              set simulation rate to maximum\n\n"
       " Throttling is only available on host systems that implement a precision\n"
       " real-time delay function.\n\n"
@@ -1188,6 +1230,15 @@ static const char simh_help[] =
       " to wall clock time.  Very short running programs may complete before\n"
       " calibration completes and therefore before the simulated execution rate\n"
       " can match the desired rate.\n\n"
+      " The -P switch selects precise throttling where the host supports a\n"
+      " monotonic nanosecond clock and absolute sleeps (clock_nanosleep).\n"
+      " Instead of sleeping for whole milliseconds every so many instructions\n"
+      " and rechecking the rate every 10 seconds, precise throttling checks\n"
+      " about once per millisecond of simulated execution and sleeps until\n"
+      " the exact time the instructions executed so far should have taken.\n"
+      " A controller learns how late the host wakes from a sleep and wakes\n"
+      " that much earlier.  SHOW THROTTLE then reports the achieved rate, the\n"
+      " drift from the requested rate and the wake-up timing error.\n\n"
       " The SET NOTHROTTLE command turns off throttling.  The SHOW THROTTLE\n"
       " command shows the current settings for throttling and the calibration\n"
       " results\n\n"
@@ -2021,6 +2072,15 @@ static const char simh_help[] =
 #else
       " which will create a screen shot file called screenshotfile.bmp\n"
 #endif
+#define HLP_SCD         "*Commands Compacting_SCD_Disk_Stores"
+      "2Compacting SCD Disk Stores\n"
+      " SCD disk containers keep their data in a shared store directory which\n"
+      " is only ever added to while disks are in use.  The data which none of\n"
+      " the containers using a store needs any more is removed with:\n\n"
+      "++SCD COMPACT container {container ...}\n\n"
+      " Every container using the store must be named, since data used only\n"
+      " by containers which aren't named is removed.  None of the containers\n"
+      " may be attached by any simulator while the store is compacted.\n"
 #define HLP_SPAWN       "*Commands Executing_System_Commands"
       "2Executing System Commands\n"
       " The simulator can execute operating system commands with the ! (spawn)\n"
@@ -2094,6 +2154,7 @@ static CTAB cmd_table[] = {
     { "SLEEP",      &sleep_cmd,     0,          HLP_SLEEP },
     { "!",          &spawn_cmd,     0,          HLP_SPAWN },
     { "HELP",       &help_cmd,      0,          HLP_HELP },
+    { "SCD",        &sim_disk_scd_cmd,0,        HLP_SCD },
 #if defined(USE_SIM_VIDEO)
     { "SCREENSHOT", &screenshot_cmd,0,          HLP_SCREENSHOT },
 #endif
@@ -2285,6 +2346,7 @@ sim_interval = 0;
 sim_time = sim_rtime = 0;
 noqueue_time = 0;
 sim_clock_queue = QUEUE_LIST_END;
+sim_clock_heap_count = 0;
 sim_is_running = FALSE;
 sim_log = NULL;
 if (sim_emax <= 0)
@@ -5270,11 +5332,24 @@ else if (!flag)
 return SCPE_OK;
 }
 
+static int _show_queue_compare (const void *pa, const void *pb)
+{
+const UNIT *a = *(UNIT * const *)pa;
+const UNIT *b = *(UNIT * const *)pb;
+
+if (SIM_QUEUE_BEFORE (a, b))
+    return -1;
+if (SIM_QUEUE_BEFORE (b, a))
+    return 1;
+return 0;
+}
+
 t_stat show_queue (FILE *st, DEVICE *dnotused, UNIT *unotused, int32 flag, CONST char *cptr)
 {
 DEVICE *dptr;
 UNIT *uptr;
-int32 accum;
+UNIT **queue;
+int32 i, accum;
 MEMFILE buf;
 
 memset (&buf, 0, sizeof (buf));
@@ -5288,8 +5363,14 @@ else {
 
     fprintf (st, "%s event queue status, time = %.0f, executing %s instructions/sec\n",
              sim_name, sim_time, sim_fmt_numeric (sim_timer_inst_per_sec ()));
-    accum = 0;
-    for (uptr = sim_clock_queue; uptr != QUEUE_LIST_END; uptr = uptr->next) {
+    queue = (UNIT **)malloc (sim_clock_heap_count * sizeof (*queue));
+    if (queue == NULL)
+        return SCPE_MEM;
+    memcpy (queue, sim_clock_heap, sim_clock_heap_count * sizeof (*queue));
+    qsort (queue, sim_clock_heap_count, sizeof (*queue), _show_queue_compare);
+    for (i = 0; i < sim_clock_heap_count; i++) {
+        uptr = queue[i];
+        accum = sim_clock_queue->time + (int32)(uptr->q_due - sim_clock_queue->q_due);
         if (uptr == &sim_step_unit)
             fprintf (st, "  Step timer");
         else
@@ -5303,17 +5384,17 @@ else {
                     }
                 else
                     fprintf (st, "  Unknown");
-        tim = sim_fmt_secs(((accum + uptr->time) / sim_timer_inst_per_sec ()) + (uptr->usecs_remaining / 1000000.0));
+        tim = sim_fmt_secs((accum / sim_timer_inst_per_sec ()) + (uptr->usecs_remaining / 1000000.0));
         if (uptr->usecs_remaining)
-            fprintf (st, " at %d plus %.0f usecs%s%s%s%s\n", accum + uptr->time, uptr->usecs_remaining,
+            fprintf (st, " at %d plus %.0f usecs%s%s%s%s\n", accum, uptr->usecs_remaining,
                                             (*tim) ? " (" : "", tim, (*tim) ? " total)" : "",
                                             (uptr->flags & UNIT_IDLE) ? " (Idle capable)" : "");
         else
-            fprintf (st, " at %d%s%s%s%s\n", accum + uptr->time, 
+            fprintf (st, " at %d%s%s%s%s\n", accum, 
                                             (*tim) ? " (" : "", tim, (*tim) ? ")" : "",
                                             (uptr->flags & UNIT_IDLE) ? " (Idle capable)" : "");
-        accum = accum + uptr->time;
         }
+    free (queue);
     }
 sim_show_clock_queues (st, dnotused, unotused, flag, cptr);
 #if defined (SIM_ASYNCH_IO)
@@ -5957,6 +6038,8 @@ GET_SWITCHES (cptr);                                    /* get switches */
 cptr = get_glyph (svptr = cptr, gbuf, 0);               /* get next glyph */
 if ((dptr = find_dev (gbuf)))                           /* device match? */
 return set_dev_debug (dptr, NULL, flg, *cptr ? cptr : NULL);
+if (flg && (0 == strcmp (gbuf, "DECODE")))              /* decode binary debug file? */
+    return sim_debug_decode_cmd (cptr);
 cptr = svptr;
 if (flg)
     return sim_set_debon (0, cptr);
@@ -6560,9 +6643,274 @@ return uptr->uname = strcpy ((char *)malloc (1 + strlen (uname)), uname);
 }
 
 
+/* Snapshot tracking
+
+   Incremental snapshots need to know which parts of memory changed
+   since the last SAVE or RESTORE.  Rather than hooking every simulator's
+   memory writes, each SRBSIZ block of every memory-like unit is
+   fingerprinted as it is saved or restored with two independent 64 bit
+   hashes.  An incremental SAVE writes only the blocks for which either
+   hash differs, and marks the others as present in the base snapshot,
+   which is the file most recently saved or restored.  The base is
+   identified by its name, relative to the directory of the delta so
+   that a chain of snapshots can be moved as a whole, and by a
+   fingerprint of all of its memory blocks, which RESTORE checks before
+   applying a delta.
+
+   A simulator whose memory is a plain array can also track writes to it
+   by supplying sim_vm_mem_dirty.  It returns a map with a byte for each
+   block of blksize addresses, which the simulator sets when the block is
+   written (a new map has every block set), or NULL for units it doesn't
+   track.  An incremental SAVE then skips examining and fingerprinting the
+   blocks which weren't written, and SAVE and RESTORE clear the map once
+   every block's fingerprint is current.
+*/
+
+typedef struct {
+    UNIT        *uptr;                                  /* memory unit */
+    t_addr      high;                                   /* capacity at last use */
+    uint32      nblk;                                   /* number of blocks */
+    t_uint64    *hash;                                  /* block fingerprints (2 per block) */
+    } SAVE_TRACK;
+
+#define SAVE_NBLK(high, dptr) ((uint32) (((high) + (SRBSIZ * (dptr)->aincr) - 1) / (SRBSIZ * (dptr)->aincr)))
+
+static SAVE_TRACK *save_track = NULL;
+static uint32 save_track_count = 0;
+static char *save_base = NULL;                          /* last saved/restored file (absolute) */
+static t_uint64 save_base_fp[2] = {0, 0};               /* its memory fingerprint */
+static const char *sim_save_file = NULL;                /* file SAVE is writing */
+static const char *sim_rest_file = NULL;                /* file RESTORE is reading */
+static int32 sim_rest_base = 0;                         /* restoring base of delta */
+
+/* Fingerprint table for a unit; all blocks unknown (0) if the size changed */
+
+static t_uint64 *sim_save_track_unit (UNIT *uptr, t_addr high, DEVICE *dptr)
+{
+SAVE_TRACK *tp;
+uint32 i, nblk = SAVE_NBLK (high, dptr);
+
+for (i = 0; i < save_track_count; i++)
+    if (save_track[i].uptr == uptr)
+        break;
+if (i == save_track_count) {
+    tp = (SAVE_TRACK *) realloc (save_track, (i + 1) * sizeof (*tp));
+    if (tp == NULL)
+        return NULL;
+    save_track = tp;
+    memset (&save_track[i], 0, sizeof (*tp));
+    save_track[i].uptr = uptr;
+    ++save_track_count;
+    }
+tp = &save_track[i];
+if ((tp->hash == NULL) || (tp->high != high)) {
+    free (tp->hash);
+    tp->hash = (t_uint64 *) calloc (nblk ? 2 * nblk : 2, sizeof (*tp->hash));
+    tp->high = high;
+    tp->nblk = nblk;
+    }
+return tp->hash;
+}
+
+/* The simulator's written block map for a unit, or NULL */
+
+static uint8 *sim_save_dirty_map (UNIT *uptr, t_addr high, DEVICE *dptr)
+{
+if (sim_vm_mem_dirty == NULL)
+    return NULL;
+return sim_vm_mem_dirty (uptr, SRBSIZ * dptr->aincr, SAVE_NBLK (high, dptr));
+}
+
+/* Block fingerprint: an FNV-1a variant and an unrelated multiply-rotate
+   hash (MurmurHash3's mixing steps), so that a block is only assumed
+   unchanged when both agree */
+
+static void sim_save_hash (const void *buf, size_t len, t_uint64 *h)
+{
+const uint8 *bp = (const uint8 *) buf;
+t_uint64 h1 = 0xCBF29CE484222325ull;                    /* FNV-1a */
+t_uint64 h2 = len;                                      /* multiply-rotate */
+t_uint64 w;
+size_t i;
+
+for (i = 0; i + sizeof (w) <= len; i += sizeof (w)) {   /* a word at a time */
+    memcpy (&w, bp + i, sizeof (w));
+    h1 = (h1 ^ w) * 0x100000001B3ull;
+    h1 ^= h1 >> 29;
+    w *= 0x87C37B91114253D5ull;
+    w = (w << 31) | (w >> 33);
+    h2 ^= w * 0x4CF5AD432745937Full;
+    h2 = ((h2 << 27) | (h2 >> 37)) * 5 + 0x52DCE729;
+    }
+for ( ; i < len; i++) {
+    h1 = (h1 ^ bp[i]) * 0x100000001B3ull;
+    h2 = ((h2 ^ bp[i]) * 0x9E3779B97F4A7C15ull);
+    }
+h2 ^= h2 >> 33;
+h2 *= 0xFF51AFD7ED558CCDull;
+h2 ^= h2 >> 33;
+h2 *= 0xC4CEB9FE1A85EC53ull;
+h2 ^= h2 >> 33;
+h[0] = h1 | 1;                                          /* 0 means unknown */
+h[1] = h2;
+}
+
+/* Fingerprint of all tracked memory, independent of unit order */
+
+static void sim_save_fingerprint (t_uint64 *fp)
+{
+uint32 i, blk;
+
+fp[0] = fp[1] = 0;
+for (i = 0; i < save_track_count; i++) {
+    const t_uint64 *hash = save_track[i].hash;
+
+    for (blk = 0; blk < save_track[i].nblk; blk++) {
+        fp[0] += (hash[2 * blk] ^ (blk * 0x9E3779B97F4A7C15ull)) * 0xFF51AFD7ED558CCDull;
+        fp[1] += (hash[2 * blk + 1] ^ (blk * 0xC2B2AE3D27D4EB4Full)) * 0xC4CEB9FE1A85EC53ull;
+        }
+    }
+}
+
+/* Absolute form of a file name with . and .. resolved, or NULL for names
+   which aren't plain paths (VMS, drive relative) */
+
+static char *sim_save_abspath (const char *name)
+{
+char cwd[PATH_MAX];
+char *path, *out;
+const char *cp, *ep;
+size_t root = 0, o = 0;
+
+if ((strchr (name, ']') != NULL) ||
+    ((strchr (name, ':') != NULL) && 
+     !(isalpha ((unsigned char)name[0]) && (name[1] == ':') && 
+       ((name[2] == '/') || (name[2] == '\\')))))
+    return NULL;
+if ((name[0] == '/') || (name[0] == '\\') || (name[1] == ':'))
+    cwd[0] = '\0';
+else if (getcwd (cwd, sizeof (cwd)) == NULL)
+    return NULL;
+path = (char *) malloc (strlen (cwd) + strlen (name) + 2);
+out = (char *) malloc (strlen (cwd) + strlen (name) + 2);
+if ((path == NULL) || (out == NULL)) {
+    free (path);
+    free (out);
+    return NULL;
+    }
+sprintf (path, "%s%s%s", cwd, cwd[0] ? "/" : "", name);
+cp = path;
+if (isalpha ((unsigned char)cp[0]) && (cp[1] == ':')) { /* drive */
+    out[o++] = *cp++;
+    out[o++] = *cp++;
+    }
+out[o++] = '/';
+root = o;
+while (*cp) {
+    while ((*cp == '/') || (*cp == '\\'))
+        ++cp;
+    for (ep = cp; *ep && (*ep != '/') && (*ep != '\\'); ep++);
+    if ((ep == cp) || ((ep - cp == 1) && (cp[0] == '.')))
+        ;                                               /* empty or . */
+    else if ((ep - cp == 2) && (cp[0] == '.') && (cp[1] == '.')) {
+        while ((o > root) && (out[o - 1] != '/'))       /* drop last component */
+            --o;
+        if (o > root)
+            --o;
+        }
+    else {
+        if (o > root)
+            out[o++] = '/';
+        memcpy (out + o, cp, ep - cp);
+        o += ep - cp;
+        }
+    cp = ep;
+    }
+out[o] = '\0';
+free (path);
+return out;
+}
+
+/* Name of a file relative to the directory of another (both absolute) */
+
+static char *sim_save_relpath (const char *name, const char *from)
+{
+size_t i, common = 0, up = 0;
+char *rel;
+
+for (i = 0; name[i] && (name[i] == from[i]); i++)       /* common directories */
+    if (name[i] == '/')
+        common = i + 1;
+if (common > 0) {                                       /* same drive? */
+    for (i = common; from[i]; i++)                      /* directories to leave */
+        if (from[i] == '/')
+            ++up;
+    }
+rel = (char *) malloc (3 * up + strlen (name + common) + 1);
+if (rel == NULL)
+    return NULL;
+for (i = 0; i < up; i++)
+    memcpy (rel + 3 * i, "../", 3);
+strcpy (rel + 3 * up, name + common);
+return rel;
+}
+
+static void sim_save_set_base (const char *name)
+{
+free (save_base);
+save_base = NULL;
+if (name != NULL) {
+    save_base = sim_save_abspath (name);
+    if ((save_base == NULL) && 
+        ((save_base = (char *) malloc (1 + strlen (name))) != NULL))
+        strcpy (save_base, name);
+    sim_save_fingerprint (save_base_fp);
+    }
+}
+
+#if defined (HAVE_ZLIB)
+/* Write a block through the unit's deflate stream.  Each block is sync
+   flushed, so it can be inflated as soon as it is read, but it shares
+   the compression dictionary with the blocks before it */
+
+static t_stat sim_save_zblock (z_stream *zs, void *buf, size_t len, int32 cnt, FILE *sfile)
+{
+static uint8 *zbuf = NULL;
+static size_t zbuf_size = 0;
+size_t need = len + (len >> 3) + 64;
+int32 clen;
+
+if (zbuf_size < need) {
+    uint8 *nbuf = (uint8 *) realloc (zbuf, need);
+
+    if (nbuf == NULL)
+        return SCPE_MEM;
+    zbuf = nbuf;
+    zbuf_size = need;
+    }
+zs->next_in = (Bytef *) buf;
+zs->avail_in = (uInt) len;
+zs->next_out = zbuf;
+zs->avail_out = (uInt) zbuf_size;
+if ((deflate (zs, Z_SYNC_FLUSH) != Z_OK) || (zs->avail_in != 0) || (zs->avail_out == 0))
+    return SCPE_IERR;
+clen = (int32) (zbuf_size - zs->avail_out);
+cnt = cnt | SAVE_BLK_ZLIB;
+sim_fwrite (&cnt, sizeof (cnt), 1, sfile);
+sim_fwrite (&clen, sizeof (clen), 1, sfile);
+sim_fwrite (zbuf, 1, clen, sfile);
+return SCPE_OK;
+}
+#endif
+
 /* Save command
 
    sa[ve] filename              save state to specified file
+
+   switches:
+    -I                  incremental: write only memory changed since
+                        the last SAVE or RESTORE, which becomes the base
+    -C                  compress memory contents
 */
 
 t_stat save_cmd (int32 flag, CONST char *cptr)
@@ -6570,6 +6918,7 @@ t_stat save_cmd (int32 flag, CONST char *cptr)
 FILE *sfile;
 t_stat r;
 char gbuf[4*CBUFSIZE];
+char *aname;
 
 GET_SWITCHES (cptr);                                    /* get switches */
 if (*cptr == 0)                                         /* must be more */
@@ -6577,10 +6926,21 @@ if (*cptr == 0)                                         /* must be more */
 gbuf[sizeof(gbuf)-1] = '\0';
 strlcpy (gbuf, cptr, sizeof(gbuf));
 sim_trim_endspc (gbuf);
+aname = sim_save_abspath (gbuf);
+if ((sim_switches & SWMASK ('I')) &&                    /* incremental */
+    ((save_base == NULL) ||                             /* w/o usable base? */
+     (strcmp (save_base, aname ? aname : gbuf) == 0))) {
+    sim_messagef (SCPE_OK, "No base snapshot, saving complete state\n");
+    sim_switches &= ~SWMASK ('I');
+    }
+free (aname);
 if ((sfile = sim_fopen (gbuf, "wb")) == NULL)
     return SCPE_OPENERR;
+sim_save_file = gbuf;
 r = sim_save (sfile);
+sim_save_file = NULL;
 fclose (sfile);
+sim_save_set_base ((r == SCPE_OK)? gbuf: NULL);         /* new base snapshot */
 return r;
 }
 
@@ -6588,7 +6948,7 @@ t_stat sim_save (FILE *sfile)
 {
 void *mbuf;
 int32 l, t;
-uint32 i, j, device_count;
+uint32 i, j, blk, device_count;
 t_addr k, high;
 t_value val;
 t_stat r;
@@ -6597,13 +6957,33 @@ size_t sz;
 DEVICE *dptr;
 UNIT *uptr;
 REG *rptr;
+t_uint64 h[2], *hash;
+uint8 *dirty;
+t_bool inbase;
+int32 run = 0, runtype = 0;
+t_bool delta = ((sim_switches & SWMASK ('I')) != 0) && (save_base != NULL);
+t_bool zip = ((sim_switches & SWMASK ('C')) != 0);
+#if defined (HAVE_ZLIB)
+z_stream zs;
+#endif
 
 #define WRITE_I(xx) sim_fwrite (&(xx), sizeof (xx), 1, sfile)
+#define SAVE_RUN_FLUSH                                  /* write pending run */ \
+    run = runtype? (run | runtype): -run;                                       \
+    WRITE_I (run);                                                              \
+    run = 0
+
+#if !defined (HAVE_ZLIB)
+if (zip) {
+    sim_messagef (SCPE_OK, "Compression unavailable, saving uncompressed\n");
+    zip = FALSE;
+    }
+#endif
 
 /* Don't make changes below without also changing save_vercur above */
 
 fprintf (sfile, "%s\n%s\n%s\n%s\n%s\n%.0f\n",
-    save_vercur,                                        /* [V2.5] save format */
+    (delta || zip)? save_ver41: save_vercur,            /* [V2.5] save format */
     sim_savename,                                       /* sim name */
     sim_si64, sim_sa64, eth_capabilities(),             /* [V3.5] options */
     sim_time);                                          /* [V3.2] sim time */
@@ -6617,6 +6997,22 @@ fprintf (sfile, "git commit id: %8.8s\n", S_xstr(SIM_GIT_COMMIT_ID));
 #else
 fprintf (sfile, "git commit id: unknown\n");
 #endif
+if (delta || zip) {                                     /* [V4.1] base snapshot */
+    if (delta) {
+        char *dname = sim_save_file ? sim_save_abspath (sim_save_file) : NULL;
+        char *rname = NULL;
+
+        if ((dname != NULL) &&                          /* both absolute paths? */
+            ((save_base[0] == '/') || ((save_base[1] == ':') && (save_base[2] == '/'))))
+            rname = sim_save_relpath (save_base, dname);
+
+        fprintf (sfile, "base: %016" LL_FMT "X %016" LL_FMT "X %s\n", 
+                 save_base_fp[0], save_base_fp[1], rname ? rname : save_base);
+        free (rname);
+        free (dname);
+        }
+    else fprintf (sfile, "base:\n");
+    }
 
 for (device_count = 0; sim_devices[device_count]; device_count++);/* count devices */
 for (i = 0; i < (device_count + sim_internal_device_count); i++) {/* loop thru devices */
@@ -6669,27 +7065,94 @@ for (i = 0; i < (device_count + sim_internal_device_count); i++) {/* loop thru d
                 fclose (sfile);
                 return SCPE_MEM;
                 }
-            for (k = 0; k < high; ) {                   /* loop thru mem */
+            hash = sim_save_track_unit (uptr, high, dptr);
+            dirty = (hash != NULL)? sim_save_dirty_map (uptr, high, dptr): NULL;
+#if defined (HAVE_ZLIB)
+            if (zip) {
+                memset (&zs, 0, sizeof (zs));
+                if (deflateInit (&zs, Z_BEST_SPEED) != Z_OK) {
+                    free (mbuf);
+                    return SCPE_MEM;
+                    }
+                }
+#endif
+            run = 0;
+            for (k = 0, blk = 0; k < high; blk++) {     /* loop thru mem */
+                if (delta && (dirty != NULL) &&         /* [V4.1] not written since */
+                    (dirty[blk] == 0) && (hash[2 * blk] != 0)) {/* last fingerprinted? */
+                    l = (int32) ((high - k + dptr->aincr - 1) / dptr->aincr);
+                    if (l > SRBSIZ)
+                        l = SRBSIZ;
+                    k = k + l * dptr->aincr;
+                    if (run && ((runtype != SAVE_BLK_BASE) || ((run + l) > SAVE_BLK_CNT))) {
+                        SAVE_RUN_FLUSH;
+                        }
+                    runtype = SAVE_BLK_BASE;
+                    run = run + l;
+                    continue;
+                    }
                 zeroflg = TRUE;
                 for (l = 0; (l < SRBSIZ) && (k < high); l++,
                      k = k + (dptr->aincr)) {           /* check for 0 block */
                     r = dptr->examine (&val, k, uptr, SIM_SW_REST);
                     if (r != SCPE_OK) {
+#if defined (HAVE_ZLIB)
+                        if (zip)
+                            deflateEnd (&zs);
+#endif
                         free (mbuf);
                         return r;
                         }
                     if (val) zeroflg = FALSE;
                     SZ_STORE (sz, val, mbuf, l);
                     }                                   /* end for l */
+                sim_save_hash (mbuf, l * sz, h);        /* fingerprint block */
+                inbase = delta && (hash != NULL) && 
+                         (hash[2 * blk] == h[0]) && (hash[2 * blk + 1] == h[1]);
+                if (hash != NULL) {
+                    hash[2 * blk] = h[0];
+                    hash[2 * blk + 1] = h[1];
+                    }
+                if ((delta || zip) && (zeroflg || inbase)) {/* [V4.1] run of blocks? */
+                    t = inbase? SAVE_BLK_BASE: 0;
+                    if (run && ((t != runtype) || ((run + l) > SAVE_BLK_CNT))) {
+                        SAVE_RUN_FLUSH;
+                        }
+                    runtype = t;
+                    run = run + l;
+                    continue;
+                    }
+                if (run) {
+                    SAVE_RUN_FLUSH;
+                    }
                 if (zeroflg) {                          /* all zero's? */
                     l = -l;                             /* invert block count */
                     WRITE_I (l);                        /* write only count */
                     }
+#if defined (HAVE_ZLIB)
+                else if (zip) {                         /* compressed? */
+                    r = sim_save_zblock (&zs, mbuf, l * sz, l, sfile);
+                    if (r != SCPE_OK) {
+                        deflateEnd (&zs);
+                        free (mbuf);
+                        return r;
+                        }
+                    }
+#endif
                 else {
                     WRITE_I (l);                        /* block count */
                     sim_fwrite (mbuf, sz, l, sfile);
                     }
                 }                                       /* end for k */
+            if (run) {
+                SAVE_RUN_FLUSH;
+                }
+            if (dirty != NULL)                          /* all fingerprints current */
+                memset (dirty, 0, SAVE_NBLK (high, dptr));
+#if defined (HAVE_ZLIB)
+            if (zip)
+                deflateEnd (&zs);
+#endif
             free (mbuf);                                /* dealloc buffer */
             }                                           /* end if mem */
         else {                                          /* no memory */
@@ -6734,8 +7197,46 @@ strlcpy (gbuf, cptr, sizeof(gbuf));
 sim_trim_endspc (gbuf);
 if ((rfile = sim_fopen (gbuf, "rb")) == NULL)
     return SCPE_OPENERR;
+sim_rest_file = gbuf;
 r = sim_rest (rfile);
+sim_rest_file = NULL;
 fclose (rfile);
+sim_save_set_base ((r == SCPE_OK)? gbuf: NULL);         /* new base snapshot */
+return r;
+}
+
+/* Restore the memory contents of the base of an incremental snapshot.
+   The whole chain is applied oldest first; unit and register state is
+   taken from the delta alone */
+
+static t_stat sim_rest_base_file (const char *bname, const t_uint64 *bfp)
+{
+FILE *bfile;
+t_stat r;
+t_uint64 fp[2];
+const char *rfile = sim_rest_file;
+
+if (sim_rest_base >= SAVE_MAX_BASE) {
+    sim_printf ("Snapshot chain too long: %s\n", bname);
+    return SCPE_INCOMP;
+    }
+if ((bfile = sim_fopen (bname, "rb")) == NULL) {
+    sim_printf ("Can't open base snapshot: %s\n", bname);
+    return SCPE_INCOMP;
+    }
+++sim_rest_base;
+sim_switches = 0;
+sim_rest_file = bname;
+r = sim_rest (bfile);
+sim_rest_file = rfile;
+--sim_rest_base;
+fclose (bfile);
+if (r == SCPE_OK)
+    sim_save_fingerprint (fp);
+if ((r == SCPE_OK) && ((fp[0] != bfp[0]) || (fp[1] != bfp[1]))) {
+    sim_printf ("Base snapshot %s has been replaced\n", bname);
+    r = SCPE_INCOMP;
+    }
 return r;
 }
 
@@ -6753,14 +7254,26 @@ t_addr k, high, old_capac;
 t_value val, mask;
 t_stat r;
 size_t sz;
-t_bool v40, v35, v32;
+t_bool v41, v40, v35, v32;
+t_bool base_only = (sim_rest_base != 0);
+t_bool has_base = FALSE;
+uint32 blk;
+int32 zrun;
+t_uint64 *hash;
+uint8 *dirty;
+#if defined (HAVE_ZLIB)
+z_stream zs;
+t_bool zinit = FALSE;
+uint8 *zbuf = NULL;
+int32 clen;
+#endif
 DEVICE *dptr;
 UNIT *uptr;
 REG *rptr;
 struct stat rstat;
 t_bool force_restore = ((sim_switches & SWMASK ('F')) != 0);
 t_bool dont_detach_attach = ((sim_switches & SWMASK ('D')) != 0);
-t_bool suppress_warning = ((sim_switches & SWMASK ('Q')) != 0);
+t_bool suppress_warning = ((sim_switches & SWMASK ('Q')) != 0) || (sim_rest_base != 0);
 t_bool warned = FALSE;
 
 sim_switches &= ~(SWMASK ('F') | SWMASK ('D') | SWMASK ('Q'));  /* remove digested switches */
@@ -6778,8 +7291,10 @@ if (fstat (fileno (rfile), &rstat)) {
     goto Cleanup_Return;
     }
 READ_S (buf);                                           /* [V2.5+] read version */
-v40 = v35 = v32 = FALSE;
-if (strcmp (buf, save_ver40) == 0)                      /* version 4.0? */
+v41 = v40 = v35 = v32 = FALSE;
+if (strcmp (buf, save_ver41) == 0)                      /* version 4.1? */
+    v41 = v40 = v35 = v32 = TRUE;
+else if (strcmp (buf, save_ver40) == 0)                 /* version 4.0? */
     v40 = v35 = v32 = TRUE;
 else if (strcmp (buf, save_ver35) == 0)                 /* version 3.5? */
     v35 = v32 = TRUE;
@@ -6789,7 +7304,7 @@ else if (strcmp (buf, save_ver30) != 0) {               /* version 3.0? */
     sim_printf ("Invalid file version: %s\n", buf);
     return SCPE_INCOMP;
     }
-if ((strcmp (buf, save_ver40) != 0) && (!sim_quiet) && (!suppress_warning)) {
+if ((!v40) && (!sim_quiet) && (!suppress_warning)) {
     sim_printf ("warning - attempting to restore a saved simulator image in %s image format.\n", buf);
     warned = TRUE;
     }
@@ -6831,6 +7346,51 @@ if (v40) {
 #undef S_xstr
 #endif
     }
+if (v41) {                                              /* [V4.1+] base snapshot */
+    READ_S (buf);
+    if (strncmp (buf, "base:", 5) != 0) {
+        r = SCPE_IOERR;
+        goto Cleanup_Return;
+        }
+    if (buf[5] != '\0') {                               /* incremental? */
+        double stime = sim_time;
+        uint32 srtime = sim_rtime;
+        t_uint64 bfp[2] = {0, 0};
+        const char *bname;
+        char *bpath = NULL;
+        int n = 0;
+
+        if (sscanf (buf + 5, "%" LL_FMT "X %" LL_FMT "X %n", &bfp[0], &bfp[1], &n) < 2) {
+            r = SCPE_IOERR;
+            goto Cleanup_Return;
+            }
+        bname = buf + 5 + n;
+        if (sim_rest_file && (bname[0] != '/') && (bname[0] != '\\') && 
+            (strchr (bname, ':') == NULL)) {            /* relative to the delta? */
+            size_t dlen = 0, i;
+
+            for (i = 0; sim_rest_file[i]; i++)
+                if ((sim_rest_file[i] == '/') || (sim_rest_file[i] == '\\') || 
+                    (sim_rest_file[i] == ':') || (sim_rest_file[i] == ']'))
+                    dlen = i + 1;
+            if ((dlen > 0) && 
+                ((bpath = (char *) malloc (dlen + strlen (bname) + 1)) != NULL)) {
+                memcpy (bpath, sim_rest_file, dlen);
+                strcpy (bpath + dlen, bname);
+                bname = bpath;
+                }
+            }
+        r = sim_rest_base_file (bname, bfp);
+        free (bpath);
+        if (r != SCPE_OK)
+            goto Cleanup_Return;
+        sim_time = stime;                               /* delta's times */
+        sim_rtime = srtime;
+        has_base = TRUE;
+        }
+    }
+if (base_only)                                          /* memory only? */
+    dont_detach_attach = suppress_warning = TRUE;
 if (!dont_detach_attach)
     detach_all (0, 0);                                  /* Detach everything to start from a consistent state */
 else {
@@ -6858,8 +7418,9 @@ for ( ;; ) {                                            /* device loop */
         goto Cleanup_Return;
         }
     READ_S (buf);                                       /* [V3.0+] logical name */
-    deassign_device (dptr);                             /* delete old name */
-    if ((buf[0] != 0) && 
+    if (!base_only)
+        deassign_device (dptr);                         /* delete old name */
+    if ((buf[0] != 0) && (!base_only) &&
         ((r = assign_device (dptr, buf)) != SCPE_OK)) {
         r = SCPE_INCOMP;
         goto Cleanup_Return;
@@ -6918,7 +7479,7 @@ for ( ;; ) {                                            /* device loop */
                 goto Cleanup_Return;
                 }
             }
-        if ((buf[0] != '\0') &&                         /* unit to be reattached? */
+        if ((buf[0] != '\0') && (!base_only) &&        /* unit to be reattached? */
             ((uptr->flags & UNIT_ATTABLE) ||            /*  and unit is attachable */
              (dptr->attach != NULL))) {                 /*    or VM attach routine provided? */
             uptr->flags = uptr->flags & ~UNIT_DIS;      /* ensure device is enabled */
@@ -6964,20 +7525,82 @@ for ( ;; ) {                                            /* device loop */
                 r = SCPE_MEM;
                 goto Cleanup_Return;
                 }
+            hash = sim_save_track_unit (uptr, high, dptr);
+            zrun = 0;
             for (k = 0; k < high; ) {                   /* loop thru mem */
-                if (sim_fread (&blkcnt, sizeof (blkcnt), 1, rfile) == 0) {/* block count */
+                blk = (uint32) (k / (SRBSIZ * dptr->aincr));
+                if (zrun > 0) {                         /* [V4.1+] in zero run? */
+                    blkcnt = -((zrun > SRBSIZ)? SRBSIZ: zrun);
+                    zrun = zrun + blkcnt;
+                    }
+                else if (sim_fread (&blkcnt, sizeof (blkcnt), 1, rfile) == 0) {/* block count */
                     free (mbuf);
                     r = SCPE_IOERR;
                     goto Cleanup_Return;
                     }
-                if (blkcnt < 0)                         /* compressed? */
+                if ((blkcnt > 0) && (blkcnt & SAVE_BLK_BASE)) {/* [V4.1+] in base? */
+                    limit = blkcnt & SAVE_BLK_CNT;
+                    if ((!has_base) || (limit <= 0)) {
+                        free (mbuf);
+                        r = SCPE_IOERR;
+                        goto Cleanup_Return;
+                        }
+                    k = k + limit * dptr->aincr;        /* already restored */
+                    continue;
+                    }
+                if ((blkcnt > 0) && (blkcnt & SAVE_BLK_ZLIB)) {/* [V4.1+] deflated? */
+                    limit = blkcnt & SAVE_BLK_CNT;
+#if defined (HAVE_ZLIB)
+                    if ((limit > SRBSIZ) ||
+                        (sim_fread (&clen, sizeof (clen), 1, rfile) == 0) ||
+                        (clen <= 0) || (clen > (int32) (2 * SRBSIZ * sz + 64)))
+                        limit = 0;
+                    if ((limit > 0) && (!zinit)) {      /* first in unit? */
+                        memset (&zs, 0, sizeof (zs));
+                        zbuf = (uint8 *) malloc (2 * SRBSIZ * sz + 64);
+                        if ((zbuf == NULL) || (inflateInit (&zs) != Z_OK)) {
+                            free (zbuf);
+                            free (mbuf);
+                            r = SCPE_MEM;
+                            goto Cleanup_Return;
+                            }
+                        zinit = TRUE;
+                        }
+                    if (limit > 0) {
+                        zs.next_in = zbuf;
+                        zs.avail_in = (uInt) sim_fread (zbuf, 1, clen, rfile);
+                        zs.next_out = (Bytef *) mbuf;
+                        zs.avail_out = (uInt) (limit * sz);
+                        if ((zs.avail_in != (uInt) clen) ||
+                            (inflate (&zs, Z_SYNC_FLUSH) != Z_OK) ||
+                            (zs.avail_in != 0) || (zs.avail_out != 0))
+                            limit = 0;
+                        }
+#else
+                    sim_printf ("Compressed save file, this simulator was built without zlib\n");
+                    limit = 0;
+#endif
+                    }
+                else if (blkcnt < 0) {                  /* compressed? */
                     limit = -blkcnt;
-                else limit = (int32)sim_fread (mbuf, sz, blkcnt, rfile);
-                if (limit <= 0) {                       /* invalid or err? */
+                    if (v41 && (limit > SRBSIZ)) {      /* [V4.1+] zero run */
+                        zrun = limit - SRBSIZ;
+                        blkcnt = -SRBSIZ;
+                        limit = SRBSIZ;
+                        }
+                    if (limit <= SRBSIZ)
+                        memset (mbuf, 0, limit * sz);
+                    }
+                else if (blkcnt <= SRBSIZ)
+                    limit = (int32)sim_fread (mbuf, sz, blkcnt, rfile);
+                else limit = 0;
+                if ((limit <= 0) || (limit > SRBSIZ)) { /* invalid or err? */
                     free (mbuf);
                     r = SCPE_IOERR;
                     goto Cleanup_Return;
                     }
+                if (hash != NULL)                       /* fingerprint block */
+                    sim_save_hash (mbuf, limit * sz, &hash[2 * blk]);
                 for (j = 0; j < limit; j++, k = k + (dptr->aincr)) {
                     if (blkcnt < 0)                     /* compressed? */
                         val = 0;
@@ -6989,7 +7612,18 @@ for ( ;; ) {                                            /* device loop */
                         }
                     }                                   /* end for j */
                 }                                       /* end for k */
+#if defined (HAVE_ZLIB)
+            if (zinit) {                                /* end unit's stream */
+                inflateEnd (&zs);
+                free (zbuf);
+                zbuf = NULL;
+                zinit = FALSE;
+                }
+#endif
             free (mbuf);                                /* dealloc buffer */
+            if ((hash != NULL) &&                       /* all fingerprints current */
+                ((dirty = sim_save_dirty_map (uptr, high, dptr)) != NULL))
+                memset (dirty, 0, SAVE_NBLK (high, dptr));
             }                                           /* end if high */
         }                                               /* end unit loop */
     for ( ;; ) {                                        /* register loop */
@@ -7016,7 +7650,7 @@ for ( ;; ) {                                            /* device loop */
             if (val > mask) {                           /* value ok? */
                 sim_printf ("Invalid register value: %s %s\n", sim_dname (dptr), buf);
                 }
-            else if (us < rptr->depth)                  /* in range? */
+            else if ((us < rptr->depth) && (!base_only))/* in range? */
                 put_rval (rptr, us, val);
             }
         }                                               /* end register loop */
@@ -7062,6 +7696,11 @@ for (j=0, r = SCPE_OK; j<attcnt; j++) {
     attnames[j] = NULL;
     }
 Cleanup_Return:
+#if defined (HAVE_ZLIB)
+if (zinit)
+    inflateEnd (&zs);
+free (zbuf);
+#endif
 for (j=0; j < attcnt; j++)
     free (attnames[j]);
 free (attnames);
@@ -9860,8 +10499,15 @@ return buf;
    and to see if further events need to be processed, or sim_interval
    reset to count the next one.
 
-   The event queue is maintained in clock order; entry timeouts are
-   RELATIVE to the time in the previous entry.
+   The event queue is a binary min-heap keyed on each entry's ABSOLUTE
+   due time (q_due, in the units of sim_gtime) with ties broken by
+   insertion order (q_seq), so insertion and cancellation are O(log n)
+   and entries which become due at the same time are processed in the
+   order they were scheduled.  sim_clock_queue always points at the
+   earliest entry and its time field holds the count down remaining
+   until it is due, as the simulator sees it in sim_interval.  The
+   next fields of queued units link the heap slots in slot order so
+   that the queue can still be walked to enumerate all pending events.
 
    sim_process_event - process event
 
@@ -9872,6 +10518,116 @@ return buf;
                         or 0 (SCPE_OK) if no exceptions
 */
 
+/* Store a unit into a heap slot and maintain the slot order next links */
+
+static void _sim_queue_place (UNIT *uptr, int32 slot)
+{
+sim_clock_heap[slot] = uptr;
+uptr->q_index = slot;
+uptr->next = (slot + 1 < sim_clock_heap_count) ? sim_clock_heap[slot + 1] : QUEUE_LIST_END;
+if (slot > 0)
+    sim_clock_heap[slot - 1]->next = uptr;
+}
+
+static void _sim_queue_sift_up (UNIT *uptr, int32 slot)
+{
+while (slot > 0) {
+    int32 parent = (slot - 1) / 2;
+
+    if (!SIM_QUEUE_BEFORE (uptr, sim_clock_heap[parent]))
+        break;
+    _sim_queue_place (sim_clock_heap[parent], slot);
+    slot = parent;
+    }
+_sim_queue_place (uptr, slot);
+}
+
+static void _sim_queue_sift_down (UNIT *uptr, int32 slot)
+{
+int32 child;
+
+while ((child = 2 * slot + 1) < sim_clock_heap_count) {
+    if ((child + 1 < sim_clock_heap_count) &&
+        SIM_QUEUE_BEFORE (sim_clock_heap[child + 1], sim_clock_heap[child]))
+        ++child;
+    if (!SIM_QUEUE_BEFORE (sim_clock_heap[child], uptr))
+        break;
+    _sim_queue_place (sim_clock_heap[child], slot);
+    slot = child;
+    }
+_sim_queue_place (uptr, slot);
+}
+
+/* Establish sim_interval after the head of the queue may have changed.
+   The simulator time must be current (UPDATE_SIM_TIME) when called. */
+
+static void _sim_queue_set_interval (void)
+{
+if (sim_clock_heap_count == 0) {
+    sim_clock_queue = QUEUE_LIST_END;
+    sim_interval = noqueue_time = NOQUEUE_WAIT;
+    }
+else {
+    sim_clock_queue = sim_clock_heap[0];
+    sim_interval = sim_clock_queue->time = (int32)(sim_clock_queue->q_due - sim_time);
+    }
+}
+
+static t_bool _sim_queue_contains (UNIT *uptr)
+{
+return ((uptr->next != NULL) &&
+        (uptr->q_index >= 0) &&
+        (uptr->q_index < sim_clock_heap_count) &&
+        (sim_clock_heap[uptr->q_index] == uptr));
+}
+
+static void _sim_queue_insert (UNIT *uptr, int32 event_time)
+{
+if (sim_clock_heap_count == sim_clock_heap_size) {
+    sim_clock_heap_size = sim_clock_heap_size ? 2 * sim_clock_heap_size : 64;
+    sim_clock_heap = (UNIT **)realloc (sim_clock_heap, sim_clock_heap_size * sizeof (*sim_clock_heap));
+    if (sim_clock_heap == NULL) {
+        sim_printf ("Event queue allocation failed for %s\n", sim_uname (uptr));
+        abort ();
+        }
+    }
+uptr->q_due = sim_time + event_time;
+uptr->q_seq = sim_clock_heap_seq++;
+uptr->time = event_time;
+_sim_queue_sift_up (uptr, sim_clock_heap_count++);
+_sim_queue_set_interval ();
+}
+
+static void _sim_queue_remove (UNIT *uptr)
+{
+int32 slot = uptr->q_index;
+UNIT *last = sim_clock_heap[--sim_clock_heap_count];
+
+if (slot != sim_clock_heap_count) {
+    if ((slot > 0) && SIM_QUEUE_BEFORE (last, sim_clock_heap[(slot - 1) / 2]))
+        _sim_queue_sift_up (last, slot);
+    else
+        _sim_queue_sift_down (last, slot);
+    }
+if (sim_clock_heap_count > 0)
+    sim_clock_heap[sim_clock_heap_count - 1]->next = QUEUE_LIST_END;
+uptr->next = NULL;                                      /* hygiene */
+uptr->q_index = 0;
+_sim_queue_set_interval ();
+}
+
+/* Instructions until a queued entry is due, measured the same way the
+   former delta list accumulated entry times from the head */
+
+static int32 _sim_queue_accum (UNIT *uptr)
+{
+int32 accum = (int32)(uptr->q_due - sim_clock_queue->q_due);
+
+if (sim_interval > 0)
+    accum = accum + sim_interval;
+return accum;
+}
+
 t_stat sim_process_event (void)
 {
 UNIT *uptr;
@@ -9892,13 +10648,8 @@ if (sim_clock_queue == QUEUE_LIST_END) {                /* queue empty? */
 sim_processing_event = TRUE;
 do {
     uptr = sim_clock_queue;                             /* get first */
-    sim_clock_queue = uptr->next;                       /* remove first */
-    uptr->next = NULL;                                  /* hygiene */
+    _sim_queue_remove (uptr);                           /* remove first */
     uptr->time = 0;
-    if (sim_clock_queue != QUEUE_LIST_END)
-        sim_interval = sim_clock_queue->time;
-    else
-        sim_interval = noqueue_time = NOQUEUE_WAIT;
     sim_debug (SIM_DBG_EVENT, sim_dflt_dev, "Processing Event for %s\n", sim_uname (uptr));
     AIO_EVENT_BEGIN(uptr);
     if (uptr->usecs_remaining)
@@ -9948,9 +10699,6 @@ return _sim_activate (uptr, event_time);
 
 t_stat _sim_activate (UNIT *uptr, int32 event_time)
 {
-UNIT *cptr, *prvptr;
-int32 accum;
-
 AIO_ACTIVATE (_sim_activate, uptr, event_time);
 if (sim_is_active (uptr))                               /* already active? */
     return SCPE_OK;
@@ -9958,26 +10706,7 @@ UPDATE_SIM_TIME;                                        /* update sim time */
 
 sim_debug (SIM_DBG_ACTIVATE, sim_dflt_dev, "Activating %s delay=%d\n", sim_uname (uptr), event_time);
 
-prvptr = NULL;
-accum = 0;
-for (cptr = sim_clock_queue; cptr != QUEUE_LIST_END; cptr = cptr->next) {
-    if (event_time < (accum + cptr->time))
-        break;
-    accum = accum + cptr->time;
-    prvptr = cptr;
-    }
-if (prvptr == NULL) {                                   /* insert at head */
-    cptr = uptr->next = sim_clock_queue;
-    sim_clock_queue = uptr;
-    }
-else {
-    cptr = uptr->next = prvptr->next;                   /* insert at prvptr */
-    prvptr->next = uptr;
-    }
-uptr->time = event_time - accum;
-if (cptr != QUEUE_LIST_END)
-    cptr->time = cptr->time - uptr->time;
-sim_interval = sim_clock_queue->time;
+_sim_queue_insert (uptr, event_time);
 return SCPE_OK;
 }
 
@@ -10076,8 +10805,6 @@ return sim_timer_activate_after (uptr, usec_delay);
 
 t_stat sim_cancel (UNIT *uptr)
 {
-UNIT *cptr, *nptr;
-
 AIO_VALIDATE;
 if ((uptr->cancel) && uptr->cancel (uptr))
     return SCPE_OK;
@@ -10091,29 +10818,11 @@ sim_debug (SIM_DBG_EVENT, sim_dflt_dev, "Canceling Event for %s\n", sim_uname(up
 UPDATE_SIM_TIME;                                        /* update sim time */
 if (!sim_is_active (uptr))
     return SCPE_OK;
-nptr = QUEUE_LIST_END;
-
-if (sim_clock_queue == uptr) {
-    nptr = sim_clock_queue = uptr->next;
-    uptr->next = NULL;                                  /* hygiene */
-    }
-else {
-    for (cptr = sim_clock_queue; cptr != QUEUE_LIST_END; cptr = cptr->next) {
-        if (cptr->next == uptr) {
-            nptr = cptr->next = uptr->next;
-            uptr->next = NULL;                          /* hygiene */
-            break;                                      /* end queue scan */
-            }
-        }
-    }
-if (nptr != QUEUE_LIST_END)
-    nptr->time += (uptr->next) ? 0 : uptr->time;
+if (_sim_queue_contains (uptr))
+    _sim_queue_remove (uptr);
 if (!uptr->next)
     uptr->time = 0;
 uptr->usecs_remaining = 0;
-if (sim_clock_queue != QUEUE_LIST_END)
-    sim_interval = sim_clock_queue->time;
-else sim_interval = noqueue_time = NOQUEUE_WAIT;
 if (uptr->next) {
     sim_printf ("Cancel failed for %s\n", sim_uname(uptr));
     if (sim_deb)
@@ -10148,20 +10857,8 @@ return (((uptr->next) || AIO_IS_ACTIVE(uptr) || ((uptr->dynflags & UNIT_TMR_UNIT
 
 int32 _sim_activate_time (UNIT *uptr)
 {
-UNIT *cptr;
-int32 accum;
-
-accum = 0;
-for (cptr = sim_clock_queue; cptr != QUEUE_LIST_END; cptr = cptr->next) {
-    if (cptr == sim_clock_queue) {
-        if (sim_interval > 0)
-            accum = accum + sim_interval;
-        }
-    else
-        accum = accum + cptr->time;
-    if (cptr == uptr)
-        return accum + 1 + (int32)((uptr->usecs_remaining * sim_timer_inst_per_sec ()) / 1000000.0);
-    }
+if (_sim_queue_contains (uptr))
+    return _sim_queue_accum (uptr) + 1 + (int32)((uptr->usecs_remaining * sim_timer_inst_per_sec ()) / 1000000.0);
 return 0;
 }
 
@@ -10178,25 +10875,14 @@ return _sim_activate_time (uptr);
 
 double sim_activate_time_usecs (UNIT *uptr)
 {
-UNIT *cptr;
-int32 accum;
 double result;
 
 AIO_VALIDATE;
 result = sim_timer_activate_time_usecs (uptr);
 if (result >= 0)
     return result;
-accum = 0;
-for (cptr = sim_clock_queue; cptr != QUEUE_LIST_END; cptr = cptr->next) {
-    if (cptr == sim_clock_queue) {
-        if (sim_interval > 0)
-            accum = accum + sim_interval;
-        }
-    else
-        accum = accum + cptr->time;
-    if (cptr == uptr)
-        return 1.0 + uptr->usecs_remaining + ((1000000.0 * accum) / sim_timer_inst_per_sec ());
-    }
+if (_sim_queue_contains (uptr))
+    return 1.0 + uptr->usecs_remaining + ((1000000.0 * _sim_queue_accum (uptr)) / sim_timer_inst_per_sec ());
 return 0.0;
 }
 
@@ -10231,13 +10917,7 @@ return sim_rtime;
 
 int32 sim_qcount (void)
 {
-int32 cnt;
-UNIT *uptr;
-
-cnt = 0;
-for (uptr = sim_clock_queue; uptr != QUEUE_LIST_END; uptr = uptr->next)
-    cnt++;
-return cnt;
+return sim_clock_heap_count;
 }
 
 /* Breakpoint package.  This module replaces the VM-implemented one
@@ -10259,6 +10939,13 @@ return cnt;
    is the bitwise OR of all the type fields).  A simulator need only check for
    a breakpoint of type X if bit SWMASK('X') is set in sim_brk_summ.
 
+   sim_brk_filt refines that summary by address.  Each breakpoint's types are
+   ORed into the entry selected by hashing its address, so an entry without
+   type X means no type X breakpoint exists at any address which hashes to it.
+   sim_brk_test consults the filter before searching the table, and
+   simulators can avoid the call entirely by testing sim_brk_maybe (addr, typ)
+   first.
+
    The package contains the following public routines:
 
         sim_brk_init            initialize
@@ -10296,6 +10983,7 @@ sim_brk_tab = (BRKTAB **) realloc (sim_brk_tab, sim_brk_lnt*sizeof (BRKTAB*));
 if (sim_brk_tab == NULL)
     return SCPE_MEM;
 memset (sim_brk_tab, 0, sim_brk_lnt*sizeof (BRKTAB*));
+memset (sim_brk_filt, 0, sizeof (sim_brk_filt));
 sim_brk_ent = sim_brk_ins = 0;
 sim_brk_clract ();
 sim_brk_npc (0);
@@ -10429,6 +11117,7 @@ if ((act != NULL) && (*act != 0)) {                     /* new action? */
     bp->act = newp;                                     /* set pointer */
     }
 sim_brk_summ = sim_brk_summ | (sw & ~BRK_TYP_TEMP);
+sim_brk_filt[SIM_BRK_FILT_IDX (loc)] |= (sw & ~BRK_TYP_TEMP);
 return SCPE_OK;
 }
 
@@ -10466,10 +11155,12 @@ if (sim_brk_tab[sim_brk_ins] == NULL) {                 /* erased entry */
         sim_brk_tab[i] = sim_brk_tab[i+1];
     }
 sim_brk_summ = 0;                                       /* recalc summary */
+memset (sim_brk_filt, 0, sizeof (sim_brk_filt));        /* and filter */
 for (i = 0; i < sim_brk_ent; i++) {
     bp = sim_brk_tab[i];
     while (bp) {
         sim_brk_summ |= (bp->typ & ~BRK_TYP_TEMP);
+        sim_brk_filt[SIM_BRK_FILT_IDX (bp->addr)] |= (bp->typ & ~BRK_TYP_TEMP);
         bp = bp->next;
         }
     }
@@ -10612,6 +11303,8 @@ uint32 sim_brk_test (t_addr loc, uint32 btyp)
 BRKTAB *bp;
 uint32 spc = (btyp >> SIM_BKPT_V_SPC) & (SIM_BKPT_N_SPC - 1);
 
+if (!sim_brk_maybe (loc, btyp))                         /* filter says none here? */
+    return 0;
 if (sim_brk_summ & BRK_TYP_DYN_ALL)
     btyp |= BRK_TYP_DYN_ALL;
 
@@ -10879,40 +11572,261 @@ for (i=start_rule; i<exp->size; i++)
 return NULL;
 }
 
-/* Clear (delete) an expect rule */
+/* Regular expression rules are evaluated against the data in the match
+   buffer.  Most patterns which match a prefix of the buffer also match
+   the whole buffer, so once a block of data has been deposited a single
+   regexec determines whether a match occurred and a binary search over
+   the buffer length finds the byte at which it first occurred.  Patterns
+   containing end anchors, word boundaries or look ahead assertions can
+   stop matching as data is added and must be evaluated at each byte. */
 
-t_stat sim_exp_clr_tab (EXPECT *exp, EXPTAB *ep)
+static t_bool _sim_exp_regex_batchable (const char *pattern)
 {
-int32 i;
+const char *cptr;
 
-if (!ep)                                                /* not there? ok */
-    return SCPE_OK;
-free (ep->match);                                       /* deallocate match string */
-free (ep->match_pattern);                               /* deallocate the display format match string */
-free (ep->act);                                         /* deallocate action */
-#if defined(USE_REGEX)
-if (ep->switches & EXP_TYP_REGEX)
-    regfree (&ep->regex);                               /* release compiled regex */
-#endif
-exp->size -= 1;                                         /* decrement count */
-for (i=ep-exp->rules; i<exp->size; i++)                 /* shuffle up remaining rules */
-    exp->rules[i] = exp->rules[i+1];
-if (exp->size == 0) {                                   /* No rules left? */
-    free (exp->rules);
-    exp->rules = NULL;
+if (strchr (pattern, '$') || strstr (pattern, "(?"))
+    return FALSE;
+for (cptr = strchr (pattern, '\\'); cptr; cptr = strchr (cptr + 2, '\\')) {
+    if (cptr[1] == '\0')
+        break;
+    if (strchr ("bB<>'`zZG", cptr[1]))
+        return FALSE;
     }
-return SCPE_OK;
+return TRUE;
 }
 
-t_stat sim_exp_clr (EXPECT *exp, const char *match)
+static void _sim_exp_ac_free (EXPECT *exp)
 {
-EXPTAB *ep = (EXPTAB *)sim_exp_fnd (exp, match, 0);
-
-while (ep) {
-    sim_exp_clr_tab (exp, ep);
-    ep = (EXPTAB *)sim_exp_fnd (exp, match, ep - exp->rules);
-    }
-return SCPE_OK;
+free (exp->ac_next);
+exp->ac_next = NULL;
+free (exp->ac_rule);
+exp->ac_rule = NULL;
+free (exp->ac_depth);
+exp->ac_depth = NULL;
+exp->ac_states = exp->ac_classes = exp->ac_state = 0;
+}
+
+/* Recompute the automaton state from the data already in the match buffer */
+
+static void _sim_exp_ac_resync (EXPECT *exp)
+{
+uint32 i, state = 0;
+
+if (exp->ac_states && exp->buf && exp->buf_size) {
+    for (i = exp->buf_data; i > 0; i--) {
+        uint8 c = exp->buf[(exp->buf_ins + exp->buf_size - i) % exp->buf_size];
+
+        state = exp->ac_next[state * exp->ac_classes + exp->ac_class[c]];
+        }
+    }
+exp->ac_state = state;
+}
+
+/* Compile the match rules of an expect context.
+
+   All literal match strings are combined into a single Aho-Corasick
+   automaton with a complete transition table, so each output byte costs
+   one table lookup regardless of the number or length of the rules.
+   Input bytes are mapped to classes (bytes not in any match string share
+   class 0) to keep the table small.  Each state records the lowest
+   numbered rule whose match string ends there, which preserves the
+   rule precedence of a sequential scan of the rules. */
+
+static t_stat _sim_exp_compile (EXPECT *exp)
+{
+int32 i, literals = 0;
+uint32 j, c, s, t, states = 1, max_states = 1, qhead = 0, qtail = 0;
+int32 *next;
+uint32 *fail, *queue;
+
+_sim_exp_ac_free (exp);
+exp->regex_rules = exp->regex_bytewise = 0;
+memset (exp->ac_class, 0, sizeof (exp->ac_class));
+exp->ac_classes = 1;
+for (i=0; i<exp->size; i++) {
+    EXPTAB *ep = &exp->rules[i];
+
+    if (ep->switches & EXP_TYP_REGEX) {
+        ++exp->regex_rules;
+#if defined(USE_REGEX)
+        if (!ep->batch)
+            ++exp->regex_bytewise;
+#endif
+        continue;
+        }
+    ++literals;
+    max_states += ep->size;
+    for (j=0; j<ep->size; j++)
+        if (exp->ac_class[ep->match[j]] == 0)
+            exp->ac_class[ep->match[j]] = (uint16)exp->ac_classes++;
+    }
+if (literals == 0)
+    return SCPE_OK;
+next = (int32 *)malloc (max_states * exp->ac_classes * sizeof (*next));
+exp->ac_rule = (int32 *)malloc (max_states * sizeof (*exp->ac_rule));
+exp->ac_depth = (uint32 *)calloc (max_states, sizeof (*exp->ac_depth));
+fail = (uint32 *)calloc (max_states, sizeof (*fail));
+queue = (uint32 *)malloc (max_states * sizeof (*queue));
+exp->ac_next = next;
+if ((!next) || (!exp->ac_rule) || (!exp->ac_depth) || (!fail) || (!queue)) {
+    _sim_exp_ac_free (exp);
+    free (fail);
+    free (queue);
+    return SCPE_MEM;
+    }
+memset (next, 0xFF, max_states * exp->ac_classes * sizeof (*next));
+for (s=0; s<max_states; s++)
+    exp->ac_rule[s] = -1;
+for (i=0; i<exp->size; i++) {                           /* build the trie */
+    EXPTAB *ep = &exp->rules[i];
+
+    if (ep->switches & EXP_TYP_REGEX)
+        continue;
+    s = 0;
+    for (j=0; j<ep->size; j++) {
+        c = exp->ac_class[ep->match[j]];
+        if (next[s * exp->ac_classes + c] < 0) {
+            exp->ac_depth[states] = exp->ac_depth[s] + 1;
+            next[s * exp->ac_classes + c] = (int32)states++;
+            }
+        s = (uint32)next[s * exp->ac_classes + c];
+        }
+    if (exp->ac_rule[s] < 0)
+        exp->ac_rule[s] = i;
+    }
+for (c=0; c<exp->ac_classes; c++) {                     /* root transitions */
+    if (next[c] < 0)
+        next[c] = 0;
+    else
+        queue[qtail++] = (uint32)next[c];               /* fail[child of root] = 0 */
+    }
+while (qhead < qtail) {                                 /* breadth first fill in */
+    s = queue[qhead++];
+    if ((exp->ac_rule[fail[s]] >= 0) &&
+        ((exp->ac_rule[s] < 0) || (exp->ac_rule[fail[s]] < exp->ac_rule[s])))
+        exp->ac_rule[s] = exp->ac_rule[fail[s]];
+    for (c=0; c<exp->ac_classes; c++) {
+        t = s * exp->ac_classes + c;
+        if (next[t] < 0)
+            next[t] = next[fail[s] * exp->ac_classes + c];
+        else {
+            fail[next[t]] = (uint32)next[fail[s] * exp->ac_classes + c];
+            queue[qtail++] = (uint32)next[t];
+            }
+        }
+    }
+free (fail);
+free (queue);
+exp->ac_states = states;
+_sim_exp_ac_resync (exp);
+sim_debug (exp->dbit, exp->dptr, "Expect automaton: %d literal rules, %d states, %d input classes\n", (int)literals, (int)states, (int)exp->ac_classes);
+return SCPE_OK;
+}
+
+#if defined(USE_REGEX)
+/* Return the first end bytes of the match buffer as a string for RegEx compares */
+
+static char *_sim_exp_regex_string (EXPECT *exp, uint32 end, uint8 *saved)
+{
+uint32 i, len = 0;
+
+*saved = exp->buf[end];
+if (memchr (exp->buf, 0, end) == NULL) {                /* No Nul characters in buffer? */
+    exp->buf[end] = '\0';                               /* Nul terminate in place */
+    return (char *)exp->buf;
+    }
+for (i=0; i<end; i++)
+    if (exp->buf[i])
+        exp->rbuf[len++] = (char)exp->buf[i];
+exp->rbuf[len] = '\0';
+return exp->rbuf;
+}
+
+static t_bool _sim_exp_regex_test (EXPECT *exp, EXPTAB *ep, uint32 end)
+{
+uint8 saved;
+char *cbuf = _sim_exp_regex_string (exp, end, &saved);
+int res;
+
+if (sim_deb && exp->dptr && (exp->dptr->dctrl & exp->dbit)) {
+    char *estr = sim_encode_quoted_string (exp->buf, end);
+    sim_debug (exp->dbit, exp->dptr, "Checking String: %s\n", estr);
+    sim_debug (exp->dbit, exp->dptr, "Against RegEx Match Rule: %s\n", ep->match_pattern);
+    free (estr);
+    }
+res = regexec (&ep->regex, cbuf, ep->regex.re_nsub + 1, ep->matches, REG_NOTBOL);
+exp->buf[end] = saved;
+return (res == 0);
+}
+
+/* Make the match and substrings available as environment variables */
+
+static void _sim_exp_regex_groups (EXPECT *exp, EXPTAB *ep, uint32 end)
+{
+static size_t sim_exp_match_sub_count = 0;
+uint8 saved;
+char *cbuf = _sim_exp_regex_string (exp, end, &saved);
+char *buf = (char *)malloc (1 + end);
+size_t j;
+
+regexec (&ep->regex, cbuf, ep->regex.re_nsub + 1, ep->matches, REG_NOTBOL);
+for (j=0; j<ep->regex.re_nsub + 1; j++) {
+    char env_name[32];
+
+    sprintf (env_name, "_EXPECT_MATCH_GROUP_%d", (int)j);
+    memcpy (buf, &cbuf[ep->matches[j].rm_so], ep->matches[j].rm_eo-ep->matches[j].rm_so);
+    buf[ep->matches[j].rm_eo-ep->matches[j].rm_so] = '\0';
+    setenv (env_name, buf, 1);
+    sim_debug (exp->dbit, exp->dptr, "%s=%s\n", env_name, buf);
+    }
+for (; j<sim_exp_match_sub_count; j++) {
+    char env_name[32];
+
+    sprintf (env_name, "_EXPECT_MATCH_GROUP_%d", (int)j);
+    setenv (env_name, "", 1);                           /* Remove previous extra environment variables */
+    }
+sim_exp_match_sub_count = ep->regex.re_nsub;
+exp->buf[end] = saved;
+free (buf);
+}
+#endif
+
+/* Clear (delete) an expect rule */
+
+t_stat sim_exp_clr_tab (EXPECT *exp, EXPTAB *ep)
+{
+int32 i;
+
+if (!ep)                                                /* not there? ok */
+    return SCPE_OK;
+free (ep->match);                                       /* deallocate match string */
+free (ep->match_pattern);                               /* deallocate the display format match string */
+free (ep->act);                                         /* deallocate action */
+#if defined(USE_REGEX)
+if (ep->switches & EXP_TYP_REGEX) {
+    regfree (&ep->regex);                               /* release compiled regex */
+    free (ep->matches);                                 /* and match results */
+    }
+#endif
+exp->size -= 1;                                         /* decrement count */
+for (i=ep-exp->rules; i<exp->size; i++)                 /* shuffle up remaining rules */
+    exp->rules[i] = exp->rules[i+1];
+if (exp->size == 0) {                                   /* No rules left? */
+    free (exp->rules);
+    exp->rules = NULL;
+    }
+return _sim_exp_compile (exp);                          /* rebuild the matcher */
+}
+
+t_stat sim_exp_clr (EXPECT *exp, const char *match)
+{
+EXPTAB *ep = (EXPTAB *)sim_exp_fnd (exp, match, 0);
+
+while (ep) {
+    sim_exp_clr_tab (exp, ep);
+    ep = (EXPTAB *)sim_exp_fnd (exp, match, ep - exp->rules);
+    }
+return SCPE_OK;
 }
 
 /* Clear all expect rules */
@@ -10925,14 +11839,24 @@ for (i=0; i<exp->size; i++) {
     free (exp->rules[i].match);                         /* deallocate match string */
     free (exp->rules[i].match_pattern);                 /* deallocate display format match string */
     free (exp->rules[i].act);                           /* deallocate action */
+#if defined(USE_REGEX)
+    if (exp->rules[i].switches & EXP_TYP_REGEX) {
+        regfree (&exp->rules[i].regex);                 /* release compiled regex */
+        free (exp->rules[i].matches);                   /* and match results */
+        }
+#endif
     }
 free (exp->rules);
 exp->rules = NULL;
 exp->size = 0;
 free (exp->buf);
 exp->buf = NULL;
+free (exp->rbuf);
+exp->rbuf = NULL;
 exp->buf_size = 0;
 exp->buf_data = exp->buf_ins = 0;
+_sim_exp_ac_free (exp);
+exp->regex_rules = exp->regex_bytewise = 0;
 return SCPE_OK;
 }
 
@@ -11016,6 +11940,13 @@ if (switches & EXP_TYP_REGEX) {
     memcpy (match_buf, match+1, strlen(match)-2);      /* extract string without surrounding quotes */
     match_buf[strlen(match)-2] = '\0';
     regcomp (&ep->regex, (char *)match_buf, REG_EXTENDED);
+    ep->batch = _sim_exp_regex_batchable ((char *)match_buf);
+    ep->matches = (regmatch_t *)calloc (ep->regex.re_nsub + 1, sizeof (*ep->matches));
+    if (ep->matches == NULL) {
+        free (match_buf);
+        sim_exp_clr_tab (exp, ep);                      /* clear it */
+        return SCPE_MEM;
+        }
 #endif
     free (match_buf);
     match_buf = NULL;
@@ -11051,10 +11982,14 @@ for (i=0; i<exp->size; i++) {
     uint32 compare_size = (exp->rules[i].switches & EXP_TYP_REGEX) ? MAX(10 * strlen(ep->match_pattern), 1024) : exp->rules[i].size;
     if (compare_size >= exp->buf_size) {
         exp->buf = (uint8 *)realloc (exp->buf, compare_size + 2); /* Extra byte to null terminate regex compares */
+        exp->rbuf = (char *)realloc (exp->rbuf, compare_size + 2);
+        if ((exp->buf == NULL) || (exp->rbuf == NULL))
+            return SCPE_MEM;
+        memset (&exp->buf[exp->buf_size], 0, compare_size + 2 - exp->buf_size);
         exp->buf_size = compare_size + 1;
         }
     }
-return SCPE_OK;
+return _sim_exp_compile (exp);
 }
 
 /* Show an expect rule */
@@ -11133,173 +12068,150 @@ return SCPE_OK;
 
 t_stat sim_exp_check (EXPECT *exp, uint8 data)
 {
-int32 i;
-EXPTAB *ep;
-int regex_checks = 0;
-char *tstr = NULL;
-
-if ((!exp) || (!exp->rules))                            /* Anying to check? */
-    return SCPE_OK;
+return sim_exp_check_buf (exp, &data, 1);
+}
 
-exp->buf[exp->buf_ins++] = data;                        /* Save new data */
-exp->buf[exp->buf_ins] = '\0';                          /* Nul terminate for RegEx match */
-if (exp->buf_data < exp->buf_size)
-    ++exp->buf_data;                                    /* Record amount of data in buffer */
+/* Process a matched expect rule */
 
-for (i=0; i < exp->size; i++) {
-    ep = &exp->rules[i];
-    if (ep->switches & EXP_TYP_REGEX) {
+static void _sim_exp_matched (EXPECT *exp, EXPTAB *ep)
+{
 #if defined (USE_REGEX)
-        regmatch_t *matches;
-        char *cbuf = (char *)exp->buf;
-        static size_t sim_exp_match_sub_count = 0;
-
-        if (tstr)
-            cbuf = tstr;
-        else {
-            if (strlen ((char *)exp->buf) != exp->buf_ins) { /* Nul characters in buffer? */
-                size_t off;
-
-                tstr = (char *)malloc (exp->buf_ins + 1);
-                tstr[0] = '\0';
-                for (off=0; off < exp->buf_ins; off += 1 + strlen ((char *)&exp->buf[off]))
-                    strcpy (&tstr[strlen (tstr)], (char *)&exp->buf[off]);
-                cbuf = tstr;
-                }
-            }
-        ++regex_checks;
-        matches = (regmatch_t *)calloc ((ep->regex.re_nsub + 1), sizeof(*matches));
-        if (sim_deb && exp->dptr && (exp->dptr->dctrl & exp->dbit)) {
-            char *estr = sim_encode_quoted_string (exp->buf, exp->buf_ins);
-            sim_debug (exp->dbit, exp->dptr, "Checking String: %s\n", estr);
-            sim_debug (exp->dbit, exp->dptr, "Against RegEx Match Rule: %s\n", ep->match_pattern);
-            free (estr);
-            }
-        if (!regexec (&ep->regex, cbuf, ep->regex.re_nsub + 1, matches, REG_NOTBOL)) {
-            size_t j;
-            char *buf = (char *)malloc (1 + exp->buf_ins);
-
-            for (j=0; j<ep->regex.re_nsub + 1; j++) {
-                char env_name[32];
-
-                sprintf (env_name, "_EXPECT_MATCH_GROUP_%d", (int)j);
-                memcpy (buf, &cbuf[matches[j].rm_so], matches[j].rm_eo-matches[j].rm_so);
-                buf[matches[j].rm_eo-matches[j].rm_so] = '\0';
-                setenv (env_name, buf, 1);      /* Make the match and substrings available as environment variables */
-                sim_debug (exp->dbit, exp->dptr, "%s=%s\n", env_name, buf);
-                }
-            for (; j<sim_exp_match_sub_count; j++) {
-                char env_name[32];
-
-                sprintf (env_name, "_EXPECT_MATCH_GROUP_%d", (int)j);
-                setenv (env_name, "", 1);      /* Remove previous extra environment variables */
-                }
-            sim_exp_match_sub_count = ep->regex.re_nsub;
-            free (matches);
-            free (buf);
-            break;
-            }
-        free (matches);
+if (ep->switches & EXP_TYP_REGEX)
+    _sim_exp_regex_groups (exp, ep, exp->buf_ins);
 #endif
+sim_debug (exp->dbit, exp->dptr, "Matched expect pattern: %s\n", ep->match_pattern);
+setenv ("_EXPECT_MATCH_PATTERN", ep->match_pattern, 1);   /* Make the match detail available as an environment variable */
+if (ep->cnt > 0) {
+    ep->cnt -= 1;
+    sim_debug (exp->dbit, exp->dptr, "Waiting for %d more match%s before stopping\n", 
+                                     ep->cnt, (ep->cnt == 1) ? "" : "es");
+    }
+else {
+    int32 switches = ep->switches;                      /* rule is gone after it is cleared */
+    uint32 after = ep->after;
+
+    if (ep->act && *ep->act) {
+        sim_debug (exp->dbit, exp->dptr, "Initiating actions: %s\n", ep->act);
         }
     else {
-        if (exp->buf_data < ep->size)                           /* Too little data to match yet? */
-            continue;                                           /* Yes, Try next one. */
-        if (exp->buf_ins < ep->size) {                          /* Match might stradle end of buffer */
-            /* 
-             * First compare the newly deposited data at the beginning 
-             * of buffer with the end of the match string
-             */
-            if (exp->buf_ins) {
-                if (sim_deb && exp->dptr && (exp->dptr->dctrl & exp->dbit)) {
-                    char *estr = sim_encode_quoted_string (exp->buf, exp->buf_ins);
-                    char *mstr = sim_encode_quoted_string (&ep->match[ep->size-exp->buf_ins], exp->buf_ins);
-
-                    sim_debug (exp->dbit, exp->dptr, "Checking String[0:%d]: %s\n", exp->buf_ins, estr);
-                    sim_debug (exp->dbit, exp->dptr, "Against Match Data: %s\n", mstr);
-                    free (estr);
-                    free (mstr);
-                    }
-                if (memcmp (exp->buf, &ep->match[ep->size-exp->buf_ins], exp->buf_ins)) /* Tail Match? */
-                    continue;                                   /* Nope, Try next one. */
-                }
-            if (sim_deb && exp->dptr && (exp->dptr->dctrl & exp->dbit)) {
-                char *estr = sim_encode_quoted_string (&exp->buf[exp->buf_size-(ep->size-exp->buf_ins)], ep->size-exp->buf_ins);
-                char *mstr = sim_encode_quoted_string (ep->match, ep->size-exp->buf_ins);
-
-                sim_debug (exp->dbit, exp->dptr, "Checking String[%d:%d]: %s\n", exp->buf_size-(ep->size-exp->buf_ins), ep->size-exp->buf_ins, estr);
-                sim_debug (exp->dbit, exp->dptr, "Against Match Data: %s\n", mstr);
-                free (estr);
-                free (mstr);
-                }
-            if (memcmp (&exp->buf[exp->buf_size-(ep->size-exp->buf_ins)], ep->match, ep->size-exp->buf_ins)) /* Front Match? */
-                continue;                                       /* Nope, Try next one. */
-            break;
-            }
-        else {
-            if (sim_deb && exp->dptr && (exp->dptr->dctrl & exp->dbit)) {
-                char *estr = sim_encode_quoted_string (&exp->buf[exp->buf_ins-ep->size], ep->size);
-                char *mstr = sim_encode_quoted_string (ep->match, ep->size);
-
-                sim_debug (exp->dbit, exp->dptr, "Checking String[%d:%d]: %s\n", exp->buf_ins-ep->size, ep->size, estr);
-                sim_debug (exp->dbit, exp->dptr, "Against Match Data: %s\n", mstr);
-                free (estr);
-                free (mstr);
-                }
-            if (memcmp (&exp->buf[exp->buf_ins-ep->size], ep->match, ep->size)) /* Whole string match? */
-                continue;                                       /* Nope, Try next one. */
-            break;
-            }
-        }
-    }
-if (exp->buf_ins == exp->buf_size) {                    /* At end of match buffer? */
-    if (regex_checks) {
-        /* When processing regular expressions, let the match buffer fill 
-           up and then shuffle the buffer contents down by half the buffer size
-           so that the regular expression has a single contiguous buffer to 
-           match against instead of the wrapping buffer paradigm which is 
-           used when no regular expression rules are in effect */
-        memmove (exp->buf, &exp->buf[exp->buf_size/2], exp->buf_size-(exp->buf_size/2));
-        exp->buf_ins -= exp->buf_size/2;
-        exp->buf_data = exp->buf_ins;
-        sim_debug (exp->dbit, exp->dptr, "Buffer Full - sliding the last %d bytes to start of buffer new insert at: %d\n", (exp->buf_size/2), exp->buf_ins);
+        sim_debug (exp->dbit, exp->dptr, "No actions specified, stopping...\n");
         }
+    sim_brk_setact (ep->act);                           /* set up actions */
+    if (switches & EXP_TYP_CLEARALL)                    /* Clear-all expect rule? */
+        sim_exp_clrall (exp);                           /* delete all rules */
     else {
-        exp->buf_ins = 0;                               /* wrap around to beginning */
-        sim_debug (exp->dbit, exp->dptr, "Buffer wrapping\n");
+        if (!(switches & EXP_TYP_PERSIST))              /* One shot expect rule? */
+            sim_exp_clr_tab (exp, ep);                  /* delete it */
         }
+    sim_activate (&sim_expect_unit,                     /* schedule simulation stop when indicated */
+                  (switches & EXP_TYP_TIME) ?  
+                        (int32)((sim_timer_inst_per_sec ()*after)/1000000.0) : 
+                        after);
     }
-if (i != exp->size) {                                   /* Found? */
-    sim_debug (exp->dbit, exp->dptr, "Matched expect pattern: %s\n", ep->match_pattern);
-    setenv ("_EXPECT_MATCH_PATTERN", ep->match_pattern, 1);   /* Make the match detail available as an environment variable */
-    if (ep->cnt > 0) {
-        ep->cnt -= 1;
-        sim_debug (exp->dbit, exp->dptr, "Waiting for %d more match%s before stopping\n", 
-                                         ep->cnt, (ep->cnt == 1) ? "" : "es");
+/* Matched data is no longer available for future matching */
+exp->buf_data = exp->buf_ins = 0;
+exp->ac_state = 0;
+}
+
+/* Test a block of output data for expect matches
+
+   The data is deposited in the match buffer in runs which end at the
+   end of the buffer.  Literal rules are matched by the automaton one
+   byte at a time; RegEx rules are evaluated once per run (or once per
+   byte for patterns which aren't batchable).  The earliest byte at
+   which any rule matched wins, with ties going to the lowest numbered
+   rule, exactly as if each byte had been checked against every rule as
+   it arrived.  Data following a match is then checked afresh against
+   the remaining rules. */
+
+t_stat sim_exp_check_buf (EXPECT *exp, const uint8 *data, uint32 size)
+{
+while ((size > 0) && exp && exp->rules) {
+    uint32 start = exp->buf_ins;
+    uint32 cnt = exp->buf_size - exp->buf_ins;
+    uint32 end, match_end = 0;
+    int32 match_rule = -1;
+
+    if (exp->regex_bytewise || (cnt > size))
+        cnt = exp->regex_bytewise ? 1 : size;
+    memcpy (&exp->buf[start], data, cnt);               /* Save new data */
+    end = start + cnt;
+    if (exp->ac_states) {
+        const int32 *next = exp->ac_next;
+        uint32 classes = exp->ac_classes;
+        uint32 state = exp->ac_state;
+        uint32 p;
+
+        for (p = start; p < end; p++) {
+            state = (uint32)next[state * classes + exp->ac_class[exp->buf[p]]];
+            if (exp->ac_rule[state] >= 0) {
+                match_end = p + 1;
+                match_rule = exp->ac_rule[state];
+                break;
+                }
+            }
+        exp->ac_state = state;
         }
-    else {
-        if (ep->act && *ep->act) {
-            sim_debug (exp->dbit, exp->dptr, "Initiating actions: %s\n", ep->act);
+#if defined (USE_REGEX)
+    if (exp->regex_rules) {
+        int32 i;
+
+        for (i=0; i < exp->size; i++) {
+            EXPTAB *ep = &exp->rules[i];
+            uint32 lo = start + 1;
+            uint32 hi = end;
+
+            if (!(ep->switches & EXP_TYP_REGEX))
+                continue;
+            if (match_rule >= 0)                        /* Only an earlier match can win */
+                hi = (i < match_rule) ? match_end : match_end - 1;
+            if ((hi < lo) || (!_sim_exp_regex_test (exp, ep, hi)))
+                continue;
+            while (lo < hi) {                           /* find the byte which completed the match */
+                uint32 mid = lo + (hi - lo) / 2;
+
+                if (_sim_exp_regex_test (exp, ep, mid))
+                    hi = mid;
+                else
+                    lo = mid + 1;
+                }
+            match_end = lo;
+            match_rule = i;
             }
-        else {
-            sim_debug (exp->dbit, exp->dptr, "No actions specified, stopping...\n");
+        }
+#endif
+    if (match_rule >= 0)
+        cnt = match_end - start;
+    exp->buf_ins = start + cnt;
+    exp->buf_data += cnt;                               /* Record amount of data in buffer */
+    if (exp->buf_data > exp->buf_size)
+        exp->buf_data = exp->buf_size;
+    data += cnt;
+    size -= cnt;
+    if (match_rule >= 0) {
+        _sim_exp_matched (exp, &exp->rules[match_rule]);
+        continue;
+        }
+    if (exp->buf_ins == exp->buf_size) {                /* At end of match buffer? */
+        if (exp->regex_rules) {
+            /* When processing regular expressions, let the match buffer fill 
+               up and then shuffle the buffer contents down by half the buffer size
+               so that the regular expression has a single contiguous buffer to 
+               match against instead of the wrapping buffer paradigm which is 
+               used when no regular expression rules are in effect */
+            memmove (exp->buf, &exp->buf[exp->buf_size/2], exp->buf_size-(exp->buf_size/2));
+            exp->buf_ins -= exp->buf_size/2;
+            exp->buf_data = exp->buf_ins;
+            sim_debug (exp->dbit, exp->dptr, "Buffer Full - sliding the last %d bytes to start of buffer new insert at: %d\n", (exp->buf_size/2), exp->buf_ins);
+            if (exp->ac_states && (exp->ac_depth[exp->ac_state] > exp->buf_data))
+                _sim_exp_ac_resync (exp);               /* partial literal match slid out of the buffer */
             }
-        sim_brk_setact (ep->act);                       /* set up actions */
-        if (ep->switches & EXP_TYP_CLEARALL)            /* Clear-all expect rule? */
-            sim_exp_clrall (exp);                       /* delete all rules */
         else {
-            if (!(ep->switches & EXP_TYP_PERSIST))      /* One shot expect rule? */
-                sim_exp_clr_tab (exp, ep);              /* delete it */
+            exp->buf_ins = 0;                           /* wrap around to beginning */
+            sim_debug (exp->dbit, exp->dptr, "Buffer wrapping\n");
             }
-        sim_activate (&sim_expect_unit,                 /* schedule simulation stop when indicated */
-                      (ep->switches & EXP_TYP_TIME) ?  
-                            (int32)((sim_timer_inst_per_sec ()*ep->after)/1000000.0) : 
-                            ep->after);
         }
-    /* Matched data is no longer available for future matching */
-    exp->buf_data = exp->buf_ins = 0;
     }
-free (tstr);
 return SCPE_OK;
 }
 
@@ -11466,104 +12378,1446 @@ while (dptr->debflags[offset].name && (offset < 32)) {
 return some_match ? some_match : debtab_nomatch;
 }
 
-/* Prints standard debug prefix unless previous call unterminated */
+/* Formats the standard debug prefix from its components */
 
-static const char *sim_debug_prefix (uint32 dbits, DEVICE* dptr)
+static const char *sim_debug_prefix_fmt (char *prefix, int32 switches, struct timespec *time_now, 
+                                         struct timespec *basetime, double gtime, const char *pc_s, 
+                                         t_bool main_thread, const char *dev_name, const char *debug_type)
 {
-const char* debug_type = get_dbg_verb (dbits, dptr);
 char tim_t[32] = "";
 char tim_a[32] = "";
-char pc_s[64] = "";
-struct timespec time_now;
 
-if (sim_deb_switches & (SWMASK ('T') | SWMASK ('R') | SWMASK ('A'))) {
-    clock_gettime(CLOCK_REALTIME, &time_now);
-    if (sim_deb_switches & SWMASK ('R'))
-        sim_timespec_diff (&time_now, &time_now, &sim_deb_basetime);
-    if (sim_deb_switches & SWMASK ('T')) {
-        time_t tnow = (time_t)time_now.tv_sec;
+if (switches & (SWMASK ('T') | SWMASK ('R') | SWMASK ('A'))) {
+    if (switches & SWMASK ('R'))
+        sim_timespec_diff (time_now, time_now, basetime);
+    if (switches & SWMASK ('T')) {
+        time_t tnow = (time_t)time_now->tv_sec;
         struct tm *now = localtime(&tnow);
 
-        sprintf(tim_t, "%02d:%02d:%02d.%03d ", now->tm_hour, now->tm_min, now->tm_sec, (int)(time_now.tv_nsec/1000000));
+        sprintf(tim_t, "%02d:%02d:%02d.%03d ", now->tm_hour, now->tm_min, now->tm_sec, (int)(time_now->tv_nsec/1000000));
         }
-    if (sim_deb_switches & SWMASK ('A')) {
-        sprintf(tim_t, "%" LL_FMT "d.%03d ", (LL_TYPE)(time_now.tv_sec), (int)(time_now.tv_nsec/1000000));
+    if (switches & SWMASK ('A')) {
+        sprintf(tim_t, "%" LL_FMT "d.%03d ", (LL_TYPE)(time_now->tv_sec), (int)(time_now->tv_nsec/1000000));
         }
     }
+sprintf(prefix, "DBG(%s%s%.0f%s)%s> %s %s: ", tim_t, tim_a, gtime, pc_s, main_thread ? "" : "+", dev_name, debug_type);
+return prefix;
+}
+
+static t_value sim_debug_pc (void)
+{
+/* Some simulators expose the PC as a register, some don't expose it or expose a register 
+   which is not a variable which is updated during instruction execution (i.e. only upon
+   exit of sim_instr()).  For the -P debug option to be effective, such a simulator should
+   provide a routine which returns the value of the current PC and set the sim_vm_pc_value
+   routine pointer to that routine.
+ */
+if (sim_vm_pc_value)
+    return (*sim_vm_pc_value)();
+return get_rval (sim_PC, 0);
+}
+
+/* Prints standard debug prefix unless previous call unterminated */
+
+static const char *sim_debug_prefix (uint32 dbits, DEVICE* dptr)
+{
+const char* debug_type = get_dbg_verb (dbits, dptr);
+char pc_s[64] = "";
+struct timespec time_now;
+
+if (sim_deb_switches & (SWMASK ('T') | SWMASK ('R') | SWMASK ('A')))
+    clock_gettime(CLOCK_REALTIME, &time_now);
 if (sim_deb_switches & SWMASK ('P')) {
-    t_value val;
-    
-    /* Some simulators expose the PC as a register, some don't expose it or expose a register 
-       which is not a variable which is updated during instruction execution (i.e. only upon
-       exit of sim_instr()).  For the -P debug option to be effective, such a simulator should
-       provide a routine which returns the value of the current PC and set the sim_vm_pc_value
-       routine pointer to that routine.
-     */
-    if (sim_vm_pc_value)
-        val = (*sim_vm_pc_value)();
-    else
-        val = get_rval (sim_PC, 0);
     sprintf(pc_s, "-%s:", sim_PC->name);
-    sprint_val (&pc_s[strlen(pc_s)], val, sim_PC->radix, sim_PC->width, sim_PC->flags & REG_FMT);
+    sprint_val (&pc_s[strlen(pc_s)], sim_debug_pc (), sim_PC->radix, sim_PC->width, sim_PC->flags & REG_FMT);
     }
-sprintf(debug_line_prefix, "DBG(%s%s%.0f%s)%s> %s %s: ", tim_t, tim_a, sim_gtime(), pc_s, AIO_MAIN_THREAD ? "" : "+", dptr->name, debug_type);
-return debug_line_prefix;
+return sim_debug_prefix_fmt (debug_line_prefix, sim_deb_switches, &time_now, &sim_deb_basetime, 
+                             sim_gtime(), pc_s, AIO_MAIN_THREAD, dptr->name, debug_type);
 }
 
-void fprint_fields (FILE *stream, t_value before, t_value after, BITFIELD* bitdefs)
+/* Output formatted debug data expanding newlines where they exist */
+
+static void sim_debug_write (FILE *f, const char *debug_prefix, const char *buf, int32 len, int32 *unterm)
 {
-int32 i, fields, offset;
-uint32 value, beforevalue, mask;
+int32 i, j;
 
-for (fields=offset=0; bitdefs[fields].name; ++fields) {
-    if (bitdefs[fields].offset == 0xffffffff)       /* fixup uninitialized offsets */
-        bitdefs[fields].offset = offset;
-    offset += bitdefs[fields].width;
+for (i = j = 0; i < len; ++i) {
+    if ('\n' == buf[i]) {
+        if (i >= j) {
+            if ((i != j) || (i == 0)) {
+                if (!*unterm)                           /* print prefix when required */
+                    fwrite (debug_prefix, 1, strlen (debug_prefix), f);
+                fwrite (&buf[j], 1, i-j, f);
+                fwrite ("\r\n", 1, 2, f);
+                }
+            *unterm = 0;
+            }
+        j = i + 1;
+        }
     }
-for (i = fields-1; i >= 0; i--) {                   /* print xlation, transition */
-    if (bitdefs[i].name[0] == '\0')
-        continue;
-    if ((bitdefs[i].width == 1) && (bitdefs[i].valuenames == NULL)) {
-        int off = ((after >> bitdefs[i].offset) & 1) + (((before ^ after) >> bitdefs[i].offset) & 1) * 2;
-        fprintf(stream, "%s%c ", bitdefs[i].name, debug_bstates[off]);
+if (i > j) {
+    if (!*unterm)                                       /* print prefix when required */
+        fwrite (debug_prefix, 1, strlen (debug_prefix), f);
+    fwrite (&buf[j], 1, i-j, f);
+    }
+
+/* Set unterminated flag for next time */
+
+*unterm = len ? (((buf[len-1]=='\n')) ? 0 : 1) : *unterm;
+}
+
+/* Binary debug output
+
+   When debug output is enabled with SET DEBUG -B, sim_debug() calls don't
+   format their message text.  Each call instead builds a binary record
+   holding the simulated time (and the time of day and PC when those were
+   requested), the ids of the format string and of the device/debug flag 
+   combination, and the raw argument values.  The record is appended to
+   a ring buffer owned by the calling thread.  A ring has one producer
+   (its thread) and one consumer (whoever holds sim_dbr_drain_lock, 
+   normally the writer thread), so records are passed without locking.
+   The writer thread moves records to the debug file every few 
+   milliseconds, preceded by definitions of any format strings and device 
+   flag names which the file doesn't contain yet.  Output written directly 
+   to sim_deb (fprintf (sim_deb, ...) and friends) is captured as text 
+   records, which preserves the ordering of all debug output.
+
+   DEBUG DECODE renders the binary file as exactly the text which would 
+   have been written without -B.  Decoding needs no simulator state, so
+   any simulator can decode any simulator's binary debug file produced 
+   on a host with the same data type sizes.
+ */
+
+typedef struct DBG_REC {
+    uint32      size;                                   /* record size (multiple of 8) */
+    uint16      type;                                   /* record type */
+    uint16      flags;                                  /* record flags */
+    uint32      id;                                     /* format or definition id */
+    uint32      src;                                    /* source (device & debug flags) id */
+    double      gtime;                                  /* simulated time */
+    } DBG_REC;
+
+#define DBR_PAD         0                               /* ring wrap filler (never written) */
+#define DBR_SESSION     1                               /* start of a debug session */
+#define DBR_FORMAT      2                               /* format string definition */
+#define DBR_SOURCE      3                               /* device name & debug flag name definition */
+#define DBR_MSG         4                               /* sim_debug message with argument values */
+#define DBR_TEXT        5                               /* sim_debug message formatted when recorded */
+#define DBR_RAW         6                               /* text written directly to sim_deb */
+#define DBR_DATA        7                               /* sim_data_trace data */
+
+#define DBR_F_AIO       1                               /* not recorded by the simulation thread */
+#define DBR_F_TOD       2                               /* time of day (2 x t_int64) follows header */
+#define DBR_F_PC        4                               /* PC value (t_uint64) follows header & tod */
+#define DBR_F_UNTERM    8                               /* previous output line was unterminated */
+
+#define DBR_MAGIC       "SIMHDBG"
+#define DBR_VERSION     1
+#define DBR_REC_MAX     (256*1024)                      /* largest record */
+#define DBR_ROUND(n)    (((n) + 7) & ~7)
+
+typedef struct DBG_SESSION {
+    char        magic[8];                               /* DBR_MAGIC */
+    uint32      version;                                /* DBR_VERSION */
+    int32       switches;                               /* SET DEBUG switches */
+    t_int64     base_sec;                               /* -R base time */
+    t_int64     base_nsec;
+    uint32      pc_radix;                               /* -P PC register display */
+    uint32      pc_width;
+    uint32      pc_flags;
+    uint32      value_size;                             /* sizeof (t_value) */
+    char        pc_name[32];
+    char        sim_name[64];
+    } DBG_SESSION;
+
+/* Argument value kinds */
+
+#define DBA_END         0
+#define DBA_STAR        1                               /* * width or precision (int) */
+#define DBA_INT         2                               /* int (and promoted char/short) */
+#define DBA_CHAR        3                               /* %c */
+#define DBA_LONG        4
+#define DBA_LLONG       5
+#define DBA_SIZE        6
+#define DBA_PTRDIFF     7
+#define DBA_DOUBLE      8
+#define DBA_STR         9
+#define DBA_PTR         10
+#define DBA_UNSUPPORTED -1
+
+typedef struct DBG_ARG {
+    int32       kind;
+    int32       prec;                                   /* DBA_STR precision (-1 none, -2 from *) */
+    int32       pre_ch;                                 /* last format character preceding (or -1) */
+    } DBG_ARG;
+
+/* Parse the printf conversion specification at fmt (which points at the %).
+   Returns a pointer past it, the kind of value it consumes (DBA_END for
+   %%), the number of * arguments preceding the value and the string
+   precision. */
+
+static const char *_sim_dbr_spec (const char *fmt, int32 *kind, int32 *stars, int32 *prec)
+{
+const char *p = fmt + 1;
+int lng = 0;                                            /* 1 h, 2 l, 3 ll, 4 L, 5 z, 6 t */
+
+*kind = DBA_END;
+*stars = 0;
+*prec = -1;
+if (*p == '%')
+    return p + 1;
+while (*p && strchr ("-+ #0'", *p))
+    ++p;
+if (*p == '*') {
+    ++*stars;
+    ++p;
+    }
+else
+    while (sim_isdigit (*p))
+        ++p;
+if (*p == '.') {
+    ++p;
+    if (*p == '*') {
+        ++*stars;
+        *prec = -2;
+        ++p;
         }
     else {
-        const char *delta = "";
-
-        mask = 0xFFFFFFFF >> (32-bitdefs[i].width);
-        value = (uint32)((after >> bitdefs[i].offset) & mask);
-        beforevalue = (uint32)((before >> bitdefs[i].offset) & mask);
-        if (value < beforevalue)
-            delta = "_";
-        if (value > beforevalue)
-            delta = "^";
-        if (bitdefs[i].valuenames)
-            fprintf(stream, "%s=%s%s ", bitdefs[i].name, delta, bitdefs[i].valuenames[value]);
-        else
-            if (bitdefs[i].format) {
-                fprintf(stream, "%s=%s", bitdefs[i].name, delta);
-                fprintf(stream, bitdefs[i].format, value);
-                fprintf(stream, " ");
-                }
-            else
-                fprintf(stream, "%s=%s0x%X ", bitdefs[i].name, delta, value);
+        *prec = 0;
+        while (sim_isdigit (*p))
+            *prec = *prec * 10 + (*p++ - '0');
         }
     }
+switch (*p) {
+    case 'h':
+        lng = 1;
+        if (*++p == 'h')
+            ++p;
+        break;
+    case 'l':
+        lng = 2;
+        if (*++p == 'l') {
+            lng = 3;
+            ++p;
+            }
+        break;
+    case 'q':
+        lng = 3;
+        ++p;
+        break;
+    case 'L':
+        lng = 4;
+        ++p;
+        break;
+    case 'z':
+        lng = 5;
+        ++p;
+        break;
+    case 't':
+        lng = 6;
+        ++p;
+        break;
+    case 'I':
+        if ((p[1] == '6') && (p[2] == '4')) {
+            lng = 3;
+            p += 3;
+            }
+        else if ((p[1] == '3') && (p[2] == '2'))
+            p += 3;
+        else {
+            lng = 5;
+            ++p;
+            }
+        break;
+    }
+switch (*p) {
+    case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+        switch (lng) {
+            case 0: case 1:
+                *kind = DBA_INT;
+                break;
+            case 2:
+                *kind = DBA_LONG;
+                break;
+            case 3:
+                *kind = DBA_LLONG;
+                break;
+            case 5:
+                *kind = DBA_SIZE;
+                break;
+            case 6:
+                *kind = DBA_PTRDIFF;
+                break;
+            default:
+                *kind = DBA_UNSUPPORTED;
+                break;
+            }
+        break;
+    case 'c':
+        *kind = (lng == 0) ? DBA_CHAR : DBA_UNSUPPORTED;
+        break;
+    case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+        *kind = ((lng == 0) || (lng == 2)) ? DBA_DOUBLE : DBA_UNSUPPORTED;
+        break;
+    case 's':
+        *kind = (lng == 0) ? DBA_STR : DBA_UNSUPPORTED;
+        break;
+    case 'p':
+        *kind = DBA_PTR;
+        break;
+    default:                                            /* %n, wide chars, etc. */
+        *kind = DBA_UNSUPPORTED;
+        return *p ? p + 1 : p;
+    }
+return p + 1;
 }
 
-/* Prints state of a register: bit translation + state (0,1,_,^)
-   indicating the state and transition of the bit and bitfields. States:
-   0=steady(0->0), 1=steady(1->1), _=falling(1->0), ^=rising(0->1) */
-
-void sim_debug_bits_hdr(uint32 dbits, DEVICE* dptr, const char *header, 
-    BITFIELD* bitdefs, uint32 before, uint32 after, int terminate)
+static t_bool _sim_dbr_read (FILE *f, DBG_REC *hdr, uint8 **buf, size_t *bufsize)
 {
-if (sim_deb && dptr && (dptr->dctrl & dbits)) {
-    TMLN *saved_oline = sim_oline;
+size_t len;
 
-    sim_oline = NULL;                                                   /* avoid potential debug to active socket */
-    if (!debug_unterm)
-        fprintf(sim_deb, "%s", sim_debug_prefix(dbits, dptr));          /* print prefix if required */
+if (1 != fread (hdr, sizeof (*hdr), 1, f))
+    return FALSE;
+if ((hdr->size < sizeof (*hdr)) || (hdr->size > DBR_REC_MAX) || (hdr->size & 7))
+    return FALSE;
+len = hdr->size - sizeof (*hdr);
+if (len + 1 > *bufsize) {
+    *bufsize = len + 1;
+    *buf = (uint8 *)realloc (*buf, *bufsize);
+    if (*buf == NULL)
+        return FALSE;
+    }
+if ((len > 0) && (1 != fread (*buf, len, 1, f)))
+    return FALSE;
+(*buf)[len] = 0;
+return TRUE;
+}
+
+static void _sim_dbr_cat (char **buf, size_t *size, size_t *len, const char *s, size_t n)
+{
+if (*len + n + 1 > *size) {
+    *size = 2 * (*len + n + 1);
+    *buf = (char *)realloc (*buf, *size);
+    }
+memcpy (*buf + *len, s, n);
+*len += n;
+(*buf)[*len] = '\0';
+}
+
+/* Render a recorded message */
+
+static t_bool _sim_dbr_render (const char *fmt, const uint8 *args, const uint8 *end, char **buf, size_t *size, size_t *len)
+{
+const char *start, *p = fmt;
+int32 kind, stars, prec;
+
+*len = 0;
+_sim_dbr_cat (buf, size, len, "", 0);
+while (*p) {
+    char spec[64], tmp[512];
+    char *out = tmp;
+    int32 star_val[2], i, sidx, n;
+    t_int64 ival;
+    double dval;
+
+    for (start = p; *p && (*p != '%'); ++p)
+        ;
+    _sim_dbr_cat (buf, size, len, start, p - start);
+    if (*p == '\0')
+        break;
+    start = p;
+    p = _sim_dbr_spec (p, &kind, &stars, &prec);
+    if (kind == DBA_END) {
+        _sim_dbr_cat (buf, size, len, "%", 1);
+        continue;
+        }
+    if ((kind == DBA_UNSUPPORTED) || ((size_t)(p - start) > 20))
+        return FALSE;
+    for (i = 0; i < stars; i++) {
+        if (args + 8 > end)
+            return FALSE;
+        memcpy (&ival, args, 8);
+        star_val[i] = (int32)ival;
+        args += 8;
+        }
+    for (i = sidx = n = 0; start + i < p; i++) {        /* build spec substituting * values */
+        if (start[i] == '*') {
+            int32 v = star_val[sidx++];
+
+            if ((start[i-1] == '.') && (v < 0))         /* negative precision is no precision */
+                --n;
+            else
+                n += sprintf (&spec[n], "%d", (int)v);
+            }
+        else
+            spec[n++] = start[i];
+        }
+    spec[n] = '\0';
+    if (kind == DBA_STR) {
+        uint32 slen;
+
+        if (args + 4 > end)
+            return FALSE;
+        memcpy (&slen, args, 4);
+        if (slen == 0xFFFFFFFF) {
+            n = snprintf (tmp, sizeof (tmp), spec, (char *)NULL);
+            args += 8;
+            }
+        else {
+            if (args + 4 + slen + 1 > end)
+                return FALSE;
+            n = snprintf (NULL, 0, spec, (const char *)(args + 4));
+            if (n >= (int32)sizeof (tmp))
+                out = (char *)malloc (n + 1);
+            n = snprintf (out, n + 1, spec, (const char *)(args + 4));
+            args += DBR_ROUND (4 + slen + 1);
+            }
+        }
+    else {
+        if (args + 8 > end)
+            return FALSE;
+        memcpy (&ival, args, 8);
+        memcpy (&dval, args, 8);
+        args += 8;
+        switch (kind) {
+            case DBA_INT:
+            case DBA_CHAR:
+                n = snprintf (NULL, 0, spec, (int)ival);
+                break;
+            case DBA_LONG:
+                n = snprintf (NULL, 0, spec, (long)ival);
+                break;
+            case DBA_LLONG:
+                n = snprintf (NULL, 0, spec, (LL_TYPE)ival);
+                break;
+            case DBA_SIZE:
+                n = snprintf (NULL, 0, spec, (size_t)ival);
+                break;
+            case DBA_PTRDIFF:
+                n = snprintf (NULL, 0, spec, (ptrdiff_t)ival);
+                break;
+            case DBA_DOUBLE:
+                n = snprintf (NULL, 0, spec, dval);
+                break;
+            case DBA_PTR:
+                n = snprintf (NULL, 0, spec, (void *)(size_t)ival);
+                break;
+            }
+        if (n >= (int32)sizeof (tmp))
+            out = (char *)malloc (n + 1);
+        switch (kind) {
+            case DBA_INT:
+            case DBA_CHAR:
+                n = snprintf (out, n + 1, spec, (int)ival);
+                break;
+            case DBA_LONG:
+                n = snprintf (out, n + 1, spec, (long)ival);
+                break;
+            case DBA_LLONG:
+                n = snprintf (out, n + 1, spec, (LL_TYPE)ival);
+                break;
+            case DBA_SIZE:
+                n = snprintf (out, n + 1, spec, (size_t)ival);
+                break;
+            case DBA_PTRDIFF:
+                n = snprintf (out, n + 1, spec, (ptrdiff_t)ival);
+                break;
+            case DBA_DOUBLE:
+                n = snprintf (out, n + 1, spec, dval);
+                break;
+            case DBA_PTR:
+                n = snprintf (out, n + 1, spec, (void *)(size_t)ival);
+                break;
+            }
+        }
+    if (n > 0)
+        _sim_dbr_cat (buf, size, len, out, (size_t)n);
+    if (out != tmp)
+        free (out);
+    }
+return TRUE;
+}
+
+static void _sim_data_dump (const uint8 *data, size_t len, int32 switches, void (*line)(void *ctx, const char *text), void *ctx);
+
+typedef struct DBG_DECODE {
+    FILE        *st;
+    const char  *prefix;
+    int32       unterm;
+    } DBG_DECODE;
+
+static void _sim_dbr_decode_line (void *ctx, const char *text)
+{
+DBG_DECODE *dc = (DBG_DECODE *)ctx;
+
+sim_debug_write (dc->st, dc->prefix, text, (int32)strlen (text), &dc->unterm);
+}
+
+/* Decode a binary debug file */
+
+t_stat sim_debug_decode (FILE *st, const char *filename)
+{
+FILE *f = sim_fopen (filename, "rb");
+DBG_REC hdr;
+DBG_SESSION ses;
+DBG_DECODE dc;
+uint8 *rbuf = NULL;
+size_t rbufsize = 0;
+char **fmts = NULL, **srcs = NULL;
+uint32 nfmts = 0, nsrcs = 0, i;
+char *text = NULL;
+size_t textsize = 0, textlen;
+char prefix[256];
+t_bool raw_seen = FALSE;
+t_stat r = SCPE_OK;
+
+if (f == NULL)
+    return sim_messagef (SCPE_OPENERR, "Can't open binary debug file: %s\n", filename);
+memset (&ses, 0, sizeof (ses));
+memset (&dc, 0, sizeof (dc));
+dc.st = st;
+dc.prefix = prefix;
+while (_sim_dbr_read (f, &hdr, &rbuf, &rbufsize)) {
+    uint8 *p = rbuf;
+    uint8 *end = rbuf + hdr.size - sizeof (hdr);
+    struct timespec tod, base;
+    char pc_s[64] = "";
+
+    if ((hdr.type != DBR_SESSION) && (ses.version == 0)) {
+        r = sim_messagef (SCPE_FMT, "%s is not a binary debug file\n", filename);
+        break;
+        }
+    memset (&tod, 0, sizeof (tod));
+    if (hdr.flags & DBR_F_TOD) {
+        t_int64 t[2];
+
+        memcpy (t, p, sizeof (t));
+        tod.tv_sec = (time_t)t[0];
+        tod.tv_nsec = (long)t[1];
+        p += sizeof (t);
+        }
+    if (hdr.flags & DBR_F_PC) {
+        t_uint64 pc;
+
+        memcpy (&pc, p, sizeof (pc));
+        sprintf (pc_s, "-%s:", ses.pc_name);
+        sprint_val (&pc_s[strlen (pc_s)], (t_value)pc, ses.pc_radix, ses.pc_width, ses.pc_flags);
+        p += sizeof (pc);
+        }
+    switch (hdr.type) {
+        case DBR_SESSION:
+            memcpy (&ses, p, ((size_t)(end - p) < sizeof (ses)) ? (size_t)(end - p) : sizeof (ses));
+            ses.pc_name[sizeof (ses.pc_name) - 1] = '\0';
+            ses.sim_name[sizeof (ses.sim_name) - 1] = '\0';
+            if (memcmp (ses.magic, DBR_MAGIC, sizeof (DBR_MAGIC)) || (ses.version != DBR_VERSION) || 
+                (ses.value_size != sizeof (t_value))) {
+                r = sim_messagef (SCPE_FMT, "%s is not a compatible binary debug file\n", filename);
+                ses.version = 0;
+                goto Done;
+                }
+            for (i = 0; i < nfmts; i++)
+                free (fmts[i]);
+            for (i = 0; i < nsrcs; i++)
+                free (srcs[i]);
+            nfmts = nsrcs = 0;
+            dc.unterm = 0;
+            raw_seen = FALSE;
+            break;
+        case DBR_FORMAT:
+        case DBR_SOURCE:
+            if (hdr.type == DBR_FORMAT) {
+                if (hdr.id >= nfmts) {
+                    fmts = (char **)realloc (fmts, (hdr.id + 1) * sizeof (*fmts));
+                    while (nfmts <= hdr.id)
+                        fmts[nfmts++] = NULL;
+                    }
+                free (fmts[hdr.id]);
+                fmts[hdr.id] = (char *)malloc (end - p + 1);
+                memcpy (fmts[hdr.id], p, end - p + 1);  /* buffer has an extra NUL */
+                }
+            else {
+                if (hdr.id >= nsrcs) {
+                    srcs = (char **)realloc (srcs, (hdr.id + 1) * sizeof (*srcs));
+                    while (nsrcs <= hdr.id)
+                        srcs[nsrcs++] = NULL;
+                    }
+                free (srcs[hdr.id]);
+                srcs[hdr.id] = (char *)malloc (end - p + 1);
+                memcpy (srcs[hdr.id], p, end - p + 1);  /* device name NUL debug flag name */
+                }
+            break;
+        case DBR_RAW:
+            if (p + 4 <= end) {
+                uint32 len;
+
+                memcpy (&len, p, 4);
+                if (p + 4 + len <= end)
+                    fwrite (p + 4, 1, len, st);
+                }
+            raw_seen = TRUE;
+            break;
+        case DBR_MSG:
+        case DBR_TEXT:
+        case DBR_DATA:
+            if ((hdr.src >= nsrcs) || (srcs[hdr.src] == NULL) ||
+                ((hdr.type == DBR_MSG) && ((hdr.id >= nfmts) || (fmts[hdr.id] == NULL)))) {
+                r = sim_messagef (SCPE_FMT, "Undefined format or source in binary debug file: %s\n", filename);
+                goto Done;
+                }
+            base.tv_sec = (time_t)ses.base_sec;
+            base.tv_nsec = (long)ses.base_nsec;
+            sim_debug_prefix_fmt (prefix, ses.switches, &tod, &base, hdr.gtime, pc_s, !(hdr.flags & DBR_F_AIO), 
+                                  srcs[hdr.src], srcs[hdr.src] + strlen (srcs[hdr.src]) + 1);
+            if (raw_seen)                               /* direct output doesn't maintain the line state */
+                dc.unterm = (hdr.flags & DBR_F_UNTERM) ? 1 : 0;
+            raw_seen = FALSE;
+            if (hdr.type == DBR_MSG) {
+                if (!_sim_dbr_render (fmts[hdr.id], p, end, &text, &textsize, &textlen)) {
+                    r = sim_messagef (SCPE_FMT, "Invalid message record in binary debug file: %s\n", filename);
+                    goto Done;
+                    }
+                sim_debug_write (st, prefix, text, (int32)textlen, &dc.unterm);
+                }
+            else {
+                uint32 len = 0;
+
+                if (p + 4 <= end)
+                    memcpy (&len, p, 4);
+                if (p + 4 + len > end)
+                    len = 0;
+                if (hdr.type == DBR_TEXT)
+                    sim_debug_write (st, prefix, (const char *)(p + 4), (int32)len, &dc.unterm);
+                else
+                    _sim_data_dump (p + 4, len, ses.switches, &_sim_dbr_decode_line, &dc);
+                }
+            break;
+        default:                                        /* ignore unknown records */
+            break;
+        }
+    }
+Done:
+for (i = 0; i < nfmts; i++)
+    free (fmts[i]);
+for (i = 0; i < nsrcs; i++)
+    free (srcs[i]);
+free (fmts);
+free (srcs);
+free (text);
+free (rbuf);
+fclose (f);
+return r;
+}
+
+#if defined (SIM_ASYNCH_IO) && defined (__GNUC__) && \
+    ((defined (__GLIBC__) && defined (_GNU_SOURCE)) || defined (__APPLE__) || \
+     defined (__FreeBSD__) || defined (__NetBSD__) || defined (__OpenBSD__))
+#define SIM_DEBUG_BINARY 1
+
+#define DBR_RING_SIZE   (4*1024*1024)                   /* per thread ring size (power of 2) */
+#define DBR_HASH_SIZE   8192                            /* registry hash table size (power of 2) */
+#define DBR_MAX_IDS     4096                            /* maximum formats and sources */
+#define DBR_LOAD(p)     __atomic_load_n ((p), __ATOMIC_ACQUIRE)
+#define DBR_STORE(p, v) __atomic_store_n ((p), (v), __ATOMIC_RELEASE)
+
+typedef struct DBG_FMT {
+    char        *text;                                  /* copy of the format string */
+    DBG_ARG     *args;                                  /* arguments (NULL if unsupported) */
+    int32       end_ch;                                 /* last format character after the arguments (or -1) */
+    } DBG_FMT;
+
+typedef struct DBG_KEY {
+    const void  *key;                                   /* registered format text or DEVICE */
+    uint32      dbits;                                  /* debug bits (sources) or text hash (formats) */
+    uint32      id;
+    } DBG_KEY;
+
+typedef struct DBG_RING {
+    uint8       *buf;                                   /* ring data */
+    uint32      size;                                   /* ring size */
+    uint32      head;                                   /* producer offset */
+    uint32      tail;                                   /* consumer offset */
+    uint8       *scratch;                               /* record assembly area */
+    struct DBG_RING *next;                              /* next ring */
+    } DBG_RING;
+
+static t_bool sim_deb_binary = FALSE;                   /* binary debug session active */
+static FILE *sim_dbr_file = NULL;                       /* binary debug file */
+static FILE *sim_dbr_cookie = NULL;                     /* sim_deb stream which produces DBR_RAW records */
+static DBG_RING *sim_dbr_rings = NULL;                  /* all thread rings */
+static pthread_key_t sim_dbr_ring_key;
+static pthread_once_t sim_dbr_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t sim_dbr_reg_lock = PTHREAD_MUTEX_INITIALIZER;   /* registry & ring list */
+static pthread_mutex_t sim_dbr_drain_lock = PTHREAD_MUTEX_INITIALIZER; /* ring consumer */
+static pthread_mutex_t sim_dbr_wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sim_dbr_wake = PTHREAD_COND_INITIALIZER;
+static pthread_t sim_dbr_writer_thread;
+static t_bool sim_dbr_stop = FALSE;
+static DBG_KEY sim_dbr_fmt_hash[DBR_HASH_SIZE];
+static DBG_KEY sim_dbr_src_hash[DBR_HASH_SIZE];
+static DBG_FMT sim_dbr_fmts[DBR_MAX_IDS];
+static char *sim_dbr_srcs[DBR_MAX_IDS];                 /* device name NUL debug flag name NUL */
+static size_t sim_dbr_src_len[DBR_MAX_IDS];
+static uint32 sim_dbr_fmt_count = 0;                    /* formats defined */
+static uint32 sim_dbr_src_count = 0;                    /* sources defined */
+static uint32 sim_dbr_fmt_written = 0;                  /* formats written to the current file */
+static uint32 sim_dbr_src_written = 0;                  /* sources written to the current file */
+static uint32 sim_dbr_stalls = 0;                       /* times a full ring was drained by its producer */
+
+static void _sim_dbr_drain (void);
+
+/* A thread is exiting: write out what its ring still holds and release it */
+
+static void _sim_dbr_ring_free (void *arg)
+{
+DBG_RING *r = (DBG_RING *)arg;
+DBG_RING **rp;
+
+_sim_dbr_drain ();
+pthread_mutex_lock (&sim_dbr_drain_lock);               /* no drain is walking the list */
+pthread_mutex_lock (&sim_dbr_reg_lock);
+for (rp = &sim_dbr_rings; *rp; rp = &(*rp)->next)
+    if (*rp == r) {
+        DBR_STORE (rp, r->next);
+        break;
+        }
+pthread_mutex_unlock (&sim_dbr_reg_lock);
+pthread_mutex_unlock (&sim_dbr_drain_lock);
+free (r->buf);
+free (r->scratch);
+free (r);
+}
+
+static void _sim_dbr_key_create (void)
+{
+pthread_key_create (&sim_dbr_ring_key, &_sim_dbr_ring_free);
+}
+
+/* Get the calling thread's ring */
+
+static DBG_RING *_sim_dbr_ring (void)
+{
+DBG_RING *r;
+
+pthread_once (&sim_dbr_once, &_sim_dbr_key_create);
+r = (DBG_RING *)pthread_getspecific (sim_dbr_ring_key);
+if (r)
+    return r;
+r = (DBG_RING *)calloc (1, sizeof (*r));
+if (r == NULL)
+    return NULL;
+r->size = DBR_RING_SIZE;
+r->buf = (uint8 *)malloc (r->size);
+r->scratch = (uint8 *)malloc (DBR_REC_MAX);
+if ((r->buf == NULL) || (r->scratch == NULL)) {
+    free (r->buf);
+    free (r->scratch);
+    free (r);
+    return NULL;
+    }
+pthread_mutex_lock (&sim_dbr_reg_lock);
+r->next = sim_dbr_rings;
+DBR_STORE (&sim_dbr_rings, r);
+pthread_mutex_unlock (&sim_dbr_reg_lock);
+pthread_setspecific (sim_dbr_ring_key, r);
+return r;
+}
+
+static void _sim_dbr_define (uint16 type, uint32 id, const char *text, size_t len)
+{
+size_t size = DBR_ROUND (sizeof (DBG_REC) + len + 1);
+DBG_REC *rec = (DBG_REC *)calloc (1, size);
+
+if (rec == NULL)
+    return;
+rec->size = (uint32)size;
+rec->type = type;
+rec->id = id;
+memcpy (rec + 1, text, len);
+fwrite (rec, 1, size, sim_dbr_file);
+free (rec);
+}
+
+/* Move all recorded data to the debug file (or discard it when no file is open) */
+
+static void _sim_dbr_drain (void)
+{
+DBG_RING *r;
+t_bool wrote = FALSE;
+
+pthread_mutex_lock (&sim_dbr_drain_lock);
+for (r = DBR_LOAD (&sim_dbr_rings); r; r = r->next) {
+    uint32 head = DBR_LOAD (&r->head);
+    uint32 tail = r->tail;
+    uint32 count;
+
+    if (head == tail)
+        continue;
+    if (sim_dbr_file) {
+        /* Definitions are published before the records which use them, 
+           so everything this ring refers to has been registered by now */
+        for (count = DBR_LOAD (&sim_dbr_fmt_count); sim_dbr_fmt_written < count; ++sim_dbr_fmt_written)
+            _sim_dbr_define (DBR_FORMAT, sim_dbr_fmt_written, sim_dbr_fmts[sim_dbr_fmt_written].text, 
+                             strlen (sim_dbr_fmts[sim_dbr_fmt_written].text));
+        for (count = DBR_LOAD (&sim_dbr_src_count); sim_dbr_src_written < count; ++sim_dbr_src_written)
+            _sim_dbr_define (DBR_SOURCE, sim_dbr_src_written, sim_dbr_srcs[sim_dbr_src_written], 
+                             sim_dbr_src_len[sim_dbr_src_written]);
+        }
+    while (tail != head) {
+        DBG_REC *rec = (DBG_REC *)&r->buf[tail & (r->size - 1)];
+
+        if ((rec->type != DBR_PAD) && sim_dbr_file)
+            fwrite (rec, 1, rec->size, sim_dbr_file);
+        tail += rec->size;
+        }
+    DBR_STORE (&r->tail, tail);
+    wrote = TRUE;
+    }
+if (wrote && sim_dbr_file)
+    fflush (sim_dbr_file);
+pthread_mutex_unlock (&sim_dbr_drain_lock);
+}
+
+static void *_sim_dbr_writer (void *arg)
+{
+pthread_mutex_lock (&sim_dbr_wake_lock);
+while (!sim_dbr_stop) {
+    struct timespec due;
+
+    clock_gettime (CLOCK_REALTIME, &due);
+    due.tv_nsec += 10000000;                            /* 10ms */
+    if (due.tv_nsec >= 1000000000) {
+        due.tv_nsec -= 1000000000;
+        ++due.tv_sec;
+        }
+    pthread_cond_timedwait (&sim_dbr_wake, &sim_dbr_wake_lock, &due);
+    pthread_mutex_unlock (&sim_dbr_wake_lock);
+    _sim_dbr_drain ();
+    pthread_mutex_lock (&sim_dbr_wake_lock);
+    }
+pthread_mutex_unlock (&sim_dbr_wake_lock);
+return NULL;
+}
+
+/* Append a completed record to a ring */
+
+static void _sim_dbr_put (DBG_RING *r, DBG_REC *rec)
+{
+uint32 n = rec->size;
+uint32 pos = r->head;
+uint32 idx = pos & (r->size - 1);
+uint32 room = r->size - idx;
+uint32 need = (n > room) ? n + room : n;
+
+if ((r->size - (pos - DBR_LOAD (&r->tail))) < need) {  /* ring full? */
+    __atomic_add_fetch (&sim_dbr_stalls, 1, __ATOMIC_RELAXED);
+    while ((r->size - (pos - DBR_LOAD (&r->tail))) < need)
+        _sim_dbr_drain ();                              /* empty it ourselves */
+    }
+if (n > room) {                                         /* doesn't fit before the wrap? */
+    DBG_REC *pad = (DBG_REC *)&r->buf[idx];
+
+    pad->size = room;
+    pad->type = DBR_PAD;
+    pos += room;
+    idx = 0;
+    }
+memcpy (&r->buf[idx], rec, n);
+DBR_STORE (&r->head, pos + n);
+if ((pos + n - DBR_LOAD (&r->tail)) > (r->size / 2))    /* more than half full? */
+    pthread_cond_signal (&sim_dbr_wake);                /* hurry the writer */
+}
+
+/* Start building a record in the ring's scratch area */
+
+static DBG_REC *_sim_dbr_begin (DBG_RING *r, uint16 type, uint32 id, uint32 src, uint8 **payload)
+{
+DBG_REC *rec = (DBG_REC *)r->scratch;
+uint8 *p = (uint8 *)(rec + 1);
+
+rec->type = type;
+rec->flags = (AIO_MAIN_THREAD ? 0 : DBR_F_AIO) | (debug_unterm ? DBR_F_UNTERM : 0);
+rec->id = id;
+rec->src = src;
+rec->gtime = sim_gtime ();
+if ((type != DBR_RAW) && (sim_deb_switches & (SWMASK ('T') | SWMASK ('R') | SWMASK ('A')))) {
+    struct timespec now;
+    t_int64 t[2];
+
+    clock_gettime (CLOCK_REALTIME, &now);
+    t[0] = (t_int64)now.tv_sec;
+    t[1] = (t_int64)now.tv_nsec;
+    memcpy (p, t, sizeof (t));
+    p += sizeof (t);
+    rec->flags |= DBR_F_TOD;
+    }
+if ((type != DBR_RAW) && (sim_deb_switches & SWMASK ('P'))) {
+    t_uint64 pc = (t_uint64)sim_debug_pc ();
+
+    memcpy (p, &pc, sizeof (pc));
+    p += sizeof (pc);
+    rec->flags |= DBR_F_PC;
+    }
+*payload = p;
+return rec;
+}
+
+static void _sim_dbr_end (DBG_RING *r, DBG_REC *rec, uint8 *p)
+{
+size_t size = p - (uint8 *)rec;
+
+memset (p, 0, DBR_ROUND (size) - size);
+rec->size = (uint32)DBR_ROUND (size);
+_sim_dbr_put (r, rec);
+}
+
+static uint32 _sim_dbr_hash (const void *key, uint32 dbits)
+{
+return (uint32)((((size_t)key >> 3) ^ dbits) * 2654435761u) & (DBR_HASH_SIZE - 1);
+}
+
+/* Register a format string, building its argument list */
+
+static void _sim_dbr_parse (DBG_FMT *df)
+{
+const char *p = df->text;
+int32 nargs = 0, kind, stars, prec;
+DBG_ARG args[64];
+
+df->args = NULL;
+df->end_ch = -1;
+while (*p) {
+    if (*p++ != '%') {
+        df->end_ch = (uint8)p[-1];
+        continue;
+        }
+    p = _sim_dbr_spec (p - 1, &kind, &stars, &prec);
+    if (kind == DBA_END) {
+        df->end_ch = '%';
+        continue;
+        }
+    if ((kind == DBA_UNSUPPORTED) || (nargs + stars + 1 >= (int32)(sizeof (args) / sizeof (args[0]))))
+        return;
+    while (stars-- > 0) {
+        args[nargs].kind = DBA_STAR;
+        args[nargs].prec = -1;
+        args[nargs++].pre_ch = -1;
+        }
+    args[nargs].kind = kind;
+    args[nargs].prec = prec;
+    args[nargs++].pre_ch = df->end_ch;
+    df->end_ch = -1;
+    }
+df->args = (DBG_ARG *)malloc ((nargs + 1) * sizeof (*df->args));
+if (df->args == NULL)
+    return;
+memcpy (df->args, args, nargs * sizeof (*df->args));
+df->args[nargs].kind = DBA_END;
+}
+
+/* Formats are registered by their text rather than by their address, so
+   a format built in a buffer (and a buffer reused for different formats)
+   gets the id of whatever text it holds when the message is recorded */
+
+static int32 _sim_dbr_fmt_id (const char *fmt)
+{
+uint32 hash = 2166136261u;                              /* FNV-1a */
+uint32 h;
+const char *p;
+int32 id = -1;
+
+for (p = fmt; *p; ++p)
+    hash = (hash ^ (uint8)*p) * 16777619u;
+h = hash & (DBR_HASH_SIZE - 1);
+while (1) {                                             /* lock free lookup */
+    const char *key = (const char *)DBR_LOAD (&sim_dbr_fmt_hash[h].key);
+
+    if (key == NULL)
+        break;
+    if ((sim_dbr_fmt_hash[h].dbits == hash) && (0 == strcmp (key, fmt)))
+        return (int32)sim_dbr_fmt_hash[h].id;
+    h = (h + 1) & (DBR_HASH_SIZE - 1);
+    }
+pthread_mutex_lock (&sim_dbr_reg_lock);
+while ((sim_dbr_fmt_hash[h].key != NULL) && 
+       ((sim_dbr_fmt_hash[h].dbits != hash) || strcmp ((const char *)sim_dbr_fmt_hash[h].key, fmt)))
+    h = (h + 1) & (DBR_HASH_SIZE - 1);
+if (sim_dbr_fmt_hash[h].key != NULL)                    /* registered by another thread meanwhile */
+    id = (int32)sim_dbr_fmt_hash[h].id;
+else {
+    if ((sim_dbr_fmt_count < DBR_MAX_IDS) &&
+        (NULL != (sim_dbr_fmts[sim_dbr_fmt_count].text = (char *)malloc (strlen (fmt) + 1)))) {
+        id = (int32)sim_dbr_fmt_count;
+        strcpy (sim_dbr_fmts[id].text, fmt);
+        _sim_dbr_parse (&sim_dbr_fmts[id]);
+        sim_dbr_fmt_hash[h].dbits = hash;
+        sim_dbr_fmt_hash[h].id = (uint32)id;
+        DBR_STORE (&sim_dbr_fmt_hash[h].key, (const void *)sim_dbr_fmts[id].text);
+        DBR_STORE (&sim_dbr_fmt_count, sim_dbr_fmt_count + 1);
+        }
+    }
+pthread_mutex_unlock (&sim_dbr_reg_lock);
+return id;
+}
+
+static int32 _sim_dbr_src_id (uint32 dbits, DEVICE *dptr)
+{
+uint32 h;
+int32 id = -1;
+
+dbits &= dptr->dctrl;                                   /* the debug flag name depends on these */
+h = _sim_dbr_hash (dptr, dbits);
+while (1) {                                             /* lock free lookup */
+    const void *key = DBR_LOAD (&sim_dbr_src_hash[h].key);
+
+    if (key == NULL)
+        break;
+    if ((key == dptr) && (sim_dbr_src_hash[h].dbits == dbits))
+        return (int32)sim_dbr_src_hash[h].id;
+    h = (h + 1) & (DBR_HASH_SIZE - 1);
+    }
+pthread_mutex_lock (&sim_dbr_reg_lock);
+while ((sim_dbr_src_hash[h].key != NULL) && 
+       ((sim_dbr_src_hash[h].key != dptr) || (sim_dbr_src_hash[h].dbits != dbits)))
+    h = (h + 1) & (DBR_HASH_SIZE - 1);
+if (sim_dbr_src_hash[h].key != NULL)                    /* registered by another thread meanwhile */
+    id = (int32)sim_dbr_src_hash[h].id;
+else {
+    const char *verb = get_dbg_verb (dbits, dptr);
+    size_t len = strlen (dptr->name) + 1 + strlen (verb) + 1;
+
+    if ((sim_dbr_src_count < DBR_MAX_IDS) &&
+        (NULL != (sim_dbr_srcs[sim_dbr_src_count] = (char *)malloc (len)))) {
+        id = (int32)sim_dbr_src_count;
+        strcpy (sim_dbr_srcs[id], dptr->name);
+        strcpy (sim_dbr_srcs[id] + strlen (dptr->name) + 1, verb);
+        sim_dbr_src_len[id] = len;
+        sim_dbr_src_hash[h].dbits = dbits;
+        sim_dbr_src_hash[h].id = (uint32)id;
+        DBR_STORE (&sim_dbr_src_hash[h].key, (const void *)dptr);
+        DBR_STORE (&sim_dbr_src_count, sim_dbr_src_count + 1);
+        }
+    }
+pthread_mutex_unlock (&sim_dbr_reg_lock);
+return id;
+}
+
+/* Record a sim_debug message.  Returns FALSE if the message must be formatted as text */
+
+static t_bool _sim_debug_record (uint32 dbits, DEVICE *dptr, const char *fmt, va_list arglist)
+{
+DBG_RING *r = _sim_dbr_ring ();
+int32 fid, sid;
+DBG_REC *rec;
+DBG_FMT *df;
+uint8 *p, *start, *end;
+int last_ch = -1;
+int32 len, last_star = -1;
+
+if (r == NULL)
+    return FALSE;
+sid = _sim_dbr_src_id (dbits, dptr);
+if (sid < 0)
+    return FALSE;
+fid = _sim_dbr_fmt_id (fmt);
+rec = _sim_dbr_begin (r, DBR_MSG, (uint32)fid, (uint32)sid, &start);
+p = start;
+end = r->scratch + DBR_REC_MAX;
+df = (fid >= 0) ? &sim_dbr_fmts[fid] : NULL;
+if (df && df->args) {
+    va_list args;
+    const DBG_ARG *a;
+    t_bool fits = TRUE;
+
+    va_copy (args, arglist);
+    for (a = df->args; fits && (a->kind != DBA_END); ++a) {
+        t_int64 ival = 0;
+        double dval;
+
+        if (p + 8 > end) {
+            fits = FALSE;
+            break;
+            }
+        if (a->pre_ch >= 0)                             /* track the output's last character */
+            last_ch = a->pre_ch;
+        switch (a->kind) {
+            case DBA_STAR:
+                ival = last_star = va_arg (args, int);
+                break;
+            case DBA_INT:
+                ival = va_arg (args, int);
+                break;
+            case DBA_CHAR:
+                ival = va_arg (args, int);
+                break;
+            case DBA_LONG:
+                ival = va_arg (args, long);
+                break;
+            case DBA_LLONG:
+                ival = va_arg (args, LL_TYPE);
+                break;
+            case DBA_SIZE:
+                ival = (t_int64)va_arg (args, size_t);
+                break;
+            case DBA_PTRDIFF:
+                ival = va_arg (args, ptrdiff_t);
+                break;
+            case DBA_DOUBLE:
+                dval = va_arg (args, double);
+                memcpy (&ival, &dval, sizeof (ival));
+                break;
+            case DBA_PTR:
+                ival = (t_int64)(size_t)va_arg (args, void *);
+                break;
+            case DBA_STR: {
+                const char *s = va_arg (args, const char *);
+                int32 prec = (a->prec == -2) ? last_star : a->prec;
+                uint32 slen;
+
+                if (s == NULL) {
+                    slen = 0xFFFFFFFF;
+                    memcpy (p, &slen, 4);
+                    memset (p + 4, 0, 4);
+                    p += 8;
+                    last_ch = ')';                      /* (null) */
+                    continue;
+                    }
+                if (prec >= 0) {
+                    const char *e = (const char *)memchr (s, 0, prec);
+
+                    slen = e ? (uint32)(e - s) : (uint32)prec;
+                    }
+                else
+                    slen = (uint32)strlen (s);
+                if ((size_t)(end - p) < DBR_ROUND (4 + slen + 1)) {
+                    fits = FALSE;
+                    break;
+                    }
+                memcpy (p, &slen, 4);
+                memcpy (p + 4, s, slen);
+                memset (p + 4 + slen, 0, DBR_ROUND (4 + slen + 1) - (4 + slen));
+                p += DBR_ROUND (4 + slen + 1);
+                if (slen)
+                    last_ch = (uint8)s[slen - 1];
+                continue;
+                }
+            }
+        memcpy (p, &ival, 8);
+        p += 8;
+        if (a->kind == DBA_CHAR)
+            last_ch = (uint8)ival;
+        else if (a->kind != DBA_STAR)
+            last_ch = ' ';                              /* numbers don't end with newlines */
+        }
+    va_end (args);
+    if (fits) {
+        if (df->end_ch >= 0)
+            last_ch = df->end_ch;
+        if (last_ch >= 0)
+            debug_unterm = (last_ch == '\n') ? 0 : 1;
+        _sim_dbr_end (r, rec, p);
+        return TRUE;
+        }
+    }
+rec->type = DBR_TEXT;                                   /* format the message now */
+p = start;
+len = vsnprintf ((char *)p + 4, end - (p + 4) - 8, fmt, arglist);
+if (len < 0)
+    len = 0;
+if (len > (int32)(end - (p + 4) - 8))
+    len = (int32)(end - (p + 4) - 8);
+memcpy (p, &len, 4);
+if (len)
+    debug_unterm = (p[4 + len - 1] == '\n') ? 0 : 1;
+_sim_dbr_end (r, rec, p + 4 + len);
+return TRUE;
+}
+
+/* Record the data of a sim_data_trace */
+
+static t_bool _sim_debug_record_data (uint32 dbits, DEVICE *dptr, const uint8 *data, size_t len)
+{
+DBG_RING *r = _sim_dbr_ring ();
+int32 sid;
+DBG_REC *rec;
+uint8 *p;
+uint32 dlen = (uint32)len;
+
+if ((r == NULL) || (len > DBR_REC_MAX - 64))
+    return FALSE;
+sid = _sim_dbr_src_id (dbits, dptr);
+if (sid < 0)
+    return FALSE;
+rec = _sim_dbr_begin (r, DBR_DATA, 0, (uint32)sid, &p);
+memcpy (p, &dlen, 4);
+memcpy (p + 4, data, len);
+_sim_dbr_end (r, rec, p + 4 + len);
+debug_unterm = 0;                                       /* dump lines are terminated */
+return TRUE;
+}
+
+/* Capture output written directly to sim_deb */
+
+static void _sim_dbr_raw (const char *buf, size_t size)
+{
+DBG_RING *r = _sim_dbr_ring ();
+
+while (r && size) {
+    uint8 *p;
+    DBG_REC *rec = _sim_dbr_begin (r, DBR_RAW, 0, 0, &p);
+    uint32 len = (size > DBR_REC_MAX/2) ? DBR_REC_MAX/2 : (uint32)size;
+
+    memcpy (p, &len, 4);
+    memcpy (p + 4, buf, len);
+    _sim_dbr_end (r, rec, p + 4 + len);
+    buf += len;
+    size -= len;
+    }
+}
+
+#if defined (__GLIBC__)
+static ssize_t _sim_dbr_cookie_write (void *cookie, const char *buf, size_t size)
+{
+_sim_dbr_raw (buf, size);
+return (ssize_t)size;
+}
+#else
+static int _sim_dbr_cookie_write (void *cookie, const char *buf, int size)
+{
+_sim_dbr_raw (buf, (size_t)size);
+return size;
+}
+#endif
+
+t_stat sim_debug_binary_open (const char *filename)
+{
+char gbuf[CBUFSIZE];
+t_stat r;
+
+get_glyph (filename, gbuf, 0);
+if ((!strcmp (gbuf, "STDOUT")) || (!strcmp (gbuf, "STDERR")) || 
+    (!strcmp (gbuf, "LOG")) || (!strcmp (gbuf, "DEBUG")))
+    return sim_messagef (SCPE_ARG, "Binary debug output must be written to a file\n");
+sim_debug_binary_close ();
+r = sim_open_logfile (filename, TRUE, &sim_dbr_file, &sim_deb_ref);
+if (r != SCPE_OK)
+    return r;
+if (sim_dbr_cookie == NULL) {                           /* first use? */
+#if defined (__GLIBC__)
+    cookie_io_functions_t funcs;
+
+    memset (&funcs, 0, sizeof (funcs));
+    funcs.write = &_sim_dbr_cookie_write;
+    sim_dbr_cookie = fopencookie (NULL, "w", funcs);
+#else
+    sim_dbr_cookie = funopen (NULL, NULL, &_sim_dbr_cookie_write, NULL, NULL);
+#endif
+    if (sim_dbr_cookie == NULL) {
+        sim_close_logfile (&sim_deb_ref);
+        sim_dbr_file = NULL;
+        return SCPE_MEM;
+        }
+    setvbuf (sim_dbr_cookie, NULL, _IONBF, 0);          /* keep ordering with binary records */
+    }
+sim_deb = sim_dbr_cookie;
+return SCPE_OK;
+}
+
+/* Start recording: write the session header and start the writer */
+
+t_stat sim_debug_binary_start (void)
+{
+DBG_REC rec;
+DBG_SESSION ses;
+
+if ((sim_dbr_file == NULL) || sim_deb_binary)
+    return SCPE_OK;
+memset (&rec, 0, sizeof (rec));
+memset (&ses, 0, sizeof (ses));
+rec.size = (uint32)(sizeof (rec) + DBR_ROUND (sizeof (ses)));
+rec.type = DBR_SESSION;
+memcpy (ses.magic, DBR_MAGIC, sizeof (DBR_MAGIC));
+ses.version = DBR_VERSION;
+ses.switches = sim_deb_switches;
+ses.base_sec = (t_int64)sim_deb_basetime.tv_sec;
+ses.base_nsec = (t_int64)sim_deb_basetime.tv_nsec;
+ses.value_size = sizeof (t_value);
+if (sim_PC) {
+    strncpy (ses.pc_name, sim_PC->name, sizeof (ses.pc_name) - 1);
+    ses.pc_radix = sim_PC->radix;
+    ses.pc_width = sim_PC->width;
+    ses.pc_flags = sim_PC->flags & REG_FMT;
+    }
+else
+    sim_deb_switches &= ~SWMASK ('P');
+snprintf (ses.sim_name, sizeof (ses.sim_name), "%s", sim_name);
+pthread_mutex_lock (&sim_dbr_drain_lock);
+fwrite (&rec, 1, sizeof (rec), sim_dbr_file);
+fwrite (&ses, 1, DBR_ROUND (sizeof (ses)), sim_dbr_file);
+sim_dbr_fmt_written = sim_dbr_src_written = 0;          /* new file needs all definitions */
+pthread_mutex_unlock (&sim_dbr_drain_lock);
+sim_dbr_stalls = 0;
+sim_dbr_stop = FALSE;
+if (pthread_create (&sim_dbr_writer_thread, NULL, &_sim_dbr_writer, NULL)) {
+    sim_debug_binary_close ();
+    return SCPE_IERR;
+    }
+sim_deb_binary = TRUE;
+return SCPE_OK;
+}
+
+/* Stop recording and write out everything recorded */
+
+void sim_debug_binary_close (void)
+{
+if (sim_dbr_file == NULL)
+    return;
+if (sim_deb_binary) {
+    sim_deb_binary = FALSE;
+    pthread_mutex_lock (&sim_dbr_wake_lock);
+    sim_dbr_stop = TRUE;
+    pthread_cond_signal (&sim_dbr_wake);
+    pthread_mutex_unlock (&sim_dbr_wake_lock);
+    pthread_join (sim_dbr_writer_thread, NULL);
+    }
+_sim_dbr_drain ();
+pthread_mutex_lock (&sim_dbr_drain_lock);
+sim_dbr_file = NULL;                                    /* caller closes sim_deb_ref */
+pthread_mutex_unlock (&sim_dbr_drain_lock);
+}
+
+t_stat sim_debug_binary_flush (void)
+{
+_sim_dbr_drain ();
+return SCPE_OK;
+}
+
+t_bool sim_debug_is_binary (void)
+{
+return (sim_dbr_file != NULL);
+}
+
+void sim_debug_binary_show (FILE *st)
+{
+uint32 stalls = __atomic_load_n (&sim_dbr_stalls, __ATOMIC_RELAXED);
+
+if (sim_dbr_file == NULL)
+    return;
+fprintf (st, "   Debug messages are recorded in binary form\n");
+if (stalls)
+    fprintf (st, "   Recording waited %u time%s for a full ring buffer to be written (no records were lost)\n", 
+                 stalls, (stalls == 1) ? "" : "s");
+}
+
+#else /* !SIM_DEBUG_BINARY */
+
+t_stat sim_debug_binary_open (const char *filename)
+{
+return sim_messagef (SCPE_NOFNC, "Binary debug output is not available on this host\n");
+}
+
+t_stat sim_debug_binary_start (void)
+{
+return SCPE_OK;
+}
+
+void sim_debug_binary_close (void)
+{
+}
+
+t_stat sim_debug_binary_flush (void)
+{
+return SCPE_OK;
+}
+
+t_bool sim_debug_is_binary (void)
+{
+return FALSE;
+}
+
+void sim_debug_binary_show (FILE *st)
+{
+}
+#endif /* SIM_DEBUG_BINARY */
+
+/* DEBUG DECODE binary_file {output_file} */
+
+static t_stat sim_debug_decode_cmd (CONST char *cptr)
+{
+char fbuf[CBUFSIZE], obuf[CBUFSIZE];
+FILE *st = stdout;
+t_stat r;
+
+cptr = get_glyph_nc (cptr, fbuf, 0);
+cptr = get_glyph_nc (cptr, obuf, 0);
+if (fbuf[0] == '\0')
+    return SCPE_2FARG;
+if (*cptr != '\0')
+    return SCPE_2MARG;
+if (obuf[0] != '\0') {
+    st = sim_fopen (obuf, "wb");
+    if (st == NULL)
+        return sim_messagef (SCPE_OPENERR, "Can't open output file: %s\n", obuf);
+    }
+r = sim_debug_decode (st, fbuf);
+if (st != stdout)
+    fclose (st);
+return r;
+}
+
+void fprint_fields (FILE *stream, t_value before, t_value after, BITFIELD* bitdefs)
+{
+int32 i, fields, offset;
+uint32 value, beforevalue, mask;
+
+for (fields=offset=0; bitdefs[fields].name; ++fields) {
+    if (bitdefs[fields].offset == 0xffffffff)       /* fixup uninitialized offsets */
+        bitdefs[fields].offset = offset;
+    offset += bitdefs[fields].width;
+    }
+for (i = fields-1; i >= 0; i--) {                   /* print xlation, transition */
+    if (bitdefs[i].name[0] == '\0')
+        continue;
+    if ((bitdefs[i].width == 1) && (bitdefs[i].valuenames == NULL)) {
+        int off = ((after >> bitdefs[i].offset) & 1) + (((before ^ after) >> bitdefs[i].offset) & 1) * 2;
+        fprintf(stream, "%s%c ", bitdefs[i].name, debug_bstates[off]);
+        }
+    else {
+        const char *delta = "";
+
+        mask = 0xFFFFFFFF >> (32-bitdefs[i].width);
+        value = (uint32)((after >> bitdefs[i].offset) & mask);
+        beforevalue = (uint32)((before >> bitdefs[i].offset) & mask);
+        if (value < beforevalue)
+            delta = "_";
+        if (value > beforevalue)
+            delta = "^";
+        if (bitdefs[i].valuenames)
+            fprintf(stream, "%s=%s%s ", bitdefs[i].name, delta, bitdefs[i].valuenames[value]);
+        else
+            if (bitdefs[i].format) {
+                fprintf(stream, "%s=%s", bitdefs[i].name, delta);
+                fprintf(stream, bitdefs[i].format, value);
+                fprintf(stream, " ");
+                }
+            else
+                fprintf(stream, "%s=%s0x%X ", bitdefs[i].name, delta, value);
+        }
+    }
+}
+
+/* Prints state of a register: bit translation + state (0,1,_,^)
+   indicating the state and transition of the bit and bitfields. States:
+   0=steady(0->0), 1=steady(1->1), _=falling(1->0), ^=rising(0->1) */
+
+void sim_debug_bits_hdr(uint32 dbits, DEVICE* dptr, const char *header, 
+    BITFIELD* bitdefs, uint32 before, uint32 after, int terminate)
+{
+if (sim_deb && dptr && (dptr->dctrl & dbits)) {
+    TMLN *saved_oline = sim_oline;
+
+    sim_oline = NULL;                                                   /* avoid potential debug to active socket */
+    if (!debug_unterm)
+        fprintf(sim_deb, "%s", sim_debug_prefix(dbits, dptr));          /* print prefix if required */
     if (header)
         fprintf(sim_deb, "%s: ", header);
     fprint_fields (sim_deb, (t_value)before, (t_value)after, bitdefs);  /* print xlation, transition */
@@ -11747,9 +14001,21 @@ if (sim_deb && dptr && (dptr->dctrl & dbits)) {
     int32 bufsize = sizeof(stackbuf);
     char *buf = stackbuf;
     va_list arglist;
-    int32 i, j, len;
-    const char* debug_prefix = sim_debug_prefix(dbits, dptr);   /* prefix to print if required */
+    int32 len;
+    const char* debug_prefix;
+
+#if defined (SIM_DEBUG_BINARY)
+    if (sim_deb_binary) {                               /* recording binary debug records? */
+        t_bool recorded;
 
+        va_start (arglist, fmt);
+        recorded = _sim_debug_record (dbits, dptr, fmt, arglist);
+        va_end (arglist);
+        if (recorded)
+            return;
+        }
+#endif
+    debug_prefix = sim_debug_prefix(dbits, dptr);       /* prefix to print if required */
     sim_oline = NULL;                                   /* avoid potential debug to active socket */
     buf[bufsize-1] = '\0';
 
@@ -11781,29 +14047,7 @@ if (sim_deb && dptr && (dptr->dctrl & dbits)) {
 
 /* Output the formatted data expanding newlines where they exist */
 
-    for (i = j = 0; i < len; ++i) {
-        if ('\n' == buf[i]) {
-            if (i >= j) {
-                if ((i != j) || (i == 0)) {
-                    if (!debug_unterm)                  /* print prefix when required */
-                        fwrite (debug_prefix, 1, strlen (debug_prefix), sim_deb);
-                    fwrite (&buf[j], 1, i-j, sim_deb);
-                    fwrite ("\r\n", 1, 2, sim_deb);
-                    }
-                debug_unterm = 0;
-                }
-            j = i + 1;
-            }
-        }
-    if (i > j) {
-        if (!debug_unterm)                          /* print prefix when required */
-            fwrite (debug_prefix, 1, strlen (debug_prefix), sim_deb);
-        fwrite (&buf[j], 1, i-j, sim_deb);
-        }
-
-/* Set unterminated flag for next time */
-
-    debug_unterm = len ? (((buf[len-1]=='\n')) ? 0 : 1) : debug_unterm;
+    sim_debug_write (sim_deb, debug_prefix, buf, len, &debug_unterm);
     if (buf != stackbuf)
         free (buf);
     sim_oline = saved_oline;                            /* restore original socket */
@@ -11811,105 +14055,135 @@ if (sim_deb && dptr && (dptr->dctrl & dbits)) {
 return;
 }
 
+/* Produce the hex dump lines of a data trace */
+
+static void _sim_data_dump (const uint8 *data, size_t len, int32 switches, void (*line)(void *ctx, const char *text), void *ctx)
+{
+unsigned int i, same, group, sidx, oidx, ridx, eidx, soff;
+char outbuf[80], strbuf[28], rad50buf[36], ebcdicbuf[32], linebuf[200];
+static char hex[] = "0123456789ABCDEF";
+static char rad50[] = " ABCDEFGHIJKLMNOPQRSTUVWXYZ$._0123456789";
+static unsigned char ebcdic2ascii[] = {
+    0000,0001,0002,0003,0234,0011,0206,0177,
+    0227,0215,0216,0013,0014,0015,0016,0017,
+    0020,0021,0022,0023,0235,0205,0010,0207,
+    0030,0031,0222,0217,0034,0035,0036,0037,
+    0200,0201,0202,0203,0204,0012,0027,0033,
+    0210,0211,0212,0213,0214,0005,0006,0007,
+    0220,0221,0026,0223,0224,0225,0226,0004,
+    0230,0231,0232,0233,0024,0025,0236,0032,
+    0040,0240,0241,0242,0243,0244,0245,0246,
+    0247,0250,0133,0056,0074,0050,0053,0041,
+    0046,0251,0252,0253,0254,0255,0256,0257,
+    0260,0261,0135,0044,0052,0051,0073,0136,
+    0055,0057,0262,0263,0264,0265,0266,0267,
+    0270,0271,0174,0054,0045,0137,0076,0077,
+    0272,0273,0274,0275,0276,0277,0300,0301,
+    0302,0140,0072,0043,0100,0047,0075,0042,
+    0303,0141,0142,0143,0144,0145,0146,0147,
+    0150,0151,0304,0305,0306,0307,0310,0311,
+    0312,0152,0153,0154,0155,0156,0157,0160,
+    0161,0162,0313,0314,0315,0316,0317,0320,
+    0321,0176,0163,0164,0165,0166,0167,0170,
+    0171,0172,0322,0323,0324,0325,0326,0327,
+    0330,0331,0332,0333,0334,0335,0336,0337,
+    0340,0341,0342,0343,0344,0345,0346,0347,
+    0173,0101,0102,0103,0104,0105,0106,0107,
+    0110,0111,0350,0351,0352,0353,0354,0355,
+    0175,0112,0113,0114,0115,0116,0117,0120,
+    0121,0122,0356,0357,0360,0361,0362,0363,
+    0134,0237,0123,0124,0125,0126,0127,0130,
+    0131,0132,0364,0365,0366,0367,0370,0371,
+    0060,0061,0062,0063,0064,0065,0066,0067,
+    0070,0071,0372,0373,0374,0375,0376,0377,
+    };
+
+for (i=same=0; i<len; i += 16) {
+    if ((i > 0) && ((len - i) >= 16) && (0 == memcmp (&data[i], &data[i-16], 16))) {
+        ++same;
+        continue;
+        }
+    if (same > 0) {
+        sprintf (linebuf, "%04X thru %04X same as above\n", (unsigned int)(i-(16*same)), (unsigned int)(i-1));
+        line (ctx, linebuf);
+        same = 0;
+        }
+    group = (((len - i) > 16) ? 16 : (len - i));
+    strcpy (ebcdicbuf, (switches & SWMASK ('E')) ? " EBCDIC:" : "");
+    eidx = strlen(ebcdicbuf);
+    strcpy (rad50buf, (switches & SWMASK ('D')) ? " RAD50:" : "");
+    ridx = strlen(rad50buf);
+    strcpy (strbuf, (switches & (SWMASK ('E') | SWMASK ('D'))) ? "ASCII:" : "");
+    soff = strlen(strbuf);
+    for (sidx=oidx=0; sidx<group; ++sidx) {
+        outbuf[oidx++] = ' ';
+        outbuf[oidx++] = hex[(data[i+sidx]>>4)&0xf];
+        outbuf[oidx++] = hex[data[i+sidx]&0xf];
+        if (sim_isprint (data[i+sidx]))
+            strbuf[soff+sidx] = data[i+sidx];
+        else
+            strbuf[soff+sidx] = '.';
+        if (ridx && ((sidx&1) == 0)) {
+            uint16 word = data[i+sidx] + (((i+sidx+1) < len) ? (((uint16)data[i+sidx+1]) << 8) : 0);
+
+            if (word >= 64000) {
+                rad50buf[ridx++] = '|'; /* Invalid RAD-50 character */
+                rad50buf[ridx++] = '|'; /* Invalid RAD-50 character */
+                rad50buf[ridx++] = '|'; /* Invalid RAD-50 character */
+                }
+            else {
+                rad50buf[ridx++] = rad50[word/1600];
+                rad50buf[ridx++] = rad50[(word/40)%40];
+                rad50buf[ridx++] = rad50[word%40];
+                }
+            }
+        if (eidx) {
+            if (sim_isprint (ebcdic2ascii[data[i+sidx]]))
+                ebcdicbuf[eidx++] = ebcdic2ascii[data[i+sidx]];
+            else
+                ebcdicbuf[eidx++] = '.';
+            }
+        }
+    outbuf[oidx] = '\0';
+    strbuf[soff+sidx] = '\0';
+    ebcdicbuf[eidx] = '\0';
+    rad50buf[ridx] = '\0';
+    sprintf (linebuf, "%04X%-48s %s%s%s\n", i, outbuf, strbuf, ebcdicbuf, rad50buf);
+    line (ctx, linebuf);
+    }
+if (same > 0) {
+    sprintf (linebuf, "%04X thru %04X same as above\n", i-(16*same), (unsigned int)(len-1));
+    line (ctx, linebuf);
+    }
+}
+
+typedef struct DATA_TRACE {
+    DEVICE      *dptr;
+    uint32      reason;
+    } DATA_TRACE;
+
+static void _sim_data_trace_line (void *ctx, const char *text)
+{
+DATA_TRACE *dt = (DATA_TRACE *)ctx;
+
+sim_debug (dt->reason, dt->dptr, "%s", text);
+}
+
 void sim_data_trace(DEVICE *dptr, UNIT *uptr, const uint8 *data, const char *position, size_t len, const char *txt, uint32 reason)
 {
 
 if (sim_deb && (dptr->dctrl & reason)) {
     sim_debug (reason, dptr, "%s %s %slen: %08X\n", sim_uname(uptr), txt, position, (unsigned int)len);
     if (data && len) {
-        unsigned int i, same, group, sidx, oidx, ridx, eidx, soff;
-        char outbuf[80], strbuf[28], rad50buf[36], ebcdicbuf[32];
-        static char hex[] = "0123456789ABCDEF";
-        static char rad50[] = " ABCDEFGHIJKLMNOPQRSTUVWXYZ$._0123456789";
-        static unsigned char ebcdic2ascii[] = {
-            0000,0001,0002,0003,0234,0011,0206,0177,
-            0227,0215,0216,0013,0014,0015,0016,0017,
-            0020,0021,0022,0023,0235,0205,0010,0207,
-            0030,0031,0222,0217,0034,0035,0036,0037,
-            0200,0201,0202,0203,0204,0012,0027,0033,
-            0210,0211,0212,0213,0214,0005,0006,0007,
-            0220,0221,0026,0223,0224,0225,0226,0004,
-            0230,0231,0232,0233,0024,0025,0236,0032,
-            0040,0240,0241,0242,0243,0244,0245,0246,
-            0247,0250,0133,0056,0074,0050,0053,0041,
-            0046,0251,0252,0253,0254,0255,0256,0257,
-            0260,0261,0135,0044,0052,0051,0073,0136,
-            0055,0057,0262,0263,0264,0265,0266,0267,
-            0270,0271,0174,0054,0045,0137,0076,0077,
-            0272,0273,0274,0275,0276,0277,0300,0301,
-            0302,0140,0072,0043,0100,0047,0075,0042,
-            0303,0141,0142,0143,0144,0145,0146,0147,
-            0150,0151,0304,0305,0306,0307,0310,0311,
-            0312,0152,0153,0154,0155,0156,0157,0160,
-            0161,0162,0313,0314,0315,0316,0317,0320,
-            0321,0176,0163,0164,0165,0166,0167,0170,
-            0171,0172,0322,0323,0324,0325,0326,0327,
-            0330,0331,0332,0333,0334,0335,0336,0337,
-            0340,0341,0342,0343,0344,0345,0346,0347,
-            0173,0101,0102,0103,0104,0105,0106,0107,
-            0110,0111,0350,0351,0352,0353,0354,0355,
-            0175,0112,0113,0114,0115,0116,0117,0120,
-            0121,0122,0356,0357,0360,0361,0362,0363,
-            0134,0237,0123,0124,0125,0126,0127,0130,
-            0131,0132,0364,0365,0366,0367,0370,0371,
-            0060,0061,0062,0063,0064,0065,0066,0067,
-            0070,0071,0372,0373,0374,0375,0376,0377,
-            };
-
-        for (i=same=0; i<len; i += 16) {
-            if ((i > 0) && (0 == memcmp (&data[i], &data[i-16], 16))) {
-                ++same;
-                continue;
-                }
-            if (same > 0) {
-                sim_debug (reason, dptr, "%04X thru %04X same as above\n", i-(16*same), i-1);
-                same = 0;
-                }
-            group = (((len - i) > 16) ? 16 : (len - i));
-            strcpy (ebcdicbuf, (sim_deb_switches & SWMASK ('E')) ? " EBCDIC:" : "");
-            eidx = strlen(ebcdicbuf);
-            strcpy (rad50buf, (sim_deb_switches & SWMASK ('D')) ? " RAD50:" : "");
-            ridx = strlen(rad50buf);
-            strcpy (strbuf, (sim_deb_switches & (SWMASK ('E') | SWMASK ('D'))) ? "ASCII:" : "");
-            soff = strlen(strbuf);
-            for (sidx=oidx=0; sidx<group; ++sidx) {
-                outbuf[oidx++] = ' ';
-                outbuf[oidx++] = hex[(data[i+sidx]>>4)&0xf];
-                outbuf[oidx++] = hex[data[i+sidx]&0xf];
-                if (sim_isprint (data[i+sidx]))
-                    strbuf[soff+sidx] = data[i+sidx];
-                else
-                    strbuf[soff+sidx] = '.';
-                if (ridx && ((sidx&1) == 0)) {
-                    uint16 word = data[i+sidx] + (((uint16)data[i+sidx+1]) << 8);
-
-                    if (word >= 64000) {
-                        rad50buf[ridx++] = '|'; /* Invalid RAD-50 character */
-                        rad50buf[ridx++] = '|'; /* Invalid RAD-50 character */
-                        rad50buf[ridx++] = '|'; /* Invalid RAD-50 character */
-                        }
-                    else {
-                        rad50buf[ridx++] = rad50[word/1600];
-                        rad50buf[ridx++] = rad50[(word/40)%40];
-                        rad50buf[ridx++] = rad50[word%40];
-                        }
-                    }
-                if (eidx) {
-                    if (sim_isprint (ebcdic2ascii[data[i+sidx]]))
-                        ebcdicbuf[eidx++] = ebcdic2ascii[data[i+sidx]];
-                    else
-                        ebcdicbuf[eidx++] = '.';
-                    }
-                }
-            outbuf[oidx] = '\0';
-            strbuf[soff+sidx] = '\0';
-            ebcdicbuf[eidx] = '\0';
-            rad50buf[ridx] = '\0';
-            sim_debug (reason, dptr, "%04X%-48s %s%s%s\n", i, outbuf, strbuf, ebcdicbuf, rad50buf);
-            }
-        if (same > 0) {
-            sim_debug (reason, dptr, "%04X thru %04X same as above\n", i-(16*same), (unsigned int)(len-1));
-            }
+        DATA_TRACE dt;
+
+#if defined (SIM_DEBUG_BINARY)
+        if (sim_deb_binary && _sim_debug_record_data (reason, dptr, data, len))
+            return;
+#endif
+        dt.dptr = dptr;
+        dt.reason = reason;
+        _sim_data_dump (data, len, sim_deb_switches, &_sim_data_trace_line, &dt);
         }
     }
 }
@@ -273,6 +273,7 @@ t_stat get_aval (t_addr addr, DEVICE *dptr, UNIT *uptr);
 t_value get_rval (REG *rptr, uint32 idx);
 BRKTAB *sim_brk_fnd (t_addr loc);
 uint32 sim_brk_test (t_addr bloc, uint32 btyp);
+#define sim_brk_maybe(bloc, btyp) (sim_brk_filt[SIM_BRK_FILT_IDX (bloc)] & ((btyp) | BRK_TYP_DYN_ALL))
 void sim_brk_clrspc (uint32 spc, uint32 btyp);
 void sim_brk_npc (uint32 cnt);
 void sim_brk_setact (const char *action);
@@ -290,6 +291,7 @@ t_stat sim_exp_clrall (EXPECT *exp);
 t_stat sim_exp_show (FILE *st, CONST EXPECT *exp, const char *match);
 t_stat sim_exp_showall (FILE *st, const EXPECT *exp);
 t_stat sim_exp_check (EXPECT *exp, uint8 data);
+t_stat sim_exp_check_buf (EXPECT *exp, const uint8 *data, uint32 size);
 CONST char *match_ext (CONST char *fnam, const char *ext);
 t_stat show_version (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, CONST char *cptr);
 t_stat set_dev_debug (DEVICE *dptr, UNIT *uptr, int32 flag, CONST char *cptr);
@@ -301,6 +303,13 @@ void sim_printf (const char *fmt, ...) GCC_FMT_ATTR(1, 2);
 void sim_perror (const char *msg);
 t_stat sim_messagef (t_stat stat, const char *fmt, ...) GCC_FMT_ATTR(2, 3);
 void sim_data_trace(DEVICE *dptr, UNIT *uptr, const uint8 *data, const char *position, size_t len, const char *txt, uint32 reason);
+t_stat sim_debug_binary_open (const char *filename);
+t_stat sim_debug_binary_start (void);
+void sim_debug_binary_close (void);
+t_stat sim_debug_binary_flush (void);
+t_bool sim_debug_is_binary (void);
+void sim_debug_binary_show (FILE *st);
+t_stat sim_debug_decode (FILE *st, const char *filename);
 void sim_debug_bits_hdr (uint32 dbits, DEVICE* dptr, const char *header, 
     BITFIELD* bitdefs, uint32 before, uint32 after, int terminate);
 void sim_debug_bits (uint32 dbits, DEVICE* dptr, BITFIELD* bitdefs,
@@ -357,6 +366,7 @@ extern volatile t_bool stop_cpu;
 extern uint32 sim_brk_types;                            /* breakpoint info */
 extern uint32 sim_brk_dflt;
 extern uint32 sim_brk_summ;
+extern uint32 sim_brk_filt[SIM_BRK_FILT_LNT];
 extern uint32 sim_brk_match_type;
 extern t_addr sim_brk_match_addr;
 extern BRKTYPTAB *sim_brk_type_desc;                      /* type descriptions */
@@ -394,6 +404,7 @@ extern t_addr (*sim_vm_parse_addr) (DEVICE *dptr, CONST char *cptr, CONST char *
 extern t_bool (*sim_vm_fprint_stopped) (FILE *st, t_stat reason);
 extern t_value (*sim_vm_pc_value) (void);
 extern t_bool (*sim_vm_is_subroutine_call) (t_addr **ret_addrs);
+extern uint8 *(*sim_vm_mem_dirty) (UNIT *uptr, t_addr blksize, uint32 nblk);
 
 #ifdef  __cplusplus
 }
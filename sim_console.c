@@ -131,9 +131,13 @@
 #include "sim_tmxr.h"
 #include "sim_serial.h"
 #include "sim_timer.h"
+#include "sim_frontpanel.h"
 #include <ctype.h>
 #include <math.h>
 
+#undef DBG_XMT                                          /* frontpanel API debug bits */
+#undef DBG_RCV                                          /* aren't used here */
+
 #ifdef __HAIKU__
 #define nice(n) ({})
 #endif
@@ -487,6 +491,14 @@ struct BITSAMPLE_REG {
     uint32          width;          /* number of bits to sample */
     BITSAMPLE       *bits;
     };
+typedef struct SHMEM_REG SHMEM_REG;
+struct SHMEM_REG {
+    REG             *reg;           /* Register to be published */
+    uint32          idx;            /* Register index */
+    t_bool          indirect;       /* Register value points at memory */
+    DEVICE          *dptr;          /* Device register is part of */
+    UNIT            *uptr;          /* Unit Register is related to */
+    };
 typedef struct REMOTE REMOTE;
 struct REMOTE {
     int32           buf_size;
@@ -507,6 +519,12 @@ struct REMOTE {
     int             smp_sample_dither_pct;  /* dithering of cycles interval */
     uint32          smp_reg_count;          /* sample register count */
     BITSAMPLE_REG   *smp_regs;              /* registers being sampled */
+    SHMEM           *shm;                   /* shared memory sample area */
+    SIM_PANEL_SHMEM *shm_area;              /* mapped sample area */
+    uint32          shm_reg_count;          /* published register value count */
+    SHMEM_REG       *shm_regs;              /* published register values */
+    uint32          shm_bit_slot_count;     /* published bit sample registers */
+    uint32          *shm_bit_slots;         /* bit totals published for each */
     };
 REMOTE *sim_rem_consoles = NULL;
 
@@ -615,6 +633,8 @@ for (i=connections=0; i<sim_rem_con_tmxr.lines; i++) {
         fprintf (st, "The Command: %s\n", rem->repeat_action);
         fprintf (st, "    is repeated every %s\n", sim_fmt_secs (rem->repeat_interval / 1000000.0));
         }
+    if (rem->shm)
+        fprintf (st, "%d Register Values and %d Bit Sample Registers are published to shared memory every %s\n", rem->shm_reg_count, rem->shm_bit_slot_count, sim_fmt_secs (rem->repeat_interval / 1000000.0));
     if (rem->smp_reg_count) {
         uint32 reg;
         DEVICE *dptr = NULL;
@@ -717,6 +737,11 @@ static t_stat x_run_cmd (int32 flag, CONST char *cptr)
 return 7+SCPE_IERR;         /* This routine should never be called */
 }
 
+static t_stat x_shmem_cmd (int32 flag, CONST char *cptr)
+{
+return 8+SCPE_IERR;         /* This routine should never be called */
+}
+
 static t_stat x_help_cmd (int32 flag, CONST char *cptr);
 
 static CTAB allowed_remote_cmds[] = {
@@ -731,6 +756,7 @@ static CTAB allowed_remote_cmds[] = {
     { "REPEAT",   &x_repeat_cmd,      0 },
     { "COLLECT",  &x_collect_cmd,     0 },
     { "SAMPLEOUT",&x_sampleout_cmd,   0 },
+    { "SHMEM",    &x_shmem_cmd,       0 },
     { "STEP",     &x_step_cmd,        0 },
     { "PWD",      &pwd_cmd,           0 },
     { "SAVE",     &save_cmd,          0 },
@@ -756,6 +782,7 @@ static CTAB allowed_master_remote_cmds[] = {
     { "REPEAT",   &x_repeat_cmd,      0 },
     { "COLLECT",  &x_collect_cmd,     0 },
     { "SAMPLEOUT",&x_sampleout_cmd,   0 },
+    { "SHMEM",    &x_shmem_cmd,       0 },
     { "EXECUTE",  &x_execute_cmd,     0 },
     { "STEP",     &x_step_cmd,        0 },
     { "PWD",      &pwd_cmd,           0 },
@@ -791,6 +818,7 @@ static CTAB allowed_single_remote_cmds[] = {
     { "REPEAT",   &x_repeat_cmd,      0 },
     { "COLLECT",  &x_collect_cmd,     0 },
     { "SAMPLEOUT",&x_sampleout_cmd,   0 },
+    { "SHMEM",    &x_shmem_cmd,       0 },
     { "EXECUTE",  &x_execute_cmd,     0 },
     { "PWD",      &pwd_cmd,           0 },
     { "DIR",      &dir_cmd,           0 },
@@ -808,6 +836,7 @@ static CTAB remote_only_cmds[] = {
     { "REPEAT",   &x_repeat_cmd,      0 },
     { "COLLECT",  &x_collect_cmd,     0 },
     { "SAMPLEOUT",&x_sampleout_cmd,   0 },
+    { "SHMEM",    &x_shmem_cmd,       0 },
     { "EXECUTE",  &x_execute_cmd,     0 },
     { NULL,       NULL }
     };
@@ -980,6 +1009,8 @@ else {
 return buf;
 }
 
+static void sim_rem_shmem_release (REMOTE *rem);
+
 /* 
     Parse and setup Remote Console REPEAT command:
        REPEAT EVERY nnn USECS Command {; command...}
@@ -1033,6 +1064,7 @@ if (stat == SCPE_OK) {
     if (all_stop) {
         for (line = 0; line < sim_rem_con_tmxr.lines; line++) {
             rem = &sim_rem_consoles[line];
+            sim_rem_shmem_release (rem);
             free (rem->repeat_action);
             rem->repeat_action = NULL;
             sim_cancel (rem->uptr);
@@ -1041,6 +1073,7 @@ if (stat == SCPE_OK) {
             }
         }
     else {
+        sim_rem_shmem_release (rem);                /* repeats replace any publishing */
         if (rem->repeat_interval != 0) {
             rem->repeat_action = (char *)realloc (rem->repeat_action, 1 + strlen (cptr));
             strcpy (rem->repeat_action, cptr);
@@ -1255,6 +1288,246 @@ else {
 return stat;
 }
 
+/* 
+    Parse and setup Remote Console SHMEM command:
+       SHMEM name EVERY nnn USECS {BITS n{,n...}} {{-I} {dev} reg{[lo:hi]}{,...}}
+       SHMEM STOP
+
+    The named shared memory region must have been created by the front 
+    panel with a SIM_PANEL_SHMEM header describing the same number of 
+    register values and bit sample totals.  The register values listed 
+    are published in order, followed by the bit sample totals of the 
+    registers being gathered by the COLLECT command.  Each BITS value 
+    specifies how many bit totals are published for the corresponding 
+    COLLECT register.
+ */
+static void sim_rem_shmem_release (REMOTE *rem)
+{
+if (rem->shm == NULL)
+    return;
+sim_shmem_close (rem->shm);
+rem->shm = NULL;
+rem->shm_area = NULL;
+free (rem->shm_regs);
+rem->shm_regs = NULL;
+rem->shm_reg_count = 0;
+free (rem->shm_bit_slots);
+rem->shm_bit_slots = NULL;
+rem->shm_bit_slot_count = 0;
+}
+
+static void sim_rem_shmem_publish (REMOTE *rem)
+{
+SIM_PANEL_SHMEM *shm = rem->shm_area;
+unsigned long long *values = SIM_PANEL_SHMEM_VALUES(shm);
+int *bits = SIM_PANEL_SHMEM_BITS(shm);
+uint32 i, bit;
+
+shm->sequence += 1;                             /* odd while updating */
+SIM_PANEL_SHMEM_BARRIER ();
+shm->simulation_time = (unsigned long long)sim_gtime ();
+for (i = 0; i < rem->shm_reg_count; i++) {
+    SHMEM_REG *sreg = &rem->shm_regs[i];
+    t_value val = get_rval (sreg->reg, sreg->idx);
+
+    if (sreg->indirect) {                       /* memory contents, low address first */
+        uint32 k, shift;
+
+        get_aval ((t_addr)val, sreg->dptr, sreg->uptr);
+        values[i] = 0;
+        for (k = shift = 0; (k < (uint32)sim_emax) && (shift < 64); k++, shift += sreg->dptr->dwidth)
+            values[i] |= ((unsigned long long)sim_eval[k]) << shift;
+        }
+    else
+        values[i] = (unsigned long long)val;
+    }
+for (i = 0; i < rem->shm_bit_slot_count; i++) {
+    for (bit = 0; bit < rem->shm_bit_slots[i]; bit++) {
+        if ((i < rem->smp_reg_count) && (bit < rem->smp_regs[i].width))
+            *bits++ = rem->smp_regs[i].bits[bit].tot;
+        else
+            *bits++ = 0;
+        }
+    }
+SIM_PANEL_SHMEM_BARRIER ();
+shm->sequence += 1;                             /* even when complete */
+}
+
+static t_stat sim_rem_shmem_cmd_setup (int32 line, CONST char **iptr)
+{
+char gbuf[CBUFSIZE], name[CBUFSIZE];
+int32 usecs;
+uint32 bit_count = 0;
+t_stat stat = SCPE_OK;
+CONST char *cptr = *iptr;
+CONST char *tptr;
+REMOTE *rem = &sim_rem_consoles[line];
+SHMEM_REG *shm_regs = NULL;
+uint32 shm_reg_count = 0;
+uint32 *bit_slots = NULL;
+uint32 bit_slot_count = 0;
+SIM_PANEL_SHMEM *shm;
+void *addr;
+
+sim_debug (DBG_REP, &sim_remote_console, "Shmem Setup: %s\n", cptr);
+if (*cptr == 0)         /* required argument? */
+    return SCPE_2FARG;
+cptr = get_glyph_nc (cptr, name, 0);            /* get region name */
+if (strcasecmp (name, "STOP") == 0) {
+    *iptr = cptr;
+    if (*cptr)
+        return SCPE_2MARG;
+    if (rem->shm) {
+        sim_rem_shmem_release (rem);
+        rem->repeat_interval = 0;
+        sim_cancel (rem->uptr);
+        }
+    return SCPE_OK;
+    }
+cptr = get_glyph (cptr, gbuf, 0);               /* get next glyph */
+if (MATCH_CMD (gbuf, "EVERY") != 0) {
+    *iptr = cptr;
+    return sim_messagef (SCPE_ARG, "Expected EVERY found: %s\n", gbuf);
+    }
+cptr = get_glyph (cptr, gbuf, 0);               /* get next glyph */
+usecs = (int32) get_uint (gbuf, 10, INT_MAX, &stat);
+if ((stat != SCPE_OK) || (usecs <= 0)) {        /* error? */
+    *iptr = cptr;
+    return sim_messagef (SCPE_ARG, "Expected value found: %s\n", gbuf);
+    }
+cptr = get_glyph (cptr, gbuf, 0);               /* get next glyph */
+if (MATCH_CMD (gbuf, "USECS") != 0) {
+    *iptr = cptr;
+    return sim_messagef (SCPE_ARG, "Expected USECS found: %s\n", gbuf);
+    }
+tptr = get_glyph (cptr, gbuf, 0);               /* peek at next glyph */
+if (MATCH_CMD (gbuf, "BITS") == 0) {
+    cptr = get_glyph (tptr, gbuf, 0);           /* get bit slot list */
+    tptr = gbuf;
+    while (*tptr) {
+        CONST char *eptr;
+        uint32 *slots;
+        uint32 width = (uint32) strtotv (tptr, &eptr, 10);
+
+        if ((eptr == tptr) || ((*eptr != ',') && (*eptr != '\0')) || (width > 64)) {
+            stat = sim_messagef (SCPE_ARG, "Invalid BITS value: %s\n", tptr);
+            break;
+            }
+        slots = (uint32 *)realloc (bit_slots, (bit_slot_count + 1) * sizeof (*slots));
+        if (slots == NULL) {
+            stat = SCPE_MEM;
+            break;
+            }
+        bit_slots = slots;
+        bit_slots[bit_slot_count++] = width;
+        bit_count += width;
+        tptr = (*eptr == ',') ? eptr + 1 : eptr;
+        }
+    }
+while ((stat == SCPE_OK) && cptr && *cptr) {
+    const char *comma = strchr (cptr, ',');
+    char tbuf[2*CBUFSIZE];
+    REG *reg;
+    uint32 idx, high;
+    int32 saved_switches = sim_switches;
+    t_bool indirect = FALSE;
+    SHMEM_REG *sregs;
+
+    if (comma) {
+        strncpy (tbuf, cptr, comma - cptr);
+        tbuf[comma - cptr] = '\0';
+        cptr = comma + 1;
+        }
+    else {
+        strcpy (tbuf, cptr);
+        cptr += strlen (cptr);
+        }
+    tptr = tbuf;
+    if (strchr (tbuf, ' ')) {
+        sim_switches = 0;
+        tptr = get_sim_opt (CMD_OPT_SW|CMD_OPT_DFT, tbuf, &stat); /* get switches and device */
+        indirect = ((sim_switches & SWMASK('I')) != 0);
+        sim_switches = saved_switches;
+        }
+    if (stat != SCPE_OK)
+        break;
+    tptr = get_glyph (tptr, gbuf, 0);           /* get next glyph */
+    reg = find_reg (gbuf, &tptr, sim_dfdev);
+    if (reg == NULL) {
+        stat = sim_messagef (SCPE_NXREG, "Nonexistent Register: %s\n", gbuf);
+        break;
+        }
+    idx = high = 0;                             /* assume not array */
+    if (*tptr == '[') {                         /* subscript? */
+        const char *tgptr = ++tptr;
+
+        if (reg->depth <= 1) {                  /* array register? */
+            stat = sim_messagef (SCPE_SUB, "Not Array Register: %s\n", reg->name);
+            break;
+            }
+        idx = high = (uint32) strtotv (tgptr, &tptr, 10);/* convert index */
+        if ((tgptr != tptr) && (*tptr == ':')) {/* range? */
+            tgptr = ++tptr;
+            high = (uint32) strtotv (tgptr, &tptr, 10);
+            }
+        if ((tgptr == tptr) || (*tptr++ != ']')) {
+            stat = sim_messagef (SCPE_SUB, "Missing or Invalid Register Subscript: %s[%s\n", reg->name, tgptr);
+            break;
+            }
+        if ((high < idx) || (high >= reg->depth)) {/* validate subscript */
+            stat = sim_messagef (SCPE_SUB, "Invalid Register Subscript: %s[%d]\n", reg->name, high);
+            break;
+            }
+        }
+    sregs = (SHMEM_REG *)realloc (shm_regs, (shm_reg_count + 1 + high - idx) * sizeof (*sregs));
+    if (sregs == NULL) {
+        stat = SCPE_MEM;
+        break;
+        }
+    shm_regs = sregs;
+    for (; idx <= high; idx++) {
+        shm_regs[shm_reg_count].reg = reg;
+        shm_regs[shm_reg_count].idx = idx;
+        shm_regs[shm_reg_count].indirect = indirect;
+        shm_regs[shm_reg_count].dptr = sim_dfdev;
+        shm_regs[shm_reg_count].uptr = sim_dfunit;
+        ++shm_reg_count;
+        }
+    }
+if (stat == SCPE_OK) {
+    tptr = strcpy (gbuf, "STOP");               /* Start from a clean slate */
+    sim_rem_repeat_cmd_setup (line, &tptr);
+    stat = sim_shmem_attach (name, SIM_PANEL_SHMEM_SIZE(shm_reg_count, bit_count), &rem->shm, &addr);
+    if (stat != SCPE_OK)
+        stat = sim_messagef (stat, "Can't access shared memory region: %s\n", name);
+    }
+if (stat == SCPE_OK) {
+    shm = (SIM_PANEL_SHMEM *)addr;
+    rem->shm_area = shm;
+    rem->shm_regs = shm_regs;
+    rem->shm_reg_count = shm_reg_count;
+    rem->shm_bit_slots = bit_slots;
+    rem->shm_bit_slot_count = bit_slot_count;
+    shm_regs = NULL;
+    bit_slots = NULL;
+    if ((shm->magic != SIM_PANEL_SHMEM_MAGIC) ||
+        (shm->value_count != shm_reg_count) ||
+        (shm->bit_count != bit_count)) {
+        sim_rem_shmem_release (rem);
+        stat = sim_messagef (SCPE_ARG, "Shared memory region %s doesn't describe %d values and %d bits\n", name, shm_reg_count, bit_count);
+        }
+    }
+free (shm_regs);
+free (bit_slots);
+if (stat == SCPE_OK) {
+    rem->repeat_interval = usecs;
+    sim_rem_shmem_publish (rem);                /* make initial values available */
+    stat = sim_activate_after (rem->uptr, rem->repeat_interval);
+    }
+*iptr = cptr;
+return stat;
+}
+
 t_stat sim_rem_con_repeat_svc (UNIT *uptr)
 {
 int line = uptr - rem_con_repeat_units;
@@ -1262,7 +1535,10 @@ REMOTE *rem = &sim_rem_consoles[line];
 
 sim_debug (DBG_REP, &sim_remote_console, "sim_rem_con_repeat_svc(line=%d) - interval=%d usecs\n", line, rem->repeat_interval);
 if (rem->repeat_interval) {
-    rem->repeat_pending = TRUE;
+    if (rem->shm)                                           /* publishing to shared memory? */
+        sim_rem_shmem_publish (rem);
+    else
+        rem->repeat_pending = TRUE;
     sim_activate_after (uptr, rem->repeat_interval);        /* reschedule */
     sim_activate_abs (rem_con_data_unit, -1);               /* wake up to process */
     }
@@ -1731,16 +2007,23 @@ for (i=(was_active_command ? sim_rem_cmd_active_line : 0);
                                             stat = sim_rem_collect_cmd_setup (i, &cptr);
                                             }
                                         else {
-                                            if (sim_con_stable_registers && 
-                                                sim_rem_master_mode) {  /* can we process command now? */
-                                                sim_debug (DBG_CMD, &sim_remote_console, "Processing Command directly\n");
-                                                sim_oline = lp;         /* specify output socket */
-                                                sim_remote_process_command ();
-                                                stat = SCPE_OK;         /* any message has already been emitted */
+                                            if (cmdp->action == &x_shmem_cmd) {
+                                                sim_debug (DBG_CMD, &sim_remote_console, "shmem_cmd executing\n");
+                                                stat = sim_rem_shmem_cmd_setup (i, &cptr);
+                                                sim_last_cmd_stat = SCPE_BARE_STATUS(stat); /* report status to the panel */
                                                 }
                                             else {
-                                                sim_debug (DBG_CMD, &sim_remote_console, "Processing Command via SCPE_REMOTE\n");
-                                                stat = SCPE_REMOTE;     /* force processing outside of sim_instr() */
+                                                if (sim_con_stable_registers && 
+                                                    sim_rem_master_mode) {  /* can we process command now? */
+                                                    sim_debug (DBG_CMD, &sim_remote_console, "Processing Command directly\n");
+                                                    sim_oline = lp;         /* specify output socket */
+                                                    sim_remote_process_command ();
+                                                    stat = SCPE_OK;         /* any message has already been emitted */
+                                                    }
+                                                else {
+                                                    sim_debug (DBG_CMD, &sim_remote_console, "Processing Command via SCPE_REMOTE\n");
+                                                    stat = SCPE_REMOTE;     /* force processing outside of sim_instr() */
+                                                    }
                                                 }
                                             }
                                         }
@@ -2232,10 +2515,17 @@ if ((cptr == NULL) || (*cptr == 0))                     /* need arg */
 cptr = get_glyph_nc (cptr, gbuf, 0);                    /* get file name */
 if (*cptr != 0)                                         /* now eol? */
     return SCPE_2MARG;
-r = sim_open_logfile (gbuf, FALSE, &sim_deb, &sim_deb_ref);
+sim_debug_binary_close ();                              /* stop any binary recording */
+if (sim_switches & SWMASK ('B'))                        /* binary debug records? */
+    r = sim_debug_binary_open (gbuf);
+else
+    r = sim_open_logfile (gbuf, FALSE, &sim_deb, &sim_deb_ref);
 
-if (r != SCPE_OK)
+if (r != SCPE_OK) {
+    if (sim_deb_ref == NULL)                            /* previous file closed? */
+        sim_deb = NULL;
     return r;
+    }
 
 sim_deb_switches = sim_switches;                        /* save debug switches */
 if (sim_deb_switches & SWMASK ('R')) {
@@ -2243,8 +2533,17 @@ if (sim_deb_switches & SWMASK ('R')) {
     if (!(sim_deb_switches & (SWMASK ('A') | SWMASK ('T'))))
         sim_deb_switches |= SWMASK ('T');
     }
+r = sim_debug_binary_start ();
+if (r != SCPE_OK) {
+    sim_close_logfile (&sim_deb_ref);
+    sim_deb = NULL;
+    sim_deb_switches = 0;
+    return r;
+    }
 if (!sim_quiet) {
     sim_printf ("Debug output to \"%s\"\n", sim_logfile_name (sim_deb, sim_deb_ref));
+    if (sim_debug_is_binary ())
+        sim_printf ("   Debug messages are recorded in binary form (see HELP DEBUG)\n");
     if (sim_deb_switches & SWMASK ('P'))
         sim_printf ("   Debug messages contain current PC value\n");
     if (sim_deb_switches & SWMASK ('T'))
@@ -2277,6 +2576,9 @@ if (sim_deb == sim_log) {                               /* debug is log */
     return SCPE_OK;
     }
 
+if (sim_debug_is_binary ())                             /* binary records? */
+    return sim_debug_binary_flush ();                   /* write out what's been recorded */
+
 strcpy (saved_debug_filename, sim_logfile_name (sim_deb, sim_deb_ref));
 
 sim_quiet = 1;
@@ -2297,6 +2599,7 @@ if (cptr && (*cptr != 0))                               /* now eol? */
     return SCPE_2MARG;
 if (sim_deb == NULL)                                    /* no debug? */
     return SCPE_OK;
+sim_debug_binary_close ();                              /* write out any binary records */
 sim_close_logfile (&sim_deb_ref);
 sim_deb = NULL;
 sim_deb_switches = 0;
@@ -2316,6 +2619,7 @@ if (cptr && (*cptr != 0))
 if (sim_deb) {
     fprintf (st, "Debug output enabled to \"%s\"\n", 
                  sim_logfile_name (sim_deb, sim_deb_ref));
+    sim_debug_binary_show (st);
     if (sim_deb_switches & SWMASK ('P'))
         fprintf (st, "   Debug messages contain current PC value\n");
     if (sim_deb_switches & SWMASK ('T'))
@@ -339,6 +339,11 @@ typedef uint32          t_addr;
 #define SIM_BKPT_N_SPC  (1 << (32 - SIM_BKPT_V_SPC))    /* max number spaces */
 #define SIM_BKPT_V_SPC  (BRK_TYP_MAX + 1)               /* location in arg */
 
+/* Breakpoint filter definitions */
+
+#define SIM_BRK_FILT_LNT 4096                           /* filter entries (power of 2) */
+#define SIM_BRK_FILT_IDX(a) ((((uint32)(a)) ^ ((uint32)(((t_uint64)(a)) >> 12))) & (SIM_BRK_FILT_LNT - 1))
+
 /* Extended switch definitions (bits >= 26) */
 
 #define SIM_SW_HIDE     (1u << 26)                      /* enable hiding */
@@ -553,7 +558,7 @@ struct DEVICE {
 */
 
 struct UNIT {
-    UNIT                *next;                          /* next active */
+    UNIT                *next;                          /* next active (in queue slot order) */
     t_stat              (*action)(UNIT *up);            /* action routine */
     char                *filename;                      /* open file name */
     FILE                *fileref;                       /* file reference */
@@ -580,6 +585,9 @@ struct UNIT {
     t_bool              (*cancel)(UNIT *);
     double              usecs_remaining;                /* time balance for long delays */
     char                *uname;                         /* Unit name */
+    double              q_due;                          /* event queue absolute due time */
+    t_uint64            q_seq;                          /* event queue insertion sequence */
+    int32               q_index;                        /* event queue heap slot */
 #ifdef SIM_ASYNCH_IO
     void                (*a_check_completion)(UNIT *);
     t_bool              (*a_is_active)(UNIT *);
@@ -636,6 +644,8 @@ struct UNIT {
 #define UNIT_TMR_UNIT   0000020         /* Unit registered as a calibrated timer */
 #define UNIT_V_DF_TAPE  5               /* Bit offset for Tape Density reservation */
 #define UNIT_S_DF_TAPE  3               /* Bits Reserved for Tape Density */
+#define UNIT_V_DF_TAPEBUF 8             /* Bit offset for Tape Buffer Size reservation */
+#define UNIT_S_DF_TAPEBUF 4             /* Bits Reserved for Tape Buffer Size */
 
 struct BITFIELD {
     const char      *name;                              /* field name */
@@ -791,6 +801,8 @@ struct EXPTAB {
 #define EXP_TYP_TIME            (SWMASK ('T'))      /* halt delay is in microseconds instead of instructions */
 #if defined(USE_REGEX)
     regex_t             regex;                          /* compiled regular expression */
+    regmatch_t          *matches;                       /* match results (re_nsub + 1 entries) */
+    t_bool              batch;                          /* match can be evaluated after a block of data */
 #endif
     char                *act;                           /* action string */
     };
@@ -806,6 +818,16 @@ struct EXPECT {
     uint32              buf_ins;                        /* buffer insertion point for the next output data */
     uint32              buf_size;                       /* buffer size */
     uint32              buf_data;                       /* count of data in buffer */
+    char                *rbuf;                          /* NUL stripped copy of buf for RegEx compares */
+    int32               regex_rules;                    /* count of RegEx rules */
+    int32               regex_bytewise;                 /* count of RegEx rules needing per byte evaluation */
+    int32               *ac_next;                       /* literal rule automaton transitions */
+    int32               *ac_rule;                       /* first literal rule matched in each automaton state */
+    uint32              *ac_depth;                      /* automaton state depth (matched prefix length) */
+    uint32              ac_states;                      /* automaton state count (0 if no literal rules) */
+    uint32              ac_classes;                     /* count of automaton input classes */
+    uint32              ac_state;                       /* current automaton state */
+    uint16              ac_class[256];                  /* input byte to automaton input class */
     };
 
 /* Send Context */
@@ -51,6 +51,7 @@ Public routines:
    sim_disk_set_async        enable asynchronous operation
    sim_disk_clr_async        disable asynchronous operation
    sim_disk_data_trace       debug support
+   sim_disk_scd_cmd          SCD store maintenance command
 
 Internal routines:
 
@@ -69,6 +70,13 @@ Internal routines:
    sim_vhd_disk_rdsect       platform independent read virtual disk sectors
    sim_vhd_disk_wrsect       platform independent write virtual disk sectors
 
+   sim_scd_disk_open         open sparse/compressed/dedup (SCD) container
+   sim_scd_disk_create       create SCD container
+   sim_scd_disk_close        close SCD container
+   sim_scd_disk_size         SCD container disk size
+   sim_scd_disk_rdsect       read SCD container sectors
+   sim_scd_disk_wrsect       write SCD container sectors
+
 
 */
 
@@ -84,6 +92,38 @@ Internal routines:
 #include <pthread.h>
 #endif
 
+#if defined SIM_ASYNCH_IO
+/* Each unit has a queue of up to DISK_AIO_QUEUE_DEPTH outstanding requests.
+   Requests are serviced by a single I/O thread when the container is
+   accessed through a shared stdio stream (or VHD) and by a small pool of
+   threads when every transfer is self positioning (memory mapped SIMH
+   containers and raw devices).  Requests which overlap a request already
+   in progress wait for it, so the guest visible ordering of overlapping
+   transfers is that of submission.  A submitter which finds the queue
+   full waits for a transfer to complete, after setting aside any completed
+   request whose callback hasn't been dispatched yet. */
+
+#define DISK_AIO_QUEUE_DEPTH    16
+#define DISK_AIO_MAX_WORKERS    4
+
+#define DIOQ_FREE       0       /* slot available */
+#define DIOQ_PENDING    1       /* queued awaiting an I/O thread */
+#define DIOQ_ACTIVE     2       /* transfer in progress */
+#define DIOQ_DONE       3       /* complete, callback not yet dispatched */
+
+struct disk_io_req {
+    int                 state;
+    int                 dop;
+    uint32              seq;                /* submission, then completion order */
+    uint8               *buf;
+    t_seccnt            *rsects;
+    t_seccnt            sects;
+    t_lba               lba;
+    DISK_PCALLBACK      callback;
+    t_stat              io_status;
+    };
+#endif
+
 struct disk_context {
     DEVICE              *dptr;              /* Device for unit (access to debug flags) */
     uint32              dbit;               /* debugging bit */
@@ -95,6 +135,9 @@ struct disk_context {
     uint32              is_cdrom;           /* Host system CDROM Device */
     uint32              media_removed;      /* Media not available flag */
     uint32              auto_format;        /* Format determined dynamically */
+    FMAP                *fmap;              /* Memory mapping of SIMH format container */
+    uint8               *fmap_base;         /* Mapped container contents */
+    t_offset            fmap_size;          /* Bytes of container mapped */
 #if defined _WIN32
     HANDLE              disk_handle;        /* OS specific Raw device handle */
 #endif
@@ -102,18 +145,19 @@ struct disk_context {
     int                 asynch_io;          /* Asynchronous Interrupt scheduling enabled */
     int                 asynch_io_latency;  /* instructions to delay pending interrupt */
     pthread_mutex_t     lock;
-    pthread_t           io_thread;          /* I/O Thread Id */
     pthread_mutex_t     io_lock;
-    pthread_cond_t      io_cond;
-    pthread_cond_t      io_done;
+    pthread_cond_t      io_cond;            /* request queued or retired */
+    pthread_cond_t      io_done;            /* request completed */
     pthread_cond_t      startup_cond;
-    int                 io_dop;
-    uint8               *buf;
-    t_seccnt            *rsects;
-    t_seccnt            sects;
-    t_lba               lba;
-    DISK_PCALLBACK      callback;
-    t_stat              io_status;
+    int                 io_workers;         /* I/O threads servicing the queue */
+    int                 io_started;         /* I/O threads running */
+    pthread_t           io_thread[DISK_AIO_MAX_WORKERS];/* I/O Thread Ids */
+    uint32              io_seq;             /* request and completion sequence */
+    int                 io_pending;         /* requests queued or in progress */
+    struct disk_io_req  io_queue[DISK_AIO_QUEUE_DEPTH];
+    struct disk_io_req  *io_retired;        /* completions set aside (in completion order) */
+    int                 io_retired_count;
+    int                 io_retired_size;
 #endif
     };
 
@@ -126,27 +170,8 @@ struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;   \
 if ((!callback) || !ctx->asynch_io)
 
 #define AIO_CALL(op, _lba, _buf, _rsects, _sects,  _callback)   \
-    if (ctx->asynch_io) {                                       \
-        struct disk_context *ctx =                              \
-                      (struct disk_context *)uptr->disk_ctx;    \
-                                                                \
-        pthread_mutex_lock (&ctx->io_lock);                     \
-                                                                \
-        sim_debug (ctx->dbit, ctx->dptr,                        \
-      "sim_disk AIO_CALL(op=%d, unit=%d, lba=0x%X, sects=%d)\n",\
-                op, (int)(uptr-ctx->dptr->units), _lba, _sects);\
-                                                                \
-        if (ctx->callback)                                      \
-            abort(); /* horrible mistake, stop */               \
-        ctx->io_dop = op;                                       \
-        ctx->lba = _lba;                                        \
-        ctx->buf = _buf;                                        \
-        ctx->sects = _sects;                                    \
-        ctx->rsects = _rsects;                                  \
-        ctx->callback = _callback;                              \
-        pthread_cond_signal (&ctx->io_cond);                    \
-        pthread_mutex_unlock (&ctx->io_lock);                   \
-        }                                                       \
+    if (ctx->asynch_io)                                         \
+        _disk_queue_request (uptr, op, _lba, _buf, _rsects, _sects, _callback);\
     else                                                        \
         if (_callback)                                          \
             (_callback) (uptr, r);
@@ -157,11 +182,115 @@ if ((!callback) || !ctx->asynch_io)
 #define DOP_WSEC  2             /* sim_disk_wrsect_a */
 #define DOP_IAVL  3             /* sim_disk_isavailable_a */
 
+/* Two requests conflict when either is an availability check (which may
+   reattach the unit) or when they touch a common storage sector.  Ranges
+   are widened to storage sector boundaries since an unaligned write is a
+   read-modify-write of the whole storage sectors it touches. */
+static t_bool _disk_io_conflict (struct disk_context *ctx, struct disk_io_req *a, struct disk_io_req *b)
+{
+t_offset ssize = (ctx->storage_sector_size > ctx->sector_size) ? ctx->storage_sector_size : ctx->sector_size;
+t_offset a_start, a_end, b_start, b_end;
+
+if ((a->dop == DOP_IAVL) || (b->dop == DOP_IAVL))
+    return TRUE;
+a_start = ((t_offset)a->lba * ctx->sector_size) / ssize;
+a_end = (((t_offset)(a->lba + a->sects) * ctx->sector_size) + ssize - 1) / ssize;
+b_start = ((t_offset)b->lba * ctx->sector_size) / ssize;
+b_end = (((t_offset)(b->lba + b->sects) * ctx->sector_size) + ssize - 1) / ssize;
+return ((a_start < b_end) && (b_start < a_end));
+}
+
+/* Select the oldest pending request which doesn't conflict with a request
+   in progress or with an older pending one.  Called with io_lock held. */
+static struct disk_io_req *_disk_io_next (struct disk_context *ctx)
+{
+struct disk_io_req *req = NULL;
+int i, j;
+
+for (i = 0; i < DISK_AIO_QUEUE_DEPTH; i++) {
+    struct disk_io_req *r = &ctx->io_queue[i];
+    t_bool blocked = FALSE;
+
+    if ((r->state != DIOQ_PENDING) ||
+        ((req != NULL) && ((int32)(r->seq - req->seq) > 0)))
+        continue;
+    for (j = 0; (j < DISK_AIO_QUEUE_DEPTH) && !blocked; j++) {
+        struct disk_io_req *o = &ctx->io_queue[j];
+
+        if ((o != r) &&
+            ((o->state == DIOQ_ACTIVE) ||
+             ((o->state == DIOQ_PENDING) && ((int32)(o->seq - r->seq) < 0))))
+            blocked = _disk_io_conflict (ctx, o, r);
+        }
+    if (!blocked)
+        req = r;
+    }
+return req;
+}
+
+static void _disk_queue_request (UNIT *uptr, int op, t_lba lba, uint8 *buf, t_seccnt *rsects, t_seccnt sects, DISK_PCALLBACK callback)
+{
+struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
+struct disk_io_req *req = NULL;
+int i;
+
+pthread_mutex_lock (&ctx->io_lock);
+
+sim_debug (ctx->dbit, ctx->dptr, "_disk_queue_request(op=%d, unit=%d, lba=0x%X, sects=%d, pending=%d)\n",
+                                 op, (int)(uptr-ctx->dptr->units), lba, sects, ctx->io_pending);
+
+while (req == NULL) {
+    struct disk_io_req *done = NULL;
+
+    for (i = 0; (i < DISK_AIO_QUEUE_DEPTH) && (req == NULL); i++) {
+        struct disk_io_req *r = &ctx->io_queue[i];
+
+        if (r->state == DIOQ_FREE)
+            req = r;
+        else
+            if ((r->state == DIOQ_DONE) &&
+                ((done == NULL) || ((int32)(r->seq - done->seq) < 0)))
+                done = r;
+        }
+    if (req != NULL)
+        break;
+    if (done != NULL) {                 /* Queue full: set the oldest completion aside */
+        if (ctx->io_retired_count == ctx->io_retired_size) {
+            int size = ctx->io_retired_size ? 2 * ctx->io_retired_size : DISK_AIO_QUEUE_DEPTH;
+            struct disk_io_req *retired = (struct disk_io_req *)realloc (ctx->io_retired, size * sizeof (*retired));
+
+            if (retired != NULL) {
+                ctx->io_retired = retired;
+                ctx->io_retired_size = size;
+                }
+            }
+        if (ctx->io_retired_count < ctx->io_retired_size) {
+            ctx->io_retired[ctx->io_retired_count++] = *done;
+            req = done;
+            break;
+            }
+        }
+    pthread_cond_wait (&ctx->io_done, &ctx->io_lock);/* for a transfer to complete */
+    }
+req->dop = op;
+req->lba = lba;
+req->buf = buf;
+req->sects = sects;
+req->rsects = rsects;
+req->callback = callback;
+req->seq = ctx->io_seq++;
+req->state = DIOQ_PENDING;
+++ctx->io_pending;
+pthread_cond_broadcast (&ctx->io_cond);
+pthread_mutex_unlock (&ctx->io_lock);
+}
+
 static void *
 _disk_io(void *arg)
 {
 UNIT* volatile uptr = (UNIT*)arg;
 struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
+struct disk_io_req *req;
 
 /* Boost Priority for this I/O thread vs the CPU instruction execution
    thread which in general won't be readily yielding the processor when
@@ -171,26 +300,33 @@ sim_os_set_thread_priority (PRIORITY_ABOVE_NORMAL);
 sim_debug (ctx->dbit, ctx->dptr, "_disk_io(unit=%d) starting\n", (int)(uptr-ctx->dptr->units));
 
 pthread_mutex_lock (&ctx->io_lock);
+++ctx->io_started;
 pthread_cond_signal (&ctx->startup_cond);   /* Signal we're ready to go */
-while (ctx->asynch_io) {
-    pthread_cond_wait (&ctx->io_cond, &ctx->io_lock);
-    if (ctx->io_dop == DOP_DONE)
-        break;
+while (ctx->asynch_io || ctx->io_pending) {
+    req = _disk_io_next (ctx);
+    if (req == NULL) {
+        pthread_cond_wait (&ctx->io_cond, &ctx->io_lock);
+        continue;
+        }
+    req->state = DIOQ_ACTIVE;
     pthread_mutex_unlock (&ctx->io_lock);
-    switch (ctx->io_dop) {
+    switch (req->dop) {
         case DOP_RSEC:
-            ctx->io_status = sim_disk_rdsect (uptr, ctx->lba, ctx->buf, ctx->rsects, ctx->sects);
+            req->io_status = sim_disk_rdsect (uptr, req->lba, req->buf, req->rsects, req->sects);
             break;
         case DOP_WSEC:
-            ctx->io_status = sim_disk_wrsect (uptr, ctx->lba, ctx->buf, ctx->rsects, ctx->sects);
+            req->io_status = sim_disk_wrsect (uptr, req->lba, req->buf, req->rsects, req->sects);
             break;
         case DOP_IAVL:
-            ctx->io_status = sim_disk_isavailable (uptr);
+            req->io_status = sim_disk_isavailable (uptr);
             break;
         }
     pthread_mutex_lock (&ctx->io_lock);
-    ctx->io_dop = DOP_DONE;
-    pthread_cond_signal (&ctx->io_done);
+    req->seq = ctx->io_seq++;                   /* completion order */
+    req->state = DIOQ_DONE;
+    --ctx->io_pending;
+    pthread_cond_broadcast (&ctx->io_done);
+    pthread_cond_broadcast (&ctx->io_cond);     /* others may now proceed */
     sim_activate (uptr, ctx->asynch_io_latency);
     }
 pthread_mutex_unlock (&ctx->io_lock);
@@ -206,24 +342,53 @@ return NULL;
    routine is to put the unit in proper condition to digest what may have
    occurred in the asynchrconous thread.
   
-   Since disk processing only handles a single I/O at a time to a
-   particular disk device (due to using stdio for the SimH Disk format
-   and stdio doesn't have an atomic seek+(read|write) operation),
-   we have the opportunity to possibly detect improper attempts to
-   issue multiple concurrent I/O requests. */
+   Several completions may have been coalesced into a single activation,
+   so every completed request is retired here, with callbacks delivered in
+   the order the transfers completed.  Completions set aside when the queue
+   was full all completed before those still in the queue. */
 static void _disk_completion_dispatch (UNIT *uptr)
 {
 struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
-DISK_PCALLBACK callback = ctx->callback;
+int locked = ctx->asynch_io;
 
-sim_debug (ctx->dbit, ctx->dptr, "_disk_completion_dispatch(unit=%d, dop=%d, callback=%p)\n", (int)(uptr-ctx->dptr->units), ctx->io_dop, ctx->callback);
+while (1) {
+    struct disk_io_req *req = NULL;
+    DISK_PCALLBACK callback;
+    t_stat status;
+    int i;
 
-if (ctx->io_dop != DOP_DONE)
-    abort();                                            /* horribly wrong, stop */
+    if (locked)
+        pthread_mutex_lock (&ctx->io_lock);
+    if (ctx->io_retired_count) {                /* set aside when the queue was full? */
+        req = &ctx->io_retired[0];
+        callback = req->callback;
+        status = req->io_status;
+        memmove (&ctx->io_retired[0], &ctx->io_retired[1], --ctx->io_retired_count * sizeof (*req));
+        }
+    else {
+        for (i = 0; i < DISK_AIO_QUEUE_DEPTH; i++) {
+            struct disk_io_req *r = &ctx->io_queue[i];
 
-if (ctx->callback && ctx->io_dop == DOP_DONE) {
-    ctx->callback = NULL;
-    callback (uptr, ctx->io_status);
+            if ((r->state == DIOQ_DONE) &&
+                ((req == NULL) || ((int32)(r->seq - req->seq) < 0)))
+                req = r;
+            }
+        if (req != NULL) {
+            callback = req->callback;
+            status = req->io_status;
+            req->callback = NULL;
+            req->state = DIOQ_FREE;
+            if (locked)
+                pthread_cond_broadcast (&ctx->io_done);
+            }
+        }
+    if (locked)
+        pthread_mutex_unlock (&ctx->io_lock);
+    if (req == NULL)
+        break;
+    sim_debug (ctx->dbit, ctx->dptr, "_disk_completion_dispatch(unit=%d, callback=%p)\n", (int)(uptr-ctx->dptr->units), callback);
+    if (callback)
+        callback (uptr, status);
     }
 }
 
@@ -232,8 +397,8 @@ static t_bool _disk_is_active (UNIT *uptr)
 struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
 
 if (ctx) {
-    sim_debug (ctx->dbit, ctx->dptr, "_disk_is_active(unit=%d, dop=%d)\n", (int)(uptr-ctx->dptr->units), ctx->io_dop);
-    return (ctx->io_dop != DOP_DONE);
+    sim_debug (ctx->dbit, ctx->dptr, "_disk_is_active(unit=%d, pending=%d)\n", (int)(uptr-ctx->dptr->units), ctx->io_pending);
+    return (ctx->io_pending != 0);
     }
 return FALSE;
 }
@@ -243,10 +408,10 @@ static t_bool _disk_cancel (UNIT *uptr)
 struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
 
 if (ctx) {
-    sim_debug (ctx->dbit, ctx->dptr, "_disk_cancel(unit=%d, dop=%d)\n", (int)(uptr-ctx->dptr->units), ctx->io_dop);
+    sim_debug (ctx->dbit, ctx->dptr, "_disk_cancel(unit=%d, pending=%d)\n", (int)(uptr-ctx->dptr->units), ctx->io_pending);
     if (ctx->asynch_io) {
         pthread_mutex_lock (&ctx->io_lock);
-        while (ctx->io_dop != DOP_DONE)
+        while (ctx->io_pending)
             pthread_cond_wait (&ctx->io_done, &ctx->io_lock);
         pthread_mutex_unlock (&ctx->io_lock);
         }
@@ -275,6 +440,14 @@ static t_stat sim_vhd_disk_wrsect (UNIT *uptr, t_lba lba, uint8 *buf, t_seccnt *
 static t_stat sim_vhd_disk_clearerr (UNIT *uptr);
 static t_stat sim_vhd_disk_set_dtype (FILE *f, const char *dtype);
 static const char *sim_vhd_disk_get_dtype (FILE *f);
+static FILE *sim_scd_disk_open (const char *szSCDPath, const char *DesiredAccess);
+static FILE *sim_scd_disk_create (const char *szSCDPath, t_offset desiredsize);
+static int sim_scd_disk_close (FILE *f);
+static void sim_scd_disk_flush (FILE *f);
+static t_offset sim_scd_disk_size (FILE *f);
+static t_stat sim_scd_disk_rdsect (UNIT *uptr, t_lba lba, uint8 *buf, t_seccnt *sectsread, t_seccnt sects);
+static t_stat sim_scd_disk_wrsect (UNIT *uptr, t_lba lba, uint8 *buf, t_seccnt *sectswritten, t_seccnt sects);
+static t_stat sim_scd_disk_clearerr (UNIT *uptr);
 static t_stat sim_os_disk_implemented_raw (void);
 static FILE *sim_os_disk_open_raw (const char *rawdevicename, const char *openmode);
 static int sim_os_disk_close_raw (FILE *f);
@@ -300,7 +473,7 @@ static struct sim_disk_fmt fmts[DKUF_N_FMT] = {
     { "SIMH", 0, DKUF_F_STD, NULL},
     { "RAW",  0, DKUF_F_RAW, sim_os_disk_implemented_raw},
     { "VHD",  0, DKUF_F_VHD, sim_vhd_disk_implemented},
-    { NULL,   0, 0}
+    { "SCD",  0, DKUF_F_SCD, NULL}
     };
 
 /* Set disk format */
@@ -393,6 +566,7 @@ switch (DK_GET_FMT (uptr)) {                            /* case on format */
     case DKUF_F_STD:                                    /* SIMH format */
         return TRUE;
     case DKUF_F_VHD:                                    /* VHD format */
+    case DKUF_F_SCD:                                    /* SCD format */
         return TRUE;
         break;
     case DKUF_F_RAW:                                    /* Raw Physical Disk Access */
@@ -454,6 +628,9 @@ switch (DK_GET_FMT (uptr)) {                            /* case on format */
     case DKUF_F_VHD:                                    /* VHD format */
         physical_size = sim_vhd_disk_size (uptr->fileref);
         break;
+    case DKUF_F_SCD:                                    /* SCD format */
+        physical_size = sim_scd_disk_size (uptr->fileref);
+        break;
     case DKUF_F_RAW:                                    /* Raw Physical Disk Access */
         physical_size = sim_os_disk_size_raw (uptr->fileref);
         break;
@@ -486,6 +663,15 @@ sim_debug (ctx->dbit, ctx->dptr, "sim_disk_set_async(unit=%d)\n", (int)(uptr-ctx
 ctx->asynch_io = sim_asynch_enabled;
 ctx->asynch_io_latency = latency;
 if (ctx->asynch_io) {
+    int i;
+
+    /* Transfers may run concurrently only when each is self positioning */
+    if ((DK_GET_FMT (uptr) == DKUF_F_RAW) ||
+        ((DK_GET_FMT (uptr) == DKUF_F_STD) && (ctx->fmap_base != NULL)))
+        ctx->io_workers = DISK_AIO_MAX_WORKERS;
+    else
+        ctx->io_workers = 1;
+    ctx->io_started = 0;
     pthread_mutex_init (&ctx->io_lock, NULL);
     pthread_cond_init (&ctx->io_cond, NULL);
     pthread_cond_init (&ctx->io_done, NULL);
@@ -493,9 +679,11 @@ if (ctx->asynch_io) {
     pthread_attr_init(&attr);
     pthread_attr_setscope(&attr, PTHREAD_SCOPE_SYSTEM);
     pthread_mutex_lock (&ctx->io_lock);
-    pthread_create (&ctx->io_thread, &attr, _disk_io, (void *)uptr);
+    for (i = 0; i < ctx->io_workers; i++)
+        pthread_create (&ctx->io_thread[i], &attr, _disk_io, (void *)uptr);
     pthread_attr_destroy(&attr);
-    pthread_cond_wait (&ctx->startup_cond, &ctx->io_lock); /* Wait for thread to stabilize */
+    while (ctx->io_started < ctx->io_workers)
+        pthread_cond_wait (&ctx->startup_cond, &ctx->io_lock); /* Wait for threads to stabilize */
     pthread_mutex_unlock (&ctx->io_lock);
     pthread_cond_destroy (&ctx->startup_cond);
     }
@@ -521,11 +709,14 @@ if (!ctx) return SCPE_UNATT;
 sim_debug (ctx->dbit, ctx->dptr, "sim_disk_clr_async(unit=%d)\n", (int)(uptr-ctx->dptr->units));
 
 if (ctx->asynch_io) {
+    int i;
+
     pthread_mutex_lock (&ctx->io_lock);
     ctx->asynch_io = 0;
-    pthread_cond_signal (&ctx->io_cond);
+    pthread_cond_broadcast (&ctx->io_cond);
     pthread_mutex_unlock (&ctx->io_lock);
-    pthread_join (ctx->io_thread, NULL);
+    for (i = 0; i < ctx->io_workers; i++)
+        pthread_join (ctx->io_thread[i], NULL);
     pthread_mutex_destroy (&ctx->io_lock);
     pthread_cond_destroy (&ctx->io_cond);
     pthread_cond_destroy (&ctx->io_done);
@@ -549,6 +740,17 @@ da = ((t_offset)lba) * ctx->sector_size;
 tbc = sects * ctx->sector_size;
 if (sectsread)
     *sectsread = 0;
+if (ctx->fmap_base) {                                   /* memory mapped? */
+    i = 0;
+    if (da < ctx->fmap_size)
+        i = (size_t)(((ctx->fmap_size - da) < tbc) ? (ctx->fmap_size - da) : tbc)/ctx->xfer_element_size;
+    sim_buf_copy_swapped (buf, ctx->fmap_base + da, ctx->xfer_element_size, i);
+    if (i < tbc/ctx->xfer_element_size)                 /* fill */
+        memset (&buf[i*ctx->xfer_element_size], 0, tbc-(i*ctx->xfer_element_size));
+    if (sectsread)
+        *sectsread = (t_seccnt)((i*ctx->xfer_element_size+ctx->sector_size-1)/ctx->sector_size);
+    return SCPE_OK;
+    }
 err = sim_fseeko (uptr->fileref, da, SEEK_SET);          /* set pos */
 if (!err) {
     i = sim_fread (buf, ctx->xfer_element_size, tbc/ctx->xfer_element_size, uptr->fileref);
@@ -586,6 +788,9 @@ if ((0 == (ctx->sector_size & (ctx->storage_sector_size - 1))) ||   /* Sector Al
         case DKUF_F_VHD:                                /* VHD format */
             r = sim_vhd_disk_rdsect (uptr, lba, buf, &sread, sects);
             break;
+        case DKUF_F_SCD:                                /* SCD format */
+            r = sim_scd_disk_rdsect (uptr, lba, buf, &sread, sects);
+            break;
         case DKUF_F_RAW:                                /* Raw Physical Disk Access */
             r = sim_os_disk_rdsect (uptr, lba, buf, &sread, sects);
             break;
@@ -619,6 +824,11 @@ else { /* Unaligned and/or partial sector transfers */
             if (r == SCPE_OK)
                 sim_buf_swap_data (tbuf, ctx->xfer_element_size, (sread * ctx->sector_size) / ctx->xfer_element_size);
             break;
+        case DKUF_F_SCD:                                /* SCD format */
+            r = sim_scd_disk_rdsect (uptr, tlba, tbuf, &sread, tsects);
+            if (r == SCPE_OK)
+                sim_buf_swap_data (tbuf, ctx->xfer_element_size, (sread * ctx->sector_size) / ctx->xfer_element_size);
+            break;
         case DKUF_F_RAW:                                /* Raw Physical Disk Access */
             r = sim_os_disk_rdsect (uptr, tlba, tbuf, &sread, tsects);
             if (r == SCPE_OK)
@@ -665,6 +875,13 @@ da = ((t_offset)lba) * ctx->sector_size;
 tbc = sects * ctx->sector_size;
 if (sectswritten)
     *sectswritten = 0;
+if ((ctx->fmap_base) &&                                 /* memory mapped */
+    ((da + tbc) <= ctx->fmap_size)) {                   /* and within the mapping? */
+    sim_buf_copy_swapped (ctx->fmap_base + da, buf, ctx->xfer_element_size, tbc/ctx->xfer_element_size);
+    if (sectswritten)
+        *sectswritten = sects;
+    return SCPE_OK;
+    }
 err = sim_fseeko (uptr->fileref, da, SEEK_SET);          /* set pos */
 if (!err) {
     i = sim_fwrite (buf, ctx->xfer_element_size, tbc/ctx->xfer_element_size, uptr->fileref);
@@ -723,6 +940,8 @@ if ((0 == (ctx->sector_size & (ctx->storage_sector_size - 1))) ||   /* Sector Al
         switch (DK_GET_FMT (uptr)) {                            /* case on format */
             case DKUF_F_VHD:                                    /* VHD format */
                 return sim_vhd_disk_wrsect  (uptr, lba, buf, sectswritten, sects);
+            case DKUF_F_SCD:                                    /* SCD format */
+                return sim_scd_disk_wrsect  (uptr, lba, buf, sectswritten, sects);
             case DKUF_F_RAW:                                    /* Raw Physical Disk Access */
                 return sim_os_disk_wrsect  (uptr, lba, buf, sectswritten, sects);
             default:
@@ -738,6 +957,9 @@ if ((0 == (ctx->sector_size & (ctx->storage_sector_size - 1))) ||   /* Sector Al
         case DKUF_F_VHD:                                    /* VHD format */
             r = sim_vhd_disk_wrsect (uptr, lba, tbuf, sectswritten, sects);
             break;
+        case DKUF_F_SCD:                                    /* SCD format */
+            r = sim_scd_disk_wrsect (uptr, lba, tbuf, sectswritten, sects);
+            break;
         case DKUF_F_RAW:                                    /* Raw Physical Disk Access */
             r = sim_os_disk_wrsect (uptr, lba, tbuf, sectswritten, sects);
             break;
@@ -764,6 +986,9 @@ else { /* Unaligned and/or partial sector transfers */
             case DKUF_F_VHD:                                    /* VHD format */
                 sim_vhd_disk_rdsect (uptr, tlba, tbuf, NULL, sspsts);
                 break;
+            case DKUF_F_SCD:                                    /* SCD format */
+                sim_scd_disk_rdsect (uptr, tlba, tbuf, NULL, sspsts);
+                break;
             case DKUF_F_RAW:                                    /* Raw Physical Disk Access */
                 sim_os_disk_rdsect (uptr, tlba, tbuf, NULL, sspsts);
                 break;
@@ -779,6 +1004,11 @@ else { /* Unaligned and/or partial sector transfers */
                                      tbuf + (tsects - sspsts) * ctx->sector_size,
                                      NULL, sspsts);
                 break;
+            case DKUF_F_SCD:                                    /* SCD format */
+                sim_scd_disk_rdsect (uptr, tlba + tsects - sspsts,
+                                     tbuf + (tsects - sspsts) * ctx->sector_size,
+                                     NULL, sspsts);
+                break;
             case DKUF_F_RAW:                                    /* Raw Physical Disk Access */
                 sim_os_disk_rdsect (uptr, tlba + tsects - sspsts,
                                     tbuf + (tsects - sspsts) * ctx->sector_size,
@@ -794,6 +1024,9 @@ else { /* Unaligned and/or partial sector transfers */
         case DKUF_F_VHD:                                    /* VHD format */
             r = sim_vhd_disk_wrsect (uptr, tlba, tbuf, sectswritten, tsects);
             break;
+        case DKUF_F_SCD:                                    /* SCD format */
+            r = sim_scd_disk_wrsect (uptr, tlba, tbuf, sectswritten, tsects);
+            break;
         case DKUF_F_RAW:                                    /* Raw Physical Disk Access */
             r = sim_os_disk_wrsect (uptr, tlba, tbuf, sectswritten, tsects);
             break;
@@ -827,6 +1060,7 @@ struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
 switch (DK_GET_FMT (uptr)) {                            /* case on format */
     case DKUF_F_STD:                                    /* Simh */
     case DKUF_F_VHD:                                    /* VHD format */
+    case DKUF_F_SCD:                                    /* SCD format */
         ctx->media_removed = 1;
         return sim_disk_detach (uptr);
     case DKUF_F_RAW:                                    /* Raw Physical Disk Access */
@@ -845,10 +1079,9 @@ switch (DK_GET_FMT (uptr)) {                            /* case on format */
 static void _sim_disk_io_flush (UNIT *uptr)
 {
 uint32 f = DK_GET_FMT (uptr);
-
-#if defined (SIM_ASYNCH_IO)
 struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
 
+#if defined (SIM_ASYNCH_IO)
 sim_disk_clr_async (uptr);
 if (sim_asynch_enabled)
     sim_disk_set_async (uptr, ctx->asynch_io_latency);
@@ -856,10 +1089,14 @@ if (sim_asynch_enabled)
 switch (f) {                                            /* case on format */
     case DKUF_F_STD:                                    /* Simh */
         fflush (uptr->fileref);
+        sim_fmap_flush (ctx->fmap);
         break;
     case DKUF_F_VHD:                                    /* Virtual Disk */
         sim_vhd_disk_flush (uptr->fileref);
         break;
+    case DKUF_F_SCD:                                    /* Chunked Disk */
+        sim_scd_disk_flush (uptr->fileref);
+        break;
     case DKUF_F_RAW:                                    /* Physical */
         sim_os_disk_flush_raw (uptr->fileref);
         break;
@@ -1517,6 +1754,18 @@ else
 
 switch (DK_GET_FMT (uptr)) {                            /* case on format */
     case DKUF_F_STD:                                    /* SIMH format */
+        if (NULL != (uptr->fileref = sim_scd_disk_open (cptr, "rb"))) {
+            sim_disk_set_fmt (uptr, 0, "SCD", NULL);    /* set file format to SCD */
+            sim_scd_disk_close (uptr->fileref);         /* close scd file*/
+            auto_format = TRUE;
+            uptr->fileref = NULL;
+            open_function = sim_scd_disk_open;
+            create_function = sim_scd_disk_create;
+            size_function = sim_scd_disk_size;
+            break;
+            }
+        if ((errno == EBADF) || (errno == EBUSY))      /* SCD but broken or store being compacted */
+            return SCPE_OPENERR;
         if (NULL == (uptr->fileref = sim_vhd_disk_open (cptr, "rb"))) {
             if (errno == EBADF)                        /* VHD but broken */
                 return SCPE_OPENERR;
@@ -1539,6 +1788,11 @@ switch (DK_GET_FMT (uptr)) {                            /* case on format */
         size_function = sim_os_disk_size_raw;
         storage_function = sim_os_disk_info_raw;
         break;
+    case DKUF_F_SCD:                                    /* SCD format */
+        open_function = sim_scd_disk_open;
+        create_function = sim_scd_disk_create;
+        size_function = sim_scd_disk_size;
+        break;
     default:
         return SCPE_IERR;
     }
@@ -1769,6 +2023,19 @@ if (capac && (capac != (t_offset)-1)) {
         }
     }
 
+if ((sim_switches & SWMASK ('A')) &&                   /* memory map container? */
+    (DKUF_F_STD == DK_GET_FMT (uptr))) {
+    void *base;
+
+    ctx->fmap_size = ((t_offset)uptr->capac)*ctx->capac_factor*((dptr->flags & DEV_SECTORS) ? 512 : 1);
+    if (sim_fmap_open (uptr->fileref, &ctx->fmap_size, (uptr->flags & UNIT_RO) != 0, &ctx->fmap, &base) == SCPE_OK)
+        ctx->fmap_base = (uint8 *)base;
+    else {
+        ctx->fmap_size = 0;
+        sim_messagef (SCPE_OK, "%s%d: can't memory map '%s', using file I/O\n", sim_dname (dptr), (int)(uptr-dptr->units), cptr);
+        }
+    }
+
 #if defined (SIM_ASYNCH_IO)
 sim_disk_set_async (uptr, completion_delay);
 #endif
@@ -1799,6 +2066,9 @@ switch (DK_GET_FMT (uptr)) {                            /* case on format */
     case DKUF_F_VHD:                                    /* Virtual Disk */
         close_function = sim_vhd_disk_close;
         break;
+    case DKUF_F_SCD:                                    /* Chunked Disk */
+        close_function = sim_scd_disk_close;
+        break;
     case DKUF_F_RAW:                                    /* Physical */
         close_function = sim_os_disk_close_raw;
         break;
@@ -1818,11 +2088,16 @@ if (uptr->io_flush)
 
 sim_disk_clr_async (uptr);
 
+sim_fmap_close (ctx->fmap);                             /* release any memory mapping */
+
 uptr->flags &= ~(UNIT_ATT | UNIT_RO);
 uptr->dynflags &= ~(UNIT_NO_FIO | UNIT_DISK_CHK);
 free (uptr->filename);
 uptr->filename = NULL;
 uptr->fileref = NULL;
+#if defined SIM_ASYNCH_IO
+free (ctx->io_retired);
+#endif
 free (uptr->disk_ctx);
 uptr->disk_ctx = NULL;
 uptr->io_flush = NULL;
@@ -1837,14 +2112,18 @@ t_stat sim_disk_attach_help(FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, cons
 {
 fprintf (st, "%s Disk Attach Help\n\n", dptr->name);
 
-fprintf (st, "Disk container files can be one of 3 different types:\n\n");
+fprintf (st, "Disk container files can be one of 4 different types:\n\n");
 fprintf (st, "    SIMH   A disk is an unstructured binary file of the size appropriate\n");
 fprintf (st, "           for the disk drive being simulated\n");
 fprintf (st, "    VHD    Virtual Disk format which is described in the \"Microsoft\n");
 fprintf (st, "           Virtual Hard Disk (VHD) Image Format Specification\".  The\n");
 fprintf (st, "           VHD implementation includes support for 1) Fixed (Preallocated)\n");
 fprintf (st, "           disks, 2) Dynamically Expanding disks, and 3) Differencing disks.\n");
-fprintf (st, "    RAW    platform specific access to physical disk or CDROM drives\n\n");
+fprintf (st, "    RAW    platform specific access to physical disk or CDROM drives\n");
+fprintf (st, "    SCD    Sparse, compressed and deduplicated chunk container.  The container\n");
+fprintf (st, "           file holds only an index of the disk's 64KB chunks; the chunk data\n");
+fprintf (st, "           lives in a shared store directory, so identical chunks of many\n");
+fprintf (st, "           similar disks are stored once.\n\n");
 fprintf (st, "Virtual (VHD) Disks  supported conform to \"Virtual Hard Disk Image Format\n");
 fprintf (st, "Specification\", Version 1.0 October 11, 2006.\n");
 fprintf (st, "Dynamically expanding disks never change their \"Virtual Size\", but they don't\n");
@@ -1856,6 +2135,14 @@ fprintf (st, "which describes the drive size and the simh device type in use whe
 fprintf (st, "was created.  This metadata is therefore available whenever that VHD is\n");
 fprintf (st, "attached to an emulated disk device in the future so the device type and\n");
 fprintf (st, "size can be automatically be configured.\n\n");
+fprintf (st, "SCD Disks keep each distinct chunk as a separate (compressed when zlib is\n");
+fprintf (st, "available) file named by its content hash in the store directory.  The store\n");
+fprintf (st, "is the scd-store directory beside the container unless the SIM_SCD_STORE\n");
+fprintf (st, "environment variable names another when the container is created.  Chunks\n");
+fprintf (st, "are never rewritten in place, so copying an SCD container file creates an\n");
+fprintf (st, "independent copy of the disk which shares all its unchanged data.  Chunks\n");
+fprintf (st, "which are no longer used stay in the store until it is compacted with the\n");
+fprintf (st, "SCD COMPACT command while none of the disks using it is attached.\n\n");
 
 if (0 == (uptr-dptr->units)) {
     if (dptr->numunits > 1) {
@@ -1872,11 +2159,14 @@ else
     fprintf (st, "  sim> ATTACH {switches} %s diskfile\n\n", dptr->name);
 fprintf (st, "\n%s attach command switches\n", dptr->name);
 fprintf (st, "    -R          Attach Read Only.\n");
+fprintf (st, "    -A          Access a SIMH format container through a memory mapping of\n");
+fprintf (st, "                the file rather than with file I/O for each transfer.  The\n");
+fprintf (st, "                container is extended to the full drive size when attached.\n");
 fprintf (st, "    -E          Must Exist (if not specified an attempt to create the indicated\n");
 fprintf (st, "                disk container will be attempted).\n");
 fprintf (st, "    -F          Open the indicated disk container in a specific format (default\n");
-fprintf (st, "                is to autodetect VHD defaulting to simh if the indicated\n");
-fprintf (st, "                container is not a VHD).\n");
+fprintf (st, "                is to autodetect VHD and SCD defaulting to simh if the indicated\n");
+fprintf (st, "                container is neither a VHD nor an SCD).\n");
 fprintf (st, "    -I          Initialize newly created disk so that each sector contains its\n");
 fprintf (st, "                sector address\n");
 fprintf (st, "    -K          Verify that the disk contents contain the sector address in each\n");
@@ -1983,6 +2273,7 @@ if (!(uptr->flags & UNIT_ATTABLE))                      /* not attachable? */
 switch (DK_GET_FMT (uptr)) {                            /* case on format */
     case DKUF_F_STD:                                    /* SIMH format */
     case DKUF_F_VHD:                                    /* VHD format */
+    case DKUF_F_SCD:                                    /* SCD format */
     case DKUF_F_RAW:                                    /* Raw Physical Disk Access */
 #if defined(_WIN32)
         saved_errno = GetLastError ();
@@ -2007,6 +2298,9 @@ switch (DK_GET_FMT (uptr)) {                            /* case on format */
     case DKUF_F_VHD:                                    /* VHD format */
         sim_vhd_disk_clearerr (uptr);
         break;
+    case DKUF_F_SCD:                                    /* SCD format */
+        sim_scd_disk_clearerr (uptr);
+        break;
     default:
         ;
     }
@@ -4593,3 +4887,1345 @@ struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
 return WriteVirtualDiskSectors(hVHD, buf, sects, sectswritten, ctx->sector_size, lba);
 }
 #endif
+
+/* Sparse, compressed, deduplicating chunk container (SCD) support
+
+   An SCD container file holds only a header and a chunk index.  The disk
+   is divided into fixed size chunks and each index entry is the 128 bit
+   content hash of that chunk's data, or all zeros for a chunk which has
+   never held anything but zeros.  The chunk data itself lives in a content
+   addressed store directory with one object file per distinct chunk named
+   by the hex form of its hash.  All containers created in the same
+   directory share a store by default, so the many nearly identical system
+   disks of a simulator farm keep one copy of each common chunk.
+
+   Chunk objects are never modified once written: a changed chunk becomes a
+   new object and the index entry is updated (copy on write).  Nothing is
+   removed from the store while it is in use, so copying a container file
+   safely and cheaply clones a disk, and deleting one never affects another.
+   Objects are compressed with zlib when it is available (HAVE_ZLIB) and
+   stored as is otherwise or when compression doesn't help.
+
+   Objects which no container uses any more are only removed by the SCD
+   COMPACT command, which is given every container using the store.  Each
+   simulator holds a shared lock on the store's "lock" file while it has a
+   container using the store open and compaction needs it exclusively.
+
+   Every write is appended to a journal which follows the index in the
+   container before the write completes, so nothing the guest has written
+   is lost if the simulator dies.  Recently used chunks are held
+   decompressed in a small per unit cache and modified chunks are stored
+   when evicted from it.  The index is rewritten when the unit is flushed
+   (simulator stop), at detach and when the journal gets long: the objects
+   stored since the last rewrite are made durable and a new container file
+   then atomically replaces the old one and its journal.  Opening a
+   container replays its journal onto the chunks of the index, which
+   restores every write completed since the index was last written.  The
+   journal ends at the first record which isn't intact.
+
+   Container header layout (512 bytes, little endian):
+
+        bytes 0-7       "SIMH-SCD"
+        bytes 8-11      version
+        bytes 12-15     chunk size in bytes
+        bytes 16-23     disk size in bytes
+        bytes 24-27     chunk count (index entries)
+        bytes 28-31     reserved
+        bytes 32-287    store directory (relative to the container's
+                        directory unless absolute), NUL terminated
+        bytes 288-511   reserved
+
+   Journal record layout (little endian):
+
+        bytes 0-3       "SCDW"
+        bytes 4-7       data length in bytes
+        bytes 8-15      disk address of the data in bytes
+        bytes 16-23     disk size in bytes
+        bytes 24-31     reserved
+        bytes 32-n      data (padded with zeros to a multiple of 16 bytes)
+        16 bytes        hash of the preceding bytes (detects a torn record)
+
+   Chunk object layout (little endian):
+
+        bytes 0-3       "SCDC"
+        bytes 4-7       storage method (0 stored, 1 zlib)
+        bytes 8-11      chunk data length
+        bytes 12-15     stored data length
+        bytes 16-n      stored data
+*/
+
+#if defined (HAVE_ZLIB)
+#include <zlib.h>
+#endif
+#if defined (_WIN32)
+#include <direct.h>
+#include <process.h>
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#endif
+
+#define SCD_MAGIC           "SIMH-SCD"
+#define SCD_VERSION         1
+#define SCD_HEADER_SIZE     512
+#define SCD_STORE_OFFSET    32
+#define SCD_STORE_SIZE      256
+#define SCD_HASH_SIZE       16                  /* 128 bit content hash */
+#define SCD_CHUNK_SIZE      65536               /* chunk size of new containers */
+#define SCD_MAX_CHUNK_SIZE  (16*1024*1024)
+#define SCD_CACHE_CHUNKS    32                  /* decompressed chunks cached per unit */
+#define SCD_STORE_DEFAULT   "scd-store"
+#define SCD_OBJ_MAGIC       "SCDC"
+#define SCD_OBJ_HEADER_SIZE 16
+#define SCD_OBJ_PATH_SIZE   (PATH_MAX + 2*SCD_HASH_SIZE + 2)
+#define SCD_OBJ_STORED      0                   /* object data stored as is */
+#define SCD_OBJ_ZLIB        1                   /* object data zlib compressed */
+#define SCD_JNL_MAGIC       "SCDW"
+#define SCD_JNL_HEADER_SIZE 32                  /* journal record header size */
+#define SCD_JNL_MAX         (32*1024*1024)      /* journal bytes before the index is rewritten */
+#define SCD_LOCK_BUSY       (-2)                /* store lock held elsewhere */
+
+typedef struct {
+    uint32      Chunk;                          /* chunk number held */
+    t_bool      Dirty;                          /* modified since loaded */
+    t_uint64    LastUse;                        /* cache use stamp (0 when empty) */
+    uint8       *Data;                          /* decompressed chunk data */
+    } SCD_CACHE;
+
+typedef struct {
+    FILE        *File;                          /* container file */
+    t_bool      ReadOnly;
+    char        Path[PATH_MAX+1];               /* container file (absolute when known) */
+    char        StoreName[SCD_STORE_SIZE];      /* store directory as recorded */
+    char        Store[PATH_MAX+1];              /* store directory as opened */
+    t_bool      StoreInUse;                     /* counted in the store's users */
+    uint32      ChunkSize;
+    t_uint64    DiskSize;
+    uint32      ChunkCount;
+    uint8       *Index;                         /* ChunkCount content hashes */
+    t_bool      IndexDirty;
+    t_offset    JournalStart;                   /* start of the write journal */
+    t_offset    JournalEnd;                     /* end of the write journal */
+    uint8       *JnlBuf;                        /* journal record buffer */
+    size_t      JnlBufSize;
+    uint8       *Unsynced;                      /* hashes of objects stored since the index was written */
+    uint32      UnsyncedCount;
+    uint32      UnsyncedSize;
+    t_uint64    UseClock;
+    SCD_CACHE   Cache[SCD_CACHE_CHUNKS];
+    uint8       *ObjBuf;                        /* object (stored form) buffer */
+    uint32      ObjBufSize;
+    uint8       *CmpBuf;                        /* dedup verification buffer */
+    } SCD_DISK;
+
+static t_stat _scd_grow (SCD_DISK *hSCD, t_uint64 size);
+static t_stat _scd_index_write (SCD_DISK *hSCD);
+
+#define SCD_U64(hi, lo)     ((((t_uint64)(hi)) << 32) | (t_uint64)(lo))
+#define SCD_ROTL64(x, r)    (((x) << (r)) | ((x) >> (64 - (r))))
+
+static uint32 _scd_get32 (const uint8 *p)
+{
+return ((uint32)p[0]) | (((uint32)p[1]) << 8) | (((uint32)p[2]) << 16) | (((uint32)p[3]) << 24);
+}
+
+static void _scd_put32 (uint8 *p, uint32 v)
+{
+p[0] = (uint8)v;
+p[1] = (uint8)(v >> 8);
+p[2] = (uint8)(v >> 16);
+p[3] = (uint8)(v >> 24);
+}
+
+static t_uint64 _scd_get64 (const uint8 *p)
+{
+return ((t_uint64)_scd_get32 (p)) | (((t_uint64)_scd_get32 (p + 4)) << 32);
+}
+
+static void _scd_put64 (uint8 *p, t_uint64 v)
+{
+_scd_put32 (p, (uint32)v);
+_scd_put32 (p + 4, (uint32)(v >> 32));
+}
+
+static t_uint64 _scd_fmix64 (t_uint64 k)
+{
+k ^= k >> 33;
+k *= SCD_U64 (0xFF51AFD7, 0xED558CCD);
+k ^= k >> 33;
+k *= SCD_U64 (0xC4CEB9FE, 0x1A85EC53);
+k ^= k >> 33;
+return k;
+}
+
+/* 128 bit MurmurHash3 (x64 variant) of a chunk.  Chunks are whole sectors
+   so the length is always a multiple of the 16 byte block size.  Bytes are
+   loaded little endian so that stores may be shared between hosts. */
+
+static void _scd_hash (const uint8 *data, uint32 len, uint8 *hash)
+{
+const t_uint64 c1 = SCD_U64 (0x87C37B91, 0x114253D5);
+const t_uint64 c2 = SCD_U64 (0x4CF5AD43, 0x2745937F);
+t_uint64 h1 = len;                              /* seed with the length */
+t_uint64 h2 = len;
+uint32 i;
+
+for (i = 0; i + 16 <= len; i += 16) {
+    t_uint64 k1 = _scd_get64 (data + i);
+    t_uint64 k2 = _scd_get64 (data + i + 8);
+
+    k1 *= c1; k1 = SCD_ROTL64 (k1, 31); k1 *= c2; h1 ^= k1;
+    h1 = SCD_ROTL64 (h1, 27); h1 += h2; h1 = h1 * 5 + 0x52DCE729;
+    k2 *= c2; k2 = SCD_ROTL64 (k2, 33); k2 *= c1; h2 ^= k2;
+    h2 = SCD_ROTL64 (h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495AB5;
+    }
+h1 ^= len;
+h2 ^= len;
+h1 += h2;
+h2 += h1;
+h1 = _scd_fmix64 (h1);
+h2 = _scd_fmix64 (h2);
+h1 += h2;
+h2 += h1;
+_scd_put64 (hash, h1);
+_scd_put64 (hash + 8, h2);
+}
+
+static t_bool _scd_is_zero (const uint8 *data, size_t len)
+{
+size_t i;
+
+for (i = 0; i < len; ++i)
+    if (data[i])
+        return FALSE;
+return TRUE;
+}
+
+static const uint8 *_scd_index_entry (SCD_DISK *hSCD, uint32 chunk)
+{
+return hSCD->Index + (size_t)chunk * SCD_HASH_SIZE;
+}
+
+/* Resolve a store directory name relative to the container's directory */
+
+static void _scd_store_path (const char *szSCDPath, const char *StoreName, char *Store, size_t StoreSize)
+{
+size_t dirlen = 0;
+
+if ((StoreName[0] != '/') && (StoreName[0] != '\\') &&
+    ((StoreName[0] == '\0') || (StoreName[1] != ':'))) {/* relative? */
+    size_t i;
+
+    for (i = 0; szSCDPath[i]; ++i)
+        if ((szSCDPath[i] == '/') || (szSCDPath[i] == '\\'))
+            dirlen = i + 1;
+    }
+if (dirlen + strlen (StoreName) >= StoreSize)
+    dirlen = 0;
+memcpy (Store, szSCDPath, dirlen);
+strlcpy (Store + dirlen, StoreName, StoreSize - dirlen);
+}
+
+static void _scd_object_path (SCD_DISK *hSCD, const uint8 *hash, char *path, size_t PathSize)
+{
+char hex[2*SCD_HASH_SIZE+1];
+int i;
+
+for (i = 0; i < SCD_HASH_SIZE; ++i)
+    sprintf (&hex[2*i], "%02x", hash[i]);
+snprintf (path, PathSize, "%s/%s", hSCD->Store, hex);
+}
+
+/* Make a file's contents durable */
+
+static int _scd_sync (FILE *f)
+{
+if (fflush (f) != 0)
+    return -1;
+#if defined (_WIN32)
+return _commit (_fileno (f));
+#else
+return fsync (fileno (f));
+#endif
+}
+
+/* Make renames into a directory durable */
+
+static void _scd_sync_dir (const char *dir)
+{
+#if !defined (_WIN32)
+int fd = open (dir, O_RDONLY);
+
+if (fd >= 0) {
+    (void)fsync (fd);
+    close (fd);
+    }
+#endif
+}
+
+/* Atomically replace a file with a completely written new one */
+
+static int _scd_replace (const char *newpath, const char *path)
+{
+#if defined (_WIN32)
+return MoveFileExA (newpath, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) ? 0 : -1;
+#else
+return rename (newpath, path);
+#endif
+}
+
+/* Lock a store's lock file, shared while the store is in use or exclusively
+   to compact it, without waiting.  The lock is released when the file is
+   closed, so a simulator which dies holding it doesn't wedge the store.
+   Returns the locked file's descriptor, SCD_LOCK_BUSY when the store is
+   locked elsewhere or -1 when there is no usable lock file. */
+
+static int _scd_lock (const char *Store, t_bool exclusive)
+{
+char path[SCD_OBJ_PATH_SIZE];
+int fd;
+
+snprintf (path, sizeof (path), "%s/lock", Store);
+#if defined (_WIN32)
+fd = _open (path, _O_RDWR | _O_CREAT | _O_BINARY, _S_IREAD | _S_IWRITE);
+if ((fd < 0) && !exclusive)
+    fd = _open (path, _O_RDONLY | _O_BINARY);
+if (fd < 0)
+    return -1;
+if (1) {
+    OVERLAPPED ov;
+
+    memset (&ov, 0, sizeof (ov));
+    if (!LockFileEx ((HANDLE)_get_osfhandle (fd), LOCKFILE_FAIL_IMMEDIATELY | (exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0), 0, 1, 0, &ov)) {
+        _close (fd);
+        return SCD_LOCK_BUSY;
+        }
+    }
+#else
+if (1) {
+    struct flock fl;
+
+    fd = open (path, O_RDWR | O_CREAT, 0666);
+    if ((fd < 0) && !exclusive)
+        fd = open (path, O_RDONLY);             /* read only store */
+    if (fd < 0)
+        return -1;
+    memset (&fl, 0, sizeof (fl));
+    fl.l_type = exclusive ? F_WRLCK : F_RDLCK;
+    fl.l_whence = SEEK_SET;
+    while (fcntl (fd, F_SETLK, &fl) != 0)
+        if (errno != EINTR) {
+            close (fd);
+            return SCD_LOCK_BUSY;
+            }
+    }
+#endif
+return fd;
+}
+
+static void _scd_unlock (int fd)
+{
+#if defined (_WIN32)
+OVERLAPPED ov;
+
+memset (&ov, 0, sizeof (ov));
+UnlockFileEx ((HANDLE)_get_osfhandle (fd), 0, 1, 0, &ov);
+_close (fd);
+#else
+close (fd);                                     /* releases the lock */
+#endif
+}
+
+/* The stores this simulator has containers open in.  Record locks belong
+   to the process, and closing any descriptor for a file drops all of its
+   locks there, so every container using a store shares one lock. */
+
+typedef struct SCD_STORE_USE {
+    char        Store[PATH_MAX+1];
+    int         LockFd;                         /* shared lock (-1 if the store has no lock file) */
+    uint32      Users;                          /* open containers using it */
+    struct SCD_STORE_USE *Next;
+    } SCD_STORE_USE;
+
+static SCD_STORE_USE *scd_store_uses = NULL;
+
+static SCD_STORE_USE *_scd_store_find (const char *Store)
+{
+SCD_STORE_USE *use;
+
+for (use = scd_store_uses; use != NULL; use = use->Next)
+    if (0 == strcmp (use->Store, Store))
+        break;
+return use;
+}
+
+/* Note that a container uses its store, which fails while the store is
+   being compacted */
+
+static t_stat _scd_store_use (SCD_DISK *hSCD)
+{
+SCD_STORE_USE *use = _scd_store_find (hSCD->Store);
+
+if (use == NULL) {
+    int fd = _scd_lock (hSCD->Store, FALSE);
+
+    if (fd == SCD_LOCK_BUSY)
+        return SCPE_IOERR;
+    use = (SCD_STORE_USE *)calloc (1, sizeof (*use));
+    if (use == NULL) {
+        if (fd >= 0)
+            _scd_unlock (fd);
+        return SCPE_MEM;
+        }
+    strlcpy (use->Store, hSCD->Store, sizeof (use->Store));
+    use->LockFd = fd;
+    use->Next = scd_store_uses;
+    scd_store_uses = use;
+    }
+++use->Users;
+hSCD->StoreInUse = TRUE;
+return SCPE_OK;
+}
+
+static void _scd_store_unuse (SCD_DISK *hSCD)
+{
+SCD_STORE_USE **link = &scd_store_uses;
+
+if (!hSCD->StoreInUse)
+    return;
+hSCD->StoreInUse = FALSE;
+while ((*link != NULL) && (0 != strcmp ((*link)->Store, hSCD->Store)))
+    link = &(*link)->Next;
+if ((*link != NULL) && (--(*link)->Users == 0)) {
+    SCD_STORE_USE *use = *link;
+
+    *link = use->Next;
+    if (use->LockFd >= 0)
+        _scd_unlock (use->LockFd);
+    free (use);
+    }
+}
+
+/* Note an object stored since the index was last written.  It is made
+   durable before the next index which may use it is written. */
+
+static t_stat _scd_unsynced_add (SCD_DISK *hSCD, const uint8 *hash)
+{
+if (hSCD->UnsyncedCount == hSCD->UnsyncedSize) {
+    uint32 size = hSCD->UnsyncedSize ? 2 * hSCD->UnsyncedSize : 64;
+    uint8 *Unsynced = (uint8 *)realloc (hSCD->Unsynced, (size_t)size * SCD_HASH_SIZE);
+
+    if (Unsynced == NULL)
+        return SCPE_MEM;
+    hSCD->Unsynced = Unsynced;
+    hSCD->UnsyncedSize = size;
+    }
+memcpy (hSCD->Unsynced + (size_t)hSCD->UnsyncedCount * SCD_HASH_SIZE, hash, SCD_HASH_SIZE);
+++hSCD->UnsyncedCount;
+return SCPE_OK;
+}
+
+/* Make the objects stored since the index was last written durable */
+
+static t_stat _scd_unsynced_sync (SCD_DISK *hSCD)
+{
+char path[SCD_OBJ_PATH_SIZE];
+uint32 i;
+
+for (i = 0; i < hSCD->UnsyncedCount; ++i) {
+    FILE *f;
+    int r;
+
+    _scd_object_path (hSCD, hSCD->Unsynced + (size_t)i * SCD_HASH_SIZE, path, sizeof (path));
+    f = fopen (path, "rb+");
+    if (f == NULL)
+        return SCPE_IOERR;
+    r = _scd_sync (f);
+    fclose (f);
+    if (r != 0)
+        return SCPE_IOERR;
+    }
+if (hSCD->UnsyncedCount != 0)
+    _scd_sync_dir (hSCD->Store);
+hSCD->UnsyncedCount = 0;
+return SCPE_OK;
+}
+
+/* Read and expand an object into a chunk buffer */
+
+static t_stat _scd_object_read (SCD_DISK *hSCD, FILE *f, uint8 *data)
+{
+uint8 header[SCD_OBJ_HEADER_SIZE];
+uint32 length, stored;
+
+if ((fread (header, 1, sizeof (header), f) != sizeof (header)) ||
+    (memcmp (header, SCD_OBJ_MAGIC, 4) != 0))
+    return SCPE_IOERR;
+length = _scd_get32 (header + 8);
+stored = _scd_get32 (header + 12);
+if ((length != hSCD->ChunkSize) || (stored > hSCD->ObjBufSize))
+    return SCPE_IOERR;
+switch (_scd_get32 (header + 4)) {
+    case SCD_OBJ_STORED:
+        if ((stored != length) ||
+            (fread (data, 1, length, f) != length))
+            return SCPE_IOERR;
+        return SCPE_OK;
+#if defined (HAVE_ZLIB)
+    case SCD_OBJ_ZLIB:
+        {
+        uLongf datalen = length;
+
+        if ((fread (hSCD->ObjBuf, 1, stored, f) != stored) ||
+            (uncompress (data, &datalen, hSCD->ObjBuf, stored) != Z_OK) ||
+            (datalen != length))
+            return SCPE_IOERR;
+        }
+        return SCPE_OK;
+#endif
+    default:                                    /* unknown (or zlib not available) */
+        return SCPE_IOERR;
+    }
+}
+
+/* Add a chunk's object to the store if it isn't already there.  An object
+   already present with the same hash is compared with the data before
+   being shared.  New objects appear in the store only once completely
+   written, and are made durable before the next index is written. */
+
+static t_stat _scd_object_put (SCD_DISK *hSCD, const uint8 *hash, const uint8 *data)
+{
+static uint32 seq = 0;
+char path[SCD_OBJ_PATH_SIZE], tmppath[SCD_OBJ_PATH_SIZE+32];
+uint32 method = SCD_OBJ_STORED;
+uint32 stored = hSCD->ChunkSize;
+size_t objsize;
+FILE *f;
+
+_scd_object_path (hSCD, hash, path, sizeof (path));
+f = fopen (path, "rb");
+if (f != NULL) {                                /* already stored? */
+    t_stat r = _scd_object_read (hSCD, f, hSCD->CmpBuf);
+
+    fclose (f);
+    if ((r == SCPE_OK) &&
+        (0 == memcmp (hSCD->CmpBuf, data, hSCD->ChunkSize)))
+        return _scd_unsynced_add (hSCD, hash);  /* shared (maybe not yet durable) */
+    return SCPE_IOERR;                          /* damaged object or hash collision */
+    }
+#if defined (HAVE_ZLIB)
+if (1) {
+    uLongf complen = (uLongf)(hSCD->ObjBufSize - SCD_OBJ_HEADER_SIZE);
+
+    if ((compress2 (hSCD->ObjBuf + SCD_OBJ_HEADER_SIZE, &complen, data, hSCD->ChunkSize, Z_BEST_SPEED) == Z_OK) &&
+        (complen < hSCD->ChunkSize)) {
+        method = SCD_OBJ_ZLIB;
+        stored = (uint32)complen;
+        }
+    }
+#endif
+if (method == SCD_OBJ_STORED)
+    memcpy (hSCD->ObjBuf + SCD_OBJ_HEADER_SIZE, data, stored);
+memcpy (hSCD->ObjBuf, SCD_OBJ_MAGIC, 4);
+_scd_put32 (hSCD->ObjBuf + 4, method);
+_scd_put32 (hSCD->ObjBuf + 8, hSCD->ChunkSize);
+_scd_put32 (hSCD->ObjBuf + 12, stored);
+objsize = SCD_OBJ_HEADER_SIZE + stored;
+/* Objects appear in the store only once completely written */
+sprintf (tmppath, "%s.%d-%u.tmp", path, (int)getpid (), (unsigned int)++seq);
+f = fopen (tmppath, "wb");
+if (f == NULL)
+    return SCPE_IOERR;
+if (fwrite (hSCD->ObjBuf, 1, objsize, f) != objsize) {
+    fclose (f);
+    remove (tmppath);
+    return SCPE_IOERR;
+    }
+if ((fclose (f) != 0) ||
+    (_scd_replace (tmppath, path) != 0)) {
+    remove (tmppath);
+    return SCPE_IOERR;
+    }
+return _scd_unsynced_add (hSCD, hash);
+}
+
+/* Record a write in the container's journal.  The record is handed to the
+   host before the write completes, and reaches stable storage at the
+   latest when the index is next written. */
+
+static t_stat _scd_journal_append (SCD_DISK *hSCD, t_uint64 addr, const uint8 *data, uint32 len)
+{
+uint32 padded = (len + 15) & ~15;
+size_t recsize = SCD_JNL_HEADER_SIZE + (size_t)padded + SCD_HASH_SIZE;
+uint8 *rec;
+
+if (hSCD->File == NULL)
+    return SCPE_IOERR;
+if (recsize > hSCD->JnlBufSize) {
+    uint8 *JnlBuf = (uint8 *)realloc (hSCD->JnlBuf, recsize);
+
+    if (JnlBuf == NULL)
+        return SCPE_MEM;
+    hSCD->JnlBuf = JnlBuf;
+    hSCD->JnlBufSize = recsize;
+    }
+rec = hSCD->JnlBuf;
+memset (rec, 0, SCD_JNL_HEADER_SIZE);
+memcpy (rec, SCD_JNL_MAGIC, 4);
+_scd_put32 (rec + 4, len);
+_scd_put64 (rec + 8, addr);
+_scd_put64 (rec + 16, hSCD->DiskSize);
+memcpy (rec + SCD_JNL_HEADER_SIZE, data, len);
+memset (rec + SCD_JNL_HEADER_SIZE + len, 0, padded - len);
+_scd_hash (rec, SCD_JNL_HEADER_SIZE + padded, rec + SCD_JNL_HEADER_SIZE + padded);
+if ((sim_fseeko (hSCD->File, hSCD->JournalEnd, SEEK_SET) != 0) ||
+    (fwrite (rec, 1, recsize, hSCD->File) != recsize) ||
+    (fflush (hSCD->File) != 0))
+    return SCPE_IOERR;
+hSCD->JournalEnd += recsize;
+hSCD->IndexDirty = TRUE;
+return SCPE_OK;
+}
+
+static t_stat _scd_chunk_read (SCD_DISK *hSCD, uint32 chunk, uint8 *data)
+{
+const uint8 *hash;
+char path[SCD_OBJ_PATH_SIZE];
+FILE *f;
+t_stat r;
+
+if (chunk >= hSCD->ChunkCount)
+    hash = NULL;
+else
+    hash = _scd_index_entry (hSCD, chunk);
+if ((hash == NULL) || _scd_is_zero (hash, SCD_HASH_SIZE)) {
+    memset (data, 0, hSCD->ChunkSize);          /* never written */
+    return SCPE_OK;
+    }
+_scd_object_path (hSCD, hash, path, sizeof (path));
+f = fopen (path, "rb");
+if (f == NULL)
+    return SCPE_IOERR;
+r = _scd_object_read (hSCD, f, data);
+fclose (f);
+return r;
+}
+
+/* Store a modified cached chunk and point the index at it */
+
+static t_stat _scd_chunk_write (SCD_DISK *hSCD, SCD_CACHE *c)
+{
+uint8 hash[SCD_HASH_SIZE];
+uint8 *entry = (uint8 *)_scd_index_entry (hSCD, c->Chunk);
+
+if (_scd_is_zero (c->Data, hSCD->ChunkSize))
+    memset (hash, 0, sizeof (hash));            /* sparse */
+else
+    _scd_hash (c->Data, hSCD->ChunkSize, hash);
+if (0 != memcmp (entry, hash, SCD_HASH_SIZE)) {
+    if ((!_scd_is_zero (hash, SCD_HASH_SIZE)) &&
+        (SCPE_OK != _scd_object_put (hSCD, hash, c->Data)))
+        return SCPE_IOERR;
+    memcpy (entry, hash, SCD_HASH_SIZE);
+    hSCD->IndexDirty = TRUE;
+    }
+c->Dirty = FALSE;
+return SCPE_OK;
+}
+
+/* Locate a chunk in the cache, evicting the least recently used entry to
+   make room for it when necessary.  The chunk's current contents are only
+   read when load is TRUE (i.e. when it won't be completely overwritten). */
+
+static SCD_CACHE *_scd_cache_get (SCD_DISK *hSCD, uint32 chunk, t_bool load)
+{
+SCD_CACHE *c = &hSCD->Cache[0];
+int i;
+
+for (i = 0; i < SCD_CACHE_CHUNKS; ++i) {
+    SCD_CACHE *e = &hSCD->Cache[i];
+
+    if ((e->LastUse != 0) && (e->Chunk == chunk)) {
+        e->LastUse = ++hSCD->UseClock;
+        return e;
+        }
+    if (e->LastUse < c->LastUse)
+        c = e;
+    }
+if (c->Dirty && (SCPE_OK != _scd_chunk_write (hSCD, c)))
+    return NULL;
+c->LastUse = 0;
+if ((c->Data == NULL) &&
+    (NULL == (c->Data = (uint8 *)malloc (hSCD->ChunkSize))))
+    return NULL;
+if (load && (SCPE_OK != _scd_chunk_read (hSCD, chunk, c->Data)))
+    return NULL;
+c->Chunk = chunk;
+c->LastUse = ++hSCD->UseClock;
+return c;
+}
+
+static t_stat _scd_grow (SCD_DISK *hSCD, t_uint64 size)
+{
+t_uint64 count = (size + hSCD->ChunkSize - 1) / hSCD->ChunkSize;
+
+if (count > 0xFFFFFFFF)
+    return SCPE_IOERR;
+if (count > hSCD->ChunkCount) {
+    uint8 *Index = (uint8 *)realloc (hSCD->Index, (size_t)count * SCD_HASH_SIZE);
+
+    if (Index == NULL)
+        return SCPE_MEM;
+    memset (Index + (size_t)hSCD->ChunkCount * SCD_HASH_SIZE, 0, (size_t)(count - hSCD->ChunkCount) * SCD_HASH_SIZE);
+    hSCD->Index = Index;
+    hSCD->ChunkCount = (uint32)count;
+    }
+if (size > hSCD->DiskSize)
+    hSCD->DiskSize = size;
+hSCD->IndexDirty = TRUE;
+return SCPE_OK;
+}
+
+/* TRUE if a chunk has never held anything but zeros */
+
+static t_bool _scd_chunk_sparse (SCD_DISK *hSCD, uint32 chunk)
+{
+int i;
+
+if ((chunk < hSCD->ChunkCount) &&
+    (!_scd_is_zero (_scd_index_entry (hSCD, chunk), SCD_HASH_SIZE)))
+    return FALSE;
+for (i = 0; i < SCD_CACHE_CHUNKS; ++i)          /* unless modified in the cache */
+    if ((hSCD->Cache[i].LastUse != 0) && (hSCD->Cache[i].Chunk == chunk))
+        return FALSE;
+return TRUE;
+}
+
+/* Apply a write to the cached chunks */
+
+static t_stat _scd_chunks_update (SCD_DISK *hSCD, t_uint64 addr, const uint8 *data, size_t bytes)
+{
+size_t done = 0;
+
+while (done < bytes) {
+    uint32 chunk = (uint32)((addr + done) / hSCD->ChunkSize);
+    uint32 offset = (uint32)((addr + done) % hSCD->ChunkSize);
+    size_t size = hSCD->ChunkSize - offset;
+    SCD_CACHE *c;
+
+    if (size > bytes - done)
+        size = bytes - done;
+    c = _scd_cache_get (hSCD, chunk, (size != hSCD->ChunkSize));
+    if (c == NULL)
+        return SCPE_IOERR;
+    memcpy (c->Data + offset, data + done, size);
+    c->Dirty = TRUE;
+    done += size;
+    }
+return SCPE_OK;
+}
+
+/* Replay the journal onto the index read at open.  The journal ends at
+   the first record which isn't intact (one being written at a crash). */
+
+static t_stat _scd_journal_replay (SCD_DISK *hSCD)
+{
+uint8 header[SCD_JNL_HEADER_SIZE], check[SCD_HASH_SIZE];
+
+hSCD->JournalStart = SCD_HEADER_SIZE + (t_offset)hSCD->ChunkCount * SCD_HASH_SIZE;
+hSCD->JournalEnd = hSCD->JournalStart;
+while (1) {
+    uint32 len, padded;
+    t_uint64 addr, size;
+    size_t recsize;
+
+    if ((sim_fseeko (hSCD->File, hSCD->JournalEnd, SEEK_SET) != 0) ||
+        (fread (header, 1, sizeof (header), hSCD->File) != sizeof (header)) ||
+        (memcmp (header, SCD_JNL_MAGIC, 4) != 0))
+        break;
+    len = _scd_get32 (header + 4);
+    addr = _scd_get64 (header + 8);
+    size = _scd_get64 (header + 16);
+    if ((len == 0) || (addr > size) || (len > size - addr))
+        break;
+    padded = (len + 15) & ~15;
+    recsize = SCD_JNL_HEADER_SIZE + (size_t)padded + SCD_HASH_SIZE;
+    if (recsize > hSCD->JnlBufSize) {
+        uint8 *JnlBuf = (uint8 *)realloc (hSCD->JnlBuf, recsize);
+
+        if (JnlBuf == NULL)
+            return SCPE_MEM;
+        hSCD->JnlBuf = JnlBuf;
+        hSCD->JnlBufSize = recsize;
+        }
+    memcpy (hSCD->JnlBuf, header, sizeof (header));
+    if (fread (hSCD->JnlBuf + SCD_JNL_HEADER_SIZE, 1, padded + SCD_HASH_SIZE, hSCD->File) != padded + SCD_HASH_SIZE)
+        break;
+    _scd_hash (hSCD->JnlBuf, SCD_JNL_HEADER_SIZE + padded, check);
+    if (memcmp (hSCD->JnlBuf + SCD_JNL_HEADER_SIZE + padded, check, SCD_HASH_SIZE) != 0)
+        break;
+    if ((size > hSCD->DiskSize) &&
+        (SCPE_OK != _scd_grow (hSCD, size)))
+        return SCPE_IOERR;
+    if (SCPE_OK != _scd_chunks_update (hSCD, addr, hSCD->JnlBuf + SCD_JNL_HEADER_SIZE, len))
+        return SCPE_IOERR;
+    hSCD->JournalEnd += recsize;
+    }
+return SCPE_OK;
+}
+
+static void _scd_header_build (SCD_DISK *hSCD, uint8 *header)
+{
+memset (header, 0, SCD_HEADER_SIZE);
+memcpy (header, SCD_MAGIC, 8);
+_scd_put32 (header + 8, SCD_VERSION);
+_scd_put32 (header + 12, hSCD->ChunkSize);
+_scd_put64 (header + 16, hSCD->DiskSize);
+_scd_put32 (header + 24, hSCD->ChunkCount);
+strlcpy ((char *)header + SCD_STORE_OFFSET, hSCD->StoreName, SCD_STORE_SIZE);
+}
+
+/* Write the index into a new container file which then replaces the old
+   one (and its journal).  Every modified chunk must have been stored. */
+
+static t_stat _scd_index_write (SCD_DISK *hSCD)
+{
+uint8 header[SCD_HEADER_SIZE];
+char tmppath[PATH_MAX+16], dir[PATH_MAX+1];
+size_t IndexSize = (size_t)hSCD->ChunkCount * SCD_HASH_SIZE;
+FILE *f;
+
+if (SCPE_OK != _scd_unsynced_sync (hSCD))
+    return SCPE_IOERR;
+snprintf (tmppath, sizeof (tmppath), "%s.tmp", hSCD->Path);
+f = sim_fopen (tmppath, "wb");
+if (f == NULL)
+    return SCPE_IOERR;
+_scd_header_build (hSCD, header);
+if ((fwrite (header, 1, sizeof (header), f) != sizeof (header)) ||
+    (fwrite (hSCD->Index, 1, IndexSize, f) != IndexSize) ||
+    (_scd_sync (f) != 0)) {
+    fclose (f);
+    remove (tmppath);
+    return SCPE_IOERR;
+    }
+if (fclose (f) != 0) {
+    remove (tmppath);
+    return SCPE_IOERR;
+    }
+if (hSCD->File != NULL)                         /* an open file can't be replaced everywhere */
+    fclose (hSCD->File);
+if (_scd_replace (tmppath, hSCD->Path) != 0) {
+    remove (tmppath);
+    hSCD->File = sim_fopen (hSCD->Path, "rb+");
+    return SCPE_IOERR;
+    }
+_scd_store_path (hSCD->Path, ".", dir, sizeof (dir));
+_scd_sync_dir (dir);
+hSCD->File = sim_fopen (hSCD->Path, "rb+");
+if (hSCD->File == NULL)
+    return SCPE_IOERR;
+hSCD->IndexDirty = FALSE;
+hSCD->JournalStart = SCD_HEADER_SIZE + (t_offset)IndexSize;
+hSCD->JournalEnd = hSCD->JournalStart;
+return SCPE_OK;
+}
+
+static t_stat _scd_flush (SCD_DISK *hSCD)
+{
+t_stat r = SCPE_OK;
+int i;
+
+if (hSCD->ReadOnly)
+    return SCPE_OK;
+for (i = 0; i < SCD_CACHE_CHUNKS; ++i)
+    if (hSCD->Cache[i].Dirty && (SCPE_OK != _scd_chunk_write (hSCD, &hSCD->Cache[i])))
+        r = SCPE_IOERR;
+if (hSCD->IndexDirty && (SCPE_OK != _scd_index_write (hSCD)))
+    r = SCPE_IOERR;
+return r;
+}
+
+static FILE *sim_scd_disk_open (const char *szSCDPath, const char *DesiredAccess)
+{
+uint8 header[SCD_HEADER_SIZE];
+SCD_DISK *hSCD;
+size_t IndexSize;
+FILE *File;
+
+File = sim_fopen (szSCDPath, DesiredAccess);
+if (File == NULL)
+    return NULL;
+if ((fread (header, 1, sizeof (header), File) != sizeof (header)) ||
+    (memcmp (header, SCD_MAGIC, 8) != 0)) {
+    fclose (File);
+    errno = EINVAL;                             /* Not an SCD container */
+    return NULL;
+    }
+hSCD = (SCD_DISK *)calloc (1, sizeof (*hSCD));
+if (hSCD == NULL) {
+    fclose (File);
+    errno = ENOMEM;
+    return NULL;
+    }
+hSCD->File = File;
+hSCD->ReadOnly = (strchr (DesiredAccess, '+') == NULL);
+#if defined (_WIN32)
+if (_fullpath (hSCD->Path, szSCDPath, sizeof (hSCD->Path)) == NULL)
+#else
+if (realpath (szSCDPath, hSCD->Path) == NULL)
+#endif
+    strlcpy (hSCD->Path, szSCDPath, sizeof (hSCD->Path));
+hSCD->ChunkSize = _scd_get32 (header + 12);
+hSCD->DiskSize = _scd_get64 (header + 16);
+hSCD->ChunkCount = _scd_get32 (header + 24);
+strlcpy (hSCD->StoreName, (char *)header + SCD_STORE_OFFSET, sizeof (hSCD->StoreName));
+if ((_scd_get32 (header + 8) != SCD_VERSION) ||
+    (hSCD->ChunkSize == 0) ||
+    (hSCD->ChunkSize > SCD_MAX_CHUNK_SIZE) ||
+    (hSCD->ChunkSize % 512) ||
+    (hSCD->ChunkCount != (hSCD->DiskSize + hSCD->ChunkSize - 1) / hSCD->ChunkSize))
+    goto Corrupt;
+_scd_store_path (hSCD->Path, hSCD->StoreName, hSCD->Store, sizeof (hSCD->Store));
+if (1) {                                        /* name each store the same way */
+    char Store[PATH_MAX+1];
+
+#if defined (_WIN32)
+    if (_fullpath (Store, hSCD->Store, sizeof (Store)) != NULL)
+#else
+    if (realpath (hSCD->Store, Store) != NULL)
+#endif
+        strlcpy (hSCD->Store, Store, sizeof (hSCD->Store));
+    }
+IndexSize = (size_t)hSCD->ChunkCount * SCD_HASH_SIZE;
+hSCD->ObjBufSize = hSCD->ChunkSize;
+#if defined (HAVE_ZLIB)
+hSCD->ObjBufSize = (uint32)compressBound (hSCD->ChunkSize);
+#endif
+hSCD->ObjBufSize += SCD_OBJ_HEADER_SIZE;
+hSCD->Index = (uint8 *)malloc (IndexSize ? IndexSize : 1);
+hSCD->ObjBuf = (uint8 *)malloc (hSCD->ObjBufSize);
+hSCD->CmpBuf = (uint8 *)malloc (hSCD->ChunkSize);
+if ((hSCD->Index == NULL) || (hSCD->ObjBuf == NULL) || (hSCD->CmpBuf == NULL)) {
+    sim_scd_disk_close ((FILE *)hSCD);
+    errno = ENOMEM;
+    return NULL;
+    }
+if (SCPE_OK != _scd_store_use (hSCD)) {
+    sim_scd_disk_close ((FILE *)hSCD);
+    errno = EBUSY;                              /* store being compacted */
+    return NULL;
+    }
+if ((fread (hSCD->Index, 1, IndexSize, File) != IndexSize) ||
+    (SCPE_OK != _scd_journal_replay (hSCD)))
+    goto Corrupt;
+if ((!hSCD->ReadOnly) &&                        /* recovered writes or a torn record? */
+    ((hSCD->JournalEnd != hSCD->JournalStart) || (sim_fsize_ex (File) != hSCD->JournalEnd))) {
+    hSCD->IndexDirty = TRUE;
+    if (SCPE_OK != _scd_flush (hSCD)) {         /* make them part of the index */
+        hSCD->ReadOnly = TRUE;                  /* the journal still has them */
+        sim_scd_disk_close ((FILE *)hSCD);
+        errno = EACCES;                         /* store not usable */
+        return NULL;
+        }
+    }
+return (FILE *)hSCD;
+
+Corrupt:
+hSCD->ReadOnly = TRUE;                          /* leave the container as it is */
+sim_scd_disk_close ((FILE *)hSCD);
+errno = EBADF;                                  /* SCD container but broken */
+return NULL;
+}
+
+static FILE *sim_scd_disk_create (const char *szSCDPath, t_offset desiredsize)
+{
+uint8 header[SCD_HEADER_SIZE];
+uint8 zeros[SCD_HASH_SIZE * 64];
+const char *StoreName = getenv ("SIM_SCD_STORE");
+char Store[PATH_MAX+1];
+SCD_DISK scd;
+uint32 i;
+FILE *File;
+
+File = sim_fopen (szSCDPath, "rb");
+if (File != NULL) {
+    fclose (File);
+    errno = EEXIST;
+    return NULL;
+    }
+memset (&scd, 0, sizeof (scd));
+scd.ChunkSize = SCD_CHUNK_SIZE;
+scd.DiskSize = (t_uint64)desiredsize;
+scd.ChunkCount = (uint32)((scd.DiskSize + scd.ChunkSize - 1) / scd.ChunkSize);
+if ((StoreName == NULL) || (*StoreName == '\0'))
+    StoreName = SCD_STORE_DEFAULT;
+if (strlen (StoreName) >= sizeof (scd.StoreName)) {
+    errno = ENAMETOOLONG;
+    return NULL;
+    }
+strlcpy (scd.StoreName, StoreName, sizeof (scd.StoreName));
+_scd_store_path (szSCDPath, scd.StoreName, Store, sizeof (Store));
+#if defined (_WIN32)
+(void)_mkdir (Store);                           /* may already exist and be shared */
+#else
+(void)mkdir (Store, 0777);                      /* may already exist and be shared */
+#endif
+File = sim_fopen (szSCDPath, "wb");
+if (File == NULL)
+    return NULL;
+_scd_header_build (&scd, header);
+memset (zeros, 0, sizeof (zeros));
+if (fwrite (header, 1, sizeof (header), File) != sizeof (header))
+    goto Error;
+for (i = 0; i < scd.ChunkCount; i += 64) {
+    size_t entries = ((scd.ChunkCount - i) < 64) ? (scd.ChunkCount - i) : 64;
+
+    if (fwrite (zeros, SCD_HASH_SIZE, entries, File) != entries)
+        goto Error;
+    }
+if (fclose (File) != 0) {
+    remove (szSCDPath);
+    return NULL;
+    }
+return sim_scd_disk_open (szSCDPath, "rb+");
+
+Error:
+fclose (File);
+remove (szSCDPath);
+return NULL;
+}
+
+static int sim_scd_disk_close (FILE *f)
+{
+SCD_DISK *hSCD = (SCD_DISK *)f;
+int i;
+
+if (NULL == hSCD)
+    return -1;
+if (hSCD->Index)
+    _scd_flush (hSCD);
+for (i = 0; i < SCD_CACHE_CHUNKS; ++i)
+    free (hSCD->Cache[i].Data);
+free (hSCD->Index);
+free (hSCD->ObjBuf);
+free (hSCD->CmpBuf);
+free (hSCD->JnlBuf);
+free (hSCD->Unsynced);
+if (hSCD->File != NULL)
+    fclose (hSCD->File);
+_scd_store_unuse (hSCD);
+free (hSCD);
+return 0;
+}
+
+static void sim_scd_disk_flush (FILE *f)
+{
+SCD_DISK *hSCD = (SCD_DISK *)f;
+
+if (NULL != hSCD)
+    _scd_flush (hSCD);
+}
+
+static t_offset sim_scd_disk_size (FILE *f)
+{
+SCD_DISK *hSCD = (SCD_DISK *)f;
+
+return (t_offset)hSCD->DiskSize;
+}
+
+static t_stat sim_scd_disk_clearerr (UNIT *uptr)
+{
+SCD_DISK *hSCD = (SCD_DISK *)uptr->fileref;
+
+if (hSCD->File != NULL)
+    clearerr (hSCD->File);
+return SCPE_OK;
+}
+
+static t_stat sim_scd_disk_rdsect (UNIT *uptr, t_lba lba, uint8 *buf, t_seccnt *sectsread, t_seccnt sects)
+{
+SCD_DISK *hSCD = (SCD_DISK *)uptr->fileref;
+struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
+t_uint64 addr = (t_uint64)lba * ctx->sector_size;
+size_t bytes = (size_t)sects * ctx->sector_size;
+size_t done = 0;
+
+while (done < bytes) {
+    uint32 chunk = (uint32)((addr + done) / hSCD->ChunkSize);
+    uint32 offset = (uint32)((addr + done) % hSCD->ChunkSize);
+    size_t size = hSCD->ChunkSize - offset;
+    SCD_CACHE *c;
+
+    if (size > bytes - done)
+        size = bytes - done;
+    if (_scd_chunk_sparse (hSCD, chunk)) {      /* beyond end or never written? */
+        memset (buf + done, 0, size);
+        done += size;
+        continue;
+        }
+    c = _scd_cache_get (hSCD, chunk, TRUE);
+    if (c == NULL) {
+        if (sectsread)
+            *sectsread = (t_seccnt)(done / ctx->sector_size);
+        return SCPE_IOERR;
+        }
+    memcpy (buf + done, c->Data + offset, size);
+    done += size;
+    }
+if (sectsread)
+    *sectsread = sects;
+return SCPE_OK;
+}
+
+static t_stat sim_scd_disk_wrsect (UNIT *uptr, t_lba lba, uint8 *buf, t_seccnt *sectswritten, t_seccnt sects)
+{
+SCD_DISK *hSCD = (SCD_DISK *)uptr->fileref;
+struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
+t_uint64 addr = (t_uint64)lba * ctx->sector_size;
+size_t bytes = (size_t)sects * ctx->sector_size;
+uint32 chunk;
+
+if (sectswritten)
+    *sectswritten = 0;
+if (hSCD->ReadOnly)
+    return SCPE_IOERR;
+if (_scd_is_zero (buf, bytes)) {                /* zeros (as when a disk is created)? */
+    for (chunk = (uint32)(addr / hSCD->ChunkSize); (t_uint64)chunk * hSCD->ChunkSize < addr + bytes; ++chunk)
+        if (!_scd_chunk_sparse (hSCD, chunk))
+            break;
+    if ((t_uint64)chunk * hSCD->ChunkSize >= addr + bytes) {/* onto chunks which are all zeros? */
+        if (sectswritten)
+            *sectswritten = sects;
+        return SCPE_OK;                         /* nothing changes */
+        }
+    }
+if ((addr + bytes > hSCD->DiskSize) &&
+    (SCPE_OK != _scd_grow (hSCD, addr + bytes)))
+    return SCPE_IOERR;
+if ((SCPE_OK != _scd_journal_append (hSCD, addr, buf, (uint32)bytes)) ||
+    (SCPE_OK != _scd_chunks_update (hSCD, addr, buf, bytes)))
+    return SCPE_IOERR;
+if (sectswritten)
+    *sectswritten = sects;
+if ((hSCD->JournalEnd - hSCD->JournalStart > SCD_JNL_MAX) &&
+    (SCPE_OK != _scd_flush (hSCD)))
+    return SCPE_IOERR;
+return SCPE_OK;
+}
+
+/* Compaction of an SCD store */
+
+typedef struct {
+    char        Store[PATH_MAX+1];              /* store being compacted */
+    uint8       *Used;                          /* sorted hashes of the objects in use */
+    size_t      UsedCount;
+    size_t      UsedSize;
+    uint32      Kept;
+    uint32      Removed;
+    t_offset    Freed;
+    } SCD_COMPACT;
+
+static int _scd_hash_cmp (const void *a, const void *b)
+{
+return memcmp (a, b, SCD_HASH_SIZE);
+}
+
+/* Add the objects a container's index uses to those in use.  Only the
+   index counts: its journal is replayed onto the indexed chunks when the
+   container is next opened, which stores whatever objects it needs. */
+
+static t_stat _scd_compact_container (SCD_COMPACT *ctx, const char *szSCDPath)
+{
+uint8 header[SCD_HEADER_SIZE];
+SCD_DISK scd;
+char Store[PATH_MAX+1];
+uint32 i;
+FILE *File;
+
+memset (&scd, 0, sizeof (scd));
+File = sim_fopen (szSCDPath, "rb");
+if (File == NULL)
+    return sim_messagef (SCPE_OPENERR, "Can't open %s: %s\n", szSCDPath, strerror (errno));
+#if defined (_WIN32)
+if (_fullpath (scd.Path, szSCDPath, sizeof (scd.Path)) == NULL)
+#else
+if (realpath (szSCDPath, scd.Path) == NULL)
+#endif
+    strlcpy (scd.Path, szSCDPath, sizeof (scd.Path));
+if ((fread (header, 1, sizeof (header), File) != sizeof (header)) ||
+    (memcmp (header, SCD_MAGIC, 8) != 0) ||
+    (_scd_get32 (header + 8) != SCD_VERSION)) {
+    fclose (File);
+    return sim_messagef (SCPE_ARG, "%s is not an SCD container\n", szSCDPath);
+    }
+scd.ChunkCount = _scd_get32 (header + 24);
+strlcpy (scd.StoreName, (char *)header + SCD_STORE_OFFSET, sizeof (scd.StoreName));
+_scd_store_path (scd.Path, scd.StoreName, Store, sizeof (Store));
+#if defined (_WIN32)
+if (_fullpath (scd.Store, Store, sizeof (scd.Store)) == NULL)
+#else
+if (realpath (Store, scd.Store) == NULL)
+#endif
+    strlcpy (scd.Store, Store, sizeof (scd.Store));
+if (ctx->Store[0] == '\0')
+    strlcpy (ctx->Store, scd.Store, sizeof (ctx->Store));
+if (0 != strcmp (ctx->Store, scd.Store)) {
+    fclose (File);
+    return sim_messagef (SCPE_ARG, "%s uses store %s, not %s\n", szSCDPath, scd.Store, ctx->Store);
+    }
+if (ctx->UsedCount + scd.ChunkCount > ctx->UsedSize) {
+    size_t size = ctx->UsedCount + scd.ChunkCount;
+    uint8 *Used = (uint8 *)realloc (ctx->Used, size * SCD_HASH_SIZE);
+
+    if (Used == NULL) {
+        fclose (File);
+        return SCPE_MEM;
+        }
+    ctx->Used = Used;
+    ctx->UsedSize = size;
+    }
+for (i = 0; i < scd.ChunkCount; ++i) {
+    uint8 *entry = ctx->Used + ctx->UsedCount * SCD_HASH_SIZE;
+
+    if (fread (entry, 1, SCD_HASH_SIZE, File) != SCD_HASH_SIZE) {
+        fclose (File);
+        return sim_messagef (SCPE_IOERR, "Can't read the index of %s\n", szSCDPath);
+        }
+    if (!_scd_is_zero (entry, SCD_HASH_SIZE))
+        ++ctx->UsedCount;
+    }
+fclose (File);
+return SCPE_OK;
+}
+
+/* Remove a store file unless it is an object in use.  Partly written
+   objects left by a simulator which died are removed as well. */
+
+static void _scd_compact_entry (SCD_COMPACT *ctx, const char *name)
+{
+char path[SCD_OBJ_PATH_SIZE];
+uint8 hash[SCD_HASH_SIZE];
+size_t len = strlen (name);
+struct stat statb;
+int i;
+
+if (len < 2*SCD_HASH_SIZE)
+    return;
+for (i = 0; i < SCD_HASH_SIZE; ++i) {
+    unsigned int byte;
+
+    if ((!isxdigit ((unsigned char)name[2*i])) || (!isxdigit ((unsigned char)name[2*i+1])) ||
+        (1 != sscanf (&name[2*i], "%2x", &byte)))
+        return;
+    hash[i] = (uint8)byte;
+    }
+if (len == 2*SCD_HASH_SIZE) {                   /* an object? */
+    if (NULL != bsearch (hash, ctx->Used, ctx->UsedCount, SCD_HASH_SIZE, _scd_hash_cmp)) {
+        ++ctx->Kept;
+        return;
+        }
+    }
+else
+    if ((name[2*SCD_HASH_SIZE] != '.') ||
+        (0 != strcmp (name + len - 4, ".tmp")))
+        return;                                 /* not a partly written object */
+snprintf (path, sizeof (path), "%s/%s", ctx->Store, name);
+if (0 != stat (path, &statb))
+    return;
+if (0 == remove (path)) {
+    ++ctx->Removed;
+    ctx->Freed += statb.st_size;
+    }
+}
+
+static t_stat _scd_compact (CONST char *cptr)
+{
+SCD_COMPACT ctx;
+char gbuf[CBUFSIZE];
+CONST char *tptr;
+t_stat r = SCPE_OK;
+int pass, fd = -1;
+
+memset (&ctx, 0, sizeof (ctx));
+/* The indexes are read once to find the store and then again once it is
+   locked, since a disk detached in between may have rewritten its index */
+for (pass = 0; (r == SCPE_OK) && (pass < 2); ++pass) {
+    ctx.UsedCount = 0;
+    for (tptr = cptr; (r == SCPE_OK) && (*tptr != 0); ) {
+        tptr = get_glyph_nc (tptr, gbuf, 0);
+        r = _scd_compact_container (&ctx, gbuf);
+        }
+    if ((r != SCPE_OK) || (pass != 0))
+        continue;
+    if (NULL != _scd_store_find (ctx.Store))
+        r = sim_messagef (SCPE_ALATT, "Store %s is in use by an attached disk\n", ctx.Store);
+    else {
+        fd = _scd_lock (ctx.Store, TRUE);
+        if (fd == SCD_LOCK_BUSY)
+            r = sim_messagef (SCPE_ALATT, "Store %s is in use by another simulator\n", ctx.Store);
+        else
+            if (fd < 0)
+                r = sim_messagef (SCPE_OPENERR, "Can't lock store %s\n", ctx.Store);
+        }
+    }
+if (r == SCPE_OK) {
+    qsort (ctx.Used, ctx.UsedCount, SCD_HASH_SIZE, _scd_hash_cmp);
+#if defined (_WIN32)
+    if (1) {
+        WIN32_FIND_DATAA File;
+        HANDLE hFind;
+        char WildName[PATH_MAX+3];
+
+        snprintf (WildName, sizeof (WildName), "%s/*", ctx.Store);
+        hFind = FindFirstFileA (WildName, &File);
+        if (hFind != INVALID_HANDLE_VALUE) {
+            do
+                _scd_compact_entry (&ctx, File.cFileName);
+            while (FindNextFileA (hFind, &File));
+            FindClose (hFind);
+            }
+        }
+#else
+    if (1) {
+        DIR *dir = opendir (ctx.Store);
+        struct dirent *ent;
+
+        if (dir != NULL) {
+            while (NULL != (ent = readdir (dir)))
+                _scd_compact_entry (&ctx, ent->d_name);
+            closedir (dir);
+            }
+        }
+#endif
+    _scd_sync_dir (ctx.Store);
+    sim_printf ("Store %s: %u objects in use, %u files removed (%s bytes)\n", ctx.Store, ctx.Kept, ctx.Removed, sim_fmt_numeric ((double)ctx.Freed));
+    }
+if (fd >= 0)
+    _scd_unlock (fd);
+free (ctx.Used);
+return r;
+}
+
+/* SCD COMPACT container {container ...}
+
+   Removes the objects which none of the named containers use from their
+   store.  Every container using the store must be named, and none may be
+   attached anywhere while it runs. */
+
+t_stat sim_disk_scd_cmd (int32 flag, CONST char *cptr)
+{
+char gbuf[CBUFSIZE];
+
+if ((!cptr) || (*cptr == 0))
+    return SCPE_2FARG;
+cptr = get_glyph (cptr, gbuf, 0);
+if (MATCH_CMD (gbuf, "COMPACT") != 0)
+    return sim_messagef (SCPE_ARG, "Unknown SCD command: %s\n", gbuf);
+if (*cptr == 0)
+    return SCPE_2FARG;
+return _scd_compact (cptr);
+}
@@ -49,6 +49,7 @@ typedef uint32          t_lba;                          /* disk logical block ad
 #define DKUF_F_STD       0                              /* SIMH format */
 #define DKUF_F_RAW       1                              /* Raw Physical Disk Access */
 #define DKUF_F_VHD       2                              /* VHD format */
+#define DKUF_F_SCD       3                              /* Sparse/compressed/dedup chunk format */
 #define DKUF_V_UF       (DKUF_V_FMT + DKUF_W_FMT)
 #define DKUF_WLK        (1u << DKUF_V_WLK)
 #define DKUF_FMT        (DKUF_M_FMT << DKUF_V_FMT)
@@ -57,6 +58,7 @@ typedef uint32          t_lba;                          /* disk logical block ad
 #define DK_F_STD        (DKUF_F_STD << DKUF_V_FMT)
 #define DK_F_RAW        (DKUF_F_RAW << DKUF_V_FMT)
 #define DK_F_VHD        (DKUF_F_VHD << DKUF_V_FMT)
+#define DK_F_SCD        (DKUF_F_SCD << DKUF_V_FMT)
 
 #define DK_GET_FMT(u)   (((u)->flags >> DKUF_V_FMT) & DKUF_M_FMT)
 
@@ -94,6 +96,7 @@ t_offset sim_disk_size (UNIT *uptr);
 t_bool sim_disk_vhd_support (void);
 t_bool sim_disk_raw_support (void);
 void sim_disk_data_trace (UNIT *uptr, const uint8 *data, size_t lba, size_t len, const char* txt, int detail, uint32 reason);
+t_stat sim_disk_scd_cmd (int32 flag, CONST char *cptr);
 
 #ifdef  __cplusplus
 }
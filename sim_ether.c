@@ -871,7 +871,12 @@ void ethq_remove(ETH_QUE* que)
   if (que->count) {
     if (item->packet.oversize)
       free (item->packet.oversize);
-    memset(item, 0, sizeof(struct eth_item));
+    /* the frame buffer is overwritten by the next insert, so only 
+       the descriptive fields need to be reset */
+    item->type = 0;
+    item->packet.oversize = NULL;
+    item->packet.len = item->packet.used = item->packet.crc_len = 0;
+    item->packet.status = 0;
     if (++que->head == que->max)
       que->head = 0;
     que->count--;
@@ -908,6 +913,10 @@ void ethq_insert_data(ETH_QUE* que, int32 type, const uint8 *data, int used, siz
   item->packet.used = used;
   item->packet.crc_len = crc_len;
   if (MAX (len, crc_len) <= sizeof (item->packet.msg)) {
+    if (item->packet.oversize) {        /* overwriting a lost oversize packet? */
+      free (item->packet.oversize);
+      item->packet.oversize = NULL;
+      }
     memcpy(item->packet.msg, data, ((len > crc_len) ? len : crc_len));
     if (crc_data && (crc_len > len))
       memcpy(&item->packet.msg[len], crc_data, ETH_CRC_SIZE);
@@ -1703,6 +1712,16 @@ _eth_callback((u_char *)opaque, &header, buf);
 #endif
 
 #if defined (USE_READER_THREAD)
+
+/* Most packets the reader thread will take from the host per wakeup.
+   Packets arriving in bursts are moved into the read queue together 
+   and the simulator is only notified once per batch. */
+#define ETH_READ_BATCH 32
+
+#if defined (__linux__) && defined (MSG_WAITFORONE)
+#define HAVE_RECVMMSG 1
+#endif
+
 static void *
 _eth_reader(void *arg)
 {
@@ -1711,10 +1730,36 @@ int status = 0;
 int sel_ret = 0;
 int do_select = 0;
 SOCKET select_fd = 0;
+u_char *read_buf;
+#if defined (HAVE_RECVMMSG)
+struct mmsghdr read_msgs[ETH_READ_BATCH];
+struct iovec read_iov[ETH_READ_BATCH];
+int i;
+#endif
 #if defined (_WIN32)
 HANDLE hWait = (dev->eth_api == ETH_API_PCAP) ? pcap_getevent ((pcap_t*)dev->handle) : NULL;
 #endif
 
+/* Receive buffers are allocated once for the life of the thread.
+   A datagram socket needs one buffer per batch entry, everything 
+   else is drained one packet at a time through the first buffer. */
+#if defined (HAVE_RECVMMSG)
+read_buf = (u_char *)malloc (((dev->eth_api == ETH_API_UDP) ? ETH_READ_BATCH : 1) * ETH_MAX_JUMBO_FRAME);
+memset (read_msgs, 0, sizeof (read_msgs));
+for (i = 0; i < ETH_READ_BATCH; i++) {
+  read_iov[i].iov_base = read_buf + ((dev->eth_api == ETH_API_UDP) ? i * ETH_MAX_JUMBO_FRAME : 0);
+  read_iov[i].iov_len = ETH_MAX_JUMBO_FRAME;
+  read_msgs[i].msg_hdr.msg_iov = &read_iov[i];
+  read_msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+#else
+read_buf = (u_char *)malloc (ETH_MAX_JUMBO_FRAME);
+#endif
+if (read_buf == NULL) {
+  sim_printf ("Eth: failed to allocate reader thread buffers\n");
+  return NULL;
+  }
+
 switch (dev->eth_api) {
   case ETH_API_PCAP:
 #if defined (HAVE_PCAP_NETWORK)
@@ -1787,20 +1832,22 @@ while (dev->handle) {
         if (1) {
           struct pcap_pkthdr header;
           int len;
-          u_char buf[ETH_MAX_JUMBO_FRAME];
 
+          /* The tap descriptor is non-blocking, so drain everything 
+             the kernel has queued (up to a batch) on each wakeup */
           memset(&header, 0, sizeof(header));
-          len = read(dev->fd_handle, buf, sizeof(buf));
-          if (len > 0) {
-            status = 1;
+          status = 0;
+          while (status < ETH_READ_BATCH) {
+            len = read(dev->fd_handle, read_buf, ETH_MAX_JUMBO_FRAME);
+            if (len <= 0) {
+              if ((len < 0) && (status == 0) && 
+                  (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+                status = -1;
+              break;
+              }
+            ++status;
             header.caplen = header.len = len;
-            _eth_callback((u_char *)dev, &header, buf);
-            }
-          else {
-            if (len < 0)
-              status = -1;
-            else
-              status = 0;
+            _eth_callback((u_char *)dev, &header, read_buf);
             }
           }
         break;
@@ -1835,17 +1882,38 @@ while (dev->handle) {
         break;
 #endif /* HAVE_SLIRP_NETWORK */
       case ETH_API_UDP:
+#if defined (HAVE_RECVMMSG)
+        if (1) {
+          struct pcap_pkthdr header;
+          int i;
+
+          /* Collect every datagram already queued on the socket 
+             (up to a batch) with a single system call */
+          memset(&header, 0, sizeof(header));
+          for (i = 0; i < ETH_READ_BATCH; i++)
+            read_msgs[i].msg_len = 0;
+          status = recvmmsg(select_fd, read_msgs, ETH_READ_BATCH, MSG_DONTWAIT, NULL);
+          if ((status < 0) && 
+              ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)))
+            status = 0;
+          for (i = 0; i < status; i++) {
+            if (read_msgs[i].msg_len == 0)
+              continue;
+            header.caplen = header.len = read_msgs[i].msg_len;
+            _eth_callback((u_char *)dev, &header, (u_char *)read_iov[i].iov_base);
+            }
+          }
+#else
         if (1) {
           struct pcap_pkthdr header;
           int len;
-          u_char buf[ETH_MAX_JUMBO_FRAME];
 
           memset(&header, 0, sizeof(header));
-          len = (int)sim_read_sock (select_fd, (char *)buf, (int32)sizeof(buf));
+          len = (int)sim_read_sock (select_fd, (char *)read_buf, (int32)ETH_MAX_JUMBO_FRAME);
           if (len > 0) {
             status = 1;
             header.caplen = header.len = len;
-            _eth_callback((u_char *)dev, &header, buf);
+            _eth_callback((u_char *)dev, &header, read_buf);
             }
           else {
             if (len < 0)
@@ -1854,8 +1922,17 @@ while (dev->handle) {
               status = 0;
             }
           }
+#endif /* HAVE_RECVMMSG */
         break;
       }
+    if (status > 0) {
+      pthread_mutex_lock (&dev->lock);
+      ++dev->read_batches;
+      dev->read_batch_packets += status;
+      if ((uint32)status > dev->read_batch_peak)
+        dev->read_batch_peak = status;
+      pthread_mutex_unlock (&dev->lock);
+      }
     if ((status > 0) && (dev->asynch_io)) {
       int wakeup_needed;
 
@@ -1886,6 +1963,7 @@ while (dev->handle) {
     }
   }
 
+free (read_buf);
 sim_debug(dev->dbit, dev->dptr, "Reader Thread Exiting\n");
 return NULL;
 }
@@ -3424,14 +3502,13 @@ if (bpf_used ? to_me : (to_me && !from_me)) {
     int crc_len = 0;
     uint8 crc_data[4];
     uint32 len = header->len;
-    u_char *moved_data = NULL;
+    u_char runt_data[ETH_MIN_PACKET];
 
     if (header->len < ETH_MIN_PACKET) {   /* Pad runt packets before CRC append */
-      moved_data = (u_char *)malloc(ETH_MIN_PACKET);
-      memcpy(moved_data, data, len);
-      memset(moved_data + len, 0, ETH_MIN_PACKET-len);
+      memcpy(runt_data, data, len);
+      memset(runt_data + len, 0, ETH_MIN_PACKET-len);
       len = ETH_MIN_PACKET;
-      data = moved_data;
+      data = runt_data;
       }
 
     /* If necessary, fix IP header checksums for packets originated locally */
@@ -3448,7 +3525,6 @@ if (bpf_used ? to_me : (to_me && !from_me)) {
     ethq_insert_data(&dev->read_queue, ETH_ITM_NORMAL, data, 0, len, crc_len, crc_data, 0);
     ++dev->packets_received;
     pthread_mutex_unlock (&dev->lock);
-    free(moved_data);
     }
 #else /* !USE_READER_THREAD */
   /* set data in passed read packet */
@@ -4009,6 +4085,11 @@ if (dev->throttle_count)
 fprintf(st, "  Read Queue: Count:       %d\n", dev->read_queue.count);
 fprintf(st, "  Read Queue: High:        %d\n", dev->read_queue.high);
 fprintf(st, "  Read Queue: Loss:        %d\n", dev->read_queue.loss);
+if (dev->read_batches) {
+  fprintf(st, "  Read Batches:            %d\n", dev->read_batches);
+  fprintf(st, "  Read Batch: Average:     %.1f\n", (double)dev->read_batch_packets/dev->read_batches);
+  fprintf(st, "  Read Batch: Peak:        %d\n", dev->read_batch_peak);
+  }
 fprintf(st, "  Peak Write Queue Size:   %d\n", dev->write_queue_peak);
 #endif
 if (dev->bpf_filter)
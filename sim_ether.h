@@ -313,6 +313,9 @@ struct eth_device {
   int           asynch_io;                              /* Asynchronous Interrupt scheduling enabled */
   int           asynch_io_latency;                      /* instructions to delay pending interrupt */
   ETH_QUE       read_queue;
+  uint32        read_batches;                           /* reader wakeups which delivered packets */
+  uint32        read_batch_packets;                     /* packets delivered by those wakeups */
+  uint32        read_batch_peak;                        /* most packets delivered by a single wakeup */
   pthread_mutex_t     lock;
   pthread_t     reader_thread;                          /* Reader Thread Id */
   pthread_t     writer_thread;                          /* Writer Thread Id */
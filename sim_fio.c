@@ -51,7 +51,11 @@
    sim_buf_copy_swapped -    copy data swapping elements along the way
    sim_buf_swap_data -       swap data elements inplace in buffer
    sim_shmem_open            create or attach to a shared memory region
+   sim_shmem_attach          attach to an existing shared memory region
    sim_shmem_close           close a shared memory region
+   sim_fmap_open             map an open file into memory
+   sim_fmap_flush            write back dirty pages of a file mapping
+   sim_fmap_close            unmap a file mapping
 
 
    sim_fopen and sim_fseek are OS-dependent.  The other routines are not.
@@ -447,6 +451,38 @@ if ((*shmem)->shm_base == NULL) {
 return SCPE_OK;
 }
 
+t_stat sim_shmem_attach (const char *name, size_t size, SHMEM **shmem, void **addr)
+{
+MEMORY_BASIC_INFORMATION info;
+
+*shmem = (SHMEM *)calloc (1, sizeof(**shmem));
+
+*addr = NULL;
+if (*shmem == NULL)
+    return SCPE_MEM;
+
+(*shmem)->hMapping = INVALID_HANDLE_VALUE;
+(*shmem)->shm_size = size;
+(*shmem)->shm_base = NULL;
+(*shmem)->hMapping = OpenFileMappingA (FILE_MAP_ALL_ACCESS, FALSE, name);
+if ((*shmem)->hMapping == NULL) {
+    (*shmem)->hMapping = INVALID_HANDLE_VALUE;
+    sim_shmem_close (*shmem);
+    *shmem = NULL;
+    return SCPE_OPENERR;
+    }
+(*shmem)->shm_base = MapViewOfFile ((*shmem)->hMapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+if (((*shmem)->shm_base == NULL) ||
+    (VirtualQuery ((*shmem)->shm_base, &info, sizeof (info)) == 0) ||
+    (info.RegionSize < size)) {
+    sim_shmem_close (*shmem);
+    *shmem = NULL;
+    return SCPE_OPENERR;
+    }
+*addr = (*shmem)->shm_base;
+return SCPE_OK;
+}
+
 void sim_shmem_close (SHMEM *shmem)
 {
 if (shmem == NULL)
@@ -458,6 +494,71 @@ if (shmem->hMapping != INVALID_HANDLE_VALUE)
 free (shmem);
 }
 
+struct FMAP {
+    HANDLE hMapping;
+    t_offset fmap_size;
+    void *fmap_base;
+    };
+
+t_stat sim_fmap_open (FILE *fptr, t_offset *size, t_bool readonly, FMAP **fmap, void **addr)
+{
+HANDLE hFile = (HANDLE)_get_osfhandle (_fileno (fptr));
+t_offset fsize = sim_fsize_ex (fptr);
+
+*addr = NULL;
+*fmap = NULL;
+if ((*size == 0) || ((t_offset)((size_t)*size) != *size))
+    return SCPE_ARG;
+if (fsize < *size) {
+    if (readonly)
+        *size = fsize;
+    else {
+        fflush (fptr);
+        if (_chsize_s (_fileno (fptr), (__int64)*size))
+            return SCPE_IOERR;
+        }
+    }
+if (*size == 0)
+    return SCPE_ARG;
+*fmap = (FMAP *)calloc (1, sizeof(**fmap));
+if (*fmap == NULL)
+    return SCPE_MEM;
+fflush (fptr);
+(*fmap)->fmap_size = *size;
+(*fmap)->hMapping = CreateFileMappingA (hFile, NULL, readonly ? PAGE_READONLY : PAGE_READWRITE, (DWORD)(*size >> 32), (DWORD)*size, NULL);
+if ((*fmap)->hMapping == NULL) {
+    sim_fmap_close (*fmap);
+    *fmap = NULL;
+    return SCPE_OPENERR;
+    }
+(*fmap)->fmap_base = MapViewOfFile ((*fmap)->hMapping, readonly ? FILE_MAP_READ : FILE_MAP_WRITE, 0, 0, (SIZE_T)*size);
+if ((*fmap)->fmap_base == NULL) {
+    sim_fmap_close (*fmap);
+    *fmap = NULL;
+    return SCPE_OPENERR;
+    }
+*addr = (*fmap)->fmap_base;
+return SCPE_OK;
+}
+
+t_stat sim_fmap_flush (FMAP *fmap)
+{
+if ((fmap == NULL) || (fmap->fmap_base == NULL))
+    return SCPE_OK;
+return FlushViewOfFile (fmap->fmap_base, 0) ? SCPE_OK : SCPE_IOERR;
+}
+
+void sim_fmap_close (FMAP *fmap)
+{
+if (fmap == NULL)
+    return;
+if (fmap->fmap_base != NULL)
+    UnmapViewOfFile (fmap->fmap_base);
+if (fmap->hMapping != NULL)
+    CloseHandle (fmap->hMapping);
+free (fmap);
+}
+
 #else /* !defined(_WIN32) */
 #include <unistd.h>
 int sim_set_fsize (FILE *fptr, t_addr size)
@@ -593,6 +694,40 @@ return SCPE_NOFNC;
 #endif
 }
 
+t_stat sim_shmem_attach (const char *name, size_t size, SHMEM **shmem, void **addr)
+{
+#ifdef HAVE_SHM_OPEN
+struct stat statb;
+
+*shmem = (SHMEM *)calloc (1, sizeof(**shmem));
+
+*addr = NULL;
+if (*shmem == NULL)
+    return SCPE_MEM;
+
+(*shmem)->shm_base = MAP_FAILED;
+(*shmem)->shm_size = size;
+(*shmem)->shm_fd = shm_open (name, O_RDWR, 0);
+if (((*shmem)->shm_fd == -1) ||
+    (fstat ((*shmem)->shm_fd, &statb)) ||
+    (statb.st_size != (*shmem)->shm_size)) {
+    sim_shmem_close (*shmem);
+    *shmem = NULL;
+    return SCPE_OPENERR;
+    }
+(*shmem)->shm_base = mmap(NULL, (*shmem)->shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, (*shmem)->shm_fd, 0);
+if ((*shmem)->shm_base == MAP_FAILED) {
+    sim_shmem_close (*shmem);
+    *shmem = NULL;
+    return SCPE_OPENERR;
+    }
+*addr = (*shmem)->shm_base;
+return SCPE_OK;
+#else
+return SCPE_NOFNC;
+#endif
+}
+
 void sim_shmem_close (SHMEM *shmem)
 {
 if (shmem == NULL)
@@ -604,6 +739,61 @@ if (shmem->shm_fd != -1)
 free (shmem);
 }
 
+struct FMAP {
+    t_offset fmap_size;
+    void *fmap_base;
+    };
+
+t_stat sim_fmap_open (FILE *fptr, t_offset *size, t_bool readonly, FMAP **fmap, void **addr)
+{
+t_offset fsize = sim_fsize_ex (fptr);
+
+*addr = NULL;
+*fmap = NULL;
+if ((*size == 0) || ((t_offset)((size_t)*size) != *size))
+    return SCPE_ARG;
+fflush (fptr);
+if (fsize < *size) {
+    if (readonly)
+        *size = fsize;                          /* map only what exists */
+    else
+        if (ftruncate (fileno (fptr), (off_t)*size))/* extend so every page is backed */
+            return SCPE_IOERR;
+    }
+if (*size == 0)
+    return SCPE_ARG;
+*fmap = (FMAP *)calloc (1, sizeof(**fmap));
+if (*fmap == NULL)
+    return SCPE_MEM;
+(*fmap)->fmap_size = *size;
+(*fmap)->fmap_base = mmap (NULL, (size_t)*size, readonly ? PROT_READ : (PROT_READ | PROT_WRITE), MAP_SHARED, fileno (fptr), 0);
+if ((*fmap)->fmap_base == MAP_FAILED) {
+    sim_fmap_close (*fmap);
+    *fmap = NULL;
+    return SCPE_OPENERR;
+    }
+*addr = (*fmap)->fmap_base;
+return SCPE_OK;
+}
+
+t_stat sim_fmap_flush (FMAP *fmap)
+{
+if ((fmap == NULL) || (fmap->fmap_base == MAP_FAILED))
+    return SCPE_OK;
+return msync (fmap->fmap_base, (size_t)fmap->fmap_size, MS_ASYNC) ? SCPE_IOERR : SCPE_OK;
+}
+
+void sim_fmap_close (FMAP *fmap)
+{
+if (fmap == NULL)
+    return;
+if (fmap->fmap_base != MAP_FAILED) {
+    msync (fmap->fmap_base, (size_t)fmap->fmap_size, MS_SYNC);
+    munmap (fmap->fmap_base, (size_t)fmap->fmap_size);
+    }
+free (fmap);
+}
+
 #endif
 
 #if defined(__VAX)
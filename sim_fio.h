@@ -72,7 +72,12 @@ void sim_buf_copy_swapped (void *dptr, const void *bptr, size_t size, size_t cou
 const char *sim_get_os_error_text (int error);
 typedef struct SHMEM SHMEM;
 t_stat sim_shmem_open (const char *name, size_t size, SHMEM **shmem, void **addr);
+t_stat sim_shmem_attach (const char *name, size_t size, SHMEM **shmem, void **addr);
 void sim_shmem_close (SHMEM *shmem);
+typedef struct FMAP FMAP;
+t_stat sim_fmap_open (FILE *fptr, t_offset *size, t_bool readonly, FMAP **fmap, void **addr);
+t_stat sim_fmap_flush (FMAP *fmap);
+void sim_fmap_close (FMAP *fmap);
 
 extern t_bool sim_taddr_64;         /* t_addr is > 32b and Large File Support available */
 extern t_bool sim_toffset_64;       /* Large File (>2GB) file I/O support */
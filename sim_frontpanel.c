@@ -84,6 +84,10 @@ return 0;
 #include <unistd.h>
 #define msleep(n) usleep(1000*n)
 #include <sys/wait.h>
+#if defined(HAVE_SHM_OPEN)
+#include <sys/mman.h>
+#include <fcntl.h>
+#endif
 #if defined (__APPLE__)
 #define HAVE_STRUCT_TIMESPEC 1   /* OSX defined the structure but doesn't tell us */
 #endif
@@ -172,6 +176,13 @@ struct PANEL {
     unsigned int            sample_frequency;
     unsigned int            sample_dither_pct;
     unsigned int            sample_depth;
+    char                    shmem_name[64]; /* shared memory sample area name */
+    SIM_PANEL_SHMEM         *shmem;         /* shared memory sample area */
+    size_t                  shmem_size;
+    char                    *shmem_copy;    /* consistent copy of the sample area */
+#if defined(_WIN32)
+    HANDLE                  hShmem;
+#endif
     int                     debug;
     char                    *simulator_version;
     int                     radix;
@@ -221,6 +232,9 @@ static const char *register_collect_mid1 = " samples every ";
 static const char *register_collect_mid2 = " cycles dither ";
 static const char *register_collect_mid3 = " percent ";
 static const char *register_get_postfix = "sampleout";
+static const char *register_shmem_prefix = "shmem ";
+static const char *register_shmem_every = " every ";
+static const char *register_shmem_bits = "bits ";
 static const char *register_get_start = "# REGISTERS-START";
 static const char *register_get_end = "# REGISTERS-DONE";
 static const char *register_repeat_start = "# REGISTERS-REPEAT-START";
@@ -634,6 +648,221 @@ free (buf);
 return 0;
 }
 
+/*
+   Shared memory register sampling
+
+   While the simulator is running, the callback thread reads register 
+   values and bit sample totals from a shared memory region which the 
+   simulator's remote console updates every usecs_between_callbacks.  
+   Reads are lock free: the simulator makes the sequence number odd 
+   while it is updating the region, so a copy is only consistent if 
+   the sequence was even and unchanged across the copy.
+ */
+
+static void
+_panel_shmem_release (PANEL *p)
+{
+if (p->shmem == NULL)
+    return;
+#if defined(_WIN32)
+UnmapViewOfFile ((void *)p->shmem);
+CloseHandle (p->hShmem);
+p->hShmem = NULL;
+#elif defined(HAVE_SHM_OPEN)
+munmap ((void *)p->shmem, p->shmem_size);
+shm_unlink (p->shmem_name);
+#endif
+p->shmem = NULL;
+p->shmem_size = 0;
+free (p->shmem_copy);
+p->shmem_copy = NULL;
+}
+
+static int
+_panel_shmem_create (PANEL *p, size_t value_count, size_t bit_count)
+{
+#if defined(_WIN32) || defined(HAVE_SHM_OPEN)
+static int shmem_serial = 0;
+#endif
+size_t size = SIM_PANEL_SHMEM_SIZE(value_count, bit_count);
+void *addr;
+
+_panel_shmem_release (p);
+p->shmem_copy = (char *)_panel_malloc (size);
+if (p->shmem_copy == NULL)
+    return -1;
+#if defined(_WIN32)
+sprintf (p->shmem_name, "simh-panel-%d-%d", (int)GetCurrentProcessId (), ++shmem_serial);
+p->hShmem = CreateFileMappingA (INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, (DWORD)size, p->shmem_name);
+if (p->hShmem == NULL)
+    addr = NULL;
+else {
+    addr = MapViewOfFile (p->hShmem, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if (addr == NULL) {
+        CloseHandle (p->hShmem);
+        p->hShmem = NULL;
+        }
+    }
+#elif defined(HAVE_SHM_OPEN)
+if (1) {
+    int fd;
+
+    sprintf (p->shmem_name, "/simh-panel-%d-%d", (int)getpid (), ++shmem_serial);
+    fd = shm_open (p->shmem_name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    addr = NULL;
+    if (fd != -1) {
+        if (ftruncate (fd, size) == 0) {
+            addr = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (addr == MAP_FAILED)
+                addr = NULL;
+            }
+        close (fd);
+        if (addr == NULL)
+            shm_unlink (p->shmem_name);
+        }
+    }
+#else
+addr = NULL;
+#endif
+if (addr == NULL) {
+    _panel_debug (p, DBG_THR, "Can't create shared memory region %s", NULL, 0, p->shmem_name);
+    free (p->shmem_copy);
+    p->shmem_copy = NULL;
+    return -1;
+    }
+memset (addr, 0, size);
+p->shmem = (SIM_PANEL_SHMEM *)addr;
+p->shmem_size = size;
+p->shmem->magic = SIM_PANEL_SHMEM_MAGIC;
+p->shmem->value_count = (unsigned int)value_count;
+p->shmem->bit_count = (unsigned int)bit_count;
+return 0;
+}
+
+static int
+_panel_establish_shmem (PANEL *panel)
+{
+size_t i, buf_data, buf_needed, value_count = 0, bit_count = 0, bit_reg_count = 0;
+int cmd_stat;
+char *buf, *response = NULL;
+
+pthread_mutex_lock (&panel->io_lock);
+buf_needed = strlen (register_shmem_prefix) + sizeof (panel->shmem_name) +
+             strlen (register_shmem_every) + 20 + strlen (register_repeat_units) +
+             strlen (register_shmem_bits) + 2;
+for (i=0; i<panel->reg_count; i++) {
+    if (panel->regs[i].bits) {
+        ++bit_reg_count;
+        bit_count += panel->regs[i].bit_count;
+        buf_needed += 12;
+        }
+    else {
+        value_count += (panel->regs[i].element_count > 0) ? panel->regs[i].element_count : 1;
+        buf_needed += 8 + strlen (panel->regs[i].name) + (panel->regs[i].device_name ? strlen (panel->regs[i].device_name) : 0);
+        if (panel->regs[i].element_count > 0)
+            buf_needed += 4 + 6 /* 6 digit register array index */;
+        }
+    }
+buf = (char *)_panel_malloc (buf_needed);
+if ((buf == NULL) || 
+    _panel_shmem_create (panel, value_count, bit_count)) {
+    pthread_mutex_unlock (&panel->io_lock);
+    free (buf);
+    return -1;
+    }
+sprintf (buf, "%s%s%s%d%s", register_shmem_prefix, panel->shmem_name, register_shmem_every, panel->usecs_between_callbacks, register_repeat_units);
+buf_data = strlen (buf);
+if (bit_reg_count) {
+    strcpy (buf + buf_data, register_shmem_bits);
+    buf_data += strlen (buf + buf_data);
+    for (i=bit_reg_count=0; i<panel->reg_count; i++) {
+        if (!panel->regs[i].bits)
+            continue;
+        sprintf (buf + buf_data, "%s%d", (bit_reg_count++ != 0) ? "," : "", (int)panel->regs[i].bit_count);
+        buf_data += strlen (buf + buf_data);
+        }
+    strcpy (buf + buf_data, " ");
+    buf_data += strlen (buf + buf_data);
+    }
+for (i=value_count=0; i<panel->reg_count; i++) {
+    if (panel->regs[i].bits)
+        continue;
+    sprintf (buf + buf_data, "%s%s", (value_count++ != 0) ? "," : "", panel->regs[i].indirect ? "-I " : "");
+    buf_data += strlen (buf + buf_data);
+    if (panel->regs[i].device_name) {
+        sprintf (buf + buf_data, "%s ", panel->regs[i].device_name);
+        buf_data += strlen (buf + buf_data);
+        }
+    if (panel->regs[i].element_count > 0)
+        sprintf (buf + buf_data, "%s[0:%d]", panel->regs[i].name, (int)(panel->regs[i].element_count-1));
+    else
+        sprintf (buf + buf_data, "%s", panel->regs[i].name);
+    buf_data += strlen (buf + buf_data);
+    }
+pthread_mutex_unlock (&panel->io_lock);
+if ((_panel_sendf (panel, &cmd_stat, &response, "%s\r", buf)) || (cmd_stat != 0)) {
+    _panel_debug (panel, DBG_THR, "Shared memory sampling unavailable: %s", NULL, 0, response ? response : "");
+    pthread_mutex_lock (&panel->io_lock);
+    _panel_shmem_release (panel);
+    pthread_mutex_unlock (&panel->io_lock);
+    free (response);
+    free (buf);
+    return -1;
+    }
+_panel_debug (panel, DBG_THR, "Shared memory sampling via %s", NULL, 0, panel->shmem_name);
+free (response);
+free (buf);
+return 0;
+}
+
+static int
+_panel_shmem_get_registers (PANEL *panel)
+{
+SIM_PANEL_SHMEM *shm = panel->shmem;
+SIM_PANEL_SHMEM *copy = (SIM_PANEL_SHMEM *)panel->shmem_copy;
+unsigned long long *values;
+int *bits;
+unsigned int sequence;
+size_t i, j, value = 0, bit = 0;
+int tries;
+
+for (tries = 0; tries < 100; tries++) {
+    sequence = shm->sequence;
+    if (sequence & 1)                                   /* update in progress? */
+        continue;
+    SIM_PANEL_SHMEM_BARRIER ();
+    memcpy (copy, shm, panel->shmem_size);
+    SIM_PANEL_SHMEM_BARRIER ();
+    if (shm->sequence == sequence)                      /* consistent copy? */
+        break;
+    }
+if ((tries == 100) || (sequence == 0))                  /* no consistent (or no published) data */
+    return -1;
+values = SIM_PANEL_SHMEM_VALUES(copy);
+bits = SIM_PANEL_SHMEM_BITS(copy);
+pthread_mutex_lock (&panel->io_lock);
+panel->simulation_time = copy->simulation_time;
+for (i=0; i<panel->reg_count; i++) {
+    REG *r = &panel->regs[i];
+
+    if (r->bits) {
+        for (j=0; (j < r->bit_count) && (bit < copy->bit_count); j++)
+            r->bits[j] = bits[bit++];
+        continue;
+        }
+    for (j=0; (j < ((r->element_count > 0) ? r->element_count : 1)) && (value < copy->value_count); j++) {
+        unsigned long long data = values[value++];
+
+        if (little_endian)
+            memcpy ((char *)(r->addr) + (j * r->size), &data, r->size);
+        else
+            memcpy ((char *)(r->addr) + (j * r->size), ((char *)&data) + sizeof(data)-r->size, r->size);
+        }
+    }
+pthread_mutex_unlock (&panel->io_lock);
+return 0;
+}
+
 static PANEL **panels = NULL;
 static int panel_count = 0;
 static char *sim_panel_error_buf = NULL;
@@ -1110,6 +1339,7 @@ if (panel) {
         }
     free (panel->regs);
     free (panel->reg_query);
+    _panel_shmem_release (panel);
     free (panel->io_response);
     free (panel->halt_reason);
     free (panel->simulator_version);
@@ -2447,6 +2677,7 @@ char *buf = NULL;
 size_t buf_data = 0;
 unsigned int callback_count = 0;
 int cmd_stat;
+int halt_msecs = 0;
 
 /* 
    Boost Priority for timer thread so it doesn't compete 
@@ -2469,6 +2700,7 @@ while ((p->sock != INVALID_SOCKET) &&
        (p->State != Error)) {
     int interval = p->usecs_between_callbacks;
     int new_register = p->new_register;
+    int msecs;
 
     p->new_register = 0;
     pthread_mutex_unlock (&p->io_lock);
@@ -2480,8 +2712,16 @@ while ((p->sock != INVALID_SOCKET) &&
     /*  1) update the query string if it has changed                            */
     /*     (only really happens at startup)                                     */
     /*  2) update register state by polling if the simulator is halted          */
-    msleep (500);
+    /* when sampling via shared memory, this thread also paces the callbacks    */
+    msecs = p->shmem ? ((interval + 999) / 1000) : 500;
+    msleep (msecs);
     pthread_mutex_lock (&p->io_lock);
+    if (new_register) {         /* prefer shared memory sampling */
+        pthread_mutex_unlock (&p->io_lock);
+        if (0 == _panel_establish_shmem (p))
+            new_register = 0;
+        pthread_mutex_lock (&p->io_lock);
+        }
     if (new_register) {
         size_t repeat_data = strlen (register_repeat_prefix) +  /* prefix */
                              20                              +  /* max int width */
@@ -2521,6 +2761,10 @@ while ((p->sock != INVALID_SOCKET) &&
     /* when halted, we directly poll the halted system to get updated */
     /* register state which may have changed due to panel activities */
     if (p->State == Halt) {
+        halt_msecs += msecs;
+        if (halt_msecs < 500)
+            continue;
+        halt_msecs = 0;
         pthread_mutex_unlock (&p->io_lock);
         if (_panel_get_registers (p, 1, NULL)) {
             pthread_mutex_lock (&p->io_lock);
@@ -2530,6 +2774,14 @@ while ((p->sock != INVALID_SOCKET) &&
             p->callback (p, p->simulation_time_base + p->simulation_time, p->callback_context);
         pthread_mutex_lock (&p->io_lock);
         }
+    else {
+        if ((p->State == Run) && (p->shmem)) {
+            pthread_mutex_unlock (&p->io_lock);
+            if ((0 == _panel_shmem_get_registers (p)) && (p->callback))
+                p->callback (p, p->simulation_time_base + p->simulation_time, p->callback_context);
+            pthread_mutex_lock (&p->io_lock);
+            }
+        }
     }
 pthread_mutex_unlock (&p->io_lock);
 /* stop any established repeating activity in the simulator */
@@ -2542,6 +2794,7 @@ else {
     _panel_sendf (p, &cmd_stat, NULL, "%s", register_repeat_stop);
     }
 pthread_mutex_lock (&p->io_lock);
+_panel_shmem_release (p);
 _panel_debug (p, DBG_THR, "Exiting", NULL, 0);
 pthread_setspecific (panel_thread_id, NULL);
 p->callback_thread_running = 0;
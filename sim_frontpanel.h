@@ -56,7 +56,7 @@ extern "C" {
 
 #if !defined(__VAX)         /* Unsupported platform */
 
-#define SIM_FRONTPANEL_VERSION   12
+#define SIM_FRONTPANEL_VERSION   13
 
 /**
 
@@ -201,6 +201,12 @@ sim_panel_add_register_indirect_bits (PANEL *panel,
            routine should be called.  The panel API will make a best effort 
            to deliver the current register state at the desired rate.
 
+           While the simulator is running, callback data is delivered 
+           through a shared memory region which the simulator updates 
+           and the panel reads without any locking or protocol traffic.  
+           If the shared memory region can't be established, register 
+           values are delivered as text over the remote console session.
+
 
    Note 1: The buffers described in a panel's register set will be 
            dynamically revised as soon as data is available from the 
@@ -605,6 +611,44 @@ sim_panel_flush_debug (PANEL *panel);
 
 #endif /* !defined(__VAX) */
 
+/**
+
+    Shared memory register sample area
+
+    This layout is shared between sim_frontpanel.c and the simulator's 
+    remote console (sim_console.c) and is not part of the application 
+    API.  The panel creates the region and tells the simulator its name
+    with the remote console SHMEM command.  The header is followed by 
+    value_count 64 bit register values (in the order they were specified 
+    in the SHMEM command) and then bit_count int bit sample totals.
+
+    The simulator increments sequence before and after each update, so 
+    a reader which sees an odd sequence value, or a different value 
+    after copying the data, must retry its copy.
+ */
+#define SIM_PANEL_SHMEM_MAGIC   0x53484D50  /* "SHMP" */
+
+typedef struct SIM_PANEL_SHMEM {
+    unsigned int            magic;          /* SIM_PANEL_SHMEM_MAGIC */
+    volatile unsigned int   sequence;       /* odd while an update is in progress */
+    unsigned int            value_count;    /* number of register values */
+    unsigned int            bit_count;      /* number of bit sample totals */
+    unsigned long long      simulation_time;
+    } SIM_PANEL_SHMEM;
+
+#define SIM_PANEL_SHMEM_SIZE(value_count, bit_count) \
+    (sizeof (SIM_PANEL_SHMEM) + (value_count)*sizeof (unsigned long long) + (bit_count)*sizeof (int))
+#define SIM_PANEL_SHMEM_VALUES(shm) ((unsigned long long *)((shm) + 1))
+#define SIM_PANEL_SHMEM_BITS(shm) ((int *)(SIM_PANEL_SHMEM_VALUES(shm) + (shm)->value_count))
+
+#if defined(__GNUC__)
+#define SIM_PANEL_SHMEM_BARRIER() __sync_synchronize ()
+#elif defined(_WIN32)
+#define SIM_PANEL_SHMEM_BARRIER() MemoryBarrier ()
+#else
+#define SIM_PANEL_SHMEM_BARRIER()
+#endif
+
 #ifdef  __cplusplus
 }
 #endif
@@ -110,6 +110,13 @@
    The serial port indicated by "port" is closed.
 
 
+   int sim_serial_os_fd (SERHANDLE port)
+   -------------------------------------
+
+   The host file descriptor of the serial port indicated by "port" is
+   returned (UNIX hosts only).
+
+
    int sim_serial_devices (int max, SERIAL_LIST* list)
    ---------------------------------------------------
 
@@ -1410,6 +1417,18 @@ free (port);
 }
 
 
+/* Get the file descriptor of a serial port.
+
+   The descriptor is returned so that the port may be waited on along with
+   sockets.
+*/
+
+int sim_serial_os_fd (SERHANDLE port)
+{
+return port->port;
+}
+
+
 #elif defined (VMS)
 
 /* VMS implementation */
@@ -97,6 +97,9 @@ extern int32     sim_read_serial    (SERHANDLE port, char *buffer, int32 count,
 extern int32     sim_write_serial   (SERHANDLE port, char *buffer, int32 count);
 extern void      sim_close_serial   (SERHANDLE port);
 extern t_stat    sim_show_serial    (FILE* st, DEVICE *dptr, UNIT* uptr, int32 val, CONST char* desc);
+#if defined (__unix__) || defined (__APPLE__) || defined (__hpux)
+extern int       sim_serial_os_fd   (SERHANDLE port);
+#endif
 
 #ifdef  __cplusplus
 }
@@ -84,6 +84,8 @@
    sim_tape_show_fmt    show tape format
    sim_tape_set_capac   set tape capacity
    sim_tape_show_capac  show tape capacity
+   sim_tape_set_buffer  set sequential I/O buffer size
+   sim_tape_show_buffer show sequential I/O buffer size and statistics
    sim_tape_set_dens    set tape density
    sim_tape_show_dens   show tape density
    sim_tape_set_async   enable asynchronous operation
@@ -93,6 +95,7 @@
 #include "sim_defs.h"
 #include "sim_tape.h"
 #include <ctype.h>
+#include <sys/stat.h>
 
 #if defined SIM_ASYNCH_IO
 #include <pthread.h>
@@ -133,12 +136,37 @@ static t_addr sim_tape_tpc_fnd (UNIT *uptr, t_addr *map);
 static void sim_tape_data_trace (UNIT *uptr, const uint8 *data, size_t len, const char* txt, int detail, uint32 reason);
 static t_stat tape_erase_fwd (UNIT *uptr, t_mtrlnt gap_size);
 static t_stat tape_erase_rev (UNIT *uptr, t_mtrlnt gap_size);
+static t_bool sim_tape_idx_load (UNIT *uptr);
+static void sim_tape_idx_free (UNIT *uptr);
+static void sim_tape_idx_invalidate (UNIT *uptr);
+static t_bool sim_tape_idx_fwd (UNIT *uptr, t_mtrlnt *bc, t_stat *st);
+static t_bool sim_tape_idx_rev (UNIT *uptr, t_mtrlnt *bc, t_stat *st);
+static t_stat sim_tape_buf_flush (UNIT *uptr);
+static t_stat sim_tape_buf_drop (UNIT *uptr);
+static t_bool sim_tape_buf_rdrecf (UNIT *uptr, uint8 *buf, t_mtrlnt *bc, t_mtrlnt max, t_stat *st);
+static t_bool sim_tape_buf_wrrecf (UNIT *uptr, uint8 *buf, t_mtrlnt bc, t_stat *st);
+static t_bool sim_tape_buf_wrtmk (UNIT *uptr, t_stat *st);
 
 
 struct tape_context {
     DEVICE              *dptr;              /* Device for unit (access to debug flags) */
     uint32              dbit;               /* debugging bit for trace */
     uint32              auto_format;        /* Format determined dynamically */
+    t_bool              idx_enabled;        /* record index requested (ATTACH -I) */
+    t_addr              *idx_pos;           /* record index: object start positions */
+    t_mtrlnt            *idx_bc;            /* record index: object metadata markers */
+    uint32              idx_count;          /* record index: number of objects */
+    uint32              idx_hint;           /* record index: last object located */
+    uint8               *iobuf;             /* sequential I/O buffer (SET BUFFER) */
+    uint32              iobuf_size;         /* sequential I/O buffer size in bytes */
+    t_addr              iobuf_pos;          /* tape position of iobuf[0] */
+    uint32              iobuf_len;          /* bytes read ahead or waiting to be written */
+    t_bool              iobuf_write;        /* buffer holds write-behind data */
+    t_uint64            rd_records;         /* records and tape marks read forward */
+    t_uint64            rd_hits;            /*   of which found already in the buffer */
+    t_uint64            rd_fills;           /* read-ahead transfers */
+    t_uint64            wr_records;         /* records and tape marks written behind */
+    t_uint64            wr_flushes;         /* write-behind transfers */
 #if defined SIM_ASYNCH_IO
     int                 asynch_io;          /* Asynchronous Interrupt scheduling enabled */
     int                 asynch_io_latency;  /* instructions to delay pending interrupt */
@@ -445,6 +473,7 @@ sim_tape_clr_async (uptr);
 if (sim_asynch_enabled)
     sim_tape_set_async (uptr, ctx->asynch_io_latency);
 #endif
+sim_tape_buf_flush (uptr);                              /* write out write-behind data */
 fflush (uptr->fileref);
 }
 
@@ -523,6 +552,20 @@ uptr->tape_ctx = ctx = (struct tape_context *)calloc(1, sizeof(struct tape_conte
 ctx->dptr = dptr;                                       /* save DEVICE pointer */
 ctx->dbit = dbit;                                       /* save debug bit */
 ctx->auto_format = auto_format;                         /* save that we auto selected format */
+if ((sim_switches & SWMASK ('I')) &&                    /* record index requested */
+    ((MT_GET_FMT (uptr) == MTUF_F_STD) ||               /*   for a format with */
+     (MT_GET_FMT (uptr) == MTUF_F_E11))) {              /*   symmetric record metadata? */
+    ctx->idx_enabled = TRUE;
+    sim_tape_idx_load (uptr);                           /* use a saved index if it's current */
+    }
+if ((MT_BUF (uptr->dynflags) != 0) &&                   /* sequential buffer requested */
+    ((MT_GET_FMT (uptr) == MTUF_F_STD) ||               /*   for a format */
+     (MT_GET_FMT (uptr) == MTUF_F_E11))) {              /*   that supports it? */
+    ctx->iobuf_size = MT_BUF_SIZE (uptr->dynflags);
+    ctx->iobuf = (uint8 *)malloc (ctx->iobuf_size);
+    if (ctx->iobuf == NULL)                             /* no memory? */
+        ctx->iobuf_size = 0;                            /*   then run unbuffered */
+    }
 
 sim_tape_rewind (uptr);
 
@@ -560,6 +603,8 @@ sim_tape_clr_async (uptr);
 r = detach_unit (uptr);                                 /* detach unit */
 if (r != SCPE_OK)
     return r;
+sim_tape_idx_free (uptr);                               /* release record index */
+free (ctx->iobuf);                                      /* release sequential buffer */
 switch (f) {                                            /* case on format */
 
     case MTUF_F_TPC:                                    /* TPC */
@@ -604,6 +649,9 @@ fprintf (st, "    -E          Must Exist (if not specified an attempt to create
 fprintf (st, "                virtual tape will be attempted).\n");
 fprintf (st, "    -F          Open the indicated tape container in a specific format (default\n");
 fprintf (st, "                is SIMH, alternatives are E11, TPC and P7B)\n");
+fprintf (st, "    -I          Index the records of a SIMH or E11 format tape so that spacing\n");
+fprintf (st, "                and positioning don't have to read the tape.  The index is kept\n");
+fprintf (st, "                in tapefile.idx and is discarded when the tape is written.\n");
 return SCPE_OK;
 }
 
@@ -724,6 +772,11 @@ MT_CLR_PNU (uptr);                                      /* clear the position-no
 if ((uptr->flags & UNIT_ATT) == 0)                      /* if the unit is not attached */
     return MTSE_UNATT;                                  /*   then quit with an error */
 
+if (sim_tape_buf_flush (uptr) != MTSE_OK) {             /* if pending writes can't be completed */
+    MT_SET_PNU (uptr);                                  /*   then set position not updated */
+    return MTSE_IOERR;                                  /*     and quit with I/O error status */
+    }
+
 if (sim_fseek (uptr->fileref, uptr->pos, SEEK_SET)) {   /* set the initial tape position; if it fails */
     MT_SET_PNU (uptr);                                  /*   then set position not updated */
     status = sim_tape_ioerr (uptr);                     /*     and quit with I/O error status */
@@ -977,6 +1030,9 @@ MT_CLR_PNU (uptr);                                      /* clear the position-no
 if ((uptr->flags & UNIT_ATT) == 0)                      /* if the unit is not attached */
     return MTSE_UNATT;                                  /*   then quit with an error */
 
+if (sim_tape_buf_flush (uptr) != MTSE_OK)               /* if pending writes can't be completed */
+    return MTSE_IOERR;                                  /*   then quit with I/O error status */
+
 if (sim_tape_bot (uptr))                                /* if the unit is positioned at the BOT */
     status = MTSE_BOT;                                  /*   then reading backward is not possible */
 
@@ -1143,6 +1199,560 @@ sim_debug (MTSE_DBG_STR, ctx->dptr, "rd_lnt: st: %d, lnt: %d, pos: %" T_ADDR_FMT
 return status;
 }
 
+/* Record index (ATTACH -I)
+
+   Spacing over records with the routines above costs a file seek and read
+   for every object passed, so skipping to a file near the end of a large
+   tape reads metadata from the whole tape, and does it again every time
+   the tape is rewound and repositioned.  The record index remembers the
+   starting position and metadata marker of each object (data record or
+   tape mark) on the tape, so that record spacing becomes a table lookup.
+
+   The index has idx_count + 1 position entries; the last is the position of
+   the end of medium.  It is built by a single forward pass the first time
+   the tape is spaced, and is saved in the file "<tapefile>.idx" together
+   with the size and modification time of the tape image, so that a later
+   attach of the unchanged image can use it without rereading the tape.
+
+   Only SIMH and E11 tapes that contain no erase gaps are indexed; spacing
+   over a gap has side effects (runaway detection, PNU rules) that the table
+   does not model.  Any write to the tape discards the index and the saved
+   file, and indexing is not resumed until the tape is attached again.
+   Spacing from a position not in the index, or onto the end of medium,
+   uses the normal routines.
+*/
+
+#define IDX_MAGIC       0x58444954                      /* "TIDX" */
+#define IDX_VERSION     1
+#define IDX_HDR_MAGIC   0                               /* header words */
+#define IDX_HDR_VERSION 1
+#define IDX_HDR_FORMAT  2
+#define IDX_HDR_COUNT   3
+#define IDX_HDR_SIZE    4
+#define IDX_HDR_MTIME   5
+#define IDX_HDR_WORDS   6
+
+static char *sim_tape_idx_name (UNIT *uptr)
+{
+char *name = (char *)malloc (strlen (uptr->filename) + 5);
+
+if (name != NULL)
+    sprintf (name, "%s.idx", uptr->filename);
+return name;
+}
+
+static void sim_tape_idx_stamp (UNIT *uptr, t_uint64 *hdr)
+{
+struct stat info;
+
+hdr[IDX_HDR_MAGIC] = IDX_MAGIC;
+hdr[IDX_HDR_VERSION] = IDX_VERSION;
+hdr[IDX_HDR_FORMAT] = MT_GET_FMT (uptr);
+hdr[IDX_HDR_SIZE] = (t_uint64)sim_fsize_ex (uptr->fileref);
+hdr[IDX_HDR_MTIME] = (stat (uptr->filename, &info) == 0) ? (t_uint64)info.st_mtime : 0;
+}
+
+static void sim_tape_idx_free (UNIT *uptr)
+{
+struct tape_context *ctx = (struct tape_context *)uptr->tape_ctx;
+
+if (ctx == NULL)
+    return;
+free (ctx->idx_pos);
+free (ctx->idx_bc);
+ctx->idx_pos = NULL;
+ctx->idx_bc = NULL;
+ctx->idx_count = ctx->idx_hint = 0;
+}
+
+/* Discard the index because the tape contents are about to change */
+
+static void sim_tape_idx_invalidate (UNIT *uptr)
+{
+struct tape_context *ctx = (struct tape_context *)uptr->tape_ctx;
+char *name;
+
+if ((ctx == NULL) || !ctx->idx_enabled)
+    return;
+sim_debug (ctx->dbit, ctx->dptr, "sim_tape_idx_invalidate(unit=%d)\n", (int)(uptr-ctx->dptr->units));
+ctx->idx_enabled = FALSE;
+sim_tape_idx_free (uptr);
+name = sim_tape_idx_name (uptr);
+if (name != NULL) {
+    remove (name);
+    free (name);
+    }
+}
+
+static void sim_tape_idx_save (UNIT *uptr)
+{
+struct tape_context *ctx = (struct tape_context *)uptr->tape_ctx;
+t_uint64 hdr[IDX_HDR_WORDS], pos;
+char *name = sim_tape_idx_name (uptr);
+FILE *f;
+uint32 i;
+t_bool ok;
+
+if (name == NULL)
+    return;
+f = sim_fopen (name, "wb");
+if (f == NULL) {                                        /* not writable here? */
+    free (name);                                        /*   the index still works */
+    return;                                             /*   for this attach */
+    }
+sim_tape_idx_stamp (uptr, hdr);
+hdr[IDX_HDR_COUNT] = ctx->idx_count;
+ok = (sim_fwrite (hdr, sizeof (t_uint64), IDX_HDR_WORDS, f) == IDX_HDR_WORDS);
+for (i = 0; ok && (i <= ctx->idx_count); i++) {
+    pos = (t_uint64)ctx->idx_pos[i];
+    ok = (sim_fwrite (&pos, sizeof (pos), 1, f) == 1);
+    }
+if (ok)
+    ok = (sim_fwrite (ctx->idx_bc, sizeof (t_mtrlnt), ctx->idx_count, f) == ctx->idx_count);
+fclose (f);
+if (!ok)                                                /* don't leave a partial index */
+    remove (name);
+free (name);
+}
+
+static t_bool sim_tape_idx_alloc (UNIT *uptr, uint32 count)
+{
+struct tape_context *ctx = (struct tape_context *)uptr->tape_ctx;
+t_addr *pos = (t_addr *)realloc (ctx->idx_pos, (count + 1) * sizeof (*pos));
+t_mtrlnt *bc;
+
+if (pos == NULL)
+    return FALSE;
+ctx->idx_pos = pos;
+bc = (t_mtrlnt *)realloc (ctx->idx_bc, (count + 1) * sizeof (*bc));
+if (bc == NULL)
+    return FALSE;
+ctx->idx_bc = bc;
+return TRUE;
+}
+
+static t_bool sim_tape_idx_load (UNIT *uptr)
+{
+struct tape_context *ctx = (struct tape_context *)uptr->tape_ctx;
+t_uint64 hdr[IDX_HDR_WORDS], cur[IDX_HDR_WORDS], pos;
+char *name = sim_tape_idx_name (uptr);
+FILE *f;
+uint32 i, count;
+t_bool ok;
+
+if (name == NULL)
+    return FALSE;
+f = sim_fopen (name, "rb");
+free (name);
+if (f == NULL)
+    return FALSE;
+sim_tape_idx_stamp (uptr, cur);
+ok = (sim_fread (hdr, sizeof (t_uint64), IDX_HDR_WORDS, f) == IDX_HDR_WORDS) &&
+     (hdr[IDX_HDR_MAGIC] == cur[IDX_HDR_MAGIC]) &&      /* ours */
+     (hdr[IDX_HDR_VERSION] == cur[IDX_HDR_VERSION]) &&
+     (hdr[IDX_HDR_FORMAT] == cur[IDX_HDR_FORMAT]) &&    /* same format */
+     (hdr[IDX_HDR_SIZE] == cur[IDX_HDR_SIZE]) &&        /* and the tape */
+     (hdr[IDX_HDR_MTIME] == cur[IDX_HDR_MTIME]) &&      /*   is unchanged? */
+     (hdr[IDX_HDR_COUNT] < MTR_MAXLEN * (t_uint64)64);
+count = ok ? (uint32)hdr[IDX_HDR_COUNT] : 0;
+if (ok)
+    ok = sim_tape_idx_alloc (uptr, count);
+for (i = 0; ok && (i <= count); i++) {
+    ok = (sim_fread (&pos, sizeof (pos), 1, f) == 1) &&
+         ((i == 0) || (pos > ctx->idx_pos[i - 1]));     /* positions must ascend */
+    if (ok)
+        ctx->idx_pos[i] = (t_addr)pos;
+    }
+if (ok)
+    ok = (sim_fread (ctx->idx_bc, sizeof (t_mtrlnt), count, f) == count);
+fclose (f);
+if (!ok) {
+    sim_tape_idx_free (uptr);
+    return FALSE;
+    }
+ctx->idx_count = count;
+ctx->idx_hint = 0;
+sim_debug (ctx->dbit, ctx->dptr, "sim_tape_idx_load(unit=%d) %u objects\n", (int)(uptr-ctx->dptr->units), count);
+return TRUE;
+}
+
+/* Build the index by spacing over every object on the tape.  The tape
+   position and PNU state are preserved.  The index is abandoned if an
+   object's size on the tape isn't accounted for by its metadata, which
+   is how a gap shows itself.
+*/
+
+static t_bool sim_tape_idx_build (UNIT *uptr)
+{
+struct tape_context *ctx = (struct tape_context *)uptr->tape_ctx;
+uint32 f = MT_GET_FMT (uptr);
+t_addr saved_pos = uptr->pos, start;
+t_bool saved_pnu = MT_TST_PNU (uptr);
+uint32 count = 0, cap = 0;
+t_mtrlnt bc, sbc;
+t_stat st;
+t_bool ok = TRUE;
+
+uptr->pos = 0;
+while (ok) {
+    start = uptr->pos;
+    st = sim_tape_rdlntf (uptr, &bc);
+    if (st == MTSE_EOM) {                               /* done? */
+        ok = (uptr->pos == start);
+        break;
+        }
+    if (st == MTSE_TMK)
+        ok = (uptr->pos - start == sizeof (t_mtrlnt));
+    else if (st == MTSE_OK) {
+        sbc = MTR_L (bc);
+        ok = (uptr->pos - start == 2 * sizeof (t_mtrlnt) + (f == MTUF_F_STD ? (sbc + 1) & ~1 : sbc));
+        }
+    else
+        ok = FALSE;                                     /* I/O error or runaway */
+    if (ok && (count == cap)) {
+        cap = cap ? 2 * cap : 1024;
+        ok = sim_tape_idx_alloc (uptr, cap);
+        }
+    if (ok) {
+        ctx->idx_pos[count] = start;
+        ctx->idx_bc[count++] = bc;
+        }
+    }
+if (ok)
+    ctx->idx_pos[count] = uptr->pos;                    /* end of medium */
+uptr->pos = saved_pos;
+if (saved_pnu)
+    MT_SET_PNU (uptr);
+else
+    MT_CLR_PNU (uptr);
+if (!ok) {
+    sim_debug (ctx->dbit, ctx->dptr, "sim_tape_idx_build(unit=%d) tape can't be indexed\n", (int)(uptr-ctx->dptr->units));
+    sim_tape_idx_free (uptr);
+    ctx->idx_enabled = FALSE;                           /* don't try again */
+    return FALSE;
+    }
+ctx->idx_count = count;
+ctx->idx_hint = 0;
+sim_debug (ctx->dbit, ctx->dptr, "sim_tape_idx_build(unit=%d) %u objects\n", (int)(uptr-ctx->dptr->units), count);
+sim_tape_idx_save (uptr);
+return TRUE;
+}
+
+/* Locate the object starting at "pos"; returns idx_count for the end of
+   medium and -1 if "pos" isn't an object boundary.  Sequential spacing
+   is the common case, so the object after the last one located is tried
+   before searching.
+*/
+
+static int32 sim_tape_idx_find (UNIT *uptr, t_addr pos)
+{
+struct tape_context *ctx = (struct tape_context *)uptr->tape_ctx;
+uint32 lo = 0, hi = ctx->idx_count, mid;
+
+if ((ctx->idx_hint <= hi) && (ctx->idx_pos[ctx->idx_hint] == pos))
+    return (int32)ctx->idx_hint;
+while (lo <= hi) {
+    mid = lo + (hi - lo) / 2;
+    if (ctx->idx_pos[mid] == pos)
+        return (int32)mid;
+    if (ctx->idx_pos[mid] < pos)
+        lo = mid + 1;
+    else if (mid == 0)
+        break;
+    else
+        hi = mid - 1;
+    }
+return -1;
+}
+
+static t_bool sim_tape_idx_ready (UNIT *uptr)
+{
+struct tape_context *ctx = (struct tape_context *)uptr->tape_ctx;
+
+if (!ctx->idx_enabled)
+    return FALSE;
+if (ctx->idx_pos == NULL)
+    return sim_tape_idx_build (uptr);
+return TRUE;
+}
+
+/* Space one object forward or reverse using the index.  Returns FALSE if the
+   index can't handle the request, which is then left to the normal routines.
+*/
+
+static t_bool sim_tape_idx_fwd (UNIT *uptr, t_mtrlnt *bc, t_stat *st)
+{
+struct tape_context *ctx = (struct tape_context *)uptr->tape_ctx;
+int32 i;
+
+if (!sim_tape_idx_ready (uptr))
+    return FALSE;
+i = sim_tape_idx_find (uptr, uptr->pos);
+if ((i < 0) || ((uint32)i >= ctx->idx_count))           /* unknown position or EOM? */
+    return FALSE;
+MT_CLR_PNU (uptr);
+*bc = ctx->idx_bc[i];
+uptr->pos = ctx->idx_pos[i + 1];
+ctx->idx_hint = i + 1;
+*st = (*bc == MTR_TMK) ? MTSE_TMK : MTSE_OK;
+sim_debug (MTSE_DBG_STR, ctx->dptr, "rd_lnt: st: %d, lnt: %d, pos: %" T_ADDR_FMT "u (indexed)\n", *st, *bc, uptr->pos);
+return TRUE;
+}
+
+static t_bool sim_tape_idx_rev (UNIT *uptr, t_mtrlnt *bc, t_stat *st)
+{
+struct tape_context *ctx = (struct tape_context *)uptr->tape_ctx;
+int32 i;
+
+if (!sim_tape_idx_ready (uptr))
+    return FALSE;
+i = sim_tape_idx_find (uptr, uptr->pos);
+if (i <= 0)                                             /* unknown position or BOT? */
+    return FALSE;
+*bc = ctx->idx_bc[i - 1];
+uptr->pos = ctx->idx_pos[i - 1];
+ctx->idx_hint = i - 1;
+*st = (*bc == MTR_TMK) ? MTSE_TMK : MTSE_OK;
+sim_debug (MTSE_DBG_STR, ctx->dptr, "rd_lnt: st: %d, lnt: %d, pos: %" T_ADDR_FMT "u (indexed)\n", *st, *bc, uptr->pos);
+return TRUE;
+}
+
+/* Sequential I/O buffer (SET BUFFER)
+
+   Reading a record costs a seek and a read for the leading metadatum and
+   another seek and read for the data, and writing a record costs a seek and
+   three writes, so streaming a tape is bound by file system calls.  With a
+   buffer configured, forward record reads of SIMH and E11 tapes are served
+   from a read-ahead buffer that is refilled with a single read, and forward
+   record and tape mark writes are collected and written out together.
+
+   The buffer holds either read-ahead or write-behind data, never both.
+   Write-behind data is written out before any other operation touches the
+   tape image (reverse reads, spacing, gaps, erases), when a tape mark is
+   written, on rewind and when the unit is flushed or detached.  Read-ahead
+   data is discarded by any write.  Objects the buffer doesn't handle (gaps,
+   end of medium, records larger than the buffer) are read by the normal
+   routines, so status and position semantics are unchanged.
+
+   An error writing out write-behind data is reported by the operation that
+   caused the flush.
+*/
+
+static t_mtrlnt sim_tape_buf_getlnt (const uint8 *p)    /* metadata are little-endian */
+{
+return (t_mtrlnt)p[0] | ((t_mtrlnt)p[1] << 8) | ((t_mtrlnt)p[2] << 16) | ((t_mtrlnt)p[3] << 24);
+}
+
+static void sim_tape_buf_putlnt (uint8 *p, t_mtrlnt v)
+{
+p[0] = (uint8)v;
+p[1] = (uint8)(v >> 8);
+p[2] = (uint8)(v >> 16);
+p[3] = (uint8)(v >> 24);
+}
+
+/* Write out any write-behind data */
+
+static t_stat sim_tape_buf_flush (UNIT *uptr)
+{
+struct tape_context *ctx = (struct tape_context *)uptr->tape_ctx;
+uint32 len;
+
+if ((ctx == NULL) || !ctx->iobuf_write)
+    return MTSE_OK;
+len = ctx->iobuf_len;
+ctx->iobuf_write = FALSE;
+ctx->iobuf_len = 0;
+if (len == 0)
+    return MTSE_OK;
+ctx->wr_flushes = ctx->wr_flushes + 1;
+sim_debug (MTSE_DBG_STR, ctx->dptr, "buf_flush: len: %d, pos: %" T_ADDR_FMT "u\n", len, ctx->iobuf_pos);
+if (sim_fseek (uptr->fileref, ctx->iobuf_pos, SEEK_SET) ||
+    (sim_fwrite (ctx->iobuf, sizeof (uint8), len, uptr->fileref) != len) ||
+    ferror (uptr->fileref))
+    return sim_tape_ioerr (uptr);
+return MTSE_OK;
+}
+
+/* Write out write-behind data and discard read-ahead data before an
+   unbuffered write.  Returns MTSE_IOERR if the write-behind data couldn't
+   be written. */
+
+static t_stat sim_tape_buf_drop (UNIT *uptr)
+{
+struct tape_context *ctx = (struct tape_context *)uptr->tape_ctx;
+t_stat st = sim_tape_buf_flush (uptr);
+
+if (ctx != NULL)
+    ctx->iobuf_len = 0;
+return st;
+}
+
+/* Make "len" bytes at "pos" available in the read-ahead buffer.  Returns the
+   offset of "pos" in the buffer or -1 if that isn't possible (end of file,
+   I/O error); the caller then uses the unbuffered routines, which report
+   the condition properly.  "*filled" is set if the buffer had to be refilled.
+*/
+
+static int32 sim_tape_buf_fetch (UNIT *uptr, t_addr pos, uint32 len, t_bool *filled)
+{
+struct tape_context *ctx = (struct tape_context *)uptr->tape_ctx;
+
+if ((pos >= ctx->iobuf_pos) &&
+    (pos + len <= ctx->iobuf_pos + ctx->iobuf_len))     /* already there? */
+    return (int32)(pos - ctx->iobuf_pos);
+if ((len > ctx->iobuf_size) ||                          /* won't fit */
+    sim_fseek (uptr->fileref, pos, SEEK_SET)) {         /*   or can't get there? */
+    ctx->iobuf_len = 0;
+    return -1;
+    }
+ctx->rd_fills = ctx->rd_fills + 1;
+ctx->iobuf_pos = pos;
+ctx->iobuf_len = (uint32)sim_fread (ctx->iobuf, sizeof (uint8), ctx->iobuf_size, uptr->fileref);
+*filled = TRUE;
+if (ferror (uptr->fileref)) {
+    clearerr (uptr->fileref);
+    ctx->iobuf_len = 0;
+    }
+if (ctx->iobuf_len < len)
+    return -1;
+return 0;
+}
+
+/* Read a record forward from the read-ahead buffer.  Returns FALSE if the
+   object at the current position must be read by the unbuffered routines.
+*/
+
+static t_bool sim_tape_buf_rdrecf (UNIT *uptr, uint8 *buf, t_mtrlnt *bc, t_mtrlnt max, t_stat *st)
+{
+struct tape_context *ctx = (struct tape_context *)uptr->tape_ctx;
+uint32 f = MT_GET_FMT (uptr);
+t_mtrlnt tbc, rbc;
+uint32 size;
+int32 off;
+t_bool filled = FALSE;
+
+if ((ctx->iobuf == NULL) || (uptr->flags & UNIT_ATT) == 0)
+    return FALSE;
+if (ctx->iobuf_write &&                                 /* direction change? */
+    (sim_tape_buf_flush (uptr) != MTSE_OK)) {
+    MT_SET_PNU (uptr);
+    *st = MTSE_IOERR;
+    return TRUE;
+    }
+off = sim_tape_buf_fetch (uptr, uptr->pos, sizeof (t_mtrlnt), &filled);
+if (off < 0)
+    return FALSE;
+tbc = sim_tape_buf_getlnt (ctx->iobuf + off);
+if (tbc == MTR_TMK) {                                   /* tape mark? */
+    size = sizeof (t_mtrlnt);
+    rbc = 0;
+    }
+else {
+    rbc = MTR_L (tbc);
+    if (rbc > MTR_MAXLEN)                               /* gap, EOM or bad metadatum? */
+        return FALSE;
+    size = 2 * sizeof (t_mtrlnt) + (f == MTUF_F_STD ? (rbc + 1) & ~1 : rbc);
+    off = sim_tape_buf_fetch (uptr, uptr->pos, size, &filled);
+    if (off < 0)                                        /* record not all there? */
+        return FALSE;
+    }
+ctx->rd_records = ctx->rd_records + 1;
+if (!filled)
+    ctx->rd_hits = ctx->rd_hits + 1;
+MT_CLR_PNU (uptr);
+sim_debug (MTSE_DBG_STR, ctx->dptr, "rd_lnt: st: %d, lnt: %d, pos: %" T_ADDR_FMT "u (buffered)\n",
+           (tbc == MTR_TMK) ? MTSE_TMK : MTSE_OK, tbc, uptr->pos + size);
+if (tbc == MTR_TMK) {
+    uptr->pos = uptr->pos + size;
+    *st = MTSE_TMK;
+    return TRUE;
+    }
+*bc = rbc;
+if (rbc > max) {                                        /* rec out of range? */
+    MT_SET_PNU (uptr);
+    *st = MTSE_INVRL;
+    return TRUE;
+    }
+memcpy (buf, ctx->iobuf + off + sizeof (t_mtrlnt), rbc);
+uptr->pos = uptr->pos + size;
+sim_tape_data_trace(uptr, buf, rbc, "Record Read", ctx->dptr->dctrl & MTSE_DBG_DAT, MTSE_DBG_STR);
+*st = (MTR_F (tbc)? MTSE_RECE: MTSE_OK);
+return TRUE;
+}
+
+/* Append "len" bytes to the write-behind buffer at the current position;
+   returns the buffer location to fill or NULL if the data can't be buffered.
+*/
+
+static uint8 *sim_tape_buf_append (UNIT *uptr, uint32 len, t_stat *st)
+{
+struct tape_context *ctx = (struct tape_context *)uptr->tape_ctx;
+uint8 *p;
+
+*st = MTSE_OK;
+if ((ctx->iobuf == NULL) || (len > ctx->iobuf_size))
+    return NULL;
+if (!ctx->iobuf_write ||                                /* reading */
+    (uptr->pos != ctx->iobuf_pos + ctx->iobuf_len) ||   /*   or not contiguous */
+    (ctx->iobuf_len + len > ctx->iobuf_size)) {         /*   or full? */
+    *st = sim_tape_buf_flush (uptr);                    /* start over */
+    if (*st != MTSE_OK)
+        return NULL;
+    ctx->iobuf_write = TRUE;
+    ctx->iobuf_pos = uptr->pos;
+    ctx->iobuf_len = 0;
+    }
+p = ctx->iobuf + ctx->iobuf_len;
+ctx->iobuf_len = ctx->iobuf_len + len;
+ctx->wr_records = ctx->wr_records + 1;
+return p;
+}
+
+static t_bool sim_tape_buf_wrrecf (UNIT *uptr, uint8 *buf, t_mtrlnt bc, t_stat *st)
+{
+uint32 f = MT_GET_FMT (uptr);
+t_mtrlnt sbc = MTR_L (bc);
+uint8 *p;
+
+if (f == MTUF_F_STD)
+    sbc = MTR_L ((bc + 1) & ~1);                        /* pad odd length */
+else if (f != MTUF_F_E11)
+    return FALSE;
+p = sim_tape_buf_append (uptr, sbc + 2 * sizeof (t_mtrlnt), st);
+if (p == NULL) {
+    if (*st == MTSE_OK)                                 /* just doesn't fit? */
+        return FALSE;
+    MT_SET_PNU (uptr);
+    return TRUE;
+    }
+sim_tape_buf_putlnt (p, bc);
+memcpy (p + sizeof (t_mtrlnt), buf, sbc);
+sim_tape_buf_putlnt (p + sizeof (t_mtrlnt) + sbc, bc);
+uptr->pos = uptr->pos + sbc + (2 * sizeof (t_mtrlnt)); /* move tape */
+return TRUE;
+}
+
+static t_bool sim_tape_buf_wrtmk (UNIT *uptr, t_stat *st)
+{
+struct tape_context *ctx = (struct tape_context *)uptr->tape_ctx;
+uint8 *p = sim_tape_buf_append (uptr, sizeof (t_mtrlnt), st);
+
+if (p == NULL) {
+    if (*st == MTSE_OK)
+        return FALSE;
+    MT_SET_PNU (uptr);
+    return TRUE;
+    }
+sim_tape_buf_putlnt (p, MTR_TMK);
+sim_debug (MTSE_DBG_STR, ctx->dptr, "wr_lnt: lnt: %d, pos: %" T_ADDR_FMT "u (buffered)\n", MTR_TMK, uptr->pos);
+uptr->pos = uptr->pos + sizeof (t_mtrlnt);              /* move tape */
+*st = sim_tape_buf_flush (uptr);                        /* tape marks end a burst */
+if (*st != MTSE_OK)
+    MT_SET_PNU (uptr);
+return TRUE;
+}
+
 /* Read record forward
 
    Inputs:
@@ -1176,6 +1786,8 @@ if (ctx == NULL)                                        /* if not properly attac
     return sim_messagef (SCPE_IERR, "Bad Attach\n");    /*   that's a problem */
 sim_debug (ctx->dbit, ctx->dptr, "sim_tape_rdrecf(unit=%d, buf=%p, max=%d)\n", (int)(uptr-ctx->dptr->units), buf, max);
 
+if (sim_tape_buf_rdrecf (uptr, buf, bc, max, &st))      /* read ahead? */
+    return st;
 opos = uptr->pos;                                       /* old position */
 st = sim_tape_rdrlfwd (uptr, &tbc);                     /* read rec lnt */
 if (st != MTSE_OK)
@@ -1291,6 +1903,7 @@ t_stat sim_tape_wrrecf (UNIT *uptr, uint8 *buf, t_mtrlnt bc)
 struct tape_context *ctx = (struct tape_context *)uptr->tape_ctx;
 uint32 f = MT_GET_FMT (uptr);
 t_mtrlnt sbc;
+t_stat st;
 
 if (ctx == NULL)                                        /* if not properly attached? */
     return sim_messagef (SCPE_IERR, "Bad Attach\n");    /*   that's a problem */
@@ -1303,8 +1916,18 @@ if ((uptr->flags & UNIT_ATT) == 0)                      /* not attached? */
     return MTSE_UNATT;
 if (sim_tape_wrp (uptr))                                /* write prot? */
     return MTSE_WRP;
+sim_tape_idx_invalidate (uptr);
 if (sbc == 0)                                           /* nothing to do? */
     return MTSE_OK;
+if (sim_tape_buf_wrrecf (uptr, buf, bc, &st)) {         /* write behind? */
+    if (st == MTSE_OK)
+        sim_tape_data_trace(uptr, buf, sbc, "Record Written", ctx->dptr->dctrl & MTSE_DBG_DAT, MTSE_DBG_STR);
+    return st;
+    }
+if (sim_tape_buf_drop (uptr) != MTSE_OK) {              /* if pending writes can't be completed */
+    MT_SET_PNU (uptr);                                  /*   then set position not updated */
+    return MTSE_IOERR;                                  /*     and quit with I/O error status */
+    }
 sim_fseek (uptr->fileref, uptr->pos, SEEK_SET);         /* set pos */
 switch (f) {                                            /* case on format */
 
@@ -1350,6 +1973,7 @@ return r;
 static t_stat sim_tape_wrdata (UNIT *uptr, uint32 dat)
 {
 struct tape_context *ctx = (struct tape_context *)uptr->tape_ctx;
+t_stat st;
 
 MT_CLR_PNU (uptr);
 if ((uptr->flags & UNIT_ATT) == 0)                      /* not attached? */
@@ -1358,6 +1982,13 @@ if (ctx == NULL)                                        /* if not properly attac
     return sim_messagef (SCPE_IERR, "Bad Attach\n");    /*   that's a problem */
 if (sim_tape_wrp (uptr))                                /* write prot? */
     return MTSE_WRP;
+sim_tape_idx_invalidate (uptr);
+if ((dat == MTR_TMK) && sim_tape_buf_wrtmk (uptr, &st)) /* write behind? */
+    return st;
+if (sim_tape_buf_drop (uptr) != MTSE_OK) {              /* if pending writes can't be completed */
+    MT_SET_PNU (uptr);                                  /*   then set position not updated */
+    return MTSE_IOERR;                                  /*     and quit with I/O error status */
+    }
 sim_fseek (uptr->fileref, uptr->pos, SEEK_SET);         /* set pos */
 sim_fwrite (&dat, sizeof (t_mtrlnt), 1, uptr->fileref);
 if (ferror (uptr->fileref)) {                           /* error? */
@@ -1570,6 +2201,11 @@ else if (sim_tape_wrp (uptr))                           /* otherwise if the unit
 else if (gap_size == 0 || format != MTUF_F_STD)         /* otherwise if zero length or gaps aren't supported */
     return MTSE_OK;                                     /*   then take no action */
 
+sim_tape_idx_invalidate (uptr);                         /* the tape is about to change */
+if (sim_tape_buf_drop (uptr) != MTSE_OK) {              /* if pending writes can't be completed */
+    MT_SET_PNU (uptr);                                  /*   then set position not updated */
+    return MTSE_IOERR;                                  /*     and quit with I/O error status */
+    }
 file_size = sim_fsize (uptr->fileref);                  /* get the file size */
 
 if (sim_fseek (uptr->fileref, uptr->pos, SEEK_SET)) {   /* position the tape; if it fails */
@@ -1770,6 +2406,12 @@ else if (sim_tape_wrp (uptr))                           /* otherwise if the unit
 else if (gap_size == 0 || format != MTUF_F_STD)         /* otherwise if the gap length is zero or unsupported */
     return MTSE_OK;                                     /*   then take no action */
 
+sim_tape_idx_invalidate (uptr);                         /* the tape is about to change */
+if (sim_tape_buf_drop (uptr) != MTSE_OK) {              /* if pending writes can't be completed */
+    MT_SET_PNU (uptr);                                  /*   then set position not updated */
+    return MTSE_IOERR;                                  /*     and quit with I/O error status */
+    }
+
 gap_pos = uptr->pos;                                    /* save the starting position */
 
 if (gap_size == meta_size) {                            /* if the request is for a single metadatum */
@@ -1966,7 +2608,8 @@ if (ctx == NULL)                                        /* if not properly attac
     return sim_messagef (SCPE_IERR, "Bad Attach\n");    /*   that's a problem */
 sim_debug (ctx->dbit, ctx->dptr, "sim_tape_sprecf(unit=%d)\n", (int)(uptr-ctx->dptr->units));
 
-st = sim_tape_rdrlfwd (uptr, bc);                       /* get record length */
+if (!sim_tape_idx_fwd (uptr, bc, &st))                  /* not in the record index? */
+    st = sim_tape_rdrlfwd (uptr, bc);                   /* get record length */
 *bc = MTR_L (*bc);
 return st;
 }
@@ -2061,7 +2704,8 @@ if (MT_TST_PNU (uptr)) {
     *bc = 0;
     return MTSE_OK;
     }
-st = sim_tape_rdrlrev (uptr, bc);                       /* get record length */
+if (!sim_tape_idx_rev (uptr, bc, &st))                  /* not in the record index? */
+    st = sim_tape_rdrlrev (uptr, bc);                   /* get record length */
 *bc = MTR_L (*bc);
 return st;
 }
@@ -2346,6 +2990,8 @@ if (uptr->flags & UNIT_ATT) {
     if (ctx == NULL)                                    /* if not properly attached? */
         return sim_messagef (SCPE_IERR, "Bad Attach\n");/*   that's a problem */
     sim_debug (ctx->dbit, ctx->dptr, "sim_tape_rewind(unit=%d)\n", (int)(uptr-ctx->dptr->units));
+    if (sim_tape_buf_flush (uptr) != MTSE_OK)           /* write out write-behind data */
+        return MTSE_IOERR;
     }
 uptr->pos = 0;
 MT_CLR_PNU (uptr);
@@ -2670,6 +3316,56 @@ else
 return SCPE_OK;
 }
 
+/* Set the sequential I/O buffer size
+
+   The size is given in KB and is rounded up to a power of two between 1KB
+   and 16MB; BUFFER=0 disables buffering.  The size is kept in the unit's
+   dynamic flags so that it survives detach, and takes effect at the next
+   attach of a SIMH or E11 format tape.
+*/
+
+t_stat sim_tape_set_buffer (UNIT *uptr, int32 val, CONST char *cptr, void *desc)
+{
+uint32 kb, k;
+t_stat r;
+
+if ((cptr == NULL) || (*cptr == 0))
+    return SCPE_ARG;
+if (uptr->flags & UNIT_ATT)
+    return SCPE_ALATT;
+kb = (uint32) get_uint (cptr, 10, MT_BUF_SIZE (MTVF_BUF_MASK) / 1024, &r);
+if (r != SCPE_OK)
+    return SCPE_ARG;
+k = 0;
+if (kb != 0)                                            /* round up to a power of 2 */
+    for (k = 1; MT_BUF_SIZE (k << UNIT_V_DF_TAPEBUF) < kb * 1024; k++)
+        ;
+uptr->dynflags = (uptr->dynflags & ~MTVF_BUF_MASK) | (k << UNIT_V_DF_TAPEBUF);
+return SCPE_OK;
+}
+
+/* Show the sequential I/O buffer size and how well it is working */
+
+t_stat sim_tape_show_buffer (FILE *st, UNIT *uptr, int32 val, CONST void *desc)
+{
+struct tape_context *ctx = (struct tape_context *)uptr->tape_ctx;
+
+if (MT_BUF (uptr->dynflags) == 0) {
+    fprintf (st, "unbuffered");
+    return SCPE_OK;
+    }
+fprintf (st, "buffer=%uKB", MT_BUF_SIZE (uptr->dynflags) / 1024);
+if ((uptr->flags & UNIT_ATT) && (ctx != NULL) && (ctx->iobuf != NULL)) {
+    if (ctx->rd_records)
+        fprintf (st, ", %" LL_FMT "u reads %.1f%% hits in %" LL_FMT "u transfers",
+                 ctx->rd_records, (100.0 * ctx->rd_hits) / ctx->rd_records, ctx->rd_fills);
+    if (ctx->wr_records)
+        fprintf (st, ", %" LL_FMT "u writes in %" LL_FMT "u transfers",
+                 ctx->wr_records, ctx->wr_flushes);
+    }
+return SCPE_OK;
+}
+
 /* Set the tape density.
 
    Set the density of the specified tape unit either to the value supplied or to
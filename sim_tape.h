@@ -125,6 +125,10 @@ typedef uint16          t_tpclnt;                       /* magtape rec lnt */
 #define MTVF_DENS_MASK  (((1u << UNIT_S_DF_TAPE) - 1) << UNIT_V_DF_TAPE)
 #define MT_DENS(f)      (((f) & MTVF_DENS_MASK) >> UNIT_V_DF_TAPE)
 
+#define MTVF_BUF_MASK   (((1u << UNIT_S_DF_TAPEBUF) - 1) << UNIT_V_DF_TAPEBUF)
+#define MT_BUF(f)       (((f) & MTVF_BUF_MASK) >> UNIT_V_DF_TAPEBUF)
+#define MT_BUF_SIZE(f)  (512u << MT_BUF (f))            /* sequential buffer size in bytes */
+
 #define MT_NONE_VALID   (1u << MT_DENS_NONE)            /* density not set is valid */
 #define MT_200_VALID    (1u << MT_DENS_200)             /* 200 bpi is valid */
 #define MT_556_VALID    (1u << MT_DENS_556)             /* 556 bpi is valid */
@@ -207,6 +211,8 @@ t_stat sim_tape_set_capac (UNIT *uptr, int32 val, CONST char *cptr, void *desc);
 t_stat sim_tape_show_capac (FILE *st, UNIT *uptr, int32 val, CONST void *desc);
 t_stat sim_tape_set_dens (UNIT *uptr, int32 val, CONST char *cptr, void *desc);
 t_stat sim_tape_show_dens (FILE *st, UNIT *uptr, int32 val, CONST void *desc);
+t_stat sim_tape_set_buffer (UNIT *uptr, int32 val, CONST char *cptr, void *desc);
+t_stat sim_tape_show_buffer (FILE *st, UNIT *uptr, int32 val, CONST void *desc);
 t_stat sim_tape_set_asynch (UNIT *uptr, int latency);
 t_stat sim_tape_clr_asynch (UNIT *uptr);
 
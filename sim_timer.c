@@ -174,6 +174,23 @@ static double sim_throt_peak_cps;
 static double sim_throt_inst_start;
 static uint32 sim_throt_sleep_time = 0;
 static int32 sim_throt_wait = 0;
+static t_bool sim_throt_hires = FALSE;                  /* precise throttling (SET -P THROTTLE) */
+static t_bool sim_throt_hr_active = FALSE;              /* precise throttling calibrated and running */
+static t_uint64 sim_throt_hr_base_ns;                   /* reference time */
+static double sim_throt_hr_base_inst;                   /* instruction count at reference time */
+static double sim_throt_hr_ipns;                        /* desired instructions per nanosecond */
+static double sim_throt_hr_lead_ns;                     /* predicted wake-up latency */
+static double sim_throt_hr_integ_ns;                    /* integral term of the latency prediction */
+static t_uint64 sim_throt_hr_seg_ns;                    /* start of the current run */
+static double sim_throt_hr_seg_inst;                    /* instruction count at start of run */
+static double sim_throt_hr_run_ns;                      /* throttled run time */
+static double sim_throt_hr_run_inst;                    /* instructions executed during run time */
+static t_uint64 sim_throt_hr_checks;                    /* rate checks */
+static t_uint64 sim_throt_hr_sleeps;                    /* sleeps taken */
+static double sim_throt_hr_err_sum_ns;                  /* sum of |wake-up error| */
+static double sim_throt_hr_err_max_ns;                  /* max |wake-up error| */
+static double sim_throt_hr_lost_ns;                     /* time forgiven after host stalls */
+static uint32 sim_throt_hr_slips;                       /* host stalls */
 static UNIT *sim_clock_unit[SIM_NTIMERS+1] = {NULL};
 UNIT * volatile sim_clock_cosched_queue[SIM_NTIMERS+1] = {NULL};
 static int32 sim_cosched_interval[SIM_NTIMERS+1];
@@ -618,6 +635,28 @@ treq.tv_nsec = (milliseconds % MILLIS_PER_SEC) * NANOS_PER_MILLI;
 return sim_os_msec () - stime;
 }
 
+#if defined (CLOCK_MONOTONIC) && defined (TIMER_ABSTIME) && !defined (__APPLE__)
+#define SIM_THROT_HIRES 1                           /* precise throttling available */
+
+static t_uint64 sim_os_nsec (void)
+{
+struct timespec now;
+
+clock_gettime (CLOCK_MONOTONIC, &now);
+return (((t_uint64) now.tv_sec) * 1000000000) + now.tv_nsec;
+}
+
+static void sim_os_nsleep_until (t_uint64 nsec)
+{
+struct timespec treq;
+
+treq.tv_sec = (time_t) (nsec / 1000000000);
+treq.tv_nsec = (long) (nsec % 1000000000);
+while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &treq, NULL) == EINTR)
+    ;
+}
+#endif /* defined (CLOCK_MONOTONIC) && defined (TIMER_ABSTIME) */
+
 #if defined(NEED_THREAD_PRIORITY)
 #undef NEED_THREAD_PRIORITY
 #include <sys/time.h>
@@ -1598,7 +1637,9 @@ if (arg == 0) {
     if ((cptr != NULL) && (*cptr != 0))
         return sim_messagef (SCPE_ARG, "Unexpected NOTHROTTLE argument: %s\n", cptr);
     sim_throt_type = SIM_THROT_NONE;
+    sim_throt_hires = FALSE;
     sim_throt_cancel ();
+    sim_throt_hr_active = FALSE;
     }
 else if (sim_idle_rate_ms == 0) {
     return sim_messagef (SCPE_NOFNC, "Throttling is not available, Minimum OS sleep time is %dms\n", sim_os_sleep_min_ms);
@@ -1625,6 +1666,18 @@ else {
     else if ((c == '/') && (val2 != 0))
         sim_throt_type = SIM_THROT_SPC;
     else return sim_messagef (SCPE_ARG, "Invalid throttle specification: %s\n", cptr);
+    sim_throt_hires = FALSE;
+    sim_throt_hr_active = FALSE;
+    if (sim_switches & SWMASK ('P')) {                  /* precise? */
+#if defined (SIM_THROT_HIRES)
+        if (sim_throt_type == SIM_THROT_SPC)
+            return sim_messagef (SCPE_ARG, "Precise throttling needs a rate (xM, xK or x%%): %s\n", cptr);
+        sim_throt_hires = TRUE;
+        sim_throt_state = SIM_THROT_STATE_INIT;         /* calibrate afresh */
+#else
+        return sim_messagef (SCPE_NOFNC, "Precise throttling is not available on this host\n");
+#endif
+        }
     if (sim_idle_enab) {
         sim_printf ("Idling disabled\n");
         sim_clr_idle (NULL, 0, NULL, NULL);
@@ -1655,6 +1708,119 @@ else
 return SCPE_OK;
 }
 
+/* Precise throttling
+
+   The legacy throttle sleeps for sim_throt_sleep_time ms every sim_throt_wait
+   instructions and re-derives sim_throt_wait from millisecond clock samples
+   every 10 seconds, so the rate wanders by up to sim_throt_drift_pct and the
+   guest sees millisecond sized stalls.
+
+   Precise throttling uses the same calibration states to find the desired
+   rate, then checks about every SIM_THROT_HR_SLICE_NS of simulated time.
+   At each check the time at which the instructions executed since the
+   reference point should be complete is computed from the desired rate in
+   instructions per nanosecond, and the simulator sleeps until that absolute
+   time on the monotonic clock.  Because the deadline is absolute, any
+   oversleep is repaid by the next check and the rate error does not
+   accumulate (the integral action of the controller).  The host's wake-up
+   latency is predicted by a PI controller on the observed wake-up error and
+   the sleep ends that much early, which keeps the per-check timing error
+   small (the proportional action).  If the host falls more than
+   SIM_THROT_HR_MAXLAG_NS behind, the lost time is forgiven and counted
+   rather than recovered by running flat out.
+*/
+
+static void sim_throt_hr_start (double d_cps)
+{
+#if defined (SIM_THROT_HIRES)
+sim_throt_hr_ipns = d_cps / 1000000000.0;
+sim_throt_wait = (int32) (d_cps * (SIM_THROT_HR_SLICE_NS / 1000000000.0));
+if (sim_throt_wait < SIM_THROT_WMIN)
+    sim_throt_wait = SIM_THROT_WMIN;
+sim_throt_hr_lead_ns = sim_throt_hr_integ_ns = 0.0;
+sim_throt_hr_run_ns = sim_throt_hr_run_inst = 0.0;
+sim_throt_hr_err_sum_ns = sim_throt_hr_err_max_ns = sim_throt_hr_lost_ns = 0.0;
+sim_throt_hr_checks = sim_throt_hr_sleeps = 0;
+sim_throt_hr_slips = 0;
+sim_throt_hr_base_ns = sim_throt_hr_seg_ns = sim_os_nsec ();
+sim_throt_hr_base_inst = sim_throt_hr_seg_inst = sim_gtime ();
+sim_throt_hr_active = TRUE;
+sim_debug (DBG_THR, &sim_timer_dev, "sim_throt_hr_start() Precise throttling at %f instructions/ns, check every %d instructions\n",
+                                    sim_throt_hr_ipns, sim_throt_wait);
+#endif
+}
+
+static void sim_throt_hr_resume (void)
+{
+#if defined (SIM_THROT_HIRES)
+sim_throt_hr_base_ns = sim_throt_hr_seg_ns = sim_os_nsec ();
+sim_throt_hr_base_inst = sim_throt_hr_seg_inst = sim_gtime ();
+#endif
+}
+
+static void sim_throt_hr_suspend (void)
+{
+#if defined (SIM_THROT_HIRES)
+sim_throt_hr_run_ns += (double) (sim_os_nsec () - sim_throt_hr_seg_ns);
+sim_throt_hr_run_inst += sim_gtime () - sim_throt_hr_seg_inst;
+#endif
+}
+
+static void sim_throt_hr_svc (void)
+{
+#if defined (SIM_THROT_HIRES)
+double inst = sim_gtime ();
+t_uint64 now = sim_os_nsec ();
+t_uint64 deadline = sim_throt_hr_base_ns + (t_uint64) ((inst - sim_throt_hr_base_inst) / sim_throt_hr_ipns);
+double err, limit = SIM_THROT_HR_SLICE_NS / 2;
+
+++sim_throt_hr_checks;
+if ((double) now + sim_throt_hr_lead_ns >= (double) deadline) { /* on time or behind? */
+    if (now > deadline + SIM_THROT_HR_MAXLAG_NS) {  /* host stalled? */
+        sim_debug (DBG_THR, &sim_timer_dev, "sim_throt_hr_svc() Forgiving %.3f ms of lost time\n", (now - deadline) / 1000000.0);
+        sim_throt_hr_lost_ns += (double) (now - deadline);
+        ++sim_throt_hr_slips;
+        sim_throt_hr_base_ns = now;                 /* new reference point */
+        sim_throt_hr_base_inst = inst;
+        }
+    return;
+    }
+sim_os_nsleep_until (deadline - (t_uint64) sim_throt_hr_lead_ns);
+err = (double) sim_os_nsec () - (double) deadline;  /* + late, - early */
+++sim_throt_hr_sleeps;
+sim_throt_hr_err_sum_ns += fabs (err);
+if (fabs (err) > sim_throt_hr_err_max_ns)
+    sim_throt_hr_err_max_ns = fabs (err);
+sim_throt_hr_integ_ns += SIM_THROT_HR_KI * err;     /* predict the next wake-up latency */
+sim_throt_hr_integ_ns = MAX (0.0, MIN (limit, sim_throt_hr_integ_ns));
+sim_throt_hr_lead_ns = SIM_THROT_HR_KP * err + sim_throt_hr_integ_ns;
+sim_throt_hr_lead_ns = MAX (0.0, MIN (limit, sim_throt_hr_lead_ns));
+#endif
+}
+
+static void sim_show_throt_hires (FILE *st)
+{
+double d_cps, a_cps;
+
+if (!sim_throt_hr_active) {
+    fprintf (st, "Precise Throttling:            Waiting for calibration\n");
+    return;
+    }
+d_cps = sim_throt_hr_ipns * 1000000000.0;
+fprintf (st, "Precise Throttling:            checking every %d cycles, %s cycles per second\n", sim_throt_wait, sim_fmt_numeric (d_cps));
+if (sim_throt_hr_run_ns > 0.0) {
+    a_cps = (sim_throt_hr_run_inst * 1000000000.0) / sim_throt_hr_run_ns;
+    fprintf (st, "Achieved Rate:                 %s cycles per second, drift %+.4f%%\n", sim_fmt_numeric (a_cps), (100.0 * (a_cps - d_cps)) / d_cps);
+    }
+if (sim_throt_hr_sleeps)
+    fprintf (st, "Wake-up Error:                 average %.1f us, max %.1f us, %s sleeps in %s checks\n",
+                 sim_throt_hr_err_sum_ns / (1000.0 * sim_throt_hr_sleeps), sim_throt_hr_err_max_ns / 1000.0,
+                 sim_fmt_numeric ((double) sim_throt_hr_sleeps), sim_fmt_numeric ((double) sim_throt_hr_checks));
+fprintf (st, "Predicted Wake-up Latency:     %.1f us\n", sim_throt_hr_lead_ns / 1000.0);
+if (sim_throt_hr_slips)
+    fprintf (st, "Host Stalls:                   %u, %.3f ms forgiven\n", sim_throt_hr_slips, sim_throt_hr_lost_ns / 1000000.0);
+}
+
 t_stat sim_show_throt (FILE *st, DEVICE *dnotused, UNIT *unotused, int32 flag, CONST char *cptr)
 {
 if (sim_idle_rate_ms == 0)
@@ -1664,20 +1830,21 @@ else {
 
     case SIM_THROT_MCYC:
         fprintf (st, "Throttle:                      %d megacycles\n", sim_throt_val);
-        if (sim_throt_wait)
+        if (sim_throt_wait && !sim_throt_hr_active)
             fprintf (st, "Throttling by sleeping for:    %d ms every %d cycles\n", sim_throt_sleep_time, sim_throt_wait);
         break;
 
     case SIM_THROT_KCYC:
         fprintf (st, "Throttle:                      %d kilocycles\n", sim_throt_val);
-        if (sim_throt_wait)
+        if (sim_throt_wait && !sim_throt_hr_active)
             fprintf (st, "Throttling by sleeping for:    %d ms every %d cycles\n", sim_throt_sleep_time, sim_throt_wait);
         break;
 
     case SIM_THROT_PCT:
         if (sim_throt_wait) {
             fprintf (st, "Throttle:                      %d%% of %s cycles per second\n", sim_throt_val, sim_fmt_numeric (sim_throt_peak_cps));
-            fprintf (st, "Throttling by sleeping for:    %d ms every %d cycles\n", sim_throt_sleep_time, sim_throt_wait);
+            if (!sim_throt_hr_active)
+                fprintf (st, "Throttling by sleeping for:    %d ms every %d cycles\n", sim_throt_sleep_time, sim_throt_wait);
             }
         else
             fprintf (st, "Throttle:                      %d%%\n", sim_throt_val);
@@ -1696,6 +1863,8 @@ else {
         if (sim_throt_state != SIM_THROT_STATE_THROTTLE)
             fprintf (st, "Throttle State:                %s - wait: %d\n", (sim_throt_state == SIM_THROT_STATE_INIT) ? "Waiting for Init" : "Timing", sim_throt_wait);
         }
+    if (sim_throt_hires)
+        sim_show_throt_hires (st);
     }
 return SCPE_OK;
 }
@@ -1707,6 +1876,8 @@ if (sim_throt_type != SIM_THROT_NONE) {
         /* Reset recalibration reference times */
         sim_throt_ms_start = sim_os_msec ();
         sim_throt_inst_start = sim_gtime ();
+        if (sim_throt_hr_active)
+            sim_throt_hr_resume ();
         /* Start with prior calibrated delay */
         sim_activate (&sim_throttle_unit, sim_throt_wait);
         }
@@ -1720,6 +1891,8 @@ if (sim_throt_type != SIM_THROT_NONE) {
 
 void sim_throt_cancel (void)
 {
+if (sim_throt_hr_active && sim_is_active (&sim_throttle_unit))
+    sim_throt_hr_suspend ();
 sim_cancel (&sim_throttle_unit);
 }
 
@@ -1819,7 +1992,7 @@ switch (sim_throt_state) {
                 sim_set_throt (0, NULL);
                 return SCPE_OK;
                 }
-            while (1) {
+            while (!sim_throt_hires) {
                 sim_throt_wait = (int32)                /* cycles between sleeps */
                     ((a_cps * d_cps * ((double) sim_throt_sleep_time)) /
                      (1000.0 * (a_cps - d_cps)));
@@ -1829,6 +2002,8 @@ switch (sim_throt_state) {
                 sim_debug (DBG_THR, &sim_timer_dev, "sim_throt_svc() Wait too small, increasing sleep time to %d ms.  Values a_cps = %f, d_cps = %f, wait = %d\n", 
                                                     sim_throt_sleep_time, a_cps, d_cps, sim_throt_wait);
                 }
+            if (sim_throt_hires)                        /* precise? */
+                sim_throt_hr_start (d_cps);
             sim_throt_ms_start = sim_throt_ms_stop;
             sim_throt_inst_start = sim_gtime();
             sim_throt_state = SIM_THROT_STATE_THROTTLE;
@@ -1853,6 +2028,10 @@ switch (sim_throt_state) {
         break;
 
     case SIM_THROT_STATE_THROTTLE:                      /* throttling */
+        if (sim_throt_hr_active) {                      /* precise? */
+            sim_throt_hr_svc ();
+            break;
+            }
         sim_idle_ms_sleep (sim_throt_sleep_time);
         delta_ms = sim_os_msec () - sim_throt_ms_start;
         if (delta_ms >= 10000) {                        /* recompute every 10 sec */
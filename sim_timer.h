@@ -98,6 +98,10 @@ int clock_gettime(int clock_id, struct timespec *tp);
 #define SIM_THROT_STATE_INIT      0                 /* Starting */
 #define SIM_THROT_STATE_TIME      1                 /* Checking Time */
 #define SIM_THROT_STATE_THROTTLE  2                 /* Throttling  */
+#define SIM_THROT_HR_SLICE_NS     1000000           /* precise throttle: ns between checks */
+#define SIM_THROT_HR_MAXLAG_NS    100000000         /* precise throttle: lag that is forgiven */
+#define SIM_THROT_HR_KP           0.5               /* precise throttle: proportional gain */
+#define SIM_THROT_HR_KI           0.125             /* precise throttle: integral gain */
 
 #define TIMER_DBG_IDLE  0x001                       /* Debug Flag for Idle Debugging */
 #define TIMER_DBG_QUEUE 0x002                       /* Debug Flag for Asynch Queue Debugging */
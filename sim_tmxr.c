@@ -67,10 +67,12 @@
    tmxr_reset_ln -                      reset line (drops Telnet/tcp and serial connections)
    tmxr_detach_ln -                     reset line and close per line listener and outgoing destination
    tmxr_getc_ln -                       get character for line
+   tmxr_read_ln -                       get block of characters for line
    tmxr_get_packet_ln -                 get packet from line
    tmxr_get_packet_ln_ex -              get packet from line with separater byte
    tmxr_poll_rx -                       poll receive
    tmxr_putc_ln -                       put character for line
+   tmxr_write_ln -                      put block of characters for line
    tmxr_put_packet_ln -                 put packet on line
    tmxr_put_packet_ln_ex -              put packet on line with separator byte
    tmxr_poll_tx -                       poll transmit
@@ -347,6 +349,11 @@
 
 #include <ctype.h>
 #include <math.h>
+#if defined(_WIN32)
+#define poll WSAPoll
+#else
+#include <poll.h>
+#endif
 
 /* Telnet protocol constants - negatives are for init'ing signed char data */
 
@@ -450,6 +457,94 @@ static u_char mantra[] = {                  /* Telnet Option Negotiation Mantra
 /* Local routines */
 
 static void tmxr_add_to_open_list (TMXR* mux);
+#if defined(SIM_ASYNCH_MUX)
+static void _tmxr_poll_watch (SOCKET sock, TMXR *mp, TMLN *lp);
+static void _tmxr_poll_forget (SOCKET sock);
+#endif
+
+/* Close a line or listening socket, first withdrawing it from the
+   asynchronous poll thread's interest set. */
+
+static void _tmxr_close_sock (SOCKET sock)
+{
+#if defined(SIM_ASYNCH_MUX)
+_tmxr_poll_forget (sock);
+#endif
+sim_close_sock (sock);
+}
+
+static void _tmxr_close_serial (SERHANDLE port)
+{
+#if defined(SIM_ASYNCH_MUX) && !defined(_WIN32) && !defined(VMS)
+_tmxr_poll_forget ((SOCKET)sim_serial_os_fd (port));
+#endif
+sim_close_serial (port);
+}
+
+/* Add the sockets a line has just opened or connected to the
+   asynchronous poll thread's interest set. */
+
+static void _tmxr_watch_line (TMLN *lp)
+{
+#if defined(SIM_ASYNCH_MUX)
+if (lp->sock)
+    _tmxr_poll_watch (lp->sock, lp->mp, lp);
+#if !defined(_WIN32) && !defined(VMS)
+if (lp->serport)
+    _tmxr_poll_watch ((SOCKET)sim_serial_os_fd (lp->serport), lp->mp, lp);
+#endif
+if (lp->connecting)
+    _tmxr_poll_watch (lp->connecting, lp->mp, NULL);
+if (lp->master)
+    _tmxr_poll_watch (lp->master, lp->mp, NULL);
+#endif
+}
+
+static void _tmxr_watch_master (TMXR *mp)
+{
+#if defined(SIM_ASYNCH_MUX)
+if (mp->master)
+    _tmxr_poll_watch (mp->master, mp, NULL);
+#endif
+}
+
+/* Transmit work tracking.
+
+   tmxr_poll_tx only services the lines marked in the mux's txact bitmap.
+   A line is marked whenever output is queued on it (which is also when its
+   transmitter may get stalled) and when it is initialized, and it stays
+   marked until its buffers have drained and it is transmit enabled again.
+   Every line is marked on each connection poll, so a line whose state a
+   device changed directly (for example by clearing xmte) is still noticed.
+*/
+
+static void tmxr_txact_all (TMXR *mp)
+{
+int32 words = (mp->lines + 31) / 32;
+
+if (words > mp->txactsz) {
+    uint32 *act = (uint32 *)realloc (mp->txact, words * sizeof (*act));
+
+    if (act == NULL)                                    /* no bitmap? */
+        return;                                         /*   tmxr_poll_tx polls every line */
+    mp->txact = act;
+    mp->txactsz = words;
+    }
+if (mp->txact)
+    memset (mp->txact, 0xFF, mp->txactsz * sizeof (*mp->txact));
+}
+
+static void tmxr_txact_ln (TMLN *lp)
+{
+TMXR *mp = lp->mp;
+int32 ln;
+
+if (mp == NULL)
+    return;
+ln = (int32)(lp - mp->ldsc);
+if ((ln >= 0) && ((ln / 32) < mp->txactsz))
+    mp->txact[ln / 32] |= 1u << (ln % 32);
+}
 
 /* Initialize the line state.
 
@@ -464,6 +559,7 @@ static void tmxr_add_to_open_list (TMXR* mux);
 
 static void tmxr_init_line (TMLN *lp)
 {
+tmxr_txact_ln (lp);                                     /* poll_tx must look at it */
 lp->tsta = 0;                                           /* init telnet state */
 lp->xmte = 1;                                           /* enable transmit */
 lp->dstb = 0;                                           /* default bin mode */
@@ -1024,6 +1120,7 @@ srand((unsigned int)poll_time);
 tmxr_debug_trace (mp, "tmxr_poll_conn()");
 
 mp->last_poll_time = poll_time;
+tmxr_txact_all (mp);                                    /* revisit every line's transmit state */
 
 /* Check for a pending Telnet/tcp connection */
 
@@ -1114,6 +1211,7 @@ if (mp->master) {
             lp = mp->ldsc + i;                          /* get line desc */
             lp->conn = TRUE;                            /* record connection */
             lp->sock = newsock;                         /* save socket */
+            _tmxr_watch_line (lp);
             lp->ipad = address;                         /* ip address */
             tmxr_init_line (lp);                        /* init line */
             lp->notelnet = mp->notelnet;                /* apply mux default telnet setting */
@@ -1169,6 +1267,7 @@ for (i = 0; i < mp->lines; i++) {                       /* check each line in se
                             lp->conn = TRUE;                    /* record connection */
                             lp->sock = lp->connecting;          /* it now looks normal */
                             lp->connecting = 0;
+                            _tmxr_watch_line (lp);
                             lp->ipad = (char *)realloc (lp->ipad, 1+strlen (lp->destination));
                             strcpy (lp->ipad, lp->destination);
                             lp->cnms = sim_os_msec ();
@@ -1212,7 +1311,7 @@ for (i = 0; i < mp->lines; i++) {                       /* check each line in se
                             if (lp->connecting) {
                                 sprintf (msg, "tmxr_poll_conn() - aborting outgoing line connection attempt to: %s", lp->destination);
                                 tmxr_debug_connect_line (lp, msg);
-                                sim_close_sock (lp->connecting);    /* abort our as yet unconnnected socket */
+                                _tmxr_close_sock (lp->connecting);    /* abort our as yet unconnnected socket */
                                 lp->connecting = 0;
                                 }
                             }
@@ -1220,6 +1319,7 @@ for (i = 0; i < mp->lines; i++) {                       /* check each line in se
                             if ((!lp->modem_control) || (lp->modembits & TMXR_MDM_DTR)) {
                                 lp->conn = TRUE;                    /* record connection */
                                 lp->sock = newsock;                 /* save socket */
+                                _tmxr_watch_line (lp);
                                 lp->ipad = address;                 /* ip address */
                                 tmxr_init_line (lp);                /* init line */
                                 if (!lp->notelnet) {
@@ -1257,6 +1357,7 @@ for (i = 0; i < mp->lines; i++) {                       /* check each line in se
         sprintf (msg, "tmxr_poll_conn() - establishing outgoing connection to: %s", lp->destination);
         tmxr_debug_connect_line (lp, msg);
         lp->connecting = sim_connect_sock_ex (lp->datagram ? lp->port : NULL, lp->destination, "localhost", NULL, (lp->datagram ? SIM_SOCK_OPT_DATAGRAM : 0) | (lp->mp->packet ? SIM_SOCK_OPT_NODELAY : 0));
+        _tmxr_watch_line (lp);
         }
 
     }
@@ -1289,7 +1390,7 @@ tmxr_debug_connect_line (lp, msg);
 
 if (lp->serport) {
     if (closeserial) {
-        sim_close_serial (lp->serport);
+        _tmxr_close_serial (lp->serport);
         lp->serport = 0;
         lp->ser_connect_pending = FALSE;
         free (lp->destination);
@@ -1308,7 +1409,7 @@ if (lp->serport) {
     }
 else                                                    /* Telnet connection */
     if (lp->sock) {
-        sim_close_sock (lp->sock);                      /* close socket */
+        _tmxr_close_sock (lp->sock);                      /* close socket */
         free (lp->telnet_sent_opts);
         lp->telnet_sent_opts = NULL;
         lp->sock = 0;
@@ -1320,13 +1421,14 @@ free(lp->ipad);
 lp->ipad = NULL;
 if ((lp->destination) && (!lp->serport)) {
     if (lp->connecting) {
-        sim_close_sock (lp->connecting);
+        _tmxr_close_sock (lp->connecting);
         lp->connecting = 0;
         }
     if ((!lp->modem_control) || (lp->modembits & TMXR_MDM_DTR)) {
         sprintf (msg, "tmxr_reset_ln_ex() - connecting to %s", lp->destination);
         tmxr_debug_connect_line (lp, msg);
         lp->connecting = sim_connect_sock_ex (lp->datagram ? lp->port : NULL, lp->destination, "localhost", NULL, (lp->datagram ? SIM_SOCK_OPT_DATAGRAM : 0) | (lp->mp->packet ? SIM_SOCK_OPT_NODELAY : 0));
+        _tmxr_watch_line (lp);
         }
     }
 tmxr_init_line (lp);                                /* initialize line state */
@@ -1550,6 +1652,7 @@ else {
             
             lp->conn = TRUE;                            /* record connection */
             lp->sock = lp->mp->ring_sock;               /* save socket */
+            _tmxr_watch_line (lp);
             lp->mp->ring_sock = INVALID_SOCKET;
             lp->ipad = lp->mp->ring_ipad;               /* ip address */
             lp->mp->ring_ipad = NULL;
@@ -1615,6 +1718,7 @@ if (lp->mp && lp->modem_control) {                  /* This API ONLY works on mo
                 sprintf (msg, "tmxr_set_get_modem_bits() - establishing outgoing connection to: %s", lp->destination);
                 tmxr_debug_connect_line (lp, msg);
                 lp->connecting = sim_connect_sock_ex (lp->datagram ? lp->port : NULL, lp->destination, "localhost", NULL, (lp->datagram ? SIM_SOCK_OPT_DATAGRAM : 0) | (lp->mp->packet ? SIM_SOCK_OPT_NODELAY : 0));
+                _tmxr_watch_line (lp);
                 }
             }
         }
@@ -1780,6 +1884,68 @@ tmxr_debug_return(lp, val);
 return val;
 }
 
+/* Get a block of characters from specific line
+
+   Inputs:
+        *lp     =       pointer to terminal line descriptor
+        *buf    =       pointer to buffer for the characters
+        max     =       size of buffer
+   Output:
+        number of characters stored in buf
+
+   Implementation notes:
+
+    1. The characters returned are exactly those which the same number of
+       tmxr_getc_ln calls would return, without the TMXR_VALID flag.
+    2. A return value of 0 doesn't mean no input is available.  The next
+       character may have been received with a line break or may be injected 
+       (SEND) input.  Those are delivered one at a time by tmxr_getc_ln, so 
+       callers should call tmxr_getc_ln when tmxr_read_ln returns 0.
+    3. On a rate limited line, as many characters are returned as the time 
+       since the next character was due allows at the line speed, and the
+       time the next one is due is advanced by that many character times.
+*/
+
+int32 tmxr_read_ln (TMLN *lp, uint8 *buf, int32 max)
+{
+int32 j, n;
+double delta = 0.0;
+
+tmxr_debug_trace_line (lp, "tmxr_read_ln()");
+if ((!lp->conn) || (!lp->rcve) ||                       /* not conn or not enb or */
+    (lp->send.extoff < lp->send.insoff))                /* injected input pending? */
+    return 0;                                           /* need tmxr_getc_ln */
+j = lp->rxbpi - lp->rxbpr;                              /* # input chrs */
+n = (j < max) ? j : max;
+if (lp->rxbps) {                                        /* rate limited? */
+    double now = sim_gtime ();
+    double due;
+
+    if (now < lp->rxnexttime)                           /* next char not yet due? */
+        return 0;
+    delta = (lp->rxdelta * sim_timer_inst_per_sec ()) / lp->rxbpsfactor;
+    due = (delta > 0.0) ? 1.0 + floor ((now - lp->rxnexttime) / delta) : (double)n;
+    if (due < (double)n)                                /* limit to chars due by now */
+        n = (int32)due;
+    }
+for (j = 0; j < n; j++)                                 /* stop before a break */
+    if (lp->rbr[lp->rxbpr + j])
+        break;
+n = j;
+if (n > 0) {
+    memcpy (buf, &lp->rxb[lp->rxbpr], n);
+    lp->rxbpr = lp->rxbpr + n;                          /* adv pointer */
+    if (lp->rxbps)                                      /* rate limited? */
+        lp->rxnexttime = floor (lp->rxnexttime + (n * delta));/* next due n char times later */
+    else
+        lp->rxnexttime = floor (sim_gtime () + ((lp->mp->uptr->wait * sim_timer_inst_per_sec ()) / TMXR_RX_BPS_UNIT_SCALE));
+    tmxr_debug (TMXR_DBG_RET, lp, "Read", (char *)buf, n);
+    }
+if (lp->rxbpi == lp->rxbpr)                             /* empty? zero ptrs */
+    lp->rxbpi = lp->rxbpr = 0;
+return n;
+}
+
 /* Get packet from specific line
 
    Inputs:
@@ -1854,16 +2020,68 @@ return SCPE_LOST;
    Outputs:     none
 */
 
+/* Sockets which tmxr_poll_rx asks about, and whether each line may be read */
+
+static struct pollfd *tmxr_rx_fds = NULL;
+static int32 *tmxr_rx_lns = NULL;
+static char *tmxr_rx_rdy = NULL;
+static int32 tmxr_rx_size = 0;
+
+static t_bool tmxr_rx_wanted (TMLN *lp)
+{
+if (!(lp->sock || lp->serport || lp->loopback) || 
+    !(lp->rcve))                                        /* not connected? */
+    return FALSE;
+return ((lp->rxbpi == 0) || (lp->tsta));                /* room for input or in Telnet seq? */
+}
+
 void tmxr_poll_rx (TMXR *mp)
 {
-int32 i, nbytes, j;
+int32 i, nbytes, j, nfds = 0;
 TMLN *lp;
 
 tmxr_debug_trace (mp, "tmxr_poll_rx()");
+if (mp->lines > tmxr_rx_size) {
+    tmxr_rx_fds = (struct pollfd *)realloc (tmxr_rx_fds, mp->lines * sizeof (*tmxr_rx_fds));
+    tmxr_rx_lns = (int32 *)realloc (tmxr_rx_lns, mp->lines * sizeof (*tmxr_rx_lns));
+    tmxr_rx_rdy = (char *)realloc (tmxr_rx_rdy, mp->lines * sizeof (*tmxr_rx_rdy));
+    if ((tmxr_rx_fds == NULL) || (tmxr_rx_lns == NULL) || (tmxr_rx_rdy == NULL)) {
+        sim_printf ("tmxr_poll_rx() - out of memory polling %d lines\r\n", mp->lines);
+        abort ();
+        }
+    tmxr_rx_size = mp->lines;
+    }
+
+/* Rather than attempting a read on every connected socket, ask once which
+   of them have something to say (or have been closed).  Serial and loopback
+   lines are always read. */
+
 for (i = 0; i < mp->lines; i++) {                       /* loop thru lines */
     lp = mp->ldsc + i;                                  /* get line desc */
-    if (!(lp->sock || lp->serport || lp->loopback) || 
-        !(lp->rcve))                                    /* skip if not connected */
+    tmxr_rx_rdy[i] = (char)tmxr_rx_wanted (lp);
+    if (tmxr_rx_rdy[i] && lp->sock && !lp->serport && !lp->loopback) {
+        tmxr_rx_fds[nfds].fd = lp->sock;
+        tmxr_rx_fds[nfds].events = POLLIN;
+        tmxr_rx_fds[nfds].revents = 0;
+        tmxr_rx_lns[nfds++] = i;
+        tmxr_rx_rdy[i] = FALSE;
+        }
+    }
+if (nfds > 0) {
+    if (poll (tmxr_rx_fds, nfds, 0) < 0) {              /* error? read them all */
+        for (j = 0; j < nfds; j++)
+            tmxr_rx_rdy[tmxr_rx_lns[j]] = TRUE;
+        }
+    else {
+        for (j = 0; j < nfds; j++)
+            if (tmxr_rx_fds[j].revents)                 /* data, hangup or error? */
+                tmxr_rx_rdy[tmxr_rx_lns[j]] = TRUE;
+        }
+    }
+
+for (i = 0; i < mp->lines; i++) {                       /* loop thru lines */
+    lp = mp->ldsc + i;                                  /* get line desc */
+    if (!tmxr_rx_rdy[i])                                /* skip if nothing to read */
         continue;
 
     nbytes = 0;
@@ -1885,10 +2103,16 @@ for (i = 0; i < mp->lines; i++) {                       /* loop thru lines */
     else if (nbytes > 0) {                              /* if data rcvd */
 
         tmxr_debug (TMXR_DBG_RCV, lp, "Received", &(lp->rxb[lp->rxbpi]), nbytes);
+#if defined(SIM_ASYNCH_MUX)
+        tmxr_txact_ln (lp);                             /* poll_tx prods the input unit */
+#endif
 
         j = lp->rxbpi;                                  /* start of data */
         lp->rxbpi = lp->rxbpi + nbytes;                 /* adv pointers */
         lp->rxcnt = lp->rxcnt + nbytes;
+        if ((lp->rxbps) && (j == 0) &&                  /* rate limited data arriving */
+            (lp->rxnexttime < sim_gtime ()))            /* after the line went idle? */
+            lp->rxnexttime = floor (sim_gtime ());      /*   then it starts arriving now */
 
 /* Examine new data, remove TELNET cruft before making input available */
 
@@ -2132,6 +2356,7 @@ if ((lp->conn == FALSE) &&                              /* no conn & not buffere
     return SCPE_LOST;
     }
 tmxr_debug_trace_line (lp, "tmxr_putc_ln()");
+tmxr_txact_ln (lp);                                     /* line has transmit work */
 #define TXBUF_AVAIL(lp) ((lp->serport ? 2: lp->txbsz) - tmxr_tqln (lp))
 #define TXBUF_CHAR(lp, c) {                               \
     lp->txb[lp->txbpi++] = (char)(c);                     \
@@ -2168,6 +2393,98 @@ if ((lp->txbfd && !lp->notelnet) || (TXBUF_AVAIL(lp) > 1)) {/* room for char (+
 return SCPE_STALL;                                      /* char not sent */
 }
 
+/* Store a block of characters in line buffer
+
+   Inputs:
+        *lp     =       pointer to line descriptor
+        *buf    =       pointer to characters
+        size    =       number of characters
+   Outputs:
+        count   =       number of characters stored, or -1 if
+                        the line is not connected
+
+   Implementation notes:
+
+    1. The result is the same as calling tmxr_putc_ln for each character
+       until it returns something other than SCPE_OK, but runs of
+       characters are copied, logged and matched against EXPECT rules 
+       as a block.
+    2. If fewer than size characters are stored, the line was stalled
+       exactly as tmxr_putc_ln would have stalled it.
+*/
+
+int32 tmxr_write_ln (TMLN *lp, const uint8 *buf, int32 size)
+{
+int32 i, run, avail;
+t_bool buffered = (lp->txbfd && !lp->notelnet);
+const uint8 *iac;
+
+if ((lp->conn == FALSE) && (!buffered)) {               /* no conn & not buffered telnet? */
+    ++lp->txdrp;                                        /* lost */
+    return -1;
+    }
+tmxr_txact_ln (lp);                                     /* line has transmit work */
+if (!sim_is_running) {                                  /* attach message or other non simulation time message? */
+    for (i = 0; i < size; i++)                          /* pace it character by character */
+        if (tmxr_putc_ln (lp, buf[i]) != SCPE_OK)
+            break;
+    return i;
+    }
+tmxr_debug_trace_line (lp, "tmxr_write_ln()");
+for (i = 0; i < size; i += run) {
+    if (buffered)
+        avail = size - i;
+    else {
+        avail = TXBUF_AVAIL (lp) - 1;                   /* room for char (+ IAC)? */
+        if (avail <= 0) {
+            ++lp->txstall; lp->xmte = 0;                /* no room, dsbl line */
+            break;
+            }
+        }
+    run = size - i;
+    if (run > avail)
+        run = avail;
+    if (run > lp->txbsz - lp->txbpi)                    /* stop at the end of the buffer */
+        run = lp->txbsz - lp->txbpi;
+    if ((!lp->notelnet) &&                              /* telnet session with */
+        (NULL != (iac = (const uint8 *)memchr (&buf[i], TN_IAC, run)))) {/* IAC in the run? */
+        if (iac == &buf[i]) {                           /* IAC first? */
+            TXBUF_CHAR (lp, TN_IAC);                    /* stuff extra IAC char */
+            TXBUF_CHAR (lp, TN_IAC);
+            run = 1;
+            continue;
+            }
+        run = (int32)(iac - &buf[i]);                   /* copy up to the IAC */
+        }
+    if (buffered) {                                     /* overwriting oldest data? */
+        int32 room = lp->txbsz - 1 - tmxr_tqln (lp);
+
+        if (run > room) {
+            lp->txbpr = (lp->txbpr + run - room) % lp->txbsz;
+            lp->txdrp += run - room;
+            }
+        }
+    memcpy (&lp->txb[lp->txbpi], &buf[i], run);
+    lp->txbpi = (lp->txbpi + run) % lp->txbsz;
+    }
+if (i > 0) {
+    if (((!lp->txbfd) && 
+         (TXBUF_AVAIL (lp) <= TMXR_GUARD)) ||           /* near full? */
+        (lp->txbps))                                    /* or we're rate limiting output */
+        lp->xmte = 0;                                   /* disable line transmit until space available or character time has passed */
+    if (lp->txlog) {                                    /* log if available */
+        extern TMLN *sim_oline;                         /* Make sure to avoid recursion */
+        TMLN *save_oline = sim_oline;                   /* when logging to a socket */
+
+        sim_oline = NULL;                               /* save output socket */
+        fwrite (buf, 1, i, lp->txlog);                  /* log to actual file */
+        sim_oline = save_oline;                         /* resture output socket */
+        }
+    sim_exp_check_buf (&lp->expect, buf, i);            /* process expect rules as needed */
+    }
+return i;
+}
+
 /* Store packet in line buffer
 
    Inputs:
@@ -2192,7 +2509,7 @@ return tmxr_put_packet_ln_ex (lp, buf, size, 0);
 
 t_stat tmxr_put_packet_ln_ex (TMLN *lp, const uint8 *buf, size_t size, uint8 frame_byte)
 {
-t_stat r;
+int32 r;
 size_t fc_size = (frame_byte ? 1 : 0);
 size_t pktlen_size = (lp->datagram ? 0 : 2);
 
@@ -2216,9 +2533,9 @@ lp->txppsize = size + pktlen_size + fc_size;
 lp->txppoffset = 0;
 tmxr_debug (TMXR_DBG_PXMT, lp, "Sending Packet", (char *)&lp->txpb[pktlen_size+fc_size], size);
 ++lp->txpcnt;
-while ((lp->txppoffset < lp->txppsize) && 
-       (SCPE_OK == (r = tmxr_putc_ln (lp, lp->txpb[lp->txppoffset]))))
-   ++lp->txppoffset;
+r = tmxr_write_ln (lp, &lp->txpb[lp->txppoffset], (int32)(lp->txppsize - lp->txppoffset));
+if (r > 0)
+    lp->txppoffset += r;
 tmxr_send_buffered_data (lp);
 return (lp->conn || lp->loopback) ? SCPE_OK : SCPE_LOST;
 }
@@ -2233,27 +2550,42 @@ return (lp->conn || lp->loopback) ? SCPE_OK : SCPE_LOST;
 
 void tmxr_poll_tx (TMXR *mp)
 {
-int32 i, nbytes;
+int32 i, w, words, nbytes;
+uint32 bits;
 TMLN *lp;
 
 tmxr_debug_trace (mp, "tmxr_poll_tx()");
-for (i = 0; i < mp->lines; i++) {                       /* loop thru lines */
-    lp = mp->ldsc + i;                                  /* get line desc */
-    if (!lp->conn)                                      /* skip if !conn */
-        continue;
-    nbytes = tmxr_send_buffered_data (lp);              /* buffered bytes */
-    if (nbytes == 0) {                                  /* buf empty? enab line */
+words = (mp->lines + 31) / 32;
+if (words > mp->txactsz)                                /* first poll or more lines? */
+    tmxr_txact_all (mp);                                /* look at all of them */
+for (w = 0; w < words; w++) {                           /* loop thru active lines */
+    bits = (w < mp->txactsz) ? mp->txact[w] : ~0u;
+    for (i = w * 32; (bits != 0) && (i < mp->lines); i++, bits >>= 1) {
+        if ((bits & 1) == 0)
+            continue;
+        lp = mp->ldsc + i;                              /* get line desc */
+        nbytes = 0;
+        if (lp->conn) {                                 /* skip if !conn */
+            nbytes = tmxr_send_buffered_data (lp);      /* buffered bytes */
+            if (nbytes == 0) {                          /* buf empty? enab line */
 #if defined(SIM_ASYNCH_MUX)
-        UNIT *ruptr = lp->uptr ? lp->uptr : lp->mp->uptr;
-        if ((ruptr->dynflags & UNIT_TM_POLL) &&
-            sim_asynch_enabled &&
-            tmxr_rqln (lp))
-            _sim_activate (ruptr, 0);
+                UNIT *ruptr = lp->uptr ? lp->uptr : lp->mp->uptr;
+                if ((ruptr->dynflags & UNIT_TM_POLL) &&
+                    sim_asynch_enabled &&
+                    tmxr_rqln (lp))
+                    _sim_activate (ruptr, 0);
+                if (tmxr_rqln_bare (lp, FALSE))         /* keep prodding while input waits */
+                    nbytes = -1;
 #endif
-        if ((lp->xmte == 0) && 
-            ((lp->txbps == 0) ||
-             (lp->txnexttime >= sim_gtime ())))
-            lp->xmte = 1;                               /* enable line transmit */
+                if ((lp->xmte == 0) && 
+                    ((lp->txbps == 0) ||
+                     (lp->txnexttime >= sim_gtime ())))
+                    lp->xmte = 1;                       /* enable line transmit */
+                }
+            }
+        if ((!lp->conn || ((nbytes == 0) && (lp->xmte != 0))) &&
+            (w < mp->txactsz))
+            mp->txact[w] &= ~(1u << (i % 32));          /* idle, drop line */
         }
     }                                                   /* end for */
 }
@@ -2270,7 +2602,6 @@ for (i = 0; i < mp->lines; i++) {                       /* loop thru lines */
 int32 tmxr_send_buffered_data (TMLN *lp)
 {
 int32 nbytes, sbytes;
-t_stat r;
 
 tmxr_debug_trace_line (lp, "tmxr_send_buffered_data()");
 nbytes = tmxr_tqln(lp);                                 /* avail bytes */
@@ -2307,10 +2638,12 @@ if (nbytes) {                                           /* >0? write */
             }
         }
     }                                                   /* end if nbytes */
-while ((lp->txppoffset < lp->txppsize) &&               /* buffered packet data? */
-       (lp->txbsz > nbytes) &&                          /* and room in xmt buffer */
-       (SCPE_OK == (r = tmxr_putc_ln (lp, lp->txpb[lp->txppoffset]))))
-   ++lp->txppoffset;
+if ((lp->txppoffset < lp->txppsize) &&                  /* buffered packet data? */
+    (lp->txbsz > nbytes)) {                             /* and room in xmt buffer */
+    sbytes = tmxr_write_ln (lp, &lp->txpb[lp->txppoffset], (int32)(lp->txppsize - lp->txppoffset));
+    if (sbytes > 0)
+        lp->txppoffset += sbytes;
+    }
 if ((nbytes == 0) && (tmxr_tqln(lp) > 0))
     return tmxr_send_buffered_data (lp);
 return tmxr_tqln(lp) + tmxr_tpqln(lp);
@@ -2341,7 +2674,7 @@ return (0 != (lp->txppsize - lp->txppoffset));
 static void _mux_detach_line (TMLN *lp, t_bool close_listener, t_bool close_connecting)
 {
 if (close_listener && lp->master) {
-    sim_close_sock (lp->master);
+    _tmxr_close_sock (lp->master);
     lp->master = 0;
     free (lp->port);
     lp->port = NULL;
@@ -2362,7 +2695,7 @@ if (close_connecting) {
 if (lp->serport) {                          /* close current serial connection */
     tmxr_reset_ln (lp);
     sim_control_serial (lp->serport, 0, TMXR_MDM_DTR|TMXR_MDM_RTS, NULL);/* drop DTR and RTS */
-    sim_close_serial (lp->serport);
+    _tmxr_close_serial (lp->serport);
     lp->serport = 0;
     free (lp->serconfig);
     lp->serconfig = NULL;
@@ -2762,7 +3095,7 @@ while (*tptr) {
             if (sock == INVALID_SOCKET)                     /* open error */
                 return sim_messagef (SCPE_OPENERR, "Can't open network socket for listen port: %s\n", listen);
             if (mp->port) {                                 /* close prior listener */
-                sim_close_sock (mp->master);
+                _tmxr_close_sock (mp->master);
                 mp->master = 0;
                 free (mp->port);
                 mp->port = NULL;
@@ -2771,6 +3104,7 @@ while (*tptr) {
             mp->port = (char *)realloc (mp->port, 1 + strlen (listen));
             strcpy (mp->port, listen);                      /* save port */
             mp->master = sock;                              /* save master socket */
+            _tmxr_watch_master (mp);
             mp->ring_sock = INVALID_SOCKET;
             free (mp->ring_ipad);
             mp->ring_ipad = NULL;
@@ -2784,7 +3118,7 @@ while (*tptr) {
                 if (lp->serport) {                          /* serial port attached? */
                     tmxr_reset_ln (lp);                     /* close current serial connection */
                     sim_control_serial (lp->serport, 0, TMXR_MDM_DTR|TMXR_MDM_RTS, NULL);/* drop DTR and RTS */
-                    sim_close_serial (lp->serport);
+                    _tmxr_close_serial (lp->serport);
                     lp->serport = 0;
                     free (lp->serconfig);
                     lp->serconfig = NULL;
@@ -2816,7 +3150,7 @@ while (*tptr) {
             if (serport != INVALID_HANDLE) {
                 _mux_detach_line (lp, TRUE, TRUE);
                 if (lp->mp && lp->mp->master) {             /* if existing listener, close it */
-                    sim_close_sock (lp->mp->master);
+                    _tmxr_close_sock (lp->mp->master);
                     lp->mp->master = 0;
                     free (lp->mp->port);
                     lp->mp->port = NULL;
@@ -2825,6 +3159,7 @@ while (*tptr) {
                 strcpy (lp->destination, destination);
                 lp->mp = mp;
                 lp->serport = serport;
+                _tmxr_watch_line (lp);
                 lp->ser_connect_pending = TRUE;
                 lp->notelnet = TRUE;
                 tmxr_init_line (lp);                        /* init the line state */
@@ -2853,6 +3188,7 @@ while (*tptr) {
                     lp->mp = mp;
                     if (!lp->modem_control || (lp->modembits & TMXR_MDM_DTR)) {
                         lp->connecting = sock;
+                        _tmxr_watch_line (lp);
                         lp->ipad = (char *)malloc (1 + strlen (lp->destination));
                         strcpy (lp->ipad, lp->destination);
                         }
@@ -2920,6 +3256,7 @@ while (*tptr) {
             lp->port = (char *)realloc (lp->port, 1 + strlen (listen));
             strcpy (lp->port, listen);                       /* save port */
             lp->master = sock;                              /* save master socket */
+            _tmxr_watch_line (lp);
             if (listennotelnet != mp->notelnet)
                 lp->notelnet = listennotelnet;
             else
@@ -2932,6 +3269,7 @@ while (*tptr) {
                 lp->destination = (char *)malloc(1+strlen(destination));
                 strcpy (lp->destination, destination);
                 lp->serport = serport;
+                _tmxr_watch_line (lp);
                 lp->ser_connect_pending = TRUE;
                 lp->notelnet = TRUE;
                 tmxr_init_line (lp);                        /* init the line state */
@@ -2958,6 +3296,7 @@ while (*tptr) {
                     strcpy (lp->destination, hostport);
                     if (!lp->modem_control || (lp->modembits & TMXR_MDM_DTR)) {
                         lp->connecting = sock;
+                        _tmxr_watch_line (lp);
                         lp->ipad = (char *)malloc (1 + strlen (lp->destination));
                         strcpy (lp->ipad, lp->destination);
                         }
@@ -3011,6 +3350,7 @@ t_stat tmxr_set_line_unit (TMXR *mp, int line, UNIT *uptr_poll)
 if ((line < 0) || (line >= mp->lines))
     return SCPE_ARG;
 mp->ldsc[line].uptr = uptr_poll;
+_tmxr_watch_line (&mp->ldsc[line]);                     /* re-resolve its poll unit */
 return SCPE_OK;
 }
 
@@ -3088,15 +3428,249 @@ pthread_cond_t      sim_tmxr_startup_cond;
 int32               sim_tmxr_poll_count = 0;
 t_bool              sim_tmxr_poll_running = FALSE;
 
+/* The poll thread's interest set.  A socket is added to the set when it
+   is opened or connected (_tmxr_poll_watch) and removed when it is closed
+   (_tmxr_poll_forget, called by _tmxr_close_sock), so the set only
+   changes when connections do.  The thread brings the kernel's view up to
+   date only after such a change, so an unchanged set of connections costs
+   no system calls beyond the wait itself, the wait reports only the
+   sockets which are ready, and there is no FD_SETSIZE ceiling on the
+   number of sockets watched.  epoll is used when available (HAVE_EPOLL)
+   and poll() otherwise.
+
+   The unit activated for a socket is resolved when the set is brought up
+   to date (a line's own unit, or the mux's unit), so a line unit declared
+   after the socket was opened is picked up.
+*/
+
+#if defined(HAVE_EPOLL)
+#include <sys/epoll.h>
+#endif
+
+typedef struct {
+    SOCKET      sock;
+    TMXR        *mp;                            /* mux owning the socket */
+    TMLN        *lp;                            /* line when activating its unit */
+    UNIT        *uptr;                          /* unit registered to activate */
+    t_bool      registered;                     /* known to the kernel */
+    } TMXR_POLL_SOCK;
+
+static TMXR_POLL_SOCK *tmxr_poll_socks = NULL;  /* sockets of interest */
+static int tmxr_poll_sock_count = 0;
+static int tmxr_poll_sock_size = 0;
+static t_bool tmxr_poll_changed = FALSE;        /* set changed since registered */
+static int tmxr_poll_registered = 0;            /* sockets registered */
+static UNIT **tmxr_poll_activated = NULL;       /* units activated by last pass */
+static int tmxr_poll_size = 0;                  /* allocated poll thread list sizes */
+#if defined(HAVE_EPOLL)
+static int tmxr_poll_epfd = -1;
+static struct epoll_event *tmxr_poll_events = NULL;
+#else
+static struct pollfd *tmxr_poll_fds = NULL;
+static UNIT **tmxr_poll_fd_units = NULL;        /* unit for each tmxr_poll_fds entry */
+#endif
+
+static UNIT *_tmxr_poll_unit (const TMXR_POLL_SOCK *ps)
+{
+if (ps->lp && ps->lp->uptr)
+    return ps->lp->uptr;
+if ((ps->sock == ps->mp->master) &&             /* mux listener only for a polling unit */
+    ((ps->mp->uptr == NULL) || !(ps->mp->uptr->dynflags & UNIT_TM_POLL)))
+    return NULL;
+return ps->mp->uptr;
+}
+
+/* Note that a socket is of interest (lp is NULL for sockets which activate
+   the mux's unit) */
+
+static void _tmxr_poll_watch (SOCKET sock, TMXR *mp, TMLN *lp)
+{
+int i;
+
+if ((sock == 0) || (sock == INVALID_SOCKET))
+    return;
+pthread_mutex_lock (&sim_tmxr_poll_lock);
+for (i=0; i<tmxr_poll_sock_count; ++i)
+    if (tmxr_poll_socks[i].sock == sock)
+        break;
+if (i == tmxr_poll_sock_count) {
+    if (tmxr_poll_sock_count == tmxr_poll_sock_size) {
+        int size = tmxr_poll_sock_size ? 2 * tmxr_poll_sock_size : 64;
+
+        tmxr_poll_socks = (TMXR_POLL_SOCK *)realloc (tmxr_poll_socks, size * sizeof (*tmxr_poll_socks));
+        if (tmxr_poll_socks == NULL) {
+            sim_printf ("_tmxr_poll_watch() - out of memory watching %d sockets\r\n", size);
+            abort();
+            }
+        tmxr_poll_sock_size = size;
+        }
+    tmxr_poll_socks[i].sock = sock;
+    tmxr_poll_socks[i].uptr = NULL;
+    tmxr_poll_socks[i].registered = FALSE;
+    ++tmxr_poll_sock_count;
+    }
+tmxr_poll_socks[i].mp = mp;
+tmxr_poll_socks[i].lp = lp;
+tmxr_poll_changed = TRUE;
+pthread_mutex_unlock (&sim_tmxr_poll_lock);
+}
+
+/* Note that a socket is being closed.  Closing it removes it from an
+   epoll set. */
+
+static void _tmxr_poll_forget (SOCKET sock)
+{
+int i;
+
+pthread_mutex_lock (&sim_tmxr_poll_lock);
+for (i=0; i<tmxr_poll_sock_count; ++i)
+    if (tmxr_poll_socks[i].sock == sock) {
+        tmxr_poll_socks[i] = tmxr_poll_socks[--tmxr_poll_sock_count];
+        tmxr_poll_changed = TRUE;
+        break;
+        }
+pthread_mutex_unlock (&sim_tmxr_poll_lock);
+}
+
+#if defined(HAVE_EPOLL)
+static void _tmxr_poll_ctl (int op, TMXR_POLL_SOCK *ps)
+{
+struct epoll_event ev;
+
+memset (&ev, 0, sizeof (ev));
+ev.events = EPOLLIN;                            /* errors and hangups are implied */
+ev.data.ptr = ps->uptr;
+if (0 == epoll_ctl (tmxr_poll_epfd, op, ps->sock, &ev))
+    return;
+if ((op == EPOLL_CTL_ADD) && (errno == EEXIST))
+    epoll_ctl (tmxr_poll_epfd, EPOLL_CTL_MOD, ps->sock, &ev);
+if ((op == EPOLL_CTL_MOD) && (errno == ENOENT))
+    epoll_ctl (tmxr_poll_epfd, EPOLL_CTL_ADD, ps->sock, &ev);
+}
+#endif
+
+/* Bring the registered set up to date after a change (called holding
+   sim_tmxr_poll_lock) */
+
+static void _tmxr_poll_register (void)
+{
+int i;
+
+if (!tmxr_poll_changed)
+    return;
+if (tmxr_poll_sock_count > tmxr_poll_size) {
+    int size = tmxr_poll_sock_size;
+
+    tmxr_poll_activated = (UNIT **)realloc (tmxr_poll_activated, size * sizeof (*tmxr_poll_activated));
+#if defined(HAVE_EPOLL)
+    tmxr_poll_events = (struct epoll_event *)realloc (tmxr_poll_events, size * sizeof (*tmxr_poll_events));
+    if ((tmxr_poll_events == NULL) ||
+#else
+    tmxr_poll_fds = (struct pollfd *)realloc (tmxr_poll_fds, size * sizeof (*tmxr_poll_fds));
+    tmxr_poll_fd_units = (UNIT **)realloc (tmxr_poll_fd_units, size * sizeof (*tmxr_poll_fd_units));
+    if ((tmxr_poll_fds == NULL) || (tmxr_poll_fd_units == NULL) ||
+#endif
+        (tmxr_poll_activated == NULL)) {
+        sim_printf ("_tmxr_poll() - out of memory watching %d sockets\r\n", size);
+        abort();
+        }
+    tmxr_poll_size = size;
+    }
+tmxr_poll_registered = 0;
+for (i=0; i<tmxr_poll_sock_count; ++i) {
+    TMXR_POLL_SOCK *ps = &tmxr_poll_socks[i];
+    UNIT *uptr = _tmxr_poll_unit (ps);
+
+#if defined(HAVE_EPOLL)
+    if (uptr == NULL) {                         /* no unit to activate (yet)? */
+        if (ps->registered)
+            epoll_ctl (tmxr_poll_epfd, EPOLL_CTL_DEL, ps->sock, NULL);
+        ps->registered = FALSE;
+        continue;
+        }
+    if ((!ps->registered) || (ps->uptr != uptr)) {
+        ps->uptr = uptr;
+        _tmxr_poll_ctl (ps->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, ps);
+        ps->registered = TRUE;
+        }
+#else
+    if (uptr == NULL)
+        continue;
+    ps->uptr = uptr;
+    tmxr_poll_fds[tmxr_poll_registered].fd = ps->sock;
+    tmxr_poll_fds[tmxr_poll_registered].events = POLLIN;
+    tmxr_poll_fds[tmxr_poll_registered].revents = 0;
+    tmxr_poll_fd_units[tmxr_poll_registered] = uptr;
+#endif
+    ++tmxr_poll_registered;
+    }
+tmxr_poll_changed = FALSE;
+}
+
+/* Release the poll thread's resources when it exits.  The interest set
+   itself remains for the next time the thread runs. */
+
+static void _tmxr_poll_release (void)
+{
+int i;
+
+#if defined(HAVE_EPOLL)
+if (tmxr_poll_epfd != -1)
+    close (tmxr_poll_epfd);
+tmxr_poll_epfd = -1;
+free (tmxr_poll_events);
+tmxr_poll_events = NULL;
+#else
+free (tmxr_poll_fds);
+tmxr_poll_fds = NULL;
+free (tmxr_poll_fd_units);
+tmxr_poll_fd_units = NULL;
+#endif
+free (tmxr_poll_activated);
+tmxr_poll_activated = NULL;
+tmxr_poll_size = tmxr_poll_registered = 0;
+for (i=0; i<tmxr_poll_sock_count; ++i)
+    tmxr_poll_socks[i].registered = FALSE;
+tmxr_poll_changed = TRUE;
+}
+
+/* Activate a unit which has a ready socket (called holding sim_tmxr_poll_lock) */
+
+static int _tmxr_poll_activate (UNIT *uptr, int wait_count)
+{
+UNIT **activated = tmxr_poll_activated;
+DEVICE *d;
+int j;
+
+/* More than one socket can be associated with the 
+   same unit.  Only activate one time */
+for (j=0; j<wait_count; ++j)
+    if (activated[j] == uptr)
+        return wait_count;
+activated[j] = uptr;
+++wait_count;
+if (!activated[j]->a_polling_now) {
+    activated[j]->a_polling_now = TRUE;
+    activated[j]->a_poll_waiter_count = 1;
+    d = find_dev_from_unit(activated[j]);
+    sim_debug (TMXR_DBG_ASY, d, "_tmxr_poll() - Activating for data %s\n", sim_uname(activated[j]));
+    pthread_mutex_unlock (&sim_tmxr_poll_lock);
+    _sim_activate (activated[j], 0);
+    pthread_mutex_lock (&sim_tmxr_poll_lock);
+    }
+else {
+    d = find_dev_from_unit(activated[j]);
+    sim_debug (TMXR_DBG_ASY, d, "_tmxr_poll() - Already Activated %s %d times\n", sim_uname(activated[j]), activated[j]->a_poll_waiter_count);
+    ++activated[j]->a_poll_waiter_count;
+    }
+return wait_count;
+}
+
 static void *
 _tmxr_poll(void *arg)
 {
-struct timeval timeout;
 int timeout_usec;
 DEVICE *dptr = tmxr_open_devices[0]->dptr;
-UNIT **units = NULL;
-UNIT **activated = NULL;
-SOCKET *sockets = NULL;
 int wait_count = 0;
 
 /* Boost Priority for this I/O thread vs the CPU instruction execution 
@@ -3106,25 +3680,29 @@ sim_os_set_thread_priority (PRIORITY_ABOVE_NORMAL);
 
 sim_debug (TMXR_DBG_ASY, dptr, "_tmxr_poll() - starting\n");
 
-units = (UNIT **)calloc(FD_SETSIZE, sizeof(*units));
-activated = (UNIT **)calloc(FD_SETSIZE, sizeof(*activated));
-sockets = (SOCKET *)calloc(FD_SETSIZE, sizeof(*sockets));
+#if defined(HAVE_EPOLL)
+tmxr_poll_epfd = epoll_create (64);             /* size is only a hint */
+if (tmxr_poll_epfd == -1) {
+    sim_printf ("epoll_create() failed, errno=%d - %s\r\n", errno, strerror(errno));
+    abort();
+    }
+#endif
 timeout_usec = 1000000;
 pthread_mutex_lock (&sim_tmxr_poll_lock);
 pthread_cond_signal (&sim_tmxr_startup_cond);   /* Signal we're ready to go */
 while (sim_asynch_enabled) {
     int i, j, status, select_errno;
-    fd_set readfds, errorfds;
     int socket_count;
-    SOCKET max_socket_fd;
     TMXR *mp;
     DEVICE *d;
 
     if ((tmxr_open_device_count == 0) || (!sim_is_running)) {
         for (j=0; j<wait_count; ++j) {
-            d = find_dev_from_unit(activated[j]);
-            sim_debug (TMXR_DBG_ASY, d, "_tmxr_poll() - Removing interest in %s. Other interest: %d\n", sim_uname(activated[j]), activated[j]->a_poll_waiter_count);
-            --activated[j]->a_poll_waiter_count;
+            UNIT *uptr = tmxr_poll_activated[j];
+
+            d = find_dev_from_unit(uptr);
+            sim_debug (TMXR_DBG_ASY, d, "_tmxr_poll() - Removing interest in %s. Other interest: %d\n", sim_uname(uptr), uptr->a_poll_waiter_count);
+            --uptr->a_poll_waiter_count;
             --sim_tmxr_poll_count;
             }
         break;
@@ -3135,82 +3713,28 @@ while (sim_asynch_enabled) {
         pthread_cond_wait (&sim_tmxr_poll_cond, &sim_tmxr_poll_lock);
         sim_debug (TMXR_DBG_ASY, dptr, "_tmxr_poll() - continuing with timeout of %dms\n", timeout_usec/1000);
         }
-    FD_ZERO (&readfds);
-    FD_ZERO (&errorfds);
-    for (i=max_socket_fd=socket_count=0; i<tmxr_open_device_count; ++i) {
-        mp = tmxr_open_devices[i];
-        if ((mp->master) && (mp->uptr->dynflags&UNIT_TM_POLL)) {
-            units[socket_count] = mp->uptr;
-            sockets[socket_count] = mp->master;
-            FD_SET (mp->master, &readfds);
-            FD_SET (mp->master, &errorfds);
-            if (mp->master > max_socket_fd)
-                max_socket_fd = mp->master;
-            ++socket_count;
-            }
-        for (j=0; j<mp->lines; ++j) {
-            if (mp->ldsc[j].sock) {
-                units[socket_count] = mp->ldsc[j].uptr;
-                if (units[socket_count] == NULL)
-                    units[socket_count] = mp->uptr;
-                sockets[socket_count] = mp->ldsc[j].sock;
-                FD_SET (mp->ldsc[j].sock, &readfds);
-                FD_SET (mp->ldsc[j].sock, &errorfds);
-                if (mp->ldsc[j].sock > max_socket_fd)
-                    max_socket_fd = mp->ldsc[j].sock;
-                ++socket_count;
-                }
-#if !defined(_WIN32) && !defined(VMS)
-            if (mp->ldsc[j].serport) {
-                units[socket_count] = mp->ldsc[j].uptr;
-                if (units[socket_count] == NULL)
-                    units[socket_count] = mp->uptr;
-                sockets[socket_count] = mp->ldsc[j].serport;
-                FD_SET (mp->ldsc[j].serport, &readfds);
-                FD_SET (mp->ldsc[j].serport, &errorfds);
-                if (mp->ldsc[j].serport > max_socket_fd)
-                    max_socket_fd = mp->ldsc[j].serport;
-                ++socket_count;
-                }
-#endif
-            if (mp->ldsc[j].connecting) {
-                units[socket_count] = mp->uptr;
-                sockets[socket_count] = mp->ldsc[j].connecting;
-                FD_SET (mp->ldsc[j].connecting, &readfds);
-                FD_SET (mp->ldsc[j].connecting, &errorfds);
-                if (mp->ldsc[j].connecting > max_socket_fd)
-                    max_socket_fd = mp->ldsc[j].connecting;
-                ++socket_count;
-                }
-            if (mp->ldsc[j].master) {
-                units[socket_count] = mp->uptr;
-                sockets[socket_count] = mp->ldsc[j].master;
-                FD_SET (mp->ldsc[j].master, &readfds);
-                FD_SET (mp->ldsc[j].master, &errorfds);
-                if (mp->ldsc[j].master > max_socket_fd)
-                    max_socket_fd = mp->ldsc[j].master;
-                ++socket_count;
-                }
-            }
-        }
+    _tmxr_poll_register ();
+    socket_count = tmxr_poll_registered;
     pthread_mutex_unlock (&sim_tmxr_poll_lock);
     if (timeout_usec > 1000000)
         timeout_usec = 1000000;
-    timeout.tv_sec = timeout_usec/1000000;
-    timeout.tv_usec = timeout_usec%1000000;
     select_errno = 0;
     if (socket_count == 0) {
         sim_os_ms_sleep (timeout_usec/1000);
         status = 0;
         }
     else
-        status = select (1+(int)max_socket_fd, &readfds, NULL, &errorfds, &timeout);
+#if defined(HAVE_EPOLL)
+        status = epoll_wait (tmxr_poll_epfd, tmxr_poll_events, socket_count, timeout_usec/1000);
+#else
+        status = poll (tmxr_poll_fds, socket_count, timeout_usec/1000);
+#endif
     select_errno = errno;
     wait_count=0;
     pthread_mutex_lock (&sim_tmxr_poll_lock);
     switch (status) {
         case 0:     /* timeout */
-            for (i=max_socket_fd=socket_count=0; i<tmxr_open_device_count; ++i) {
+            for (i=0; i<tmxr_open_device_count; ++i) {
                 mp = tmxr_open_devices[i];
                 if (mp->master) {
                     if (!mp->uptr->a_polling_now) {
@@ -3254,49 +3778,27 @@ while (sim_asynch_enabled) {
             wait_count = 0;
             if (select_errno == EINTR)
                 break;
-            sim_printf ("select() returned -1, errno=%d - %s\r\n", select_errno, strerror(select_errno));
+            sim_printf ("_tmxr_poll() wait returned -1, errno=%d - %s\r\n", select_errno, strerror(select_errno));
             abort();
             break;
         default:
             wait_count = 0;
-            for (i=0; i<socket_count; ++i) {
-                if (FD_ISSET(sockets[i], &readfds) || 
-                    FD_ISSET(sockets[i], &errorfds)) {
-                    /* More than one socket can be associated with the 
-                       same unit.  Only activate one time */
-                    for (j=0; j<wait_count; ++j)
-                        if (activated[j] == units[i])
-                            break;
-                    if (j == wait_count) {
-                        activated[j] = units[i];
-                        ++wait_count;
-                        if (!activated[j]->a_polling_now) {
-                            activated[j]->a_polling_now = TRUE;
-                            activated[j]->a_poll_waiter_count = 1;
-                            d = find_dev_from_unit(activated[j]);
-                            sim_debug (TMXR_DBG_ASY, d, "_tmxr_poll() - Activating for data %s\n", sim_uname(activated[j]));
-                            pthread_mutex_unlock (&sim_tmxr_poll_lock);
-                            _sim_activate (activated[j], 0);
-                            pthread_mutex_lock (&sim_tmxr_poll_lock);
-                            }
-                        else {
-                            d = find_dev_from_unit(activated[j]);
-                            sim_debug (TMXR_DBG_ASY, d, "_tmxr_poll() - Already Activated %s%d %d times\n", sim_uname(activated[j]), activated[j]->a_poll_waiter_count);
-                            ++activated[j]->a_poll_waiter_count;
-                            }
-                        }
-                    }
-                }
+#if defined(HAVE_EPOLL)
+            for (i=0; i<status; ++i)
+                wait_count = _tmxr_poll_activate ((UNIT *)tmxr_poll_events[i].data.ptr, wait_count);
+#else
+            for (i=0; i<socket_count; ++i)
+                if (tmxr_poll_fds[i].revents)
+                    wait_count = _tmxr_poll_activate (tmxr_poll_fd_units[i], wait_count);
+#endif
             if (wait_count)
                 timeout_usec = 10000; /* Wait 10ms next time */
             break;
         }
     sim_tmxr_poll_count += wait_count;
     }
+_tmxr_poll_release ();
 pthread_mutex_unlock (&sim_tmxr_poll_lock);
-free(units);
-free(activated);
-free(sockets);
 
 sim_debug (TMXR_DBG_ASY, dptr, "_tmxr_poll() - exiting\n");
 
@@ -3953,7 +4455,7 @@ for (i = 0; i < mp->lines; i++) {  /* loop thru conn */
         lp->conn = FALSE;
         }
     if (lp->master) {
-        sim_close_sock (lp->master);                    /* close master socket */
+        _tmxr_close_sock (lp->master);                    /* close master socket */
         lp->master = 0;
         free (lp->port);
         lp->port = NULL;
@@ -3969,10 +4471,13 @@ for (i = 0; i < mp->lines; i++) {  /* loop thru conn */
     }
 
 if (mp->master)
-    sim_close_sock (mp->master);                        /* close master socket */
+    _tmxr_close_sock (mp->master);                        /* close master socket */
 mp->master = 0;
 free (mp->port);
 mp->port = NULL;
+free (mp->txact);
+mp->txact = NULL;
+mp->txactsz = 0;
 if (mp->ring_sock != INVALID_SOCKET) {
     sim_close_sock (mp->ring_sock);
     mp->ring_sock = INVALID_SOCKET;
@@ -4020,6 +4525,8 @@ TMXR *mp = (TMXR *)uptr->tmxr;
 int32 i, sooner = interval, due;
 double sim_gtime_now = sim_gtime ();
 
+if (mp == NULL)                         /* polled without a mux (asynch console)? */
+    return interval;
 for (i=0; i<mp->lines; i++) {
     TMLN *lp = &mp->ldsc[i];
 
@@ -4093,7 +4600,6 @@ sooner = _tmxr_activate_delay (uptr, 0x7FFFFFFF);
 #if defined(SIM_ASYNCH_MUX)
 if (!sim_asynch_enabled)
     return _sim_activate_after (uptr, (double)usecs_walltime);
-    }
 return SCPE_OK;
 #else
 return _sim_activate_after (uptr, (double)usecs_walltime);
@@ -4137,7 +4643,7 @@ if (sooner != interval) {
 #if defined(SIM_ASYNCH_MUX)
 if (!sim_asynch_enabled) {
     sim_debug (TIMER_DBG_MUX, &sim_timer_dev, "coscheduling %s after interval %d ticks\n", sim_uname (uptr), ticks);
-    return sim_clock_coschedule (uptr, tmr, ticks);
+    return sim_clock_coschedule_tmr (uptr, tmr, ticks);
     }
 return SCPE_OK;
 #else
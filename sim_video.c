@@ -29,6 +29,9 @@
 
 #include "sim_video.h"
 #include "scp.h"
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#endif
 
 t_bool vid_active = FALSE;
 int32 vid_cursor_x;
@@ -49,6 +52,44 @@ t_stat vid_show (FILE* st, DEVICE *dptr,  UNIT* uptr, int32 val, CONST char* des
 return vid_show_video (st, uptr, val, desc);
 }
 
+/* Expand a scanline of 1bpp pixels into 32bpp pixels
+
+   Inputs:
+        *dst    =       output pixels
+        *src    =       input bits, pixel n in bit (n & 0x1F) of src[n >> 5]
+        pixels  =       pixel count
+        *palette =      colors for 0 and 1 bits
+*/
+
+void vid_expand_1bpp (uint32 *dst, const uint32 *src, uint32 pixels, const uint32 *palette)
+{
+uint32 i, j, bits;
+#if defined (__SSE2__)
+const __m128i mask = _mm_set_epi32 (8, 4, 2, 1);        /* bit for each lane */
+const __m128i bg = _mm_set1_epi32 (palette[0]);
+const __m128i fg = _mm_set1_epi32 (palette[1]);
+__m128i sel;
+
+for (i = 0; (i + 32) <= pixels; i += 32) {              /* 4 pixels at a time */
+    bits = src[i >> 5];
+    for (j = 0; j < 32; j += 4) {
+        sel = _mm_and_si128 (_mm_set1_epi32 (bits >> j), mask);
+        sel = _mm_cmpeq_epi32 (sel, mask);              /* all ones where bit set */
+        _mm_storeu_si128 ((__m128i *)(dst + i + j),
+                          _mm_or_si128 (_mm_and_si128 (sel, fg), _mm_andnot_si128 (sel, bg)));
+        }
+    }
+#else
+for (i = 0; (i + 32) <= pixels; i += 32) {              /* a word at a time */
+    bits = src[i >> 5];
+    for (j = 0; j < 32; j++, bits >>= 1)
+        dst[i + j] = palette[bits & 1];
+    }
+#endif
+for ( ; i < pixels; i++)                                /* partial word */
+    dst[i] = palette[(src[i >> 5] >> (i & 0x1F)) & 1];
+}
+
 #if defined(USE_SIM_VIDEO) && defined(HAVE_LIBSDL)
 
 char vid_release_key[64] = "Ctrl-Right-Shift";
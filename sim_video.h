@@ -184,6 +184,7 @@ t_stat vid_close (void);
 t_stat vid_poll_kb (SIM_KEY_EVENT *ev);
 t_stat vid_poll_mouse (SIM_MOUSE_EVENT *ev);
 void vid_draw (int32 x, int32 y, int32 w, int32 h, uint32 *buf);
+void vid_expand_1bpp (uint32 *dst, const uint32 *src, uint32 pixels, const uint32 *palette);
 void vid_beep (void);
 void vid_refresh (void);
 const char *vid_version (void);